@@ -1,10 +1,35 @@
 #pragma once
 
-#include <unordered_map>
-#include <algorithm>
+#include <stdio.h>
+#include "PointerMap.h"
+
+class AddressLookupTableObject;
 
 constexpr UINT MaxIndex = 11;
 
+template <typename T>
+struct AddressCacheIndex { static constexpr UINT CacheIndex = 0; };
+template <>
+struct AddressCacheIndex<m_IDirect3D8> { static constexpr UINT CacheIndex = 1; };
+template <>
+struct AddressCacheIndex<m_IDirect3DDevice8> { static constexpr UINT CacheIndex = 2; };
+template <>
+struct AddressCacheIndex<m_IDirect3DCubeTexture8> { static constexpr UINT CacheIndex = 3; };
+template <>
+struct AddressCacheIndex<m_IDirect3DIndexBuffer8> { static constexpr UINT CacheIndex = 4; };
+template <>
+struct AddressCacheIndex<m_IDirect3DSurface8> { static constexpr UINT CacheIndex = 5; };
+template <>
+struct AddressCacheIndex<m_IDirect3DSwapChain8> { static constexpr UINT CacheIndex = 6; };
+template <>
+struct AddressCacheIndex<m_IDirect3DTexture8> { static constexpr UINT CacheIndex = 7; };
+template <>
+struct AddressCacheIndex<m_IDirect3DVertexBuffer8> { static constexpr UINT CacheIndex = 8; };
+template <>
+struct AddressCacheIndex<m_IDirect3DVolume8> { static constexpr UINT CacheIndex = 9; };
+template <>
+struct AddressCacheIndex<m_IDirect3DVolumeTexture8> { static constexpr UINT CacheIndex = 10; };
+
 template <typename D>
 class AddressLookupTable
 {
@@ -14,38 +39,14 @@ public:
 	{
 		ConstructorFlag = true;
 
+		ReportLeaks();
+
 		for (const auto& cache : g_map)
 		{
-			for (const auto& entry : cache)
-			{
-				entry.second->DeleteMe();
-			}
+			cache.ForEach([](const void *, auto *Wrapper) { Wrapper->DeleteMe(); });
 		}
 	}
 
-	template <typename T>
-	struct AddressCacheIndex { static constexpr UINT CacheIndex = 0; };
-	template <>
-	struct AddressCacheIndex<m_IDirect3D8> { static constexpr UINT CacheIndex = 1; };
-	template <>
-	struct AddressCacheIndex<m_IDirect3DDevice8> { static constexpr UINT CacheIndex = 2; };
-	template <>
-	struct AddressCacheIndex<m_IDirect3DCubeTexture8> { static constexpr UINT CacheIndex = 3; };
-	template <>
-	struct AddressCacheIndex<m_IDirect3DIndexBuffer8> { static constexpr UINT CacheIndex = 4; };
-	template <>
-	struct AddressCacheIndex<m_IDirect3DSurface8> { static constexpr UINT CacheIndex = 5; };
-	template <>
-	struct AddressCacheIndex<m_IDirect3DSwapChain8> { static constexpr UINT CacheIndex = 6; };
-	template <>
-	struct AddressCacheIndex<m_IDirect3DTexture8> { static constexpr UINT CacheIndex = 7; };
-	template <>
-	struct AddressCacheIndex<m_IDirect3DVertexBuffer8> { static constexpr UINT CacheIndex = 8; };
-	template <>
-	struct AddressCacheIndex<m_IDirect3DVolume8> { static constexpr UINT CacheIndex = 9; };
-	template <>
-	struct AddressCacheIndex<m_IDirect3DVolumeTexture8> { static constexpr UINT CacheIndex = 10; };
-
 	template <typename T>
 	T *FindAddress(void *Proxy)
 	{
@@ -55,48 +56,97 @@ public:
 		}
 
 		constexpr UINT CacheIndex = AddressCacheIndex<T>::CacheIndex;
-		auto it = g_map[CacheIndex].find(Proxy);
+		AddressLookupTableObject **pWrapper = g_map[CacheIndex].Find(Proxy);
 
-		if (it != std::end(g_map[CacheIndex]))
+		if (pWrapper)
 		{
-			return static_cast<T *>(it->second);
+			return static_cast<T *>(*pWrapper);
 		}
 
 		return new T(static_cast<T *>(Proxy), pDevice);
 	}
 
+	// The wrapper saved for a proxy, nullptr instead of creating one
+	template <typename T>
+	T *FindSavedAddress(void *Proxy)
+	{
+		if (!Proxy)
+		{
+			return nullptr;
+		}
+
+		constexpr UINT CacheIndex = AddressCacheIndex<T>::CacheIndex;
+		AddressLookupTableObject **pWrapper = g_map[CacheIndex].Find(Proxy);
+
+		return pWrapper ? static_cast<T *>(*pWrapper) : nullptr;
+	}
+
 	template <typename T>
 	void SaveAddress(T *Wrapper, void *Proxy)
 	{
 		constexpr UINT CacheIndex = AddressCacheIndex<T>::CacheIndex;
 		if (Wrapper && Proxy)
 		{
-			g_map[CacheIndex][Proxy] = Wrapper;
+			g_map[CacheIndex].Insert(Proxy, Wrapper);
 		}
 	}
 
+	// Proxy is the key the wrapper was saved under, the wrapper's own proxy or one of its renames
 	template <typename T>
-	void DeleteAddress(T *Wrapper)
+	void DeleteAddress(T *Wrapper, void *Proxy)
 	{
-		if (!Wrapper || ConstructorFlag)
+		if (!Wrapper || !Proxy || ConstructorFlag)
 		{
 			return;
 		}
 
 		constexpr UINT CacheIndex = AddressCacheIndex<T>::CacheIndex;
-		auto it = std::find_if(g_map[CacheIndex].begin(), g_map[CacheIndex].end(),
-			[=](auto Map) -> bool { return Map.second == Wrapper; });
+		AddressLookupTableObject **pWrapper = g_map[CacheIndex].Find(Proxy);
 
-		if (it != std::end(g_map[CacheIndex]))
+		if (pWrapper && *pWrapper == Wrapper)
 		{
-			it = g_map[CacheIndex].erase(it);
+			g_map[CacheIndex].Erase(Proxy);
+		}
+	}
+
+	// Deletes the wrapper saved for a proxy, for wrappers owned by another one such as the levels of a texture
+	template <typename T>
+	void DeleteSavedAddress(void *Proxy)
+	{
+		// The table deletes every wrapper itself when it goes
+		if (ConstructorFlag)
+		{
+			return;
+		}
+
+		T *Wrapper = FindSavedAddress<T>(Proxy);
+		if (Wrapper)
+		{
+			Wrapper->DeleteMe();
 		}
 	}
 
 private:
+	void ReportLeaks() const
+	{
+		static constexpr const char *Names[MaxIndex] = { "unknown", "IDirect3D8", "IDirect3DDevice8", "IDirect3DCubeTexture8",
+			"IDirect3DIndexBuffer8", "IDirect3DSurface8", "IDirect3DSwapChain8", "IDirect3DTexture8",
+			"IDirect3DVertexBuffer8", "IDirect3DVolume8", "IDirect3DVolumeTexture8" };
+
+		for (UINT x = 0; x < MaxIndex; x++)
+		{
+			if (g_map[x].Size())
+			{
+				char Message[128];
+				sprintf_s(Message, "d3d8: %u %s wrapper(s) still referenced at device release\n", (UINT)g_map[x].Size(), Names[x]);
+				OutputDebugStringA(Message);
+			}
+		}
+	}
+
 	bool ConstructorFlag = false;
 	D *const pDevice;
-	std::unordered_map<void*, class AddressLookupTableObject*> g_map[MaxIndex];
+	PointerMap<AddressLookupTableObject*> g_map[MaxIndex];
 };
 
 class AddressLookupTableObject
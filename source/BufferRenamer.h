@@ -0,0 +1,196 @@
+#pragma once
+
+#include <vector>
+
+// Lets the game lock a static vertex buffer to read and patch it without
+// waiting for the GPU. Once a buffer has been written a second time, its
+// contents are kept in system memory: locks hand out that copy, and the
+// written range is uploaded at Unlock into the next of a few dynamic copies
+// of the buffer, which then becomes the one that is drawn from. A copy that
+// has not been drawn from for FramesInFlight frames is idle, so only the
+// ranges it is missing are written with D3DLOCK_NOOVERWRITE. Otherwise it
+// gets all of the contents with D3DLOCK_DISCARD.
+//
+// Only default pool buffers that are neither dynamic nor write-only
+// qualify. State blocks that captured a stream, and ProcessVertices writing
+// into the buffer, still see the copy that was current at the time.
+class BufferRenamer
+{
+public:
+	static constexpr UINT MaxRenames = 3;
+	static constexpr UINT FramesInFlight = 3;
+
+	~BufferRenamer()
+	{
+		Release();
+	}
+
+	bool IsActive() const { return !Shadow.empty(); }
+	IDirect3DVertexBuffer8 *GetCurrent() const { return Renames[Current].pBuffer; }
+	IDirect3DVertexBuffer8 *GetRename(UINT Index) const { return IsActive() ? Renames[Index].pBuffer : nullptr; }
+	bool IsRename(IDirect3DVertexBuffer8 *pBuffer) const
+	{
+		for (const Rename& Entry : Renames)
+		{
+			if (pBuffer && Entry.pBuffer == pBuffer)
+			{
+				return true;
+			}
+		}
+		return false;
+	}
+
+	// Bookkeeping of locks that went to the original buffer
+	void ProxyLocked(DWORD Flags)
+	{
+		Locks++;
+		if (!(Flags & D3DLOCK_READONLY))
+		{
+			WriteLocks++;
+		}
+	}
+
+	// True when renaming should start now that the original buffer is unlocked
+	bool ProxyUnlocked()
+	{
+		if (Locks)
+		{
+			Locks--;
+		}
+		return !Locks && WriteLocks >= 2 && !Unsuitable;
+	}
+
+	// Copies the buffer into system memory and creates the renames, false when the buffer does not qualify
+	bool Start(LPDIRECT3DDEVICE8 pDevice, IDirect3DVertexBuffer8 *pBuffer)
+	{
+		Unsuitable = true;
+
+		D3DVERTEXBUFFER_DESC Desc;
+		if (FAILED(pBuffer->GetDesc(&Desc)) || Desc.Pool != D3DPOOL_DEFAULT || (Desc.Usage & (D3DUSAGE_DYNAMIC | D3DUSAGE_WRITEONLY)) || !Desc.Size)
+		{
+			return false;
+		}
+
+		BYTE *pData;
+		if (FAILED(pBuffer->Lock(0, 0, &pData, D3DLOCK_READONLY)))
+		{
+			return false;
+		}
+		Shadow.assign(pData, pData + Desc.Size);
+		pBuffer->Unlock();
+
+		const DWORD Usage = Desc.Usage | D3DUSAGE_DYNAMIC | D3DUSAGE_WRITEONLY;
+		for (Rename& Entry : Renames)
+		{
+			if (FAILED(pDevice->CreateVertexBuffer(Desc.Size, Usage, Desc.FVF, D3DPOOL_DEFAULT, &Entry.pBuffer)) || !Upload(Entry, 0, Desc.Size, D3DLOCK_DISCARD))
+			{
+				OutputDebugStringA("d3d8: could not create vertex buffer renames, locking the buffer as is\n");
+				Release();
+				return false;
+			}
+		}
+
+		Current = 0;
+		Unsuitable = false;
+		return true;
+	}
+
+	// Hands out the system memory copy
+	BYTE *Lock(UINT Offset, UINT Size, DWORD Flags)
+	{
+		if (Offset >= Shadow.size())
+		{
+			return nullptr;
+		}
+
+		if (!(Flags & D3DLOCK_READONLY))
+		{
+			// A size of zero locks the rest of the buffer
+			const UINT End = (Size && Size <= Shadow.size() - Offset) ? Offset + Size : (UINT)Shadow.size();
+			LockBegin = (LockBegin < LockEnd && LockBegin < Offset) ? LockBegin : Offset;
+			LockEnd = (LockEnd > End) ? LockEnd : End;
+		}
+		Locks++;
+
+		return Shadow.data() + Offset;
+	}
+
+	// Uploads what the game wrote, Switched is set when another rename became current.
+	// False when no rename could take the upload; the range stays dirty in all of them.
+	bool Unlock(UINT Frame, bool& Switched)
+	{
+		Switched = false;
+		if (!Locks || --Locks || LockBegin >= LockEnd)
+		{
+			return true;
+		}
+
+		// Every rename but the next one to be drawn from misses this range from now on
+		for (Rename& Entry : Renames)
+		{
+			Entry.DirtyBegin = (Entry.DirtyBegin < Entry.DirtyEnd && Entry.DirtyBegin < LockBegin) ? Entry.DirtyBegin : LockBegin;
+			Entry.DirtyEnd = (Entry.DirtyEnd > LockEnd) ? Entry.DirtyEnd : LockEnd;
+		}
+		LockBegin = LockEnd = 0;
+
+		const UINT Next = (Current + 1) % MaxRenames;
+		Rename& Entry = Renames[Next];
+		const bool Idle = Frame - Entry.RetiredFrame >= FramesInFlight;
+		if ((Idle && Upload(Entry, Entry.DirtyBegin, Entry.DirtyEnd, D3DLOCK_NOOVERWRITE)) || Upload(Entry, 0, (UINT)Shadow.size(), D3DLOCK_DISCARD))
+		{
+			Renames[Current].RetiredFrame = Frame;
+			Current = Next;
+			Switched = true;
+			return true;
+		}
+
+		// The rename drawn from now gets fresh memory with all of the contents instead
+		return Upload(Renames[Current], 0, (UINT)Shadow.size(), D3DLOCK_DISCARD);
+	}
+
+	void Release()
+	{
+		for (Rename& Entry : Renames)
+		{
+			if (Entry.pBuffer)
+			{
+				Entry.pBuffer->Release();
+			}
+			Entry = {};
+		}
+		Shadow.clear();
+		Shadow.shrink_to_fit();
+	}
+
+private:
+	struct Rename
+	{
+		IDirect3DVertexBuffer8 *pBuffer;
+		UINT DirtyBegin;			// range the rename is missing
+		UINT DirtyEnd;
+		UINT RetiredFrame;			// frame it stopped being drawn from
+	};
+
+	bool Upload(Rename& Entry, UINT Begin, UINT End, DWORD Flags)
+	{
+		BYTE *pData;
+		if (FAILED(Entry.pBuffer->Lock(Begin, End - Begin, &pData, Flags)))
+		{
+			return false;
+		}
+		memcpy(pData, Shadow.data() + Begin, End - Begin);
+		Entry.pBuffer->Unlock();
+
+		Entry.DirtyBegin = Entry.DirtyEnd = 0;
+		return true;
+	}
+
+	std::vector<BYTE> Shadow;
+	Rename Renames[MaxRenames] = {};
+	UINT Current = 0;
+	UINT LockBegin = 0;
+	UINT LockEnd = 0;
+	UINT Locks = 0;
+	UINT WriteLocks = 0;
+	bool Unsuitable = false;
+};
@@ -0,0 +1,185 @@
+#pragma once
+
+#include <atomic>
+#include <vector>
+#include <algorithm>
+
+// Display modes of each adapter, enumerated once and served from memory.
+// Duplicate modes are dropped, and the refresh rates are indexed by
+// resolution. A catalogue is rebuilt after WM_DISPLAYCHANGE, or when its
+// adapter moves to another monitor.
+class DisplayModeCatalogue
+{
+public:
+	// Any thread; marks every catalogue as stale
+	static void Invalidate()
+	{
+		Generation.fetch_add(1, std::memory_order_release);
+	}
+
+	UINT GetModeCount(LPDIRECT3D8 pD3D, UINT Adapter)
+	{
+		AcquireSRWLockExclusive(&Lock);
+		const AdapterModes *pModes = Validate(pD3D, Adapter);
+		UINT Count = pModes ? (UINT)pModes->Modes.size() : 0;
+		ReleaseSRWLockExclusive(&Lock);
+
+		return pModes ? Count : pD3D->GetAdapterModeCount(Adapter);
+	}
+
+	HRESULT EnumMode(LPDIRECT3D8 pD3D, UINT Adapter, UINT Mode, D3DDISPLAYMODE *pMode)
+	{
+		if (!pMode)
+		{
+			return D3DERR_INVALIDCALL;
+		}
+
+		AcquireSRWLockExclusive(&Lock);
+		const AdapterModes *pModes = Validate(pD3D, Adapter);
+		HRESULT hr = D3DERR_INVALIDCALL;
+		if (pModes && Mode < pModes->Modes.size())
+		{
+			*pMode = pModes->Modes[Mode];
+			hr = D3D_OK;
+		}
+		ReleaseSRWLockExclusive(&Lock);
+
+		return pModes ? hr : pD3D->EnumAdapterModes(Adapter, Mode, pMode);
+	}
+
+	// Ascending refresh rates of a resolution, or of the whole adapter if it has no such mode
+	std::vector<UINT> GetRefreshRates(LPDIRECT3D8 pD3D, UINT Adapter, UINT Width, UINT Height)
+	{
+		std::vector<UINT> Rates;
+
+		AcquireSRWLockExclusive(&Lock);
+		if (const AdapterModes *pModes = Validate(pD3D, Adapter))
+		{
+			auto it = std::lower_bound(pModes->Resolutions.begin(), pModes->Resolutions.end(), Resolution{ Width, Height });
+			if (it != pModes->Resolutions.end() && it->Width == Width && it->Height == Height)
+			{
+				Rates = it->RefreshRates;
+			}
+			else
+			{
+				Rates = pModes->AllRefreshRates;
+			}
+		}
+		ReleaseSRWLockExclusive(&Lock);
+
+		return Rates;
+	}
+
+private:
+	struct Resolution
+	{
+		UINT Width;
+		UINT Height;
+		std::vector<UINT> RefreshRates;
+
+		bool operator<(const Resolution& Other) const
+		{
+			return Width != Other.Width ? Width < Other.Width : Height < Other.Height;
+		}
+	};
+
+	struct AdapterModes
+	{
+		UINT Generation = 0;
+		HMONITOR hMonitor = nullptr;
+		bool Built = false;
+		std::vector<D3DDISPLAYMODE> Modes;			// enumeration order, without duplicates
+		std::vector<Resolution> Resolutions;		// sorted by size
+		std::vector<UINT> AllRefreshRates;			// sorted, unique
+	};
+
+	// Called with the lock held; nullptr for an adapter that does not exist
+	const AdapterModes *Validate(LPDIRECT3D8 pD3D, UINT Adapter)
+	{
+		if (Adapter >= pD3D->GetAdapterCount())
+		{
+			return nullptr;
+		}
+		if (Adapter >= Adapters.size())
+		{
+			Adapters.resize(Adapter + 1);
+		}
+
+		AdapterModes& Entry = Adapters[Adapter];
+		const UINT Current = Generation.load(std::memory_order_acquire);
+		const HMONITOR hMonitor = pD3D->GetAdapterMonitor(Adapter);
+		if (!Entry.Built || Entry.Generation != Current || Entry.hMonitor != hMonitor)
+		{
+			Build(pD3D, Adapter, Entry);
+			Entry.Generation = Current;
+			Entry.hMonitor = hMonitor;
+			Entry.Built = true;
+		}
+		return &Entry;
+	}
+
+	static void Build(LPDIRECT3D8 pD3D, UINT Adapter, AdapterModes& Entry)
+	{
+		Entry.Modes.clear();
+		Entry.Resolutions.clear();
+		Entry.AllRefreshRates.clear();
+
+		const UINT Count = pD3D->GetAdapterModeCount(Adapter);
+		Entry.Modes.reserve(Count);
+		for (UINT x = 0; x < Count; x++)
+		{
+			D3DDISPLAYMODE Mode;
+			if (FAILED(pD3D->EnumAdapterModes(Adapter, x, &Mode)))
+			{
+				continue;
+			}
+
+			auto Same = [&Mode](const D3DDISPLAYMODE& Other)
+			{
+				return Other.Width == Mode.Width && Other.Height == Mode.Height && Other.RefreshRate == Mode.RefreshRate && Other.Format == Mode.Format;
+			};
+			if (std::find_if(Entry.Modes.begin(), Entry.Modes.end(), Same) == Entry.Modes.end())
+			{
+				Entry.Modes.push_back(Mode);
+			}
+		}
+
+		// Sort by size then rate, so each resolution's rates come out ascending
+		std::vector<D3DDISPLAYMODE> Sorted(Entry.Modes);
+		std::sort(Sorted.begin(), Sorted.end(), [](const D3DDISPLAYMODE& a, const D3DDISPLAYMODE& b)
+		{
+			if (a.Width != b.Width)
+			{
+				return a.Width < b.Width;
+			}
+			if (a.Height != b.Height)
+			{
+				return a.Height < b.Height;
+			}
+			return a.RefreshRate < b.RefreshRate;
+		});
+
+		for (const D3DDISPLAYMODE& Mode : Sorted)
+		{
+			if (Entry.Resolutions.empty() || Entry.Resolutions.back().Width != Mode.Width || Entry.Resolutions.back().Height != Mode.Height)
+			{
+				Entry.Resolutions.push_back({ Mode.Width, Mode.Height });
+			}
+
+			std::vector<UINT>& Rates = Entry.Resolutions.back().RefreshRates;
+			if (Rates.empty() || Rates.back() != Mode.RefreshRate)
+			{
+				Rates.push_back(Mode.RefreshRate);
+			}
+			Entry.AllRefreshRates.push_back(Mode.RefreshRate);
+		}
+
+		std::sort(Entry.AllRefreshRates.begin(), Entry.AllRefreshRates.end());
+		Entry.AllRefreshRates.erase(std::unique(Entry.AllRefreshRates.begin(), Entry.AllRefreshRates.end()), Entry.AllRefreshRates.end());
+	}
+
+	static inline std::atomic<UINT> Generation{ 0 };
+
+	SRWLOCK Lock = SRWLOCK_INIT;
+	std::vector<AdapterModes> Adapters;
+};
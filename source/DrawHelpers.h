@@ -0,0 +1,22 @@
+#pragma once
+
+// Vertices read by a non-indexed draw, or indices read by an indexed one
+inline UINT PrimitiveVertexCount(D3DPRIMITIVETYPE Type, UINT PrimitiveCount)
+{
+	switch (Type)
+	{
+	case D3DPT_POINTLIST:
+		return PrimitiveCount;
+	case D3DPT_LINELIST:
+		return PrimitiveCount * 2;
+	case D3DPT_LINESTRIP:
+		return PrimitiveCount + 1;
+	case D3DPT_TRIANGLELIST:
+		return PrimitiveCount * 3;
+	case D3DPT_TRIANGLESTRIP:
+	case D3DPT_TRIANGLEFAN:
+		return PrimitiveCount + 2;
+	default:
+		return 0;
+	}
+}
@@ -49,7 +49,7 @@ ULONG m_IDirect3D8::Release()
 
 HRESULT m_IDirect3D8::EnumAdapterModes(THIS_ UINT Adapter, UINT Mode, D3DDISPLAYMODE* pMode)
 {
-	return ProxyInterface->EnumAdapterModes(Adapter, Mode, pMode);
+	return DisplayModes.EnumMode(ProxyInterface, Adapter, Mode, pMode);
 }
 
 UINT m_IDirect3D8::GetAdapterCount()
@@ -69,7 +69,7 @@ HRESULT m_IDirect3D8::GetAdapterIdentifier(UINT Adapter, DWORD Flags, D3DADAPTER
 
 UINT m_IDirect3D8::GetAdapterModeCount(THIS_ UINT Adapter)
 {
-	return ProxyInterface->GetAdapterModeCount(Adapter);
+	return DisplayModes.GetModeCount(ProxyInterface, Adapter);
 }
 
 HMONITOR m_IDirect3D8::GetAdapterMonitor(UINT Adapter)
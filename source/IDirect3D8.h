@@ -4,10 +4,13 @@ class m_IDirect3D8 : public IDirect3D8
 {
 private:
 	LPDIRECT3D8 ProxyInterface;
+	DisplayModeCatalogue DisplayModes;
 
 public:
 	m_IDirect3D8(LPDIRECT3D8 pD3D) : ProxyInterface(pD3D) { }
 
+	std::vector<UINT> GetRefreshRates(UINT Adapter, UINT Width, UINT Height) { return DisplayModes.GetRefreshRates(ProxyInterface, Adapter, Width, Height); }
+
 	/*** IUnknown methods ***/
 	STDMETHOD(QueryInterface)(THIS_ REFIID riid, LPVOID * ppvObj);
 	STDMETHOD_(ULONG, AddRef)(THIS);
@@ -16,6 +16,15 @@
 
 #include "d3d8.h"
 
+m_IDirect3DCubeTexture8::~m_IDirect3DCubeTexture8()
+{
+	for (LPDIRECT3DSURFACE8 pSurface : Surfaces)
+	{
+		m_pDevice->ProxyAddressLookupTable->DeleteSavedAddress<m_IDirect3DSurface8>(pSurface);
+	}
+	m_pDevice->ProxyAddressLookupTable->DeleteAddress(this, ProxyInterface);
+}
+
 HRESULT m_IDirect3DCubeTexture8::QueryInterface(THIS_ REFIID riid, void** ppvObj)
 {
 	if ((riid == IID_IDirect3DCubeTexture8 || riid == IID_IUnknown || riid == IID_IDirect3DResource8 || riid == IID_IDirect3DBaseTexture8) && ppvObj)
@@ -44,7 +53,16 @@ ULONG m_IDirect3DCubeTexture8::AddRef(THIS)
 
 ULONG m_IDirect3DCubeTexture8::Release(THIS)
 {
-	return ProxyInterface->Release();
+	ULONG ref = ProxyInterface->Release();
+
+	if (ref == 0)
+	{
+		Trace::Record(Trace::Call::Destroy, Trace::Id(this));
+
+		delete this;
+	}
+
+	return ref;
 }
 
 HRESULT m_IDirect3DCubeTexture8::GetDevice(THIS_ IDirect3DDevice8** ppDevice)
@@ -122,7 +140,16 @@ HRESULT m_IDirect3DCubeTexture8::GetCubeMapSurface(THIS_ D3DCUBEMAP_FACES FaceTy
 
 	if (SUCCEEDED(hr) && ppCubeMapSurface)
 	{
-		*ppCubeMapSurface = m_pDevice->ProxyAddressLookupTable->FindAddress<m_IDirect3DSurface8>(*ppCubeMapSurface);
+		const UINT Index = Level * 6 + FaceType;
+		if (Index >= Surfaces.size())
+		{
+			Surfaces.resize(Index + 1, nullptr);
+		}
+		Surfaces[Index] = *ppCubeMapSurface;
+
+		m_IDirect3DSurface8 *pSurface = m_pDevice->ProxyAddressLookupTable->FindAddress<m_IDirect3DSurface8>(*ppCubeMapSurface);
+		pSurface->SetContainer(this);
+		*ppCubeMapSurface = pSurface;
 	}
 
 	return hr;
@@ -130,11 +157,32 @@ HRESULT m_IDirect3DCubeTexture8::GetCubeMapSurface(THIS_ D3DCUBEMAP_FACES FaceTy
 
 HRESULT m_IDirect3DCubeTexture8::LockRect(THIS_ D3DCUBEMAP_FACES FaceType, UINT Level, D3DLOCKED_RECT* pLockedRect, CONST RECT* pRect, DWORD Flags)
 {
-	return ProxyInterface->LockRect(FaceType, Level, pLockedRect, pRect, Flags);
+	Trace::Record(Trace::Call::CubeTextureLockRect, Trace::Id(this), FaceType, Level, Trace::ByRef(pRect), Flags);
+
+	m_pDevice->FlushDraws();
+
+	HRESULT hr = ProxyInterface->LockRect(FaceType, Level, pLockedRect, pRect, Flags);
+
+	D3DSURFACE_DESC Desc;
+	if (SUCCEEDED(hr) && pLockedRect && Trace::Recorder::IsActive() && SUCCEEDED(ProxyInterface->GetLevelDesc(Level, &Desc)))
+	{
+		const UINT Height = pRect ? pRect->bottom - pRect->top : Desc.Height;
+		TraceLock = { pLockedRect->pBits, Trace::LockedRectSize(Desc.Format, *pLockedRect, Height), Level * 6 + FaceType };
+	}
+
+	return hr;
 }
 
 HRESULT m_IDirect3DCubeTexture8::UnlockRect(THIS_ D3DCUBEMAP_FACES FaceType, UINT Level)
 {
+	// Only the last lock is kept, an unlock of another face or level records no contents
+	const bool Match = TraceLock.pData && TraceLock.Key == Level * 6 + FaceType;
+	Trace::Record(Trace::Call::CubeTextureUnlockRect, Trace::Id(this), FaceType, Level, Trace::Block(Match ? TraceLock.pData : nullptr, TraceLock.Size));
+	if (Match)
+	{
+		TraceLock = {};
+	}
+
 	return ProxyInterface->UnlockRect(FaceType, Level);
 }
 
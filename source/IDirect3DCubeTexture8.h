@@ -1,17 +1,20 @@
 #pragma once
 
-class m_IDirect3DCubeTexture8 : public IDirect3DCubeTexture8, public AddressLookupTableObject
+class m_IDirect3DCubeTexture8 : public IDirect3DCubeTexture8, public AddressLookupTableObject, public PooledObject<m_IDirect3DCubeTexture8>
 {
 private:
 	LPDIRECT3DCUBETEXTURE8 ProxyInterface;
 	m_IDirect3DDevice8* m_pDevice;
+	Trace::PendingLock TraceLock = {};
+	std::vector<LPDIRECT3DSURFACE8> Surfaces;	// by Level * 6 + FaceType, the surfaces handed out
 
 public:
 	m_IDirect3DCubeTexture8(LPDIRECT3DCUBETEXTURE8 pTexture8, m_IDirect3DDevice8* pDevice) : ProxyInterface(pTexture8), m_pDevice(pDevice)
 	{
 		m_pDevice->ProxyAddressLookupTable->SaveAddress(this, ProxyInterface);
 	}
-	~m_IDirect3DCubeTexture8() {}
+	// Out of line, the surface wrapper is declared after this one
+	~m_IDirect3DCubeTexture8();
 
 	LPDIRECT3DCUBETEXTURE8 GetProxyInterface() { return ProxyInterface; }
 
@@ -39,11 +39,22 @@ HRESULT m_IDirect3DDevice8::QueryInterface(REFIID riid, LPVOID *ppvObj)
 
 ULONG m_IDirect3DDevice8::AddRef()
 {
+	InterlockedIncrement(&GameReferences);
+
 	return ProxyInterface->AddRef();
 }
 
 ULONG m_IDirect3DDevice8::Release()
 {
+	// The UP draw buffers hold device references of their own, they go once the game holds none.
+	// Resources the game still holds keep the device, and this wrapper, until they are released.
+	if (InterlockedDecrement(&GameReferences) == 0)
+	{
+		UPBuffer.Release();
+
+		Trace::Recorder::Sync();
+	}
+
 	ULONG ref = ProxyInterface->Release();
 
 	if (ref == 0)
@@ -66,11 +77,15 @@ ULONG m_IDirect3DDevice8::Release()
 
 void m_IDirect3DDevice8::SetCursorPosition(THIS_ UINT XScreenSpace, UINT YScreenSpace, DWORD Flags)
 {
+	Trace::Record(Trace::Call::SetCursorPosition, XScreenSpace, YScreenSpace, Flags);
+
 	return ProxyInterface->SetCursorPosition(XScreenSpace, YScreenSpace, Flags);
 }
 
 HRESULT m_IDirect3DDevice8::SetCursorProperties(UINT XHotSpot, UINT YHotSpot, IDirect3DSurface8 *pCursorBitmap)
 {
+	Trace::Record(Trace::Call::SetCursorProperties, XHotSpot, YHotSpot, Trace::Id(pCursorBitmap));
+
 	if (pCursorBitmap)
 	{
 		pCursorBitmap = static_cast<m_IDirect3DSurface8 *>(pCursorBitmap)->GetProxyInterface();
@@ -81,6 +96,8 @@ HRESULT m_IDirect3DDevice8::SetCursorProperties(UINT XHotSpot, UINT YHotSpot, ID
 
 BOOL m_IDirect3DDevice8::ShowCursor(BOOL bShow)
 {
+	Trace::Record(Trace::Call::ShowCursor, bShow);
+
 	return ProxyInterface->ShowCursor(bShow);
 }
 
@@ -91,6 +108,8 @@ HRESULT m_IDirect3DDevice8::CreateAdditionalSwapChain(D3DPRESENT_PARAMETERS *pPr
 	if (SUCCEEDED(hr) && ppSwapChain)
 	{
 		*ppSwapChain = new m_IDirect3DSwapChain8(*ppSwapChain, this);
+
+		Trace::Record(Trace::Call::CreateAdditionalSwapChain, Trace::ByRef(pPresentationParameters), Trace::Id(*ppSwapChain));
 	}
 
 	return hr;
@@ -103,6 +122,8 @@ HRESULT m_IDirect3DDevice8::CreateCubeTexture(THIS_ UINT EdgeLength, UINT Levels
 	if (SUCCEEDED(hr) && ppCubeTexture)
 	{
 		*ppCubeTexture = new m_IDirect3DCubeTexture8(*ppCubeTexture, this);
+
+		Trace::Record(Trace::Call::CreateCubeTexture, EdgeLength, Levels, Usage, Format, Pool, Trace::Id(*ppCubeTexture));
 	}
 
 	return hr;
@@ -115,6 +136,8 @@ HRESULT m_IDirect3DDevice8::CreateDepthStencilSurface(THIS_ UINT Width, UINT Hei
 	if (SUCCEEDED(hr) && ppSurface)
 	{
 		*ppSurface = new m_IDirect3DSurface8(*ppSurface, this);
+
+		Trace::Record(Trace::Call::CreateDepthStencilSurface, Width, Height, Format, MultiSample, Trace::Id(*ppSurface));
 	}
 
 	return hr;
@@ -127,6 +150,8 @@ HRESULT m_IDirect3DDevice8::CreateIndexBuffer(THIS_ UINT Length, DWORD Usage, D3
 	if (SUCCEEDED(hr) && ppIndexBuffer)
 	{
 		*ppIndexBuffer = new m_IDirect3DIndexBuffer8(*ppIndexBuffer, this);
+
+		Trace::Record(Trace::Call::CreateIndexBuffer, Length, Usage, Format, Pool, Trace::Id(*ppIndexBuffer));
 	}
 
 	return hr;
@@ -139,6 +164,8 @@ HRESULT m_IDirect3DDevice8::CreateRenderTarget(THIS_ UINT Width, UINT Height, D3
 	if (SUCCEEDED(hr) && ppSurface)
 	{
 		*ppSurface = new m_IDirect3DSurface8(*ppSurface, this);
+
+		Trace::Record(Trace::Call::CreateRenderTarget, Width, Height, Format, MultiSample, Lockable, Trace::Id(*ppSurface));
 	}
 
 	return hr;
@@ -151,6 +178,8 @@ HRESULT m_IDirect3DDevice8::CreateTexture(THIS_ UINT Width, UINT Height, UINT Le
 	if (SUCCEEDED(hr) && ppTexture)
 	{
 		*ppTexture = new m_IDirect3DTexture8(*ppTexture, this);
+
+		Trace::Record(Trace::Call::CreateTexture, Width, Height, Levels, Usage, Format, Pool, Trace::Id(*ppTexture));
 	}
 
 	return hr;
@@ -163,6 +192,8 @@ HRESULT m_IDirect3DDevice8::CreateVertexBuffer(THIS_ UINT Length, DWORD Usage, D
 	if (SUCCEEDED(hr) && ppVertexBuffer)
 	{
 		*ppVertexBuffer = new m_IDirect3DVertexBuffer8(*ppVertexBuffer, this);
+
+		Trace::Record(Trace::Call::CreateVertexBuffer, Length, Usage, FVF, Pool, Trace::Id(*ppVertexBuffer));
 	}
 
 	return hr;
@@ -175,58 +206,176 @@ HRESULT m_IDirect3DDevice8::CreateVolumeTexture(THIS_ UINT Width, UINT Height, U
 	if (SUCCEEDED(hr) && ppVolumeTexture)
 	{
 		*ppVolumeTexture = new m_IDirect3DVolumeTexture8(*ppVolumeTexture, this);
+
+		Trace::Record(Trace::Call::CreateVolumeTexture, Width, Height, Depth, Levels, Usage, Format, Pool, Trace::Id(*ppVolumeTexture));
 	}
 
 	return hr;
 }
 
+void m_IDirect3DDevice8::BindOwnTextures(bool Own)
+{
+	for (UINT x = 0; x < MaxTextureStages; x++)
+	{
+		m_IDirect3DTexture8 *pBound = BoundTextures[x];
+		if (pBound && pBound->GetProxyInterface() != pBound->GetOwnInterface())
+		{
+			BindTexture(x, Own ? pBound->GetOwnInterface() : pBound->GetProxyInterface());
+		}
+	}
+}
+
+void m_IDirect3DDevice8::FindBoundTextures()
+{
+	for (UINT x = 0; x < MaxTextureStages; x++)
+	{
+		IDirect3DBaseTexture8 *pTexture = nullptr;
+		if (FAILED(ProxyInterface->GetTexture(x, &pTexture)) || !pTexture)
+		{
+			BoundTextures[x] = nullptr;
+			continue;
+		}
+
+		// Stages the block left alone keep their wrapper, the rest hold a texture's own texture
+		m_IDirect3DTexture8 *pBound = BoundTextures[x];
+		if (!pBound || pBound->GetProxyInterface() != pTexture)
+		{
+			pBound = (pTexture->GetType() == D3DRTYPE_TEXTURE) ? ProxyAddressLookupTable->FindSavedAddress<m_IDirect3DTexture8>(pTexture) : nullptr;
+		}
+		pTexture->Release();
+
+		BoundTextures[x] = pBound;
+		if (pBound && pBound->GetProxyInterface() != pTexture)
+		{
+			BindTexture(x, pBound->GetProxyInterface());
+		}
+	}
+}
+
 HRESULT m_IDirect3DDevice8::BeginStateBlock()
 {
-	return ProxyInterface->BeginStateBlock();
+	Trace::Record(Trace::Call::BeginStateBlock);
+
+	FlushDraws();
+
+	HRESULT hr = ProxyInterface->BeginStateBlock();
+
+	if (SUCCEEDED(hr))
+	{
+		ShadowState.SetRecording(true);
+	}
+
+	return hr;
 }
 
 HRESULT m_IDirect3DDevice8::CreateStateBlock(THIS_ D3DSTATEBLOCKTYPE Type, DWORD* pToken)
 {
-	return ProxyInterface->CreateStateBlock(Type, pToken);
+	const bool Textures = bDeduplicateTextures && Type != D3DSBT_VERTEXSTATE;
+	if (Textures)
+	{
+		BindOwnTextures(true);
+	}
+
+	HRESULT hr = ProxyInterface->CreateStateBlock(Type, pToken);
+
+	if (Textures)
+	{
+		BindOwnTextures(false);
+	}
+
+	if (SUCCEEDED(hr) && pToken)
+	{
+		Trace::Record(Trace::Call::CreateStateBlock, Type, *pToken);
+	}
+
+	return hr;
 }
 
 HRESULT m_IDirect3DDevice8::ApplyStateBlock(THIS_ DWORD Token)
 {
-	return ProxyInterface->ApplyStateBlock(Token);
+	Trace::Record(Trace::Call::ApplyStateBlock, Token);
+
+	FlushDraws();
+
+	HRESULT hr = ProxyInterface->ApplyStateBlock(Token);
+
+	if (!ShadowState.IsRecording())
+	{
+		ShadowState.Invalidate();
+		if (bDeduplicateTextures)
+		{
+			FindBoundTextures();
+		}
+	}
+
+	return hr;
 }
 
 HRESULT m_IDirect3DDevice8::CaptureStateBlock(THIS_ DWORD Token)
 {
-	return ProxyInterface->CaptureStateBlock(Token);
+	Trace::Record(Trace::Call::CaptureStateBlock, Token);
+
+	if (!bDeduplicateTextures)
+	{
+		return ProxyInterface->CaptureStateBlock(Token);
+	}
+
+	BindOwnTextures(true);
+	HRESULT hr = ProxyInterface->CaptureStateBlock(Token);
+	BindOwnTextures(false);
+
+	return hr;
 }
 
 HRESULT m_IDirect3DDevice8::DeleteStateBlock(THIS_ DWORD Token)
 {
+	Trace::Record(Trace::Call::DeleteStateBlock, Token);
+
 	return ProxyInterface->DeleteStateBlock(Token);
 }
 
 HRESULT m_IDirect3DDevice8::EndStateBlock(THIS_ DWORD* pToken)
 {
-	return ProxyInterface->EndStateBlock(pToken);
+	ShadowState.SetRecording(false);
+
+	HRESULT hr = ProxyInterface->EndStateBlock(pToken);
+
+	if (SUCCEEDED(hr) && pToken)
+	{
+		Trace::Record(Trace::Call::EndStateBlock, *pToken);
+	}
+
+	return hr;
 }
 
 HRESULT m_IDirect3DDevice8::GetClipStatus(D3DCLIPSTATUS8 *pClipStatus)
 {
+	Trace::Record(Trace::Call::GetClipStatus);
+
+	FlushDraws();
+
 	return ProxyInterface->GetClipStatus(pClipStatus);
 }
 
 HRESULT m_IDirect3DDevice8::GetDisplayMode(THIS_ D3DDISPLAYMODE* pMode)
 {
+	Trace::Record(Trace::Call::GetDisplayMode);
+
 	return ProxyInterface->GetDisplayMode(pMode);
 }
 
 HRESULT m_IDirect3DDevice8::GetRenderState(D3DRENDERSTATETYPE State, DWORD *pValue)
 {
-	return ProxyInterface->GetRenderState(State, pValue);
+	Trace::Record(Trace::Call::GetRenderState, State);
+
+	return QueryState("GetRenderState", ShadowState.RenderState(State), pValue,
+		[&](DWORD *pDeviceValue) { return ProxyInterface->GetRenderState(State, pDeviceValue); });
 }
 
 HRESULT m_IDirect3DDevice8::GetRenderTarget(THIS_ IDirect3DSurface8** ppRenderTarget)
 {
+	Trace::Record(Trace::Call::GetRenderTarget);
+
 	HRESULT hr = ProxyInterface->GetRenderTarget(ppRenderTarget);
 
 	if (SUCCEEDED(hr) && ppRenderTarget)
@@ -239,21 +388,43 @@ HRESULT m_IDirect3DDevice8::GetRenderTarget(THIS_ IDirect3DSurface8** ppRenderTa
 
 HRESULT m_IDirect3DDevice8::GetTransform(D3DTRANSFORMSTATETYPE State, D3DMATRIX *pMatrix)
 {
-	return ProxyInterface->GetTransform(State, pMatrix);
+	Trace::Record(Trace::Call::GetTransform, State);
+
+	return QueryState("GetTransform", ShadowState.Transform(State), pMatrix,
+		[&](D3DMATRIX *pDeviceMatrix) { return ProxyInterface->GetTransform(State, pDeviceMatrix); });
 }
 
 HRESULT m_IDirect3DDevice8::SetClipStatus(CONST D3DCLIPSTATUS8 *pClipStatus)
 {
+	Trace::Record(Trace::Call::SetClipStatus, Trace::ByRef(pClipStatus));
+
+	FlushDraws();
+
 	return ProxyInterface->SetClipStatus(pClipStatus);
 }
 
 HRESULT m_IDirect3DDevice8::SetRenderState(D3DRENDERSTATETYPE State, DWORD Value)
 {
-	return ProxyInterface->SetRenderState(State, Value);
+	Trace::Record(Trace::Call::SetRenderState, State, Value);
+
+	auto pSlot = ShadowState.RenderState(State);
+	if (FilterState(pSlot, Value))
+	{
+		return D3D_OK;
+	}
+
+	HRESULT hr = ProxyInterface->SetRenderState(State, Value);
+	ShadowState.Store(pSlot, Value, hr);
+
+	return hr;
 }
 
 HRESULT m_IDirect3DDevice8::SetRenderTarget(THIS_ IDirect3DSurface8* pRenderTarget, IDirect3DSurface8* pNewZStencil)
 {
+	Trace::Record(Trace::Call::SetRenderTarget, Trace::Id(pRenderTarget), Trace::Id(pNewZStencil));
+
+	FlushDraws();
+
 	if (pRenderTarget)
 	{
 		pRenderTarget = static_cast<m_IDirect3DSurface8 *>(pRenderTarget)->GetProxyInterface();
@@ -264,46 +435,85 @@ HRESULT m_IDirect3DDevice8::SetRenderTarget(THIS_ IDirect3DSurface8* pRenderTarg
 		pNewZStencil = static_cast<m_IDirect3DSurface8 *>(pNewZStencil)->GetProxyInterface();
 	}
 
+	// Setting a render target resets the viewport to cover it
+	StateCache::Forget(ShadowState.Viewport());
+
 	return ProxyInterface->SetRenderTarget(pRenderTarget, pNewZStencil);
 }
 
 HRESULT m_IDirect3DDevice8::SetTransform(D3DTRANSFORMSTATETYPE State, CONST D3DMATRIX *pMatrix)
 {
-	return ProxyInterface->SetTransform(State, pMatrix);
+	Trace::Record(Trace::Call::SetTransform, State, Trace::ByRef(pMatrix));
+
+	FlushDraws();
+
+	HRESULT hr = ProxyInterface->SetTransform(State, pMatrix);
+
+	if (pMatrix)
+	{
+		ShadowState.Store(ShadowState.Transform(State), *pMatrix, hr);
+	}
+
+	return hr;
 }
 
 void m_IDirect3DDevice8::GetGammaRamp(THIS_ D3DGAMMARAMP* pRamp)
 {
+	Trace::Record(Trace::Call::GetGammaRamp);
+
 	ProxyInterface->GetGammaRamp(pRamp);
 }
 
 void m_IDirect3DDevice8::SetGammaRamp(THIS_ DWORD Flags, CONST D3DGAMMARAMP* pRamp)
 {
+	Trace::Record(Trace::Call::SetGammaRamp, Flags, Trace::ByRef(pRamp));
+
 	ProxyInterface->SetGammaRamp(Flags, pRamp);
 }
 
 HRESULT m_IDirect3DDevice8::DeletePatch(UINT Handle)
 {
+	Trace::Record(Trace::Call::DeletePatch, Handle);
+
 	return ProxyInterface->DeletePatch(Handle);
 }
 
 HRESULT m_IDirect3DDevice8::DrawRectPatch(UINT Handle, CONST float *pNumSegs, CONST D3DRECTPATCH_INFO *pRectPatchInfo)
 {
+	Trace::Record(Trace::Call::DrawRectPatch, Handle, Trace::Block(pNumSegs, 4 * sizeof(float)), Trace::ByRef(pRectPatchInfo));
+
+	FlushDraws();
+
 	return ProxyInterface->DrawRectPatch(Handle, pNumSegs, pRectPatchInfo);
 }
 
 HRESULT m_IDirect3DDevice8::DrawTriPatch(UINT Handle, CONST float *pNumSegs, CONST D3DTRIPATCH_INFO *pTriPatchInfo)
 {
+	Trace::Record(Trace::Call::DrawTriPatch, Handle, Trace::Block(pNumSegs, 3 * sizeof(float)), Trace::ByRef(pTriPatchInfo));
+
+	FlushDraws();
+
 	return ProxyInterface->DrawTriPatch(Handle, pNumSegs, pTriPatchInfo);
 }
 
 HRESULT m_IDirect3DDevice8::GetIndices(THIS_ IDirect3DIndexBuffer8** ppIndexData, UINT* pBaseVertexIndex)
 {
+	Trace::Record(Trace::Call::GetIndices);
+
 	HRESULT hr = ProxyInterface->GetIndices(ppIndexData, pBaseVertexIndex);
 
 	if (SUCCEEDED(hr) && ppIndexData)
 	{
-		*ppIndexData = ProxyAddressLookupTable->FindAddress<m_IDirect3DIndexBuffer8>(*ppIndexData);
+		// The UP draw buffer stands in for the runtime's, which leaves nothing bound
+		if (*ppIndexData && *ppIndexData == UPBuffer.GetIndexBuffer())
+		{
+			(*ppIndexData)->Release();
+			*ppIndexData = nullptr;
+		}
+		else
+		{
+			*ppIndexData = ProxyAddressLookupTable->FindAddress<m_IDirect3DIndexBuffer8>(*ppIndexData);
+		}
 	}
 
 	return hr;
@@ -311,31 +521,41 @@ HRESULT m_IDirect3DDevice8::GetIndices(THIS_ IDirect3DIndexBuffer8** ppIndexData
 
 HRESULT m_IDirect3DDevice8::SetIndices(THIS_ IDirect3DIndexBuffer8* pIndexData, UINT BaseVertexIndex)
 {
+	Trace::Record(Trace::Call::SetIndices, Trace::Id(pIndexData), BaseVertexIndex);
+
 	if (pIndexData)
 	{
 		pIndexData = static_cast<m_IDirect3DIndexBuffer8 *>(pIndexData)->GetProxyInterface();
 	}
 
-	return ProxyInterface->SetIndices(pIndexData, BaseVertexIndex);
+	return BindIndices(pIndexData, BaseVertexIndex);
 }
 
 UINT m_IDirect3DDevice8::GetAvailableTextureMem()
 {
+	Trace::Record(Trace::Call::GetAvailableTextureMem);
+
 	return ProxyInterface->GetAvailableTextureMem();
 }
 
 HRESULT m_IDirect3DDevice8::GetCreationParameters(D3DDEVICE_CREATION_PARAMETERS *pParameters)
 {
+	Trace::Record(Trace::Call::GetCreationParameters);
+
 	return ProxyInterface->GetCreationParameters(pParameters);
 }
 
 HRESULT m_IDirect3DDevice8::GetDeviceCaps(D3DCAPS8 *pCaps)
 {
+	Trace::Record(Trace::Call::GetDeviceCaps);
+
 	return ProxyInterface->GetDeviceCaps(pCaps);
 }
 
 HRESULT m_IDirect3DDevice8::GetDirect3D(IDirect3D8 **ppD3D9)
 {
+	Trace::Record(Trace::Call::GetDirect3D);
+
 	if (!ppD3D9)
 	{
 		return D3DERR_INVALIDCALL;
@@ -350,47 +570,96 @@ HRESULT m_IDirect3DDevice8::GetDirect3D(IDirect3D8 **ppD3D9)
 
 HRESULT m_IDirect3DDevice8::GetRasterStatus(THIS_ D3DRASTER_STATUS* pRasterStatus)
 {
+	Trace::Record(Trace::Call::GetRasterStatus);
+
 	return ProxyInterface->GetRasterStatus(pRasterStatus);
 }
 
 HRESULT m_IDirect3DDevice8::GetLight(DWORD Index, D3DLIGHT8 *pLight)
 {
-	return ProxyInterface->GetLight(Index, pLight);
+	Trace::Record(Trace::Call::GetLight, Index);
+
+	return QueryState("GetLight", ShadowState.Light(Index), pLight,
+		[&](D3DLIGHT8 *pDeviceLight) { return ProxyInterface->GetLight(Index, pDeviceLight); });
 }
 
 HRESULT m_IDirect3DDevice8::GetLightEnable(DWORD Index, BOOL *pEnable)
 {
+	Trace::Record(Trace::Call::GetLightEnable, Index);
+
 	return ProxyInterface->GetLightEnable(Index, pEnable);
 }
 
 HRESULT m_IDirect3DDevice8::GetMaterial(D3DMATERIAL8 *pMaterial)
 {
-	return ProxyInterface->GetMaterial(pMaterial);
+	Trace::Record(Trace::Call::GetMaterial);
+
+	return QueryState("GetMaterial", ShadowState.Material(), pMaterial,
+		[&](D3DMATERIAL8 *pDeviceMaterial) { return ProxyInterface->GetMaterial(pDeviceMaterial); });
 }
 
 HRESULT m_IDirect3DDevice8::LightEnable(DWORD LightIndex, BOOL bEnable)
 {
+	Trace::Record(Trace::Call::LightEnable, LightIndex, bEnable);
+
+	FlushDraws();
+
 	return ProxyInterface->LightEnable(LightIndex, bEnable);
 }
 
 HRESULT m_IDirect3DDevice8::SetLight(DWORD Index, CONST D3DLIGHT8 *pLight)
 {
+	Trace::Record(Trace::Call::SetLight, Index, Trace::ByRef(pLight));
 
-	return ProxyInterface->SetLight(Index, pLight);
+	FlushDraws();
+
+	HRESULT hr = ProxyInterface->SetLight(Index, pLight);
+
+	if (pLight)
+	{
+		ShadowState.Store(ShadowState.Light(Index), *pLight, hr);
+	}
+
+	return hr;
 }
 
 HRESULT m_IDirect3DDevice8::SetMaterial(CONST D3DMATERIAL8 *pMaterial)
 {
-	return ProxyInterface->SetMaterial(pMaterial);
+	Trace::Record(Trace::Call::SetMaterial, Trace::ByRef(pMaterial));
+
+	FlushDraws();
+
+	HRESULT hr = ProxyInterface->SetMaterial(pMaterial);
+
+	if (pMaterial)
+	{
+		ShadowState.Store(ShadowState.Material(), *pMaterial, hr);
+	}
+
+	return hr;
 }
 
 HRESULT m_IDirect3DDevice8::MultiplyTransform(D3DTRANSFORMSTATETYPE State, CONST D3DMATRIX *pMatrix)
 {
+	Trace::Record(Trace::Call::MultiplyTransform, State, Trace::ByRef(pMatrix));
+
+	FlushDraws();
+
+	// The product is read back from the device when next needed
+	if (!ShadowState.IsRecording())
+	{
+		StateCache::Forget(ShadowState.Transform(State));
+	}
+
 	return ProxyInterface->MultiplyTransform(State, pMatrix);
 }
 
 HRESULT m_IDirect3DDevice8::ProcessVertices(THIS_ UINT SrcStartIndex, UINT DestIndex, UINT VertexCount, IDirect3DVertexBuffer8* pDestBuffer, DWORD Flags)
 {
+	Trace::Record(Trace::Call::ProcessVertices, SrcStartIndex, DestIndex, VertexCount, Trace::Id(pDestBuffer), Flags);
+
+	FlushDraws();
+
 	if (pDestBuffer)
 	{
 		pDestBuffer = static_cast<m_IDirect3DVertexBuffer8 *>(pDestBuffer)->GetProxyInterface();
@@ -401,51 +670,94 @@ HRESULT m_IDirect3DDevice8::ProcessVertices(THIS_ UINT SrcStartIndex, UINT DestI
 
 HRESULT m_IDirect3DDevice8::TestCooperativeLevel()
 {
+	Trace::Record(Trace::Call::TestCooperativeLevel);
+
 	return ProxyInterface->TestCooperativeLevel();
 }
 
 HRESULT m_IDirect3DDevice8::GetCurrentTexturePalette(UINT *pPaletteNumber)
 {
+	Trace::Record(Trace::Call::GetCurrentTexturePalette);
+
 	return ProxyInterface->GetCurrentTexturePalette(pPaletteNumber);
 }
 
 HRESULT m_IDirect3DDevice8::GetPaletteEntries(UINT PaletteNumber, PALETTEENTRY *pEntries)
 {
+	Trace::Record(Trace::Call::GetPaletteEntries, PaletteNumber);
+
 	return ProxyInterface->GetPaletteEntries(PaletteNumber, pEntries);
 }
 
 HRESULT m_IDirect3DDevice8::SetCurrentTexturePalette(UINT PaletteNumber)
 {
+	Trace::Record(Trace::Call::SetCurrentTexturePalette, PaletteNumber);
+
+	FlushDraws();
+
 	return ProxyInterface->SetCurrentTexturePalette(PaletteNumber);
 }
 
 HRESULT m_IDirect3DDevice8::SetPaletteEntries(UINT PaletteNumber, CONST PALETTEENTRY *pEntries)
 {
+	Trace::Record(Trace::Call::SetPaletteEntries, PaletteNumber, Trace::Block(pEntries, 256 * sizeof(PALETTEENTRY)));
+
+	FlushDraws();
+
 	return ProxyInterface->SetPaletteEntries(PaletteNumber, pEntries);
 }
 
 HRESULT m_IDirect3DDevice8::CreatePixelShader(THIS_ CONST DWORD* pFunction, DWORD* pHandle)
 {
-	return ProxyInterface->CreatePixelShader(pFunction, pHandle);
+	HRESULT hr = ProxyInterface->CreatePixelShader(pFunction, pHandle);
+
+	if (SUCCEEDED(hr) && pHandle)
+	{
+		Trace::Record(Trace::Call::CreatePixelShader, Trace::Block(pFunction, Trace::FunctionSize(pFunction)), *pHandle);
+	}
+
+	return hr;
 }
 
 HRESULT m_IDirect3DDevice8::GetPixelShader(THIS_ DWORD* pHandle)
 {
+	Trace::Record(Trace::Call::GetPixelShader);
+
 	return ProxyInterface->GetPixelShader(pHandle);
 }
 
 HRESULT m_IDirect3DDevice8::SetPixelShader(THIS_ DWORD Handle)
 {
-	return ProxyInterface->SetPixelShader(Handle);
+	Trace::Record(Trace::Call::SetPixelShader, Handle);
+
+	auto pSlot = ShadowState.PixelShader();
+	if (FilterState(pSlot, Handle))
+	{
+		return D3D_OK;
+	}
+
+	HRESULT hr = ProxyInterface->SetPixelShader(Handle);
+	ShadowState.Store(pSlot, Handle, hr);
+
+	return hr;
 }
 
 HRESULT m_IDirect3DDevice8::DeletePixelShader(THIS_ DWORD Handle)
 {
+	Trace::Record(Trace::Call::DeletePixelShader, Handle);
+
+	FlushDraws();
+
+	// The handle may be handed out again for a different shader
+	StateCache::Forget(ShadowState.PixelShader());
+
 	return ProxyInterface->DeletePixelShader(Handle);
 }
 
 HRESULT m_IDirect3DDevice8::GetPixelShaderFunction(THIS_ DWORD Handle, void* pData, DWORD* pSizeOfData)
 {
+	Trace::Record(Trace::Call::GetPixelShaderFunction, Handle);
+
 	return ProxyInterface->GetPixelShaderFunction(Handle, pData, pSizeOfData);
 }
 
@@ -456,36 +768,135 @@ HRESULT m_IDirect3DDevice8::GetPixelShaderFunction(THIS_ DWORD Handle, void* pDa
 
 HRESULT m_IDirect3DDevice8::DrawIndexedPrimitive(THIS_ D3DPRIMITIVETYPE Type, UINT MinVertexIndex, UINT NumVertices, UINT startIndex, UINT primCount)
 {
+	Trace::Record(Trace::Call::DrawIndexedPrimitive, Type, MinVertexIndex, NumVertices, startIndex, primCount);
+
+	FlushDraws();
+
 	return ProxyInterface->DrawIndexedPrimitive(Type, MinVertexIndex, NumVertices, startIndex, primCount);
 }
 
 HRESULT m_IDirect3DDevice8::DrawIndexedPrimitiveUP(D3DPRIMITIVETYPE PrimitiveType, UINT MinIndex, UINT NumVertices, UINT PrimitiveCount, CONST void *pIndexData, D3DFORMAT IndexDataFormat, CONST void *pVertexStreamZeroData, UINT VertexStreamZeroStride)
 {
+	Trace::Record(Trace::Call::DrawIndexedPrimitiveUP, PrimitiveType, MinIndex, NumVertices, PrimitiveCount, Trace::Block(pIndexData, PrimitiveVertexCount(PrimitiveType, PrimitiveCount) * (IndexDataFormat == D3DFMT_INDEX32 ? 4 : 2)), IndexDataFormat, Trace::Block(pVertexStreamZeroData ? static_cast<const BYTE *>(pVertexStreamZeroData) + MinIndex * VertexStreamZeroStride : nullptr, NumVertices * VertexStreamZeroStride), VertexStreamZeroStride);
+
+	FlushDraws();
+
+	Counters.UPDraws++;
+
+	// Between BeginStateBlock and EndStateBlock the bindings would end up in the block
+	if (bBufferUPDraws && IndexDataFormat == D3DFMT_INDEX16 && !ShadowState.IsRecording() && pVertexStreamZeroData)
+	{
+		UINT StartVertex, StartIndex;
+		if (UPBuffer.AppendVertices(ProxyInterface, static_cast<const BYTE *>(pVertexStreamZeroData) + MinIndex * VertexStreamZeroStride, NumVertices, VertexStreamZeroStride, MinIndex, StartVertex) &&
+			UPBuffer.AppendIndices(ProxyInterface, pIndexData, PrimitiveVertexCount(PrimitiveType, PrimitiveCount), StartIndex) &&
+			SUCCEEDED(BindStream(0, UPBuffer.GetVertexBuffer(), VertexStreamZeroStride)) &&
+			SUCCEEDED(BindIndices(UPBuffer.GetIndexBuffer(), StartVertex - MinIndex)))
+		{
+			Counters.UPDrawsBuffered++;
+			Counters.UPDrawCalls++;
+
+			return ProxyInterface->DrawIndexedPrimitive(PrimitiveType, MinIndex, NumVertices, StartIndex, PrimitiveCount);
+		}
+	}
+
+	// The runtime unbinds stream 0 and the index buffer after UP draws
+	StateCache::Forget(ShadowState.Stream(0));
+	StateCache::Forget(ShadowState.Indices());
+
 	return ProxyInterface->DrawIndexedPrimitiveUP(PrimitiveType, MinIndex, NumVertices, PrimitiveCount, pIndexData, IndexDataFormat, pVertexStreamZeroData, VertexStreamZeroStride);
 }
 
 HRESULT m_IDirect3DDevice8::DrawPrimitive(D3DPRIMITIVETYPE PrimitiveType, UINT StartVertex, UINT PrimitiveCount)
 {
+	Trace::Record(Trace::Call::DrawPrimitive, PrimitiveType, StartVertex, PrimitiveCount);
+
+	FlushDraws();
+
 	return ProxyInterface->DrawPrimitive(PrimitiveType, StartVertex, PrimitiveCount);
 }
 
 HRESULT m_IDirect3DDevice8::DrawPrimitiveUP(D3DPRIMITIVETYPE PrimitiveType, UINT PrimitiveCount, CONST void *pVertexStreamZeroData, UINT VertexStreamZeroStride)
 {
+	Trace::Record(Trace::Call::DrawPrimitiveUP, PrimitiveType, PrimitiveCount, Trace::Block(pVertexStreamZeroData, PrimitiveVertexCount(PrimitiveType, PrimitiveCount) * VertexStreamZeroStride), VertexStreamZeroStride);
+
+	Counters.UPDraws++;
+
+	if (bBufferUPDraws && !ShadowState.IsRecording())
+	{
+		const UINT VertexCount = PrimitiveVertexCount(PrimitiveType, PrimitiveCount);
+
+		// Lists can be joined into one draw when nothing happened in between and the vertices end up next to each other
+		const bool Mergeable = bMergeUPDraws && (PrimitiveType == D3DPT_TRIANGLELIST || PrimitiveType == D3DPT_LINELIST);
+		if (Pending.PrimitiveCount && !(Mergeable && Pending.Type == PrimitiveType && Pending.Stride == VertexStreamZeroStride && UPBuffer.VerticesFollow(VertexCount, VertexStreamZeroStride)))
+		{
+			FlushDraws();
+		}
+
+		UINT StartVertex;
+		if (UPBuffer.AppendVertices(ProxyInterface, pVertexStreamZeroData, VertexCount, VertexStreamZeroStride, 0, StartVertex) &&
+			(Pending.PrimitiveCount || SUCCEEDED(BindStream(0, UPBuffer.GetVertexBuffer(), VertexStreamZeroStride))))
+		{
+			Counters.UPDrawsBuffered++;
+
+			// The results of deferred draws are not known, they are reported as drawn
+			if (Pending.PrimitiveCount)
+			{
+				Pending.PrimitiveCount += PrimitiveCount;
+				return D3D_OK;
+			}
+			if (Mergeable)
+			{
+				Pending = { PrimitiveType, VertexStreamZeroStride, StartVertex, PrimitiveCount };
+				return D3D_OK;
+			}
+
+			Counters.UPDrawCalls++;
+			return ProxyInterface->DrawPrimitive(PrimitiveType, StartVertex, PrimitiveCount);
+		}
+	}
+
+	FlushDraws();
+
+	// The runtime unbinds stream 0 after UP draws
+	StateCache::Forget(ShadowState.Stream(0));
+
 	return ProxyInterface->DrawPrimitiveUP(PrimitiveType, PrimitiveCount, pVertexStreamZeroData, VertexStreamZeroStride);
 }
 
 HRESULT m_IDirect3DDevice8::BeginScene()
 {
+	Trace::Record(Trace::Call::BeginScene);
+
+	FlushDraws();
+
 	return ProxyInterface->BeginScene();
 }
 
 HRESULT m_IDirect3DDevice8::GetStreamSource(THIS_ UINT StreamNumber, IDirect3DVertexBuffer8** ppStreamData, UINT* pStride)
 {
+	Trace::Record(Trace::Call::GetStreamSource, StreamNumber);
+
 	HRESULT hr = ProxyInterface->GetStreamSource(StreamNumber, ppStreamData, pStride);
 
 	if (SUCCEEDED(hr) && ppStreamData)
 	{
-		*ppStreamData = ProxyAddressLookupTable->FindAddress<m_IDirect3DVertexBuffer8>(*ppStreamData);
+		if (*ppStreamData && *ppStreamData == UPBuffer.GetVertexBuffer())
+		{
+			(*ppStreamData)->Release();
+			*ppStreamData = nullptr;
+		}
+		else if (*ppStreamData)
+		{
+			// A rename got the reference, but the game releases the wrapper, which releases the original buffer
+			IDirect3DVertexBuffer8 *pProxy = *ppStreamData;
+			m_IDirect3DVertexBuffer8 *pBuffer = ProxyAddressLookupTable->FindAddress<m_IDirect3DVertexBuffer8>(pProxy);
+			if (pBuffer->IsRename(pProxy))
+			{
+				pBuffer->AddRef();
+				pProxy->Release();
+			}
+			*ppStreamData = pBuffer;
+		}
 	}
 
 	return hr;
@@ -493,16 +904,20 @@ HRESULT m_IDirect3DDevice8::GetStreamSource(THIS_ UINT StreamNumber, IDirect3DVe
 
 HRESULT m_IDirect3DDevice8::SetStreamSource(THIS_ UINT StreamNumber, IDirect3DVertexBuffer8* pStreamData, UINT Stride)
 {
+	Trace::Record(Trace::Call::SetStreamSource, StreamNumber, Trace::Id(pStreamData), Stride);
+
 	if (pStreamData)
 	{
 		pStreamData = static_cast<m_IDirect3DVertexBuffer8 *>(pStreamData)->GetProxyInterface();
 	}
 
-	return ProxyInterface->SetStreamSource(StreamNumber, pStreamData, Stride);
+	return BindStream(StreamNumber, pStreamData, Stride);
 }
 
 HRESULT m_IDirect3DDevice8::GetBackBuffer(THIS_ UINT iBackBuffer, D3DBACKBUFFER_TYPE Type, IDirect3DSurface8** ppBackBuffer)
 {
+	Trace::Record(Trace::Call::GetBackBuffer, iBackBuffer, Type);
+
 	HRESULT hr = ProxyInterface->GetBackBuffer(iBackBuffer, Type, ppBackBuffer);
 
 	if (SUCCEEDED(hr) && ppBackBuffer)
@@ -515,6 +930,8 @@ HRESULT m_IDirect3DDevice8::GetBackBuffer(THIS_ UINT iBackBuffer, D3DBACKBUFFER_
 
 HRESULT m_IDirect3DDevice8::GetDepthStencilSurface(IDirect3DSurface8 **ppZStencilSurface)
 {
+	Trace::Record(Trace::Call::GetDepthStencilSurface);
+
 	HRESULT hr = ProxyInterface->GetDepthStencilSurface(ppZStencilSurface);
 
 	if (SUCCEEDED(hr) && ppZStencilSurface)
@@ -527,6 +944,8 @@ HRESULT m_IDirect3DDevice8::GetDepthStencilSurface(IDirect3DSurface8 **ppZStenci
 
 HRESULT m_IDirect3DDevice8::GetTexture(DWORD Stage, IDirect3DBaseTexture8 **ppTexture)
 {
+	Trace::Record(Trace::Call::GetTexture, Stage);
+
 	HRESULT hr = ProxyInterface->GetTexture(Stage, ppTexture);
 
 	if (SUCCEEDED(hr) && ppTexture && *ppTexture)
@@ -534,8 +953,20 @@ HRESULT m_IDirect3DDevice8::GetTexture(DWORD Stage, IDirect3DBaseTexture8 **ppTe
 		switch ((*ppTexture)->GetType())
 		{
 		case D3DRTYPE_TEXTURE:
+		{
+			// A shared copy is handed back as the texture that was set, stages holding one always know it
+			m_IDirect3DTexture8 *pTexture = (Stage < MaxTextureStages && BoundTextures[Stage] && BoundTextures[Stage]->GetProxyInterface() == *ppTexture) ?
+				BoundTextures[Stage] : nullptr;
+			if (pTexture)
+			{
+				pTexture->AddRef();
+				(*ppTexture)->Release();
+				*ppTexture = pTexture;
+				break;
+			}
 			*ppTexture = ProxyAddressLookupTable->FindAddress<m_IDirect3DTexture8>(*ppTexture);
 			break;
+		}
 		case D3DRTYPE_VOLUMETEXTURE:
 			*ppTexture = ProxyAddressLookupTable->FindAddress<m_IDirect3DVolumeTexture8>(*ppTexture);
 			break;
@@ -552,17 +983,24 @@ HRESULT m_IDirect3DDevice8::GetTexture(DWORD Stage, IDirect3DBaseTexture8 **ppTe
 
 HRESULT m_IDirect3DDevice8::GetTextureStageState(DWORD Stage, D3DTEXTURESTAGESTATETYPE Type, DWORD *pValue)
 {
-	return ProxyInterface->GetTextureStageState(Stage, Type, pValue);
+	Trace::Record(Trace::Call::GetTextureStageState, Stage, Type);
+
+	return QueryState("GetTextureStageState", ShadowState.TextureStageState(Stage, Type), pValue,
+		[&](DWORD *pDeviceValue) { return ProxyInterface->GetTextureStageState(Stage, Type, pDeviceValue); });
 }
 
 HRESULT m_IDirect3DDevice8::SetTexture(DWORD Stage, IDirect3DBaseTexture8 *pTexture)
 {
+	Trace::Record(Trace::Call::SetTexture, Stage, Trace::Id(pTexture));
+
+	m_IDirect3DTexture8 *pWrapper = nullptr;
 	if (pTexture)
 	{
 		switch (pTexture->GetType())
 		{
 		case D3DRTYPE_TEXTURE:
-			pTexture = static_cast<m_IDirect3DTexture8 *>(pTexture)->GetProxyInterface();
+			pWrapper = static_cast<m_IDirect3DTexture8 *>(pTexture);
+			pTexture = ShadowState.IsRecording() ? pWrapper->GetOwnInterface() : pWrapper->GetProxyInterface();
 			break;
 		case D3DRTYPE_VOLUMETEXTURE:
 			pTexture = static_cast<m_IDirect3DVolumeTexture8 *>(pTexture)->GetProxyInterface();
@@ -575,16 +1013,38 @@ HRESULT m_IDirect3DDevice8::SetTexture(DWORD Stage, IDirect3DBaseTexture8 *pText
 		}
 	}
 
-	return ProxyInterface->SetTexture(Stage, pTexture);
+	HRESULT hr = BindTexture(Stage, pTexture);
+
+	if (SUCCEEDED(hr) && Stage < MaxTextureStages && !ShadowState.IsRecording())
+	{
+		BoundTextures[Stage] = pWrapper;
+	}
+
+	return hr;
 }
 
 HRESULT m_IDirect3DDevice8::SetTextureStageState(DWORD Stage, D3DTEXTURESTAGESTATETYPE Type, DWORD Value)
 {
-	return ProxyInterface->SetTextureStageState(Stage, Type, Value);
+	Trace::Record(Trace::Call::SetTextureStageState, Stage, Type, Value);
+
+	auto pSlot = ShadowState.TextureStageState(Stage, Type);
+	if (FilterState(pSlot, Value))
+	{
+		return D3D_OK;
+	}
+
+	HRESULT hr = ProxyInterface->SetTextureStageState(Stage, Type, Value);
+	ShadowState.Store(pSlot, Value, hr);
+
+	return hr;
 }
 
 HRESULT m_IDirect3DDevice8::UpdateTexture(IDirect3DBaseTexture8 *pSourceTexture, IDirect3DBaseTexture8 *pDestinationTexture)
 {
+	Trace::Record(Trace::Call::UpdateTexture, Trace::Id(pSourceTexture), Trace::Id(pDestinationTexture));
+
+	FlushDraws();
+
 	if (pSourceTexture)
 	{
 		switch (pSourceTexture->GetType())
@@ -625,86 +1085,167 @@ HRESULT m_IDirect3DDevice8::UpdateTexture(IDirect3DBaseTexture8 *pSourceTexture,
 
 HRESULT m_IDirect3DDevice8::ValidateDevice(DWORD *pNumPasses)
 {
+	Trace::Record(Trace::Call::ValidateDevice);
+
 	return ProxyInterface->ValidateDevice(pNumPasses);
 }
 
 HRESULT m_IDirect3DDevice8::GetClipPlane(DWORD Index, float *pPlane)
 {
-	return ProxyInterface->GetClipPlane(Index, pPlane);
+	Trace::Record(Trace::Call::GetClipPlane, Index);
+
+	return QueryState("GetClipPlane", ShadowState.Plane(Index), reinterpret_cast<StateCache::ClipPlane *>(pPlane),
+		[&](StateCache::ClipPlane *pDevicePlane) { return ProxyInterface->GetClipPlane(Index, pDevicePlane->Plane); });
 }
 
 HRESULT m_IDirect3DDevice8::SetClipPlane(DWORD Index, CONST float *pPlane)
 {
-	return ProxyInterface->SetClipPlane(Index, pPlane);
+	Trace::Record(Trace::Call::SetClipPlane, Index, Trace::ByRef(reinterpret_cast<const StateCache::ClipPlane *>(pPlane)));
+
+	FlushDraws();
+
+	HRESULT hr = ProxyInterface->SetClipPlane(Index, pPlane);
+
+	if (pPlane)
+	{
+		ShadowState.Store(ShadowState.Plane(Index), *reinterpret_cast<const StateCache::ClipPlane *>(pPlane), hr);
+	}
+
+	return hr;
 }
 
 HRESULT m_IDirect3DDevice8::Clear(DWORD Count, CONST D3DRECT *pRects, DWORD Flags, D3DCOLOR Color, float Z, DWORD Stencil)
 {
+	Trace::Record(Trace::Call::Clear, Count, Trace::Block(pRects, Count * sizeof(D3DRECT)), Flags, Color, Z, Stencil);
+
+	FlushDraws();
+
 	return ProxyInterface->Clear(Count, pRects, Flags, Color, Z, Stencil);
 }
 
 HRESULT m_IDirect3DDevice8::GetViewport(D3DVIEWPORT8 *pViewport)
 {
-	return ProxyInterface->GetViewport(pViewport);
+	Trace::Record(Trace::Call::GetViewport);
+
+	return QueryState("GetViewport", ShadowState.Viewport(), pViewport,
+		[&](D3DVIEWPORT8 *pDeviceViewport) { return ProxyInterface->GetViewport(pDeviceViewport); });
 }
 
 HRESULT m_IDirect3DDevice8::SetViewport(CONST D3DVIEWPORT8 *pViewport)
 {
-	return ProxyInterface->SetViewport(pViewport);
+	Trace::Record(Trace::Call::SetViewport, Trace::ByRef(pViewport));
+
+	FlushDraws();
+
+	HRESULT hr = ProxyInterface->SetViewport(pViewport);
+
+	if (pViewport)
+	{
+		ShadowState.Store(ShadowState.Viewport(), *pViewport, hr);
+	}
+
+	return hr;
 }
 
 HRESULT m_IDirect3DDevice8::CreateVertexShader(THIS_ CONST DWORD* pDeclaration, CONST DWORD* pFunction, DWORD* pHandle, DWORD Usage)
 {
-	return ProxyInterface->CreateVertexShader(pDeclaration, pFunction, pHandle, Usage);
+	HRESULT hr = ProxyInterface->CreateVertexShader(pDeclaration, pFunction, pHandle, Usage);
+
+	if (SUCCEEDED(hr) && pHandle)
+	{
+		Trace::Record(Trace::Call::CreateVertexShader, Trace::Block(pDeclaration, Trace::DeclarationSize(pDeclaration)), Trace::Block(pFunction, Trace::FunctionSize(pFunction)), Usage, *pHandle);
+	}
+
+	return hr;
 }
 
 HRESULT m_IDirect3DDevice8::GetVertexShader(THIS_ DWORD* pHandle)
 {
+	Trace::Record(Trace::Call::GetVertexShader);
+
 	return ProxyInterface->GetVertexShader(pHandle);
 }
 
 HRESULT m_IDirect3DDevice8::SetVertexShader(THIS_ DWORD Handle)
 {
-	return ProxyInterface->SetVertexShader(Handle);
+	Trace::Record(Trace::Call::SetVertexShader, Handle);
+
+	auto pSlot = ShadowState.VertexShader();
+	if (FilterState(pSlot, Handle))
+	{
+		return D3D_OK;
+	}
+
+	HRESULT hr = ProxyInterface->SetVertexShader(Handle);
+	ShadowState.Store(pSlot, Handle, hr);
+
+	return hr;
 }
 
 HRESULT m_IDirect3DDevice8::DeleteVertexShader(THIS_ DWORD Handle)
 {
+	Trace::Record(Trace::Call::DeleteVertexShader, Handle);
+
+	FlushDraws();
+
+	// The handle may be handed out again for a different shader
+	StateCache::Forget(ShadowState.VertexShader());
+
 	return ProxyInterface->DeleteVertexShader(Handle);
 }
 
 HRESULT m_IDirect3DDevice8::GetVertexShaderDeclaration(THIS_ DWORD Handle, void* pData, DWORD* pSizeOfData)
 {
+	Trace::Record(Trace::Call::GetVertexShaderDeclaration, Handle);
+
 	return ProxyInterface->GetVertexShaderDeclaration(Handle, pData, pSizeOfData);
 }
 
 HRESULT m_IDirect3DDevice8::GetVertexShaderFunction(THIS_ DWORD Handle, void* pData, DWORD* pSizeOfData)
 {
+	Trace::Record(Trace::Call::GetVertexShaderFunction, Handle);
+
 	return ProxyInterface->GetVertexShaderFunction(Handle, pData, pSizeOfData);
 }
 
 HRESULT m_IDirect3DDevice8::SetPixelShaderConstant(THIS_ DWORD Register, CONST void* pConstantData, DWORD ConstantCount)
 {
+	Trace::Record(Trace::Call::SetPixelShaderConstant, Register, Trace::Block(pConstantData, ConstantCount * 4 * sizeof(float)), ConstantCount);
+
+	FlushDraws();
+
 	return ProxyInterface->SetPixelShaderConstant(Register, pConstantData, ConstantCount);
 }
 
 HRESULT m_IDirect3DDevice8::GetPixelShaderConstant(THIS_ DWORD Register, void* pConstantData, DWORD ConstantCount)
 {
+	Trace::Record(Trace::Call::GetPixelShaderConstant, Register, ConstantCount);
+
 	return ProxyInterface->GetPixelShaderConstant(Register, pConstantData, ConstantCount);
 }
 
 HRESULT m_IDirect3DDevice8::SetVertexShaderConstant(THIS_ DWORD Register, CONST void* pConstantData, DWORD ConstantCount)
 {
+	Trace::Record(Trace::Call::SetVertexShaderConstant, Register, Trace::Block(pConstantData, ConstantCount * 4 * sizeof(float)), ConstantCount);
+
+	FlushDraws();
+
 	return ProxyInterface->SetVertexShaderConstant(Register, pConstantData, ConstantCount);
 }
 
 HRESULT m_IDirect3DDevice8::GetVertexShaderConstant(THIS_ DWORD Register, void* pConstantData, DWORD ConstantCount)
 {
+	Trace::Record(Trace::Call::GetVertexShaderConstant, Register, ConstantCount);
+
 	return ProxyInterface->GetVertexShaderConstant(Register, pConstantData, ConstantCount);
 }
 
 HRESULT m_IDirect3DDevice8::ResourceManagerDiscardBytes(THIS_ DWORD Bytes)
 {
+	Trace::Record(Trace::Call::ResourceManagerDiscardBytes, Bytes);
+
+	FlushDraws();
+
 	return ProxyInterface->ResourceManagerDiscardBytes(Bytes);
 }
 
@@ -715,6 +1256,8 @@ HRESULT m_IDirect3DDevice8::CreateImageSurface(THIS_ UINT Width, UINT Height, D3
 	if (SUCCEEDED(hr) && ppSurface)
 	{
 		*ppSurface = new m_IDirect3DSurface8(*ppSurface, this);
+
+		Trace::Record(Trace::Call::CreateImageSurface, Width, Height, Format, Trace::Id(*ppSurface));
 	}
 
 	return hr;
@@ -722,6 +1265,10 @@ HRESULT m_IDirect3DDevice8::CreateImageSurface(THIS_ UINT Width, UINT Height, D3
 
 HRESULT m_IDirect3DDevice8::CopyRects(THIS_ IDirect3DSurface8* pSourceSurface, CONST RECT* pSourceRectsArray, UINT cRects, IDirect3DSurface8* pDestinationSurface, CONST POINT* pDestPointsArray)
 {
+	Trace::Record(Trace::Call::CopyRects, Trace::Id(pSourceSurface), Trace::Block(pSourceRectsArray, cRects * sizeof(RECT)), cRects, Trace::Id(pDestinationSurface), Trace::Block(pDestPointsArray, cRects * sizeof(POINT)));
+
+	FlushDraws();
+
 	if (pSourceSurface)
 	{
 		pSourceSurface = static_cast<m_IDirect3DSurface8 *>(pSourceSurface)->GetProxyInterface();
@@ -737,6 +1284,8 @@ HRESULT m_IDirect3DDevice8::CopyRects(THIS_ IDirect3DSurface8* pSourceSurface, C
 
 HRESULT m_IDirect3DDevice8::GetFrontBuffer(THIS_ IDirect3DSurface8* pDestSurface)
 {
+	Trace::Record(Trace::Call::GetFrontBuffer, Trace::Id(pDestSurface));
+
 	if (pDestSurface)
 	{
 		pDestSurface = static_cast<m_IDirect3DSurface8 *>(pDestSurface)->GetProxyInterface();
@@ -747,5 +1296,7 @@ HRESULT m_IDirect3DDevice8::GetFrontBuffer(THIS_ IDirect3DSurface8* pDestSurface
 
 HRESULT m_IDirect3DDevice8::GetInfo(THIS_ DWORD DevInfoID, void* pDevInfoStruct, DWORD DevInfoStructSize)
 {
+	Trace::Record(Trace::Call::GetInfo, DevInfoID, DevInfoStructSize);
+
 	return ProxyInterface->GetInfo(DevInfoID, pDevInfoStruct, DevInfoStructSize);
 }
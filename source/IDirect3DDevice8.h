@@ -1,13 +1,136 @@
 #pragma once
 
+#include <stdio.h>
+#include <string.h>
+
 class m_IDirect3DDevice8 : public IDirect3DDevice8
 {
+public:
+	// Wrapper counters, reset at every Present
+	struct FrameCounters
+	{
+		DWORD StatesForwarded;
+		DWORD StatesFiltered;
+		DWORD UPDraws;
+		DWORD UPDrawsBuffered;
+		DWORD UPDrawCalls;			// draw calls the buffered UP draws were issued as
+		DWORD LockStallsAvoided;
+	};
+
 private:
 	LPDIRECT3DDEVICE8 ProxyInterface;
 	m_IDirect3D8* m_pD3D;
+	LONG GameReferences = 1;		// references the game holds, the proxy's count also has those of resources and wrapper buffers
+	StateCache ShadowState;
+	UserPrimitiveBuffer UPBuffer;
+	TextureDeduplicator TextureDedup;
+
+	// Texture wrappers set on each stage, so stages follow them onto and off shared copies; nullptr when not known
+	m_IDirect3DTexture8 *BoundTextures[MaxTextureStages] = {};
+
+	// Buffered UP list draws that were merged and not yet issued
+	struct PendingDraw
+	{
+		D3DPRIMITIVETYPE Type;
+		UINT Stride;
+		UINT StartVertex;
+		UINT PrimitiveCount;
+	};
+	PendingDraw Pending = {};
+	FrameCounters Counters = {};
+	FrameCounters LastCounters = {};
+	UINT FrameNumber = 0;
+
+	template <typename T>
+	bool FilterState(const StateCache::Slot<T> *pSlot, const T& Value)
+	{
+		if (ShadowState.IsRedundant(pSlot, Value))
+		{
+			Counters.StatesFiltered++;
+			return true;
+		}
+
+		FlushDraws();
+		Counters.StatesForwarded++;
+		return false;
+	}
+
+	// Binds proxy buffers and textures, skipping the call when they are bound already
+	HRESULT BindStream(UINT StreamNumber, IDirect3DVertexBuffer8 *pStreamData, UINT Stride)
+	{
+		auto pSlot = ShadowState.Stream(StreamNumber);
+		const StateCache::StreamSource Value = { pStreamData, Stride };
+		if (FilterState(pSlot, Value))
+		{
+			return D3D_OK;
+		}
+
+		HRESULT hr = ProxyInterface->SetStreamSource(StreamNumber, pStreamData, Stride);
+		ShadowState.Store(pSlot, Value, hr);
+
+		return hr;
+	}
+	HRESULT BindIndices(IDirect3DIndexBuffer8 *pIndexData, UINT BaseVertexIndex)
+	{
+		auto pSlot = ShadowState.Indices();
+		const StateCache::IndexSource Value = { pIndexData, BaseVertexIndex };
+		if (FilterState(pSlot, Value))
+		{
+			return D3D_OK;
+		}
+
+		HRESULT hr = ProxyInterface->SetIndices(pIndexData, BaseVertexIndex);
+		ShadowState.Store(pSlot, Value, hr);
+
+		return hr;
+	}
+
+	HRESULT BindTexture(DWORD Stage, IDirect3DBaseTexture8 *pTexture)
+	{
+		auto pSlot = ShadowState.Texture(Stage);
+		if (FilterState(pSlot, pTexture))
+		{
+			return D3D_OK;
+		}
+
+		HRESULT hr = ProxyInterface->SetTexture(Stage, pTexture);
+		ShadowState.Store(pSlot, pTexture, hr);
+
+		return hr;
+	}
+
+	// Answers a Get* call from the mirror, or from the device filling the mirror
+	template <typename T, typename Fetch>
+	HRESULT QueryState(const char *Name, StateCache::Slot<T> *pSlot, T *pValue, Fetch FetchFromDevice)
+	{
+		if (!pValue)
+		{
+			return D3DERR_INVALIDCALL;
+		}
+
+		if (ShadowState.Load(pSlot, *pValue))
+		{
+			T Actual;
+			if (bVerifyShadowState && SUCCEEDED(FetchFromDevice(&Actual)) && memcmp(&Actual, pValue, sizeof(T)) != 0)
+			{
+				char Message[128];
+				sprintf_s(Message, "d3d8: shadow state mismatch in %s, using device value\n", Name);
+				OutputDebugStringA(Message);
+
+				*pValue = Actual;
+				ShadowState.Store(pSlot, Actual, D3D_OK);
+			}
+			return D3D_OK;
+		}
+
+		HRESULT hr = FetchFromDevice(pValue);
+		ShadowState.Store(pSlot, *pValue, hr);
+
+		return hr;
+	}
 
 public:
-	m_IDirect3DDevice8(LPDIRECT3DDEVICE8 pDevice, m_IDirect3D8* pD3D) : ProxyInterface(pDevice), m_pD3D(pD3D)
+	m_IDirect3DDevice8(LPDIRECT3DDEVICE8 pDevice, m_IDirect3D8* pD3D) : ProxyInterface(pDevice), m_pD3D(pD3D), ShadowState(bFilterRedundantStates)
 	{
 		ProxyAddressLookupTable = new AddressLookupTable<m_IDirect3DDevice8>(this);
 	}
@@ -19,6 +142,104 @@ public:
 	LPDIRECT3DDEVICE8 GetProxyInterface() { return ProxyInterface; }
 	AddressLookupTable<m_IDirect3DDevice8> *ProxyAddressLookupTable;
 
+	// Issues merged UP draws; called before anything that could change what they draw or read their results
+	void FlushDraws()
+	{
+		if (Pending.PrimitiveCount)
+		{
+			ProxyInterface->DrawPrimitive(Pending.Type, Pending.StartVertex, Pending.PrimitiveCount);
+			Counters.UPDrawCalls++;
+			Pending.PrimitiveCount = 0;
+		}
+	}
+
+	void CountLockStallAvoided() { Counters.LockStallsAvoided++; }
+
+	// A renamed vertex buffer moved to other storage, streams still using the old one follow it
+	void RebindStream(IDirect3DVertexBuffer8 *pPrevious, IDirect3DVertexBuffer8 *pCurrent)
+	{
+		for (UINT x = 0; x < MaxStreams; x++)
+		{
+			StateCache::StreamSource Source;
+			if (!ShadowState.Load(ShadowState.Stream(x), Source))
+			{
+				Source = {};
+				if (FAILED(ProxyInterface->GetStreamSource(x, &Source.pStreamData, &Source.Stride)))
+				{
+					continue;
+				}
+				if (Source.pStreamData)
+				{
+					Source.pStreamData->Release();
+				}
+			}
+
+			if (Source.pStreamData == pPrevious)
+			{
+				BindStream(x, pCurrent, Source.Stride);
+			}
+		}
+	}
+
+	TextureDeduplicator& GetTextureDeduplicator() { return TextureDedup; }
+	const TextureDeduplicator& GetTextureDeduplicator() const { return TextureDedup; }
+
+	// A texture started or stopped drawing from a shared copy, stages it is set on follow
+	void RebindTexture(m_IDirect3DTexture8 *pTexture, IDirect3DBaseTexture8 *pCurrent)
+	{
+		// While a state block is recorded, calls only go into the block
+		if (ShadowState.IsRecording())
+		{
+			return;
+		}
+
+		for (UINT x = 0; x < MaxTextureStages; x++)
+		{
+			if (BoundTextures[x] == pTexture)
+			{
+				BindTexture(x, pCurrent);
+			}
+		}
+	}
+	// State blocks only ever get each texture's own texture, since a shared copy bound by a
+	// block would stay bound after the texture is written. Stages on a shared copy switch
+	// to the texture's own one while a block captures them and back once it has.
+	// Out of line, the texture wrapper is declared after this one
+	void BindOwnTextures(bool Own);
+
+	// Finds the texture wrappers set on each stage after a state block was applied
+	void FindBoundTextures();
+
+	void ForgetTexture(m_IDirect3DTexture8 *pTexture)
+	{
+		for (m_IDirect3DTexture8 *&pBound : BoundTextures)
+		{
+			if (pBound == pTexture)
+			{
+				pBound = nullptr;
+			}
+		}
+	}
+
+	// Default pool buffers have to go before a reset, and a reset device is back to default state
+	void BeforeReset()
+	{
+		FlushDraws();
+		UPBuffer.Release();
+		ShadowState.Invalidate();
+		memset(BoundTextures, 0, sizeof(BoundTextures));
+	}
+
+	UINT GetFrameNumber() const { return FrameNumber; }
+
+	const FrameCounters& GetLastFrameCounters() const { return LastCounters; }
+	void EndFrame()
+	{
+		LastCounters = Counters;
+		Counters = {};
+		FrameNumber++;
+	}
+
 	/*** IUnknown methods ***/
 	STDMETHOD(QueryInterface)(THIS_ REFIID riid, LPVOID * ppvObj);
 	STDMETHOD_(ULONG, AddRef)(THIS);
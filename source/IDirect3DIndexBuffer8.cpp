@@ -44,7 +44,16 @@ ULONG m_IDirect3DIndexBuffer8::AddRef(THIS)
 
 ULONG m_IDirect3DIndexBuffer8::Release(THIS)
 {
-	return ProxyInterface->Release();
+	ULONG ref = ProxyInterface->Release();
+
+	if (ref == 0)
+	{
+		Trace::Record(Trace::Call::Destroy, Trace::Id(this));
+
+		delete this;
+	}
+
+	return ref;
 }
 
 HRESULT m_IDirect3DIndexBuffer8::GetDevice(THIS_ IDirect3DDevice8** ppDevice)
@@ -98,11 +107,52 @@ D3DRESOURCETYPE m_IDirect3DIndexBuffer8::GetType(THIS)
 
 HRESULT m_IDirect3DIndexBuffer8::Lock(THIS_ UINT OffsetToLock, UINT SizeToLock, BYTE** ppbData, DWORD Flags)
 {
-	return ProxyInterface->Lock(OffsetToLock, SizeToLock, ppbData, Flags);
+	Trace::Record(Trace::Call::IndexBufferLock, Trace::Id(this), OffsetToLock, SizeToLock, Flags);
+
+	m_pDevice->FlushDraws();
+
+	if (bOptimizeLockFlags)
+	{
+		if (!LockPattern.HasDesc())
+		{
+			D3DINDEXBUFFER_DESC Desc;
+			if (SUCCEEDED(ProxyInterface->GetDesc(&Desc)))
+			{
+				LockPattern.SetDesc(Desc.Usage, Desc.Size);
+			}
+		}
+
+		const DWORD Promoted = LockPattern.Promote(OffsetToLock, SizeToLock, Flags);
+		if (Promoted != Flags)
+		{
+			m_pDevice->CountLockStallAvoided();
+			Flags = Promoted;
+		}
+	}
+
+	HRESULT hr = ProxyInterface->Lock(OffsetToLock, SizeToLock, ppbData, Flags);
+
+	if (SUCCEEDED(hr) && ppbData && Trace::Recorder::IsActive())
+	{
+		// A size of zero locks the rest of the buffer
+		D3DINDEXBUFFER_DESC Desc;
+		UINT Size = SizeToLock;
+		if (!Size && SUCCEEDED(ProxyInterface->GetDesc(&Desc)))
+		{
+			Size = Desc.Size - OffsetToLock;
+		}
+		TraceLock = { *ppbData, Size, 0 };
+	}
+
+	return hr;
 }
 
 HRESULT m_IDirect3DIndexBuffer8::Unlock(THIS)
 {
+	// Recorded before the memory goes away
+	Trace::Record(Trace::Call::IndexBufferUnlock, Trace::Id(this), Trace::Block(TraceLock.pData, TraceLock.Size));
+	TraceLock = {};
+
 	return ProxyInterface->Unlock();
 }
 
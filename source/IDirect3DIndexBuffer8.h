@@ -1,17 +1,22 @@
 #pragma once
 
-class m_IDirect3DIndexBuffer8 : public IDirect3DIndexBuffer8, public AddressLookupTableObject
+class m_IDirect3DIndexBuffer8 : public IDirect3DIndexBuffer8, public AddressLookupTableObject, public PooledObject<m_IDirect3DIndexBuffer8>
 {
 private:
 	LPDIRECT3DINDEXBUFFER8 ProxyInterface;
 	m_IDirect3DDevice8* m_pDevice;
+	Trace::PendingLock TraceLock = {};
+	LockFlagOptimizer LockPattern;
 
 public:
 	m_IDirect3DIndexBuffer8(LPDIRECT3DINDEXBUFFER8 pBuffer8, m_IDirect3DDevice8* pDevice) : ProxyInterface(pBuffer8), m_pDevice(pDevice)
 	{
 		m_pDevice->ProxyAddressLookupTable->SaveAddress(this, ProxyInterface);
 	}
-	~m_IDirect3DIndexBuffer8() {}
+	~m_IDirect3DIndexBuffer8()
+	{
+		m_pDevice->ProxyAddressLookupTable->DeleteAddress(this, ProxyInterface);
+	}
 
 	LPDIRECT3DINDEXBUFFER8 GetProxyInterface() { return ProxyInterface; }
 
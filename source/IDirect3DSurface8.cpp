@@ -44,7 +44,21 @@ ULONG m_IDirect3DSurface8::AddRef(THIS)
 
 ULONG m_IDirect3DSurface8::Release(THIS)
 {
-	return ProxyInterface->Release();
+	if (pContainer)
+	{
+		return pContainer->Release();
+	}
+
+	ULONG ref = ProxyInterface->Release();
+
+	if (ref == 0)
+	{
+		Trace::Record(Trace::Call::Destroy, Trace::Id(this));
+
+		delete this;
+	}
+
+	return ref;
 }
 
 HRESULT m_IDirect3DSurface8::GetDevice(THIS_ IDirect3DDevice8** ppDevice)
@@ -95,10 +109,26 @@ HRESULT m_IDirect3DSurface8::GetDesc(THIS_ D3DSURFACE_DESC *pDesc)
 
 HRESULT m_IDirect3DSurface8::LockRect(THIS_ D3DLOCKED_RECT* pLockedRect, CONST RECT* pRect, DWORD Flags)
 {
-	return ProxyInterface->LockRect(pLockedRect, pRect, Flags);
+	Trace::Record(Trace::Call::SurfaceLockRect, Trace::Id(this), Trace::ByRef(pRect), Flags);
+
+	m_pDevice->FlushDraws();
+
+	HRESULT hr = ProxyInterface->LockRect(pLockedRect, pRect, Flags);
+
+	D3DSURFACE_DESC Desc;
+	if (SUCCEEDED(hr) && pLockedRect && Trace::Recorder::IsActive() && SUCCEEDED(ProxyInterface->GetDesc(&Desc)))
+	{
+		const UINT Height = pRect ? pRect->bottom - pRect->top : Desc.Height;
+		TraceLock = { pLockedRect->pBits, Trace::LockedRectSize(Desc.Format, *pLockedRect, Height), 0 };
+	}
+
+	return hr;
 }
 
 HRESULT m_IDirect3DSurface8::UnlockRect(THIS)
 {
+	Trace::Record(Trace::Call::SurfaceUnlockRect, Trace::Id(this), Trace::Block(TraceLock.pData, TraceLock.Size));
+	TraceLock = {};
+
 	return ProxyInterface->UnlockRect();
 }
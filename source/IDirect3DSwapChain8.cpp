@@ -44,11 +44,22 @@ ULONG m_IDirect3DSwapChain8::AddRef(THIS)
 
 ULONG m_IDirect3DSwapChain8::Release(THIS)
 {
-	return ProxyInterface->Release();
+	ULONG ref = ProxyInterface->Release();
+
+	if (ref == 0)
+	{
+		Trace::Record(Trace::Call::Destroy, Trace::Id(this));
+
+		delete this;
+	}
+
+	return ref;
 }
 
 HRESULT m_IDirect3DSwapChain8::Present(THIS_ CONST RECT* pSourceRect, CONST RECT* pDestRect, HWND hDestWindowOverride, CONST RGNDATA* pDirtyRegion)
 {
+	m_pDevice->FlushDraws();
+
 	return ProxyInterface->Present(pSourceRect, pDestRect, hDestWindowOverride, pDirtyRegion);
 }
 
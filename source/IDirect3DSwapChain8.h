@@ -1,6 +1,6 @@
 #pragma once
 
-class m_IDirect3DSwapChain8 : public IDirect3DSwapChain8, public AddressLookupTableObject
+class m_IDirect3DSwapChain8 : public IDirect3DSwapChain8, public AddressLookupTableObject, public PooledObject<m_IDirect3DSwapChain8>
 {
 private:
 	LPDIRECT3DSWAPCHAIN8 ProxyInterface;
@@ -11,7 +11,10 @@ public:
 	{
 		m_pDevice->ProxyAddressLookupTable->SaveAddress(this, ProxyInterface);
 	}
-	~m_IDirect3DSwapChain8() {}
+	~m_IDirect3DSwapChain8()
+	{
+		m_pDevice->ProxyAddressLookupTable->DeleteAddress(this, ProxyInterface);
+	}
 
 	LPDIRECT3DSWAPCHAIN8 GetProxyInterface() { return ProxyInterface; }
 
@@ -44,7 +44,16 @@ ULONG m_IDirect3DTexture8::AddRef(THIS)
 
 ULONG m_IDirect3DTexture8::Release(THIS)
 {
-	return ProxyInterface->Release();
+	ULONG ref = ProxyInterface->Release();
+
+	if (ref == 0)
+	{
+		Trace::Record(Trace::Call::Destroy, Trace::Id(this));
+
+		delete this;
+	}
+
+	return ref;
 }
 
 HRESULT m_IDirect3DTexture8::GetDevice(THIS_ IDirect3DDevice8** ppDevice)
@@ -88,7 +97,7 @@ DWORD m_IDirect3DTexture8::GetPriority(THIS)
 
 void m_IDirect3DTexture8::PreLoad(THIS)
 {
-	return ProxyInterface->PreLoad();
+	return GetProxyInterface()->PreLoad();
 }
 
 D3DRESOURCETYPE m_IDirect3DTexture8::GetType(THIS)
@@ -118,11 +127,26 @@ HRESULT m_IDirect3DTexture8::GetLevelDesc(THIS_ UINT Level, D3DSURFACE_DESC *pDe
 
 HRESULT m_IDirect3DTexture8::GetSurfaceLevel(THIS_ UINT Level, IDirect3DSurface8** ppSurfaceLevel)
 {
+	// The surface can be written to without the texture seeing it
+	if (Content.IsActive())
+	{
+		Content.Stop();
+		Unshare();
+	}
+
 	HRESULT hr = ProxyInterface->GetSurfaceLevel(Level, ppSurfaceLevel);
 
 	if (SUCCEEDED(hr) && ppSurfaceLevel)
 	{
-		*ppSurfaceLevel = m_pDevice->ProxyAddressLookupTable->FindAddress<m_IDirect3DSurface8>(*ppSurfaceLevel);
+		if (Level >= SurfaceLevels.size())
+		{
+			SurfaceLevels.resize(Level + 1, nullptr);
+		}
+		SurfaceLevels[Level] = *ppSurfaceLevel;
+
+		m_IDirect3DSurface8 *pSurface = m_pDevice->ProxyAddressLookupTable->FindAddress<m_IDirect3DSurface8>(*ppSurfaceLevel);
+		pSurface->SetContainer(this);
+		*ppSurfaceLevel = pSurface;
 	}
 
 	return hr;
@@ -130,15 +154,91 @@ HRESULT m_IDirect3DTexture8::GetSurfaceLevel(THIS_ UINT Level, IDirect3DSurface8
 
 HRESULT m_IDirect3DTexture8::LockRect(THIS_ UINT Level, D3DLOCKED_RECT* pLockedRect, CONST RECT* pRect, DWORD Flags)
 {
-	return ProxyInterface->LockRect(Level, pLockedRect, pRect, Flags);
+	Trace::Record(Trace::Call::TextureLockRect, Trace::Id(this), Level, Trace::ByRef(pRect), Flags);
+
+	m_pDevice->FlushDraws();
+
+	// Writes go to the texture's own copy, which still holds what it shared
+	const bool Write = !(Flags & D3DLOCK_READONLY);
+	if (Write && !Content.WriteLock(Level, pRect))
+	{
+		Unshare();
+	}
+
+	HRESULT hr = ProxyInterface->LockRect(Level, pLockedRect, pRect, Flags);
+
+	D3DSURFACE_DESC Desc;
+	const bool Hash = Write && Content.IsActive();
+	if (SUCCEEDED(hr) && pLockedRect && (Trace::Recorder::IsActive() || Hash) && SUCCEEDED(ProxyInterface->GetLevelDesc(Level, &Desc)))
+	{
+		if (Trace::Recorder::IsActive())
+		{
+			const UINT Height = pRect ? pRect->bottom - pRect->top : Desc.Height;
+			TraceLock = { pLockedRect->pBits, Trace::LockedRectSize(Desc.Format, *pLockedRect, Height), Level };
+		}
+		if (Hash)
+		{
+			Content.Locked(Level, Desc.Format, Desc.Height, *pLockedRect);
+		}
+	}
+
+	return hr;
 }
 
 HRESULT m_IDirect3DTexture8::UnlockRect(THIS_ UINT Level)
 {
-	return ProxyInterface->UnlockRect(Level);
+	// Only the last lock is kept, an unlock of another level records no contents
+	const bool Match = TraceLock.pData && TraceLock.Key == Level;
+	Trace::Record(Trace::Call::TextureUnlockRect, Trace::Id(this), Level, Trace::Block(Match ? TraceLock.pData : nullptr, TraceLock.Size));
+	if (Match)
+	{
+		TraceLock = {};
+	}
+
+	const bool Complete = Content.Unlocking(Level);
+
+	HRESULT hr = ProxyInterface->UnlockRect(Level);
+
+	if (SUCCEEDED(hr) && Complete)
+	{
+		Share();
+	}
+
+	return hr;
 }
 
 HRESULT m_IDirect3DTexture8::AddDirtyRect(THIS_ CONST RECT* pDirtyRect)
 {
 	return ProxyInterface->AddDirtyRect(pDirtyRect);
 }
+
+void m_IDirect3DTexture8::Share()
+{
+	m_IDirect3DTexture8 *pFirst;
+	LPDIRECT3DTEXTURE8 pTexture = m_pDevice->GetTextureDeduplicator().Join(m_pDevice->GetProxyInterface(), this, ProxyInterface, Content, pFirst);
+
+	if (pTexture)
+	{
+		if (pFirst)
+		{
+			pFirst->SetShared(pTexture);
+		}
+		SetShared(pTexture);
+	}
+}
+
+void m_IDirect3DTexture8::Unshare()
+{
+	m_pDevice->GetTextureDeduplicator().Leave(this, Content);
+
+	SetShared(nullptr);
+}
+
+void m_IDirect3DTexture8::SetShared(LPDIRECT3DTEXTURE8 pTexture)
+{
+	if (pShared != pTexture)
+	{
+		pShared = pTexture;
+		m_pDevice->RebindTexture(this, GetProxyInterface());
+	}
+}
@@ -1,19 +1,47 @@
 #pragma once
 
-class m_IDirect3DTexture8 : public IDirect3DTexture8, public AddressLookupTableObject
+class m_IDirect3DTexture8 : public IDirect3DTexture8, public AddressLookupTableObject, public PooledObject<m_IDirect3DTexture8>
 {
 private:
 	LPDIRECT3DTEXTURE8 ProxyInterface;
 	m_IDirect3DDevice8* m_pDevice;
+	Trace::PendingLock TraceLock = {};
+	TextureContent Content;
+	LPDIRECT3DTEXTURE8 pShared = nullptr;
+	std::vector<LPDIRECT3DSURFACE8> SurfaceLevels;	// by level, the levels handed out
+
+	void Share();
+	void Unshare();
+	void SetShared(LPDIRECT3DTEXTURE8 pTexture);
 
 public:
 	m_IDirect3DTexture8(LPDIRECT3DTEXTURE8 pTexture8, m_IDirect3DDevice8* pDevice) : ProxyInterface(pTexture8), m_pDevice(pDevice)
 	{
 		m_pDevice->ProxyAddressLookupTable->SaveAddress(this, ProxyInterface);
+
+		if (bDeduplicateTextures)
+		{
+			Content.Start(ProxyInterface);
+		}
+	}
+	~m_IDirect3DTexture8()
+	{
+		if (Content.IsComplete())
+		{
+			m_pDevice->GetTextureDeduplicator().Leave(this, Content);
+		}
+		m_pDevice->ForgetTexture(this);
+		for (LPDIRECT3DSURFACE8 pSurface : SurfaceLevels)
+		{
+			m_pDevice->ProxyAddressLookupTable->DeleteSavedAddress<m_IDirect3DSurface8>(pSurface);
+		}
+		m_pDevice->ProxyAddressLookupTable->DeleteAddress(this, ProxyInterface);
 	}
-	~m_IDirect3DTexture8() {}
 
-	LPDIRECT3DTEXTURE8 GetProxyInterface() { return ProxyInterface; }
+	// The texture drawn from, a copy shared with textures of the same contents when there is one
+	LPDIRECT3DTEXTURE8 GetProxyInterface() { return pShared ? pShared : ProxyInterface; }
+	// Its own texture, which is what state blocks are given
+	LPDIRECT3DTEXTURE8 GetOwnInterface() { return ProxyInterface; }
 
 	/*** IUnknown methods ***/
 	STDMETHOD(QueryInterface)(THIS_ REFIID riid, void** ppvObj);
@@ -44,7 +44,16 @@ ULONG m_IDirect3DVertexBuffer8::AddRef(THIS)
 
 ULONG m_IDirect3DVertexBuffer8::Release(THIS)
 {
-	return ProxyInterface->Release();
+	ULONG ref = ProxyInterface->Release();
+
+	if (ref == 0)
+	{
+		Trace::Record(Trace::Call::Destroy, Trace::Id(this));
+
+		delete this;
+	}
+
+	return ref;
 }
 
 HRESULT m_IDirect3DVertexBuffer8::GetDevice(THIS_ IDirect3DDevice8** ppDevice)
@@ -98,12 +107,93 @@ D3DRESOURCETYPE m_IDirect3DVertexBuffer8::GetType(THIS)
 
 HRESULT m_IDirect3DVertexBuffer8::Lock(THIS_ UINT OffsetToLock, UINT SizeToLock, BYTE** ppbData, DWORD Flags)
 {
-	return ProxyInterface->Lock(OffsetToLock, SizeToLock, ppbData, Flags);
+	Trace::Record(Trace::Call::VertexBufferLock, Trace::Id(this), OffsetToLock, SizeToLock, Flags);
+
+	// Merged draws still to be issued may read this resource
+	m_pDevice->FlushDraws();
+
+	if (bOptimizeLockFlags)
+	{
+		if (!LockPattern.HasDesc())
+		{
+			D3DVERTEXBUFFER_DESC Desc;
+			if (SUCCEEDED(ProxyInterface->GetDesc(&Desc)))
+			{
+				LockPattern.SetDesc(Desc.Usage, Desc.Size);
+			}
+		}
+
+		const DWORD Promoted = LockPattern.Promote(OffsetToLock, SizeToLock, Flags);
+		if (Promoted != Flags)
+		{
+			m_pDevice->CountLockStallAvoided();
+			Flags = Promoted;
+		}
+	}
+
+	HRESULT hr;
+	if (Renamer.IsActive())
+	{
+		hr = (ppbData && (*ppbData = Renamer.Lock(OffsetToLock, SizeToLock, Flags)) != nullptr) ? D3D_OK : D3DERR_INVALIDCALL;
+	}
+	else
+	{
+		hr = ProxyInterface->Lock(OffsetToLock, SizeToLock, ppbData, Flags);
+		if (SUCCEEDED(hr))
+		{
+			Renamer.ProxyLocked(Flags);
+		}
+	}
+
+	if (SUCCEEDED(hr) && ppbData && Trace::Recorder::IsActive())
+	{
+		// A size of zero locks the rest of the buffer
+		D3DVERTEXBUFFER_DESC Desc;
+		UINT Size = SizeToLock;
+		if (!Size && SUCCEEDED(ProxyInterface->GetDesc(&Desc)))
+		{
+			Size = Desc.Size - OffsetToLock;
+		}
+		TraceLock = { *ppbData, Size, 0 };
+	}
+
+	return hr;
 }
 
 HRESULT m_IDirect3DVertexBuffer8::Unlock(THIS)
 {
-	return ProxyInterface->Unlock();
+	// Recorded before the memory goes away
+	Trace::Record(Trace::Call::VertexBufferUnlock, Trace::Id(this), Trace::Block(TraceLock.pData, TraceLock.Size));
+	TraceLock = {};
+
+	if (Renamer.IsActive())
+	{
+		IDirect3DVertexBuffer8 *pPrevious = Renamer.GetCurrent();
+		bool Switched;
+		if (!Renamer.Unlock(m_pDevice->GetFrameNumber(), Switched))
+		{
+			OutputDebugStringA("d3d8: could not upload a renamed vertex buffer\n");
+			return D3DERR_INVALIDCALL;
+		}
+		if (Switched)
+		{
+			m_pDevice->RebindStream(pPrevious, Renamer.GetCurrent());
+		}
+		return D3D_OK;
+	}
+
+	HRESULT hr = ProxyInterface->Unlock();
+
+	if (SUCCEEDED(hr) && Renamer.ProxyUnlocked() && bRenameLockedBuffers && Renamer.Start(m_pDevice->GetProxyInterface(), ProxyInterface))
+	{
+		for (UINT x = 0; x < BufferRenamer::MaxRenames; x++)
+		{
+			m_pDevice->ProxyAddressLookupTable->SaveAddress(this, Renamer.GetRename(x));
+		}
+		m_pDevice->RebindStream(ProxyInterface, Renamer.GetCurrent());
+	}
+
+	return hr;
 }
 
 HRESULT m_IDirect3DVertexBuffer8::GetDesc(THIS_ D3DVERTEXBUFFER_DESC *pDesc)
@@ -1,19 +1,31 @@
 #pragma once
 
-class m_IDirect3DVertexBuffer8 : public IDirect3DVertexBuffer8, public AddressLookupTableObject
+class m_IDirect3DVertexBuffer8 : public IDirect3DVertexBuffer8, public AddressLookupTableObject, public PooledObject<m_IDirect3DVertexBuffer8>
 {
 private:
 	LPDIRECT3DVERTEXBUFFER8 ProxyInterface;
 	m_IDirect3DDevice8* m_pDevice;
+	Trace::PendingLock TraceLock = {};
+	LockFlagOptimizer LockPattern;
+	BufferRenamer Renamer;
 
 public:
 	m_IDirect3DVertexBuffer8(LPDIRECT3DVERTEXBUFFER8 pBuffer8, m_IDirect3DDevice8* pDevice) : ProxyInterface(pBuffer8), m_pDevice(pDevice)
 	{
 		m_pDevice->ProxyAddressLookupTable->SaveAddress(this, ProxyInterface);
 	}
-	~m_IDirect3DVertexBuffer8() {}
+	~m_IDirect3DVertexBuffer8()
+	{
+		for (UINT x = 0; x < BufferRenamer::MaxRenames; x++)
+		{
+			m_pDevice->ProxyAddressLookupTable->DeleteAddress(this, Renamer.GetRename(x));
+		}
+		m_pDevice->ProxyAddressLookupTable->DeleteAddress(this, ProxyInterface);
+	}
 
-	LPDIRECT3DVERTEXBUFFER8 GetProxyInterface() { return ProxyInterface; }
+	// The buffer to bind, which is the current rename once the buffer is renamed
+	LPDIRECT3DVERTEXBUFFER8 GetProxyInterface() { return Renamer.IsActive() ? Renamer.GetCurrent() : ProxyInterface; }
+	bool IsRename(IDirect3DVertexBuffer8 *pBuffer) const { return pBuffer != ProxyInterface && Renamer.IsRename(pBuffer); }
 
 	/*** IUnknown methods ***/
 	STDMETHOD(QueryInterface)(THIS_ REFIID riid, void** ppvObj);
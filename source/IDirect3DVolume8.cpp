@@ -44,7 +44,21 @@ ULONG m_IDirect3DVolume8::AddRef(THIS)
 
 ULONG m_IDirect3DVolume8::Release(THIS)
 {
-	return ProxyInterface->Release();
+	if (pContainer)
+	{
+		return pContainer->Release();
+	}
+
+	ULONG ref = ProxyInterface->Release();
+
+	if (ref == 0)
+	{
+		Trace::Record(Trace::Call::Destroy, Trace::Id(this));
+
+		delete this;
+	}
+
+	return ref;
 }
 
 HRESULT m_IDirect3DVolume8::GetDevice(THIS_ IDirect3DDevice8** ppDevice)
@@ -95,10 +109,26 @@ HRESULT m_IDirect3DVolume8::GetDesc(THIS_ D3DVOLUME_DESC *pDesc)
 
 HRESULT m_IDirect3DVolume8::LockBox(THIS_ D3DLOCKED_BOX * pLockedVolume, CONST D3DBOX* pBox, DWORD Flags)
 {
-	return ProxyInterface->LockBox(pLockedVolume, pBox, Flags);
+	Trace::Record(Trace::Call::VolumeLockBox, Trace::Id(this), Trace::ByRef(pBox), Flags);
+
+	m_pDevice->FlushDraws();
+
+	HRESULT hr = ProxyInterface->LockBox(pLockedVolume, pBox, Flags);
+
+	D3DVOLUME_DESC Desc;
+	if (SUCCEEDED(hr) && pLockedVolume && Trace::Recorder::IsActive() && SUCCEEDED(ProxyInterface->GetDesc(&Desc)))
+	{
+		const UINT Depth = pBox ? pBox->Back - pBox->Front : Desc.Depth;
+		TraceLock = { pLockedVolume->pBits, (size_t)pLockedVolume->SlicePitch * Depth, 0 };
+	}
+
+	return hr;
 }
 
 HRESULT m_IDirect3DVolume8::UnlockBox(THIS)
 {
+	Trace::Record(Trace::Call::VolumeUnlockBox, Trace::Id(this), Trace::Block(TraceLock.pData, TraceLock.Size));
+	TraceLock = {};
+
 	return ProxyInterface->UnlockBox();
 }
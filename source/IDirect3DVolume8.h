@@ -1,20 +1,28 @@
 #pragma once
 
-class m_IDirect3DVolume8 : public IDirect3DVolume8, public AddressLookupTableObject
+class m_IDirect3DVolume8 : public IDirect3DVolume8, public AddressLookupTableObject, public PooledObject<m_IDirect3DVolume8>
 {
 private:
 	LPDIRECT3DVOLUME8 ProxyInterface;
 	m_IDirect3DDevice8* m_pDevice;
+	Trace::PendingLock TraceLock = {};
+	IUnknown *pContainer = nullptr;
 
 public:
 	m_IDirect3DVolume8(LPDIRECT3DVOLUME8 pVolume8, m_IDirect3DDevice8* pDevice) : ProxyInterface(pVolume8), m_pDevice(pDevice)
 	{
 		m_pDevice->ProxyAddressLookupTable->SaveAddress(this, ProxyInterface);
 	}
-	~m_IDirect3DVolume8() {}
+	~m_IDirect3DVolume8()
+	{
+		m_pDevice->ProxyAddressLookupTable->DeleteAddress(this, ProxyInterface);
+	}
 
 	LPDIRECT3DVOLUME8 GetProxyInterface() { return ProxyInterface; }
 
+	// A level of a texture, which shares the texture's reference count and is deleted with its wrapper
+	void SetContainer(IUnknown *pTexture) { pContainer = pTexture; }
+
 	/*** IUnknown methods ***/
 	STDMETHOD(QueryInterface)(THIS_ REFIID riid, void** ppvObj);
 	STDMETHOD_(ULONG, AddRef)(THIS);
@@ -44,7 +44,16 @@ ULONG m_IDirect3DVolumeTexture8::AddRef(THIS)
 
 ULONG m_IDirect3DVolumeTexture8::Release(THIS)
 {
-	return ProxyInterface->Release();
+	ULONG ref = ProxyInterface->Release();
+
+	if (ref == 0)
+	{
+		Trace::Record(Trace::Call::Destroy, Trace::Id(this));
+
+		delete this;
+	}
+
+	return ref;
 }
 
 HRESULT m_IDirect3DVolumeTexture8::GetDevice(THIS_ IDirect3DDevice8** ppDevice)
@@ -122,7 +131,15 @@ HRESULT m_IDirect3DVolumeTexture8::GetVolumeLevel(THIS_ UINT Level, IDirect3DVol
 
 	if (SUCCEEDED(hr) && ppVolumeLevel)
 	{
-		*ppVolumeLevel = m_pDevice->ProxyAddressLookupTable->FindAddress<m_IDirect3DVolume8>(*ppVolumeLevel);
+		if (Level >= VolumeLevels.size())
+		{
+			VolumeLevels.resize(Level + 1, nullptr);
+		}
+		VolumeLevels[Level] = *ppVolumeLevel;
+
+		m_IDirect3DVolume8 *pVolume = m_pDevice->ProxyAddressLookupTable->FindAddress<m_IDirect3DVolume8>(*ppVolumeLevel);
+		pVolume->SetContainer(this);
+		*ppVolumeLevel = pVolume;
 	}
 
 	return hr;
@@ -130,11 +147,32 @@ HRESULT m_IDirect3DVolumeTexture8::GetVolumeLevel(THIS_ UINT Level, IDirect3DVol
 
 HRESULT m_IDirect3DVolumeTexture8::LockBox(THIS_ UINT Level, D3DLOCKED_BOX* pLockedVolume, CONST D3DBOX* pBox, DWORD Flags)
 {
-	return ProxyInterface->LockBox(Level, pLockedVolume, pBox, Flags);
+	Trace::Record(Trace::Call::VolumeTextureLockBox, Trace::Id(this), Level, Trace::ByRef(pBox), Flags);
+
+	m_pDevice->FlushDraws();
+
+	HRESULT hr = ProxyInterface->LockBox(Level, pLockedVolume, pBox, Flags);
+
+	D3DVOLUME_DESC Desc;
+	if (SUCCEEDED(hr) && pLockedVolume && Trace::Recorder::IsActive() && SUCCEEDED(ProxyInterface->GetLevelDesc(Level, &Desc)))
+	{
+		const UINT Depth = pBox ? pBox->Back - pBox->Front : Desc.Depth;
+		TraceLock = { pLockedVolume->pBits, (size_t)pLockedVolume->SlicePitch * Depth, Level };
+	}
+
+	return hr;
 }
 
 HRESULT m_IDirect3DVolumeTexture8::UnlockBox(THIS_ UINT Level)
 {
+	// Only the last lock is kept, an unlock of another level records no contents
+	const bool Match = TraceLock.pData && TraceLock.Key == Level;
+	Trace::Record(Trace::Call::VolumeTextureUnlockBox, Trace::Id(this), Level, Trace::Block(Match ? TraceLock.pData : nullptr, TraceLock.Size));
+	if (Match)
+	{
+		TraceLock = {};
+	}
+
 	return ProxyInterface->UnlockBox(Level);
 }
 
@@ -1,17 +1,26 @@
 #pragma once
 
-class m_IDirect3DVolumeTexture8 : public IDirect3DVolumeTexture8, public AddressLookupTableObject
+class m_IDirect3DVolumeTexture8 : public IDirect3DVolumeTexture8, public AddressLookupTableObject, public PooledObject<m_IDirect3DVolumeTexture8>
 {
 private:
 	LPDIRECT3DVOLUMETEXTURE8 ProxyInterface;
 	m_IDirect3DDevice8* m_pDevice;
+	Trace::PendingLock TraceLock = {};
+	std::vector<LPDIRECT3DVOLUME8> VolumeLevels;	// by level, the levels handed out
 
 public:
 	m_IDirect3DVolumeTexture8(LPDIRECT3DVOLUMETEXTURE8 pTexture8, m_IDirect3DDevice8* pDevice) : ProxyInterface(pTexture8), m_pDevice(pDevice)
 	{
 		m_pDevice->ProxyAddressLookupTable->SaveAddress(this, ProxyInterface);
 	}
-	~m_IDirect3DVolumeTexture8() {}
+	~m_IDirect3DVolumeTexture8()
+	{
+		for (LPDIRECT3DVOLUME8 pVolume : VolumeLevels)
+		{
+			m_pDevice->ProxyAddressLookupTable->DeleteSavedAddress<m_IDirect3DVolume8>(pVolume);
+		}
+		m_pDevice->ProxyAddressLookupTable->DeleteAddress(this, ProxyInterface);
+	}
 
 	LPDIRECT3DVOLUMETEXTURE8 GetProxyInterface() { return ProxyInterface; }
 
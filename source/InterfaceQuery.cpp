@@ -36,6 +36,10 @@ void genericQueryInterface(REFIID riid, LPVOID *ppvObj, m_IDirect3DDevice8* m_pD
 
 	if (riid == IID_IDirect3DDevice8)
 	{
+		// The proxy's QueryInterface added the reference, count it as the game's
+		m_pDevice->AddRef();
+		m_pDevice->GetProxyInterface()->Release();
+
 		*ppvObj = m_pDevice;
 		return;
 	}
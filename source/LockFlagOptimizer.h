@@ -0,0 +1,68 @@
+#pragma once
+
+// Adds D3DLOCK_NOOVERWRITE or D3DLOCK_DISCARD to vertex and index buffer
+// locks that the game makes with neither, so the runtime does not wait for
+// the GPU to finish with the buffer. Only dynamic, write-only buffers are
+// touched, and the highest byte locked since the last start over is tracked.
+//  - a lock that starts at or past that byte writes memory no draw since the
+//    last start over can use, so it gets NOOVERWRITE
+//  - a lock of the whole buffer after at least one such append starts over,
+//    so it gets DISCARD and the runtime hands out fresh memory. DISCARD drops
+//    all of the old contents, so a lock of only part of the buffer is left
+//    alone even at offset 0: the game may still draw from the rest.
+// Once the game passes NOOVERWRITE, DISCARD or READONLY itself, its flags are
+// left alone from then on.
+class LockFlagOptimizer
+{
+public:
+	bool HasDesc() const { return BufferSize != 0 || Disabled; }
+
+	void SetDesc(DWORD Usage, UINT Size)
+	{
+		BufferSize = Size;
+		Disabled = (Usage & (D3DUSAGE_DYNAMIC | D3DUSAGE_WRITEONLY)) != (D3DUSAGE_DYNAMIC | D3DUSAGE_WRITEONLY);
+	}
+
+	// Flags to lock with
+	DWORD Promote(UINT Offset, UINT Size, DWORD Flags)
+	{
+		if (Disabled || Offset >= BufferSize)
+		{
+			return Flags;
+		}
+		if (Flags & (D3DLOCK_DISCARD | D3DLOCK_NOOVERWRITE | D3DLOCK_READONLY))
+		{
+			Disabled = true;
+			return Flags;
+		}
+
+		// A size of zero locks the rest of the buffer
+		const UINT LockEnd = (Size && Size <= BufferSize - Offset) ? Offset + Size : BufferSize;
+
+		if (Written && Offset >= Written)
+		{
+			Written = LockEnd;
+			Appends++;
+			return Flags | D3DLOCK_NOOVERWRITE;
+		}
+		if (Offset == 0 && LockEnd == BufferSize && Appends)
+		{
+			Written = LockEnd;
+			Appends = 0;
+			return Flags | D3DLOCK_DISCARD;
+		}
+
+		// Rewrites memory a pending draw may read, the lock has to wait
+		if (LockEnd > Written)
+		{
+			Written = LockEnd;
+		}
+		return Flags;
+	}
+
+private:
+	UINT BufferSize = 0;
+	UINT Written = 0;		// end of the highest lock since the last start over
+	UINT Appends = 0;		// locks since the last start over
+	bool Disabled = false;
+};
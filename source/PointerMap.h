@@ -0,0 +1,172 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+#include <utility>
+
+// Flat open-addressing map keyed on pointers, using Robin Hood probing.
+// Entries live in one array so a lookup touches a handful of adjacent
+// slots instead of chasing list nodes. A key is never stored twice, erase
+// uses backward shifting so no tombstones are left behind.
+template <typename V>
+class PointerMap
+{
+public:
+	V *Find(const void *Key)
+	{
+		if (!Count)
+		{
+			return nullptr;
+		}
+
+		const size_t Mask = Entries.size() - 1;
+		size_t Pos = Hash(Key);
+		for (uint32_t Distance = 1; ; Distance++, Pos = (Pos + 1) & Mask)
+		{
+			Entry& Slot = Entries[Pos];
+
+			// A richer slot (or an empty one) means the key would have been placed before it
+			if (Slot.Distance < Distance)
+			{
+				return nullptr;
+			}
+			if (Slot.Key == Key)
+			{
+				return &Slot.Value;
+			}
+		}
+	}
+
+	void Insert(const void *Key, V Value)
+	{
+		if (V *pValue = Find(Key))
+		{
+			*pValue = Value;
+			return;
+		}
+
+		// Grow at half load, past that the probe loop runs long enough to mispredict its exit
+		// and lookups fall behind std::unordered_map (see tools/pointermapbench.cpp)
+		if ((Count + 1) * 2 > Entries.size())
+		{
+			Grow();
+		}
+
+		Place({ Key, Value, 1 });
+		Count++;
+	}
+
+	bool Erase(const void *Key)
+	{
+		if (!Count)
+		{
+			return false;
+		}
+
+		const size_t Mask = Entries.size() - 1;
+		size_t Pos = Hash(Key);
+		for (uint32_t Distance = 1; ; Distance++, Pos = (Pos + 1) & Mask)
+		{
+			if (Entries[Pos].Distance < Distance)
+			{
+				return false;
+			}
+			if (Entries[Pos].Key == Key)
+			{
+				break;
+			}
+		}
+
+		// Shift the following displaced entries one slot back
+		for (size_t Next = (Pos + 1) & Mask; Entries[Next].Distance > 1; Pos = Next, Next = (Next + 1) & Mask)
+		{
+			Entries[Pos] = Entries[Next];
+			Entries[Pos].Distance--;
+		}
+		Entries[Pos] = {};
+		Count--;
+
+		return true;
+	}
+
+	template <typename F>
+	void ForEach(F Func) const
+	{
+		for (const Entry& Slot : Entries)
+		{
+			if (Slot.Distance)
+			{
+				Func(Slot.Key, Slot.Value);
+			}
+		}
+	}
+
+	size_t Size() const { return Count; }
+
+private:
+	struct Entry
+	{
+		const void *Key;
+		V Value;
+		uint32_t Distance;		// probe distance + 1, 0 for an empty slot
+	};
+
+	size_t Hash(const void *Key) const
+	{
+		// Fibonacci hashing, the top bits of the product mix in all pointer bits
+		const uintptr_t Bits = reinterpret_cast<uintptr_t>(Key);
+		if constexpr (sizeof(uintptr_t) == 8)
+		{
+			return (size_t)((Bits * 0x9E3779B97F4A7C15ull) >> (64 - Shift));
+		}
+		else
+		{
+			return (size_t)((uint32_t)(Bits * 0x9E3779B9u) >> (32 - Shift));
+		}
+	}
+
+	void Place(Entry Item)
+	{
+		const size_t Mask = Entries.size() - 1;
+		for (size_t Pos = Hash(Item.Key); ; Pos = (Pos + 1) & Mask, Item.Distance++)
+		{
+			Entry& Slot = Entries[Pos];
+			if (!Slot.Distance)
+			{
+				Slot = Item;
+				return;
+			}
+
+			// Take the slot from an entry closer to its home and carry that one on
+			if (Slot.Distance < Item.Distance)
+			{
+				std::swap(Slot, Item);
+			}
+		}
+	}
+
+	void Grow()
+	{
+		std::vector<Entry> Old(Entries.empty() ? 16 : Entries.size() * 2);
+		Old.swap(Entries);
+		Shift = 0;
+		while (((size_t)1 << Shift) < Entries.size())
+		{
+			Shift++;
+		}
+
+		for (Entry& Item : Old)
+		{
+			if (Item.Distance)
+			{
+				Item.Distance = 1;
+				Place(Item);
+			}
+		}
+	}
+
+	std::vector<Entry> Entries;
+	size_t Count = 0;
+	uint32_t Shift = 0;
+};
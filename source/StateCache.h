@@ -0,0 +1,181 @@
+#pragma once
+
+constexpr UINT MaxRenderStates = 256;
+constexpr UINT MaxTextureStages = 8;
+constexpr UINT MaxTextureStageStates = 32;
+constexpr UINT MaxStreams = 16;
+constexpr UINT MaxTransforms = D3DTS_TEXTURE7 + 1;
+constexpr UINT MaxWorldMatrices = 4;
+constexpr UINT MaxLights = 8;
+constexpr UINT MaxClipPlanes = D3DMAXUSERCLIPPLANES;
+
+// Last value the wrapper forwarded for each piece of device state, used to
+// drop Set* calls that would not change anything and to answer Get* calls
+// without asking the runtime. A slot is only trusted while Valid, everything
+// that can change state behind the wrapper's back (Reset, ApplyStateBlock,
+// UP draws, SetRenderTarget) clears the affected slots.
+class StateCache
+{
+public:
+	template <typename T>
+	struct Slot
+	{
+		T Value;
+		bool Valid;
+	};
+
+	struct StreamSource
+	{
+		IDirect3DVertexBuffer8 *pStreamData;
+		UINT Stride;
+		bool operator==(const StreamSource& other) const { return pStreamData == other.pStreamData && Stride == other.Stride; }
+	};
+
+	struct IndexSource
+	{
+		IDirect3DIndexBuffer8 *pIndexData;
+		UINT BaseVertexIndex;
+		bool operator==(const IndexSource& other) const { return pIndexData == other.pIndexData && BaseVertexIndex == other.BaseVertexIndex; }
+	};
+
+	struct ClipPlane
+	{
+		float Plane[4];
+	};
+
+	explicit StateCache(bool Enabled) : Enabled(Enabled) {}
+
+	Slot<DWORD> *RenderState(D3DRENDERSTATETYPE State)
+	{
+		return ((UINT)State < MaxRenderStates) ? &RenderStates[State] : nullptr;
+	}
+	Slot<DWORD> *TextureStageState(DWORD Stage, D3DTEXTURESTAGESTATETYPE Type)
+	{
+		return (Stage < MaxTextureStages && (UINT)Type < MaxTextureStageStates) ? &TextureStageStates[Stage][Type] : nullptr;
+	}
+	Slot<IDirect3DBaseTexture8*> *Texture(DWORD Stage)
+	{
+		return (Stage < MaxTextureStages) ? &Textures[Stage] : nullptr;
+	}
+	Slot<DWORD> *VertexShader() { return &VertexShaderHandle; }
+	Slot<DWORD> *PixelShader() { return &PixelShaderHandle; }
+	Slot<StreamSource> *Stream(UINT StreamNumber)
+	{
+		return (StreamNumber < MaxStreams) ? &Streams[StreamNumber] : nullptr;
+	}
+	Slot<IndexSource> *Indices() { return &IndexData; }
+	Slot<D3DMATRIX> *Transform(D3DTRANSFORMSTATETYPE State)
+	{
+		if ((UINT)State < MaxTransforms)
+		{
+			return &Transforms[State];
+		}
+		if ((UINT)State >= (UINT)D3DTS_WORLD && (UINT)State < (UINT)D3DTS_WORLD + MaxWorldMatrices)
+		{
+			return &WorldMatrices[State - D3DTS_WORLD];
+		}
+		return nullptr;
+	}
+	Slot<D3DVIEWPORT8> *Viewport() { return &ViewportData; }
+	Slot<D3DMATERIAL8> *Material() { return &MaterialData; }
+	Slot<D3DLIGHT8> *Light(DWORD Index)
+	{
+		return (Index < MaxLights) ? &Lights[Index] : nullptr;
+	}
+	Slot<ClipPlane> *Plane(DWORD Index)
+	{
+		return (Index < MaxClipPlanes) ? &ClipPlanes[Index] : nullptr;
+	}
+
+	// True when forwarding Value would not change the device
+	template <typename T>
+	bool IsRedundant(const Slot<T> *pSlot, const T& Value) const
+	{
+		return Enabled && !Recording && pSlot && pSlot->Valid && pSlot->Value == Value;
+	}
+
+	// Records the outcome of a forwarded Set* call
+	template <typename T>
+	void Store(Slot<T> *pSlot, const T& Value, HRESULT hr)
+	{
+		if (Recording || !pSlot)
+		{
+			return;
+		}
+
+		pSlot->Value = Value;
+		pSlot->Valid = SUCCEEDED(hr);
+	}
+
+	// Copies a trusted value out of the mirror
+	template <typename T>
+	bool Load(const Slot<T> *pSlot, T& Value) const
+	{
+		if (!pSlot || !pSlot->Valid)
+		{
+			return false;
+		}
+
+		Value = pSlot->Value;
+		return true;
+	}
+
+	template <typename T>
+	static void Forget(Slot<T> *pSlot)
+	{
+		if (pSlot)
+		{
+			pSlot->Valid = false;
+		}
+	}
+
+	// Between BeginStateBlock and EndStateBlock Set* calls are only recorded
+	void SetRecording(bool Value) { Recording = Value; }
+	bool IsRecording() const { return Recording; }
+
+	void Invalidate()
+	{
+		InvalidateAll(RenderStates);
+		for (auto& Stage : TextureStageStates)
+		{
+			InvalidateAll(Stage);
+		}
+		InvalidateAll(Textures);
+		Forget(&VertexShaderHandle);
+		Forget(&PixelShaderHandle);
+		InvalidateAll(Streams);
+		Forget(&IndexData);
+		InvalidateAll(Transforms);
+		InvalidateAll(WorldMatrices);
+		Forget(&ViewportData);
+		Forget(&MaterialData);
+		InvalidateAll(Lights);
+		InvalidateAll(ClipPlanes);
+	}
+
+private:
+	template <typename T, size_t N>
+	static void InvalidateAll(Slot<T> (&Slots)[N])
+	{
+		for (auto& Entry : Slots)
+		{
+			Entry.Valid = false;
+		}
+	}
+
+	bool Enabled;
+	bool Recording = false;
+	Slot<DWORD> RenderStates[MaxRenderStates] = {};
+	Slot<DWORD> TextureStageStates[MaxTextureStages][MaxTextureStageStates] = {};
+	Slot<IDirect3DBaseTexture8*> Textures[MaxTextureStages] = {};
+	Slot<DWORD> VertexShaderHandle = {};
+	Slot<DWORD> PixelShaderHandle = {};
+	Slot<StreamSource> Streams[MaxStreams] = {};
+	Slot<IndexSource> IndexData = {};
+	Slot<D3DMATRIX> Transforms[MaxTransforms] = {};
+	Slot<D3DMATRIX> WorldMatrices[MaxWorldMatrices] = {};
+	Slot<D3DVIEWPORT8> ViewportData = {};
+	Slot<D3DMATERIAL8> MaterialData = {};
+	Slot<D3DLIGHT8> Lights[MaxLights] = {};
+	Slot<ClipPlane> ClipPlanes[MaxClipPlanes] = {};
+};
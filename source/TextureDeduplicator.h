@@ -0,0 +1,322 @@
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+#include <unordered_map>
+#include <vector>
+
+// Hashes what the game writes into a managed texture. A level counts once it
+// was written whole, with a single lock and no rectangle, and is hashed at
+// that UnlockRect. A second write to a level, or a write to part of one,
+// stops hashing the texture for good.
+class TextureContent
+{
+public:
+	static constexpr UINT MaxLevels = 16;
+
+	// Only managed textures are hashed, other pools are written by the device or not drawn from
+	void Start(LPDIRECT3DTEXTURE8 pTexture)
+	{
+		D3DSURFACE_DESC Desc;
+		const DWORD Count = pTexture->GetLevelCount();
+		if (Count == 0 || Count > MaxLevels || FAILED(pTexture->GetLevelDesc(0, &Desc)) || Desc.Pool != D3DPOOL_MANAGED || Desc.Usage != 0)
+		{
+			return;
+		}
+
+		Levels = Count;
+		Key = ((uint64_t)Desc.Format << 40) ^ ((uint64_t)Desc.Width << 20) ^ (uint64_t)Desc.Height ^ ((uint64_t)Count << 56);
+	}
+
+	bool IsActive() const { return Levels != 0; }
+	bool IsComplete() const { return Levels != 0 && Hashed == (1u << Levels) - 1; }
+	uint64_t GetKey() const { return Key; }
+	UINT GetSize() const { return Size; }
+
+	// False when the write ends hashing, the caller then stops sharing the texture
+	bool WriteLock(UINT Level, CONST RECT *pRect)
+	{
+		if (!Levels)
+		{
+			return true;
+		}
+		if (pRect || Level >= Levels || (Hashed & (1u << Level)) || Pending.pBits)
+		{
+			Stop();
+			return false;
+		}
+		return true;
+	}
+
+	void Locked(UINT Level, D3DFORMAT Format, UINT Height, const D3DLOCKED_RECT& Rect)
+	{
+		if (Levels && Rect.Pitch > 0)
+		{
+			Pending = { Rect.pBits, (UINT)Rect.Pitch * LevelRows(Format, Height), Level };
+		}
+	}
+
+	// Hashes the level while it is still locked, true when that was the last one
+	bool Unlocking(UINT Level)
+	{
+		if (!Levels || !Pending.pBits || Pending.Level != Level)
+		{
+			return false;
+		}
+
+		Key = (Key ^ HashBytes(Pending.pBits, Pending.Size)) * 0x9E3779B97F4A7C15ull + Level;
+		Size += Pending.Size;
+		Hashed |= 1u << Level;
+		Pending = {};
+		return IsComplete();
+	}
+
+	void Stop()
+	{
+		Levels = 0;
+		Hashed = 0;
+		Pending = {};
+	}
+
+	// Block rows of a level, compressed formats store four pixel rows per block row
+	static UINT LevelRows(D3DFORMAT Format, UINT Height)
+	{
+		const bool Compressed = Format == D3DFMT_DXT1 || Format == D3DFMT_DXT2 || Format == D3DFMT_DXT3 || Format == D3DFMT_DXT4 || Format == D3DFMT_DXT5;
+		return Compressed ? (Height + 3) / 4 : Height;
+	}
+
+	// 64-bit hash over four independent lanes, 32 bytes per step, so the multiplies overlap
+	static uint64_t HashBytes(const void *pData, size_t Size)
+	{
+		constexpr uint64_t Prime1 = 0x9E3779B185EBCA87ull;
+		constexpr uint64_t Prime2 = 0xC2B2AE3D27D4EB4Full;
+		const BYTE *p = static_cast<const BYTE *>(pData);
+		uint64_t Lanes[4] = { Prime1 + Prime2, Prime2, 0, 0 - Prime1 };
+		for (; Size >= 32; p += 32, Size -= 32)
+		{
+			for (UINT x = 0; x < 4; x++)
+			{
+				uint64_t k;
+				memcpy(&k, p + x * 8, 8);
+				Lanes[x] += k * Prime2;
+				Lanes[x] = ((Lanes[x] << 31) | (Lanes[x] >> 33)) * Prime1;
+			}
+		}
+
+		uint64_t h = Size;
+		for (UINT x = 0; x < 4; x++)
+		{
+			h = (h ^ Lanes[x]) * Prime1 + Prime2;
+			h = (h << 27) | (h >> 37);
+		}
+		for (; Size >= 8; p += 8, Size -= 8)
+		{
+			uint64_t k;
+			memcpy(&k, p, 8);
+			h ^= k * Prime2;
+			h = ((h << 27) | (h >> 37)) * Prime1;
+		}
+		uint64_t k = 0;
+		memcpy(&k, p, Size);
+		h ^= k * Prime1;
+		h ^= h >> 33;
+		h *= Prime2;
+		h ^= h >> 29;
+		return h;
+	}
+
+private:
+	struct PendingLevel
+	{
+		void *pBits;
+		UINT Size;
+		UINT Level;
+	};
+
+	uint64_t Key = 0;			// description, then each level's hash mixed in
+	UINT Levels = 0;			// zero once the texture is not hashed
+	UINT Hashed = 0;			// bit per level
+	UINT Size = 0;				// bytes hashed over all levels
+	PendingLevel Pending = {};
+};
+
+// Lets managed textures with the same contents be drawn from one copy. The
+// first texture with a given hash only waits in the table. When a second one
+// matches it, byte for byte, a shared copy is made that both are drawn from
+// from then on, as is every later match. Their own textures are never set on
+// the device, so the runtime keeps them in system memory and never uploads
+// them. A texture that is written to or whose surfaces are handed out leaves
+// first and is drawn from its own texture again, which still holds the
+// contents; the shared copy itself is never written.
+class TextureDeduplicator
+{
+public:
+	~TextureDeduplicator()
+	{
+		for (auto& Item : Entries)
+		{
+			if (Item.second.pShared)
+			{
+				Item.second.pShared->Release();
+			}
+		}
+	}
+
+	// The copy pTexture is drawn from now, nullptr when there is none yet. pFirst is set
+	// to the texture that waited with the same contents when it starts sharing as well.
+	LPDIRECT3DTEXTURE8 Join(LPDIRECT3DDEVICE8 pDevice, m_IDirect3DTexture8 *pWrapper, LPDIRECT3DTEXTURE8 pTexture, const TextureContent& Content, m_IDirect3DTexture8 *&pFirst)
+	{
+		pFirst = nullptr;
+
+		auto Item = Entries.find(Content.GetKey());
+		if (Item == Entries.end())
+		{
+			Entries[Content.GetKey()] = { pWrapper, pTexture, nullptr, {}, Content.GetSize() };
+			return nullptr;
+		}
+
+		// A hash collision leaves the later texture on its own
+		Entry& Shared = Item->second;
+		if (!Shared.pShared)
+		{
+			if (!Shared.pFirst || !CompareLevels(Shared.pFirstTexture, pTexture) || !(Shared.pShared = Copy(pDevice, pTexture)))
+			{
+				return nullptr;
+			}
+			pFirst = Shared.pFirst;
+			Shared.Users.push_back(Shared.pFirst);
+			Shared.pFirst = nullptr;
+			Shared.pFirstTexture = nullptr;
+		}
+		else if (!CompareLevels(Shared.pShared, pTexture))
+		{
+			return nullptr;
+		}
+
+		Shared.Users.push_back(pWrapper);
+		SharedTextures++;
+		BytesSaved += Shared.Size;
+		return Shared.pShared;
+	}
+
+	// Called before the texture is written to and when it goes away; its own texture may be released already
+	void Leave(m_IDirect3DTexture8 *pWrapper, const TextureContent& Content)
+	{
+		auto Item = Entries.find(Content.GetKey());
+		if (Item == Entries.end())
+		{
+			return;
+		}
+
+		Entry& Shared = Item->second;
+		if (Shared.pFirst == pWrapper)
+		{
+			Entries.erase(Item);
+			return;
+		}
+
+		for (size_t x = 0; x < Shared.Users.size(); x++)
+		{
+			if (Shared.Users[x] == pWrapper)
+			{
+				Shared.Users.erase(Shared.Users.begin() + x);
+				if (Shared.Users.empty())
+				{
+					Shared.pShared->Release();
+					Entries.erase(Item);
+				}
+				else
+				{
+					SharedTextures--;
+					BytesSaved -= Shared.Size;
+				}
+				return;
+			}
+		}
+	}
+
+	// Textures drawn from a copy another texture already uses, and the bytes they do not upload
+	UINT GetSharedTextures() const { return SharedTextures; }
+	uint64_t GetBytesSaved() const { return BytesSaved; }
+
+private:
+	struct Entry
+	{
+		m_IDirect3DTexture8 *pFirst;			// waiting for a match, no copy made yet
+		LPDIRECT3DTEXTURE8 pFirstTexture;
+		LPDIRECT3DTEXTURE8 pShared;				// holds a reference
+		std::vector<m_IDirect3DTexture8 *> Users;
+		UINT Size;
+	};
+
+	// Visits the rows of each level of two textures, pSource locked for reading and pOther with OtherFlags
+	template <typename Visit>
+	static bool ForEachLevel(LPDIRECT3DTEXTURE8 pSource, LPDIRECT3DTEXTURE8 pOther, DWORD OtherFlags, Visit VisitRow)
+	{
+		const DWORD Levels = pSource->GetLevelCount();
+		if (pOther->GetLevelCount() != Levels)
+		{
+			return false;
+		}
+		for (UINT Level = 0; Level < Levels; Level++)
+		{
+			D3DSURFACE_DESC Desc, OtherDesc;
+			D3DLOCKED_RECT Source, Other;
+			if (FAILED(pSource->GetLevelDesc(Level, &Desc)) || FAILED(pOther->GetLevelDesc(Level, &OtherDesc)) ||
+				Desc.Format != OtherDesc.Format || Desc.Width != OtherDesc.Width || Desc.Height != OtherDesc.Height ||
+				FAILED(pSource->LockRect(Level, &Source, nullptr, D3DLOCK_READONLY)))
+			{
+				return false;
+			}
+			if (FAILED(pOther->LockRect(Level, &Other, nullptr, OtherFlags)))
+			{
+				pSource->UnlockRect(Level);
+				return false;
+			}
+
+			const UINT RowBytes = (UINT)((Source.Pitch < Other.Pitch) ? Source.Pitch : Other.Pitch);
+			const UINT Rows = TextureContent::LevelRows(Desc.Format, Desc.Height);
+			bool Result = true;
+			for (UINT y = 0; y < Rows && Result; y++)
+			{
+				Result = VisitRow(static_cast<BYTE *>(Source.pBits) + y * Source.Pitch, static_cast<BYTE *>(Other.pBits) + y * Other.Pitch, RowBytes);
+			}
+
+			pOther->UnlockRect(Level);
+			pSource->UnlockRect(Level);
+			if (!Result)
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	static bool CompareLevels(LPDIRECT3DTEXTURE8 pSource, LPDIRECT3DTEXTURE8 pTexture)
+	{
+		return ForEachLevel(pSource, pTexture, D3DLOCK_READONLY, [](const BYTE *pSourceRow, const BYTE *pRow, UINT Bytes) { return memcmp(pSourceRow, pRow, Bytes) == 0; });
+	}
+
+	static LPDIRECT3DTEXTURE8 Copy(LPDIRECT3DDEVICE8 pDevice, LPDIRECT3DTEXTURE8 pSource)
+	{
+		D3DSURFACE_DESC Desc;
+		LPDIRECT3DTEXTURE8 pCopy = nullptr;
+		if (FAILED(pSource->GetLevelDesc(0, &Desc)) ||
+			FAILED(pDevice->CreateTexture(Desc.Width, Desc.Height, pSource->GetLevelCount(), 0, Desc.Format, D3DPOOL_MANAGED, &pCopy)))
+		{
+			return nullptr;
+		}
+
+		if (!ForEachLevel(pSource, pCopy, 0, [](const BYTE *pSourceRow, BYTE *pRow, UINT Bytes) { memcpy(pRow, pSourceRow, Bytes); return true; }))
+		{
+			OutputDebugStringA("d3d8: could not copy a texture to share, drawing it from its own copy\n");
+			pCopy->Release();
+			return nullptr;
+		}
+		return pCopy;
+	}
+
+	std::unordered_map<uint64_t, Entry> Entries;
+	UINT SharedTextures = 0;
+	uint64_t BytesSaved = 0;
+};
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <stdint.h>
+
+// Layout of API trace files written by TraceRecorder. Only fixed-width types
+// are used so a reader can be built without the Windows or DirectX headers.
+//
+// A file is a FileHeader followed by chunks. A chunk holds the records of one
+// thread in call order: a ChunkHeader, then records made of a RecordHeader and
+// Size payload bytes. Payloads are the call arguments in declaration order,
+// packed without padding:
+//  - values are stored as they are
+//  - structures passed by pointer are a presence byte followed by the structure
+//  - interfaces are the 64-bit address of the wrapper the game holds
+//  - memory blocks are the 64-bit content hash of a Blob record elsewhere in the
+//    file, a hash of 0 means no contents; as chunks of different threads are
+//    interleaved, the blob may come after the record that references it
+// Create calls are recorded after they succeed, with the new object last.
+namespace Trace
+{
+#define TRACE_DEVICE_CALLS(X) \
+	X(TestCooperativeLevel) X(GetAvailableTextureMem) X(ResourceManagerDiscardBytes) X(GetDirect3D) \
+	X(GetDeviceCaps) X(GetDisplayMode) X(GetCreationParameters) X(SetCursorProperties) X(SetCursorPosition) \
+	X(ShowCursor) X(CreateAdditionalSwapChain) X(Reset) X(Present) X(GetBackBuffer) X(GetRasterStatus) \
+	X(SetGammaRamp) X(GetGammaRamp) X(CreateTexture) X(CreateVolumeTexture) X(CreateCubeTexture) \
+	X(CreateVertexBuffer) X(CreateIndexBuffer) X(CreateRenderTarget) X(CreateDepthStencilSurface) \
+	X(CreateImageSurface) X(CopyRects) X(UpdateTexture) X(GetFrontBuffer) X(SetRenderTarget) \
+	X(GetRenderTarget) X(GetDepthStencilSurface) X(BeginScene) X(EndScene) X(Clear) X(SetTransform) \
+	X(GetTransform) X(MultiplyTransform) X(SetViewport) X(GetViewport) X(SetMaterial) X(GetMaterial) \
+	X(SetLight) X(GetLight) X(LightEnable) X(GetLightEnable) X(SetClipPlane) X(GetClipPlane) \
+	X(SetRenderState) X(GetRenderState) X(BeginStateBlock) X(EndStateBlock) X(ApplyStateBlock) \
+	X(CaptureStateBlock) X(DeleteStateBlock) X(CreateStateBlock) X(SetClipStatus) X(GetClipStatus) \
+	X(GetTexture) X(SetTexture) X(GetTextureStageState) X(SetTextureStageState) X(ValidateDevice) \
+	X(GetInfo) X(SetPaletteEntries) X(GetPaletteEntries) X(SetCurrentTexturePalette) \
+	X(GetCurrentTexturePalette) X(DrawPrimitive) X(DrawIndexedPrimitive) X(DrawPrimitiveUP) \
+	X(DrawIndexedPrimitiveUP) X(ProcessVertices) X(CreateVertexShader) X(SetVertexShader) \
+	X(GetVertexShader) X(DeleteVertexShader) X(SetVertexShaderConstant) X(GetVertexShaderConstant) \
+	X(GetVertexShaderDeclaration) X(GetVertexShaderFunction) X(SetStreamSource) X(GetStreamSource) \
+	X(SetIndices) X(GetIndices) X(CreatePixelShader) X(SetPixelShader) X(GetPixelShader) \
+	X(DeletePixelShader) X(SetPixelShaderConstant) X(GetPixelShaderConstant) X(GetPixelShaderFunction) \
+	X(DrawRectPatch) X(DrawTriPatch) X(DeletePatch)
+
+// Resource methods, and records that are not calls
+#define TRACE_OTHER_CALLS(X) \
+	X(VertexBufferLock) X(VertexBufferUnlock) X(IndexBufferLock) X(IndexBufferUnlock) \
+	X(TextureLockRect) X(TextureUnlockRect) X(CubeTextureLockRect) X(CubeTextureUnlockRect) \
+	X(SurfaceLockRect) X(SurfaceUnlockRect) X(VolumeTextureLockBox) X(VolumeTextureUnlockBox) \
+	X(VolumeLockBox) X(VolumeUnlockBox) X(Destroy) X(Blob)
+
+#define TRACE_ENUM(Name) Name,
+#define TRACE_NAME(Name) #Name,
+
+	enum class Call : uint16_t
+	{
+		TRACE_DEVICE_CALLS(TRACE_ENUM)
+		TRACE_OTHER_CALLS(TRACE_ENUM)
+		Count
+	};
+
+	constexpr const char *CallNames[] =
+	{
+		TRACE_DEVICE_CALLS(TRACE_NAME)
+		TRACE_OTHER_CALLS(TRACE_NAME)
+	};
+	static_assert(sizeof(CallNames) / sizeof(CallNames[0]) == (size_t)Call::Count, "a call has no name");
+
+#undef TRACE_ENUM
+#undef TRACE_NAME
+
+	constexpr uint32_t FileMagic = 0x52543844;	// "D8TR"
+	constexpr uint32_t FileVersion = 1;
+
+	struct FileHeader
+	{
+		uint32_t Magic;
+		uint32_t Version;
+		int64_t Frequency;		// ticks per second of RecordHeader::Time
+	};
+
+	struct ChunkHeader
+	{
+		uint32_t Thread;
+		uint32_t Size;			// bytes of records that follow
+	};
+
+	struct RecordHeader
+	{
+		uint16_t Call;
+		uint16_t Reserved;
+		uint32_t Size;			// payload bytes that follow
+		int64_t Time;			// performance counter at the call
+	};
+
+	static_assert(sizeof(FileHeader) == 16 && sizeof(ChunkHeader) == 8 && sizeof(RecordHeader) == 16, "trace headers must not contain padding");
+}
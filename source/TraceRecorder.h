@@ -0,0 +1,544 @@
+#pragma once
+
+#include <stdlib.h>
+#include <string.h>
+#include <atomic>
+#include <type_traits>
+#include "TraceFormat.h"
+
+// Opt-in recorder of the calls made through the wrappers, see TraceFormat.h
+// for the file layout. Each thread serializes into its own chunks without
+// locking; full chunks are handed to a writer thread through a lock-free
+// list and come back to their thread for reuse once written. Memory blocks
+// are content hashed so each distinct block is stored once.
+namespace Trace
+{
+	// Structure passed by pointer, stored inline
+	template <typename T>
+	struct Ref
+	{
+		const T *pValue;
+	};
+
+	// Interface, stored as the address of the wrapper
+	struct Object
+	{
+		const void *pObject;
+	};
+
+	// Memory block, stored once per distinct content
+	struct Data
+	{
+		const void *pData;
+		uint32_t Size;
+		mutable uint64_t Hash;
+	};
+
+	// Memory of the last lock of a resource, recorded when it is unlocked
+	struct PendingLock
+	{
+		const void *pData;
+		size_t Size;
+		UINT Key;			// level, and face for cube textures
+	};
+
+	template <typename T>
+	inline Ref<T> ByRef(const T *pValue) { return { pValue }; }
+	inline Object Id(const void *pObject) { return { pObject }; }
+	inline Data Block(const void *pData, size_t Size) { return { pData, pData ? (uint32_t)Size : 0, 0 }; }
+
+	// Size in bytes of a vertex shader declaration, up to and including D3DVSD_END()
+	inline size_t DeclarationSize(const DWORD *pDeclaration)
+	{
+		if (!pDeclaration)
+		{
+			return 0;
+		}
+
+		const DWORD *pToken = pDeclaration;
+		for (; *pToken != D3DVSD_END(); pToken++)
+		{
+			const DWORD Type = (*pToken & D3DVSD_TOKENTYPEMASK) >> D3DVSD_TOKENTYPESHIFT;
+			if (Type == D3DVSD_TOKEN_CONSTMEM)
+			{
+				pToken += ((*pToken & D3DVSD_CONSTCOUNTMASK) >> D3DVSD_CONSTCOUNTSHIFT) * 4;
+			}
+			else if (Type == D3DVSD_TOKEN_EXT)
+			{
+				pToken += (*pToken & D3DVSD_EXTCOUNTMASK) >> D3DVSD_EXTCOUNTSHIFT;
+			}
+		}
+		return (pToken - pDeclaration + 1) * sizeof(DWORD);
+	}
+
+	// Size in bytes of shader byte code, up to and including the end token
+	inline size_t FunctionSize(const DWORD *pFunction)
+	{
+		if (!pFunction)
+		{
+			return 0;
+		}
+
+		// Skip the version token, comments may hold anything so step over them whole
+		const DWORD *pToken = pFunction + 1;
+		while (*pToken != 0x0000FFFF)
+		{
+			if ((*pToken & 0xFFFF) == 0xFFFE)
+			{
+				pToken += (*pToken >> 16) & 0x7FFF;
+			}
+			pToken++;
+		}
+		return (pToken - pFunction + 1) * sizeof(DWORD);
+	}
+
+	// Bytes of a locked rectangle, rows of 4x4 blocks for compressed formats
+	inline size_t LockedRectSize(D3DFORMAT Format, const D3DLOCKED_RECT& Locked, UINT Height)
+	{
+		const bool Compressed = Format == D3DFMT_DXT1 || Format == D3DFMT_DXT2 || Format == D3DFMT_DXT3 || Format == D3DFMT_DXT4 || Format == D3DFMT_DXT5;
+		const UINT Rows = Compressed ? (Height + 3) / 4 : Height;
+		return (Locked.Pitch > 0) ? (size_t)Locked.Pitch * Rows : 0;
+	}
+
+	class Recorder
+	{
+	public:
+		static bool IsActive() { return Active.load(std::memory_order_relaxed); }
+
+		static bool Start(const char *Path)
+		{
+			// Written with WriteFile, so no CRT lock can be left held by the writer when the process exits
+			hFile = CreateFileA(Path, GENERIC_WRITE, FILE_SHARE_READ, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+			if (hFile == INVALID_HANDLE_VALUE)
+			{
+				return false;
+			}
+
+			LARGE_INTEGER Frequency;
+			QueryPerformanceFrequency(&Frequency);
+			const FileHeader Header = { FileMagic, FileVersion, Frequency.QuadPart };
+			WriteOut(&Header, sizeof(Header));
+
+			// The writer holds a reference to the module so it is never unloaded beneath it
+			HMODULE hModule = NULL;
+			hWake = CreateEventA(NULL, FALSE, FALSE, NULL);
+			hWritten = CreateEventA(NULL, FALSE, FALSE, NULL);
+			if (!hWake || !hWritten || !GetModuleHandleExA(GET_MODULE_HANDLE_EX_FLAG_FROM_ADDRESS, (LPCSTR)&WriterThread, &hModule))
+			{
+				CloseHandle(hFile);
+				hFile = INVALID_HANDLE_VALUE;
+				return false;
+			}
+
+			Active.store(true, std::memory_order_release);
+
+			HANDLE hThread = CreateThread(NULL, 0, WriterThread, hModule, 0, NULL);
+			if (!hThread)
+			{
+				Active.store(false, std::memory_order_release);
+				FreeLibrary(hModule);
+				CloseHandle(hFile);
+				hFile = INVALID_HANDLE_VALUE;
+				return false;
+			}
+			CloseHandle(hThread);
+
+			return true;
+		}
+
+		// Called when the game releases a device for good. Hands the calling thread's records to the
+		// writer and waits until everything submitted is in the file, so the trace is complete up
+		// to here even though the writer is killed mid-write at process exit. Nothing is written
+		// from DllMain; records made after the last device goes only reach the file in full chunks.
+		static void Sync()
+		{
+			if (!IsActive())
+			{
+				return;
+			}
+
+			if (Local && Local->pCurrent)
+			{
+				Submit(Local->pCurrent);
+				Local->pCurrent = nullptr;
+			}
+			SyncRequests.fetch_add(1, std::memory_order_release);
+			SetEvent(hWake);
+			WaitForSingleObject(hWritten, 5000);
+		}
+
+		// Called at the end of each frame; hands a reasonably filled chunk to the writer
+		// early so a crash loses little, without spending a whole chunk per frame
+		static void Flush()
+		{
+			if (Local && Local->pCurrent && Local->pCurrent->Used >= ChunkSize / 4)
+			{
+				Submit(Local->pCurrent);
+				Local->pCurrent = nullptr;
+			}
+		}
+
+		// Records dropped because the writer fell behind
+		static uint64_t GetDropped() { return Dropped.load(std::memory_order_relaxed); }
+
+		template <typename... Args>
+		static void Write(Call Id, const Args&... args)
+		{
+			(Prepare(args), ...);
+
+			const uint32_t Size = (0 + ... + SizeOf(args));
+			uint8_t *p = Reserve(sizeof(RecordHeader) + Size);
+			if (!p)
+			{
+				return;
+			}
+
+			const RecordHeader Header = { (uint16_t)Id, 0, Size, Now() };
+			memcpy(p, &Header, sizeof(Header));
+			p += sizeof(Header);
+			(Put(p, args), ...);
+		}
+
+	private:
+		static constexpr uint32_t ChunkSize = 1 << 20;
+		static constexpr uint32_t MaxChunks = 128;		// bytes in flight are capped at MaxChunks * ChunkSize
+		static constexpr uint32_t SeenSize = 1 << 16;	// content hashes remembered for deduplication
+		static constexpr uint32_t SeenProbes = 32;
+
+		struct ThreadBuffer;
+
+		struct Chunk
+		{
+			Chunk *pNext;
+			ThreadBuffer *pOwner;
+			uint32_t Capacity;
+			uint32_t Used;
+
+			uint8_t *Data() { return reinterpret_cast<uint8_t *>(this + 1); }
+		};
+
+		struct ThreadBuffer
+		{
+			uint32_t ThreadId;
+			Chunk *pCurrent;
+			Chunk *pFree;						// owner thread only
+			std::atomic<Chunk *> Returned;		// written chunks, pushed by the writer
+			ThreadBuffer *pNext;				// next in Registry
+		};
+
+		static inline std::atomic<bool> Active{ false };
+		static inline HANDLE hFile = INVALID_HANDLE_VALUE;
+		static inline HANDLE hWake = NULL;
+		static inline HANDLE hWritten = NULL;				// set once the chunks submitted before a Sync are written
+		static inline std::atomic<uint32_t> SyncRequests{ 0 };
+		static inline std::atomic<Chunk *> Submitted{ nullptr };
+		static inline std::atomic<ThreadBuffer *> Registry{ nullptr };
+		static inline std::atomic<uint32_t> ChunkCount{ 0 };
+		static inline std::atomic<uint64_t> Dropped{ 0 };
+		static inline std::atomic<uint64_t> Seen[SeenSize];
+		static inline thread_local ThreadBuffer *Local = nullptr;
+
+		static int64_t Now()
+		{
+			LARGE_INTEGER Counter;
+			QueryPerformanceCounter(&Counter);
+			return Counter.QuadPart;
+		}
+
+		static uint64_t Hash(const void *pData, size_t Size)
+		{
+			// 64-bit multiply-rotate hash, eight bytes per step
+			const uint8_t *p = static_cast<const uint8_t *>(pData);
+			uint64_t h = 0x9E3779B97F4A7C15ull ^ (Size * 0xFF51AFD7ED558CCDull);
+			for (; Size >= 8; p += 8, Size -= 8)
+			{
+				uint64_t k;
+				memcpy(&k, p, 8);
+				k *= 0x87C37B91114253D5ull;
+				k = (k << 31) | (k >> 33);
+				h ^= k * 0x4CF5AD432745937Full;
+				h = ((h << 27) | (h >> 37)) * 5 + 0x52DCE729;
+			}
+			uint64_t k = 0;
+			memcpy(&k, p, Size);
+			h ^= k * 0x87C37B91114253D5ull;
+			h ^= h >> 33;
+			h *= 0xFF51AFD7ED558CCDull;
+			h ^= h >> 33;
+			h *= 0xC4CEB9FE1A85EC53ull;
+			h ^= h >> 33;
+			return h ? h : 1;
+		}
+
+		// Slot holding Key, or the free slot it would go into; nullptr when the neighbourhood is full
+		static std::atomic<uint64_t> *FindSeen(uint64_t Key)
+		{
+			for (uint32_t x = 0; x < SeenProbes; x++)
+			{
+				std::atomic<uint64_t>& Slot = Seen[(Key + x) & (SeenSize - 1)];
+				const uint64_t Value = Slot.load(std::memory_order_relaxed);
+				if (Value == Key || Value == 0)
+				{
+					return &Slot;
+				}
+			}
+			return nullptr;
+		}
+
+		// A full neighbourhood just stores the block again
+		static bool WasWritten(uint64_t Key)
+		{
+			std::atomic<uint64_t> *pSlot = FindSeen(Key);
+			return pSlot && pSlot->load(std::memory_order_relaxed) == Key;
+		}
+
+		// Only called once the Blob record is in a chunk, so a dropped one is stored again by a later record
+		static void MarkWritten(uint64_t Key)
+		{
+			while (std::atomic<uint64_t> *pSlot = FindSeen(Key))
+			{
+				uint64_t Value = 0;
+				if (pSlot->compare_exchange_strong(Value, Key, std::memory_order_relaxed) || Value == Key)
+				{
+					return;
+				}
+			}
+		}
+
+		template <typename T>
+		static void Prepare(const T&) { }
+		static void Prepare(const Data& Block)
+		{
+			if (!Block.Size)
+			{
+				return;
+			}
+
+			Block.Hash = Hash(Block.pData, Block.Size);
+			if (WasWritten(Block.Hash))
+			{
+				return;
+			}
+
+			uint8_t *p = Reserve(sizeof(RecordHeader) + sizeof(uint64_t) + Block.Size);
+			if (!p)
+			{
+				return;
+			}
+
+			const RecordHeader Header = { (uint16_t)Call::Blob, 0, (uint32_t)sizeof(uint64_t) + Block.Size, Now() };
+			memcpy(p, &Header, sizeof(Header));
+			memcpy(p + sizeof(Header), &Block.Hash, sizeof(uint64_t));
+			memcpy(p + sizeof(Header) + sizeof(uint64_t), Block.pData, Block.Size);
+			MarkWritten(Block.Hash);
+		}
+
+		template <typename T>
+		static uint32_t SizeOf(const T&)
+		{
+			static_assert(std::is_trivially_copyable<T>::value && !std::is_pointer<T>::value, "pass pointers through Trace::ByRef, Trace::Id or Trace::Block");
+			return sizeof(T);
+		}
+		template <typename T>
+		static uint32_t SizeOf(const Ref<T>& Value) { return 1 + (Value.pValue ? sizeof(T) : 0); }
+		static uint32_t SizeOf(const Object&) { return sizeof(uint64_t); }
+		static uint32_t SizeOf(const Data&) { return sizeof(uint64_t); }
+
+		template <typename T>
+		static void Put(uint8_t *&p, const T& Value)
+		{
+			memcpy(p, &Value, sizeof(T));
+			p += sizeof(T);
+		}
+		template <typename T>
+		static void Put(uint8_t *&p, const Ref<T>& Value)
+		{
+			*p++ = Value.pValue ? 1 : 0;
+			if (Value.pValue)
+			{
+				memcpy(p, Value.pValue, sizeof(T));
+				p += sizeof(T);
+			}
+		}
+		static void Put(uint8_t *&p, const Object& Value)
+		{
+			const uint64_t Id = (uint64_t)(uintptr_t)Value.pObject;
+			memcpy(p, &Id, sizeof(Id));
+			p += sizeof(Id);
+		}
+		static void Put(uint8_t *&p, const Data& Value)
+		{
+			memcpy(p, &Value.Hash, sizeof(Value.Hash));
+			p += sizeof(Value.Hash);
+		}
+
+		static ThreadBuffer *Register()
+		{
+			ThreadBuffer *pBuffer = new ThreadBuffer();
+			pBuffer->ThreadId = GetCurrentThreadId();
+			pBuffer->pNext = Registry.load(std::memory_order_relaxed);
+			while (!Registry.compare_exchange_weak(pBuffer->pNext, pBuffer, std::memory_order_release, std::memory_order_relaxed));
+
+			Local = pBuffer;
+			return pBuffer;
+		}
+
+		static Chunk *Allocate(ThreadBuffer *pOwner, uint32_t Capacity)
+		{
+			if (ChunkCount.fetch_add(1, std::memory_order_relaxed) >= MaxChunks)
+			{
+				ChunkCount.fetch_sub(1, std::memory_order_relaxed);
+				return nullptr;
+			}
+
+			Chunk *pChunk = static_cast<Chunk *>(malloc(sizeof(Chunk) + Capacity));
+			if (!pChunk)
+			{
+				ChunkCount.fetch_sub(1, std::memory_order_relaxed);
+				return nullptr;
+			}
+			pChunk->pNext = nullptr;
+			pChunk->pOwner = pOwner;
+			pChunk->Capacity = Capacity;
+			pChunk->Used = 0;
+			return pChunk;
+		}
+
+		static Chunk *Acquire(ThreadBuffer *pBuffer, uint32_t Size)
+		{
+			// Blocks larger than a chunk get one of their own, freed once written
+			if (Size > ChunkSize)
+			{
+				return Allocate(pBuffer, Size);
+			}
+
+			if (!pBuffer->pFree)
+			{
+				pBuffer->pFree = pBuffer->Returned.exchange(nullptr, std::memory_order_acquire);
+			}
+			if (Chunk *pChunk = pBuffer->pFree)
+			{
+				pBuffer->pFree = pChunk->pNext;
+				pChunk->Used = 0;
+				return pChunk;
+			}
+			return Allocate(pBuffer, ChunkSize);
+		}
+
+		static uint8_t *Reserve(uint32_t Size)
+		{
+			ThreadBuffer *pBuffer = Local ? Local : Register();
+
+			Chunk *pChunk = pBuffer->pCurrent;
+			if (pChunk && pChunk->Capacity - pChunk->Used >= Size)
+			{
+				uint8_t *p = pChunk->Data() + pChunk->Used;
+				pChunk->Used += Size;
+				return p;
+			}
+
+			if (pChunk)
+			{
+				pBuffer->pCurrent = nullptr;
+				Submit(pChunk);
+			}
+
+			pChunk = Acquire(pBuffer, Size);
+			if (!pChunk)
+			{
+				Dropped.fetch_add(1, std::memory_order_relaxed);
+				return nullptr;
+			}
+
+			pBuffer->pCurrent = pChunk;
+			pChunk->Used = Size;
+			return pChunk->Data();
+		}
+
+		// Owner thread
+		static void Submit(Chunk *pChunk)
+		{
+			if (!pChunk->Used)
+			{
+				pChunk->pNext = pChunk->pOwner->pFree;
+				pChunk->pOwner->pFree = pChunk;
+				return;
+			}
+
+			pChunk->pNext = Submitted.load(std::memory_order_relaxed);
+			while (!Submitted.compare_exchange_weak(pChunk->pNext, pChunk, std::memory_order_release, std::memory_order_relaxed));
+			SetEvent(hWake);
+		}
+
+		static void WriteOut(const void *pData, DWORD Size)
+		{
+			DWORD Written;
+			WriteFile(hFile, pData, Size, &Written, NULL);
+		}
+
+		// Writer thread
+		static void Drain()
+		{
+			// The list comes out newest first
+			Chunk *pList = nullptr;
+			for (Chunk *pChunk = Submitted.exchange(nullptr, std::memory_order_acquire); pChunk; )
+			{
+				Chunk *pNext = pChunk->pNext;
+				pChunk->pNext = pList;
+				pList = pChunk;
+				pChunk = pNext;
+			}
+
+			while (pList)
+			{
+				Chunk *pChunk = pList;
+				pList = pChunk->pNext;
+
+				const ChunkHeader Header = { pChunk->pOwner->ThreadId, pChunk->Used };
+				WriteOut(&Header, sizeof(Header));
+				WriteOut(pChunk->Data(), pChunk->Used);
+
+				if (pChunk->Capacity != ChunkSize)
+				{
+					free(pChunk);
+					ChunkCount.fetch_sub(1, std::memory_order_relaxed);
+					continue;
+				}
+
+				// Only this thread pushes and the owner takes the whole list at once, so there is no ABA
+				std::atomic<Chunk *>& Returned = pChunk->pOwner->Returned;
+				pChunk->pNext = Returned.load(std::memory_order_relaxed);
+				while (!Returned.compare_exchange_weak(pChunk->pNext, pChunk, std::memory_order_release, std::memory_order_relaxed));
+			}
+		}
+
+		static DWORD WINAPI WriterThread(LPVOID hModule)
+		{
+			uint32_t Synced = 0;
+			while (Active.load(std::memory_order_acquire))
+			{
+				WaitForSingleObject(hWake, 100);
+
+				// Chunks are submitted before the request is counted, so this Drain writes them
+				const uint32_t Requests = SyncRequests.load(std::memory_order_acquire);
+				Drain();
+				if (Requests != Synced)
+				{
+					Synced = Requests;
+					SetEvent(hWritten);
+				}
+			}
+			FreeLibraryAndExitThread((HMODULE)hModule, 0);
+		}
+	};
+
+	// Call sites use this, the arguments are only serialized while recording
+	template <typename... Args>
+	inline void Record(Call Id, const Args&... args)
+	{
+		if (Recorder::IsActive())
+		{
+			Recorder::Write(Id, args...);
+		}
+	}
+}
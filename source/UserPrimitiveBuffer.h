@@ -0,0 +1,158 @@
+#pragma once
+
+// Dynamic vertex and index buffers that DrawPrimitiveUP and
+// DrawIndexedPrimitiveUP data is appended to, so those draws become ordinary
+// DrawPrimitive calls instead of a runtime allocation and copy each. Space is
+// handed out front to back with D3DLOCK_NOOVERWRITE; when a buffer is full it
+// is locked with D3DLOCK_DISCARD and filling starts over. The buffers live in
+// the default pool and have to be released before a Reset.
+class UserPrimitiveBuffer
+{
+public:
+	static constexpr UINT VertexBytes = 1024 * 1024;
+	static constexpr UINT IndexBytes = 256 * 1024;
+
+	~UserPrimitiveBuffer()
+	{
+		Release();
+	}
+
+	// Copies Count vertices in, starting at vertex MinStart or later. False when the draw does not fit or
+	// the buffer cannot be created or locked; the caller then hands the draw to the runtime.
+	bool AppendVertices(LPDIRECT3DDEVICE8 pDevice, const void *pData, UINT Count, UINT Stride, UINT MinStart, UINT& StartVertex)
+	{
+		if (!Vertices.pBuffer && !Create(pDevice))
+		{
+			return false;
+		}
+
+		UINT Offset;
+		if (!Append(Vertices, pData, Count * Stride, Stride, MinStart * Stride, Offset))
+		{
+			return false;
+		}
+
+		StartVertex = Offset / Stride;
+		return true;
+	}
+
+	// Copies Count 16-bit indices in
+	bool AppendIndices(LPDIRECT3DDEVICE8 pDevice, const void *pData, UINT Count, UINT& StartIndex)
+	{
+		if (!Indices.pBuffer && !Create(pDevice))
+		{
+			return false;
+		}
+
+		UINT Offset;
+		if (!Append(Indices, pData, Count * sizeof(WORD), sizeof(WORD), 0, Offset))
+		{
+			return false;
+		}
+
+		StartIndex = Offset / sizeof(WORD);
+		return true;
+	}
+
+	// True when Count vertices would go right after the last ones, without a discard
+	bool VerticesFollow(UINT Count, UINT Stride) const
+	{
+		return Vertices.pBuffer && Vertices.Position % Stride == 0 && Vertices.Position + Count * Stride <= Vertices.Size;
+	}
+
+	IDirect3DVertexBuffer8 *GetVertexBuffer() const { return Vertices.pBuffer; }
+	IDirect3DIndexBuffer8 *GetIndexBuffer() const { return Indices.pBuffer; }
+
+	void Release()
+	{
+		Vertices.Release();
+		Indices.Release();
+		CreateFailed = false;
+	}
+
+private:
+	template <typename T>
+	struct Ring
+	{
+		T *pBuffer = nullptr;
+		UINT Size = 0;
+		UINT Position = 0;
+
+		void Release()
+		{
+			if (pBuffer)
+			{
+				pBuffer->Release();
+				pBuffer = nullptr;
+			}
+			Position = 0;
+		}
+	};
+
+	bool Create(LPDIRECT3DDEVICE8 pDevice)
+	{
+		if (CreateFailed)
+		{
+			return false;
+		}
+
+		// Buffers drawn with software vertex processing need to say so
+		DWORD Usage = D3DUSAGE_DYNAMIC | D3DUSAGE_WRITEONLY;
+		D3DDEVICE_CREATION_PARAMETERS Parameters;
+		if (SUCCEEDED(pDevice->GetCreationParameters(&Parameters)) && (Parameters.BehaviorFlags & (D3DCREATE_SOFTWARE_VERTEXPROCESSING | D3DCREATE_MIXED_VERTEXPROCESSING)))
+		{
+			Usage |= D3DUSAGE_SOFTWAREPROCESSING;
+		}
+
+		if (FAILED(pDevice->CreateVertexBuffer(VertexBytes, Usage, 0, D3DPOOL_DEFAULT, &Vertices.pBuffer)) ||
+			FAILED(pDevice->CreateIndexBuffer(IndexBytes, Usage, D3DFMT_INDEX16, D3DPOOL_DEFAULT, &Indices.pBuffer)))
+		{
+			OutputDebugStringA("d3d8: could not create the UP draw buffers, UP draws go to the runtime\n");
+
+			Release();
+			CreateFailed = true;
+			return false;
+		}
+
+		Vertices.Size = VertexBytes;
+		Indices.Size = IndexBytes;
+		return true;
+	}
+
+	template <typename T>
+	static bool Append(Ring<T>& Buffer, const void *pData, UINT Bytes, UINT Alignment, UINT MinOffset, UINT& Offset)
+	{
+		if (!pData || !Bytes || MinOffset + Bytes > Buffer.Size)
+		{
+			return false;
+		}
+
+		// Offsets have to be a whole number of vertices or indices from the start
+		Offset = (Buffer.Position + Alignment - 1) / Alignment * Alignment;
+		if (Offset < MinOffset)
+		{
+			Offset = MinOffset;
+		}
+		DWORD Flags = D3DLOCK_NOOVERWRITE;
+		if (Offset + Bytes > Buffer.Size)
+		{
+			Offset = MinOffset;
+			Flags = D3DLOCK_DISCARD;
+		}
+
+		BYTE *pDest;
+		if (FAILED(Buffer.pBuffer->Lock(Offset, Bytes, &pDest, Flags)))
+		{
+			return false;
+		}
+		memcpy(pDest, pData, Bytes);
+		Buffer.pBuffer->Unlock();
+
+		Buffer.Position = Offset + Bytes;
+		return true;
+	}
+
+	Ring<IDirect3DVertexBuffer8> Vertices;
+	Ring<IDirect3DIndexBuffer8> Indices;
+	bool CreateFailed = false;
+};
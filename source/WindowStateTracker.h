@@ -0,0 +1,71 @@
+#pragma once
+
+#include <windows.h>
+#include "PointerMap.h"
+#include "helpers.h"
+
+// Top-level and topmost state of the windows of hooked classes, kept per thread since a
+// window only receives messages on the thread that created it
+class WindowStateTracker
+{
+public:
+	struct State
+	{
+		bool TopLevel;
+		bool Topmost;
+	};
+
+	// Reads the window from user32 the first time it is seen, afterwards from the cache
+	static State Get(HWND hWnd)
+	{
+		if (State* state = Windows.Find(hWnd))
+			return *state;
+
+		State state = { _fnIsTopLevelWindow(hWnd) != FALSE, IsTopmost(hWnd) };
+		Windows.Insert(hWnd, state);
+		return state;
+	}
+	static void Update(HWND hWnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
+	{
+		State* state = Windows.Find(hWnd);
+		if (!state)
+			return;
+
+		switch (uMsg)
+		{
+		case WM_STYLECHANGED:
+			if (wParam == GWL_EXSTYLE)
+				state->Topmost = (reinterpret_cast<STYLESTRUCT*>(lParam)->styleNew & WS_EX_TOPMOST) != 0;
+			else if (wParam == GWL_STYLE)
+				state->TopLevel = _fnIsTopLevelWindow(hWnd) != FALSE;
+			break;
+		case WM_WINDOWPOSCHANGED:
+			// Topmost is toggled through the z-order, which does not send WM_STYLECHANGED
+			if ((reinterpret_cast<WINDOWPOS*>(lParam)->flags & SWP_NOZORDER) == 0)
+				state->Topmost = IsTopmost(hWnd);
+			break;
+		default:
+			break;
+		}
+	}
+	static void MakeTopmost(HWND hWnd)
+	{
+		SetWindowPos(hWnd, HWND_TOPMOST, 0, 0, 0, 0, SWP_NOACTIVATE | SWP_NOMOVE | SWP_NOSIZE);
+
+		// The entry may have moved while SetWindowPos dispatched messages
+		if (State* state = Windows.Find(hWnd))
+			state->Topmost = IsTopmost(hWnd);
+	}
+	static void Forget(HWND hWnd)
+	{
+		Windows.Erase(hWnd);
+	}
+
+private:
+	static bool IsTopmost(HWND hWnd)
+	{
+		return (GetWindowLong(hWnd, GWL_EXSTYLE) & WS_EX_TOPMOST) != 0;
+	}
+
+	static inline thread_local PointerMap<State> Windows;
+};
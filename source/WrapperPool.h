@@ -0,0 +1,135 @@
+#pragma once
+
+#include <new>
+#include <initializer_list>
+
+constexpr UINT WrapperSlabSize = 64;
+
+struct WrapperPoolStatistics
+{
+	UINT Live;		// objects currently allocated
+	UINT Peak;		// highest Live seen
+	UINT Slabs;		// slabs reserved
+};
+
+// Fixed-size allocator for one wrapper type. Objects are carved out of
+// slabs of WrapperSlabSize and recycled through a free list, slabs are
+// kept for the lifetime of the process.
+template <typename T>
+class WrapperPool
+{
+public:
+	using Statistics = WrapperPoolStatistics;
+
+	static void *Allocate()
+	{
+		AcquireSRWLockExclusive(&Lock);
+
+		if (!FreeList)
+		{
+			Node *pSlab = new (std::nothrow) Node[WrapperSlabSize];
+			if (!pSlab)
+			{
+				ReleaseSRWLockExclusive(&Lock);
+				throw std::bad_alloc();
+			}
+
+			for (UINT x = 0; x < WrapperSlabSize; x++)
+			{
+				pSlab[x].pNext = (x + 1 < WrapperSlabSize) ? &pSlab[x + 1] : nullptr;
+			}
+			FreeList = pSlab;
+			Stats.Slabs++;
+		}
+
+		Node *pNode = FreeList;
+		FreeList = pNode->pNext;
+		if (++Stats.Live > Stats.Peak)
+		{
+			Stats.Peak = Stats.Live;
+		}
+
+		ReleaseSRWLockExclusive(&Lock);
+
+		return pNode;
+	}
+
+	static void Free(void *pObject)
+	{
+		AcquireSRWLockExclusive(&Lock);
+
+		Node *pNode = static_cast<Node *>(pObject);
+		pNode->pNext = FreeList;
+		FreeList = pNode;
+		Stats.Live--;
+
+		ReleaseSRWLockExclusive(&Lock);
+	}
+
+	static Statistics GetStatistics()
+	{
+		AcquireSRWLockShared(&Lock);
+		Statistics Result = Stats;
+		ReleaseSRWLockShared(&Lock);
+
+		return Result;
+	}
+
+private:
+	union Node
+	{
+		Node *pNext;
+		alignas(T) unsigned char Storage[sizeof(T)];
+	};
+
+	static inline SRWLOCK Lock = SRWLOCK_INIT;
+	static inline Node *FreeList = nullptr;
+	static inline Statistics Stats = {};
+};
+
+// Statistics of the pools of several wrapper types added up, Peak is the sum of each pool's own peak
+template <typename... T>
+WrapperPoolStatistics GetWrapperPoolStatistics()
+{
+	WrapperPoolStatistics Total = {};
+	for (const WrapperPoolStatistics& Stats : { WrapperPool<T>::GetStatistics()... })
+	{
+		Total.Live += Stats.Live;
+		Total.Peak += Stats.Peak;
+		Total.Slabs += Stats.Slabs;
+	}
+	return Total;
+}
+
+// Base for wrapper classes that are allocated from their WrapperPool
+template <typename T>
+class PooledObject
+{
+public:
+	static void *operator new(size_t Size)
+	{
+		// A derived class of a different size goes to the regular heap
+		if (Size != sizeof(T))
+		{
+			return ::operator new(Size);
+		}
+
+		return WrapperPool<T>::Allocate();
+	}
+
+	static void operator delete(void *pObject, size_t Size)
+	{
+		if (!pObject)
+		{
+			return;
+		}
+
+		if (Size != sizeof(T))
+		{
+			::operator delete(pObject);
+			return;
+		}
+
+		WrapperPool<T>::Free(pObject);
+	}
+};
@@ -0,0 +1,407 @@
+#ifndef __CONFIG_H
+#define __CONFIG_H
+
+#include <stdio.h>
+#include <stddef.h>
+#include <stdint.h>
+#ifdef _WIN32
+#include <windows.h>
+#include <atomic>
+#endif
+
+// Settings read from d3d8.ini, filled once and not modified afterwards
+struct Config
+{
+    // [MAIN]
+    bool ForceWindowedMode = false;
+    bool Direct3D8DisableMaximizedWindowedModeShim = false;
+    int FPSLimit = 0;
+    int FPSLimitMode = 1;
+    int FPSLimitCatchUp = 0;
+    int FPSLimitResyncMs = 250;
+    int FullScreenRefreshRateInHz = 0;
+    int DisplayFPSCounter = 0;
+    int FrameStatsLog = 0;
+    bool FilterRedundantStates = true;
+    bool BufferUPDraws = true;
+    bool MergeUPDraws = true;
+    bool OptimizeLockFlags = true;
+    bool RenameLockedBuffers = false;
+    bool DeduplicateTextures = false;
+    bool VerifyShadowState = false;
+    bool HotReload = false;
+    bool RecordTrace = false;
+
+    // [FORCEWINDOWED]
+    bool UsePrimaryMonitor = false;
+    bool CenterWindow = true;
+    bool BorderlessFullscreen = false;
+    bool AlwaysOnTop = false;
+    bool DoNotNotifyOnTaskSwitch = false;
+};
+
+/*  Single pass d3d8.ini parser.
+ *
+ *  Follows GetPrivateProfileInt: section and key names are case-insensitive,
+ *  the first occurrence of a key wins and a value is the leading integer of
+ *  the text after '=', so trailing comments are ignored. Values outside
+ *  their range keep the default. Unknown keys and malformed lines are
+ *  reported, sections used by other patches sharing the file are skipped.
+ *
+ *  Parse() only needs the C library, so tools/configfuzz.cpp builds it on
+ *  any platform; loading the file and watching it need Windows.
+ */
+class ConfigParser
+{
+public:
+    typedef void (*ReportFn)(const char* message);
+
+    static void Parse(const char* data, size_t size, Config& config, ReportFn report)
+    {
+        const Key* keys = Keys();
+        uint32_t seen = 0;
+        const char* section = nullptr;
+        size_t sectionLength = 0;
+        bool skipSection = true;   // keys before the first section are ignored like GetPrivateProfileInt does
+
+        const char* end = data + size;
+        int lineNumber = 0;
+        for (const char* line = data; line < end; )
+        {
+            const char* next = line;
+            while (next < end && *next != '\n')
+                next++;
+            const char* lineEnd = next;
+            next = (next < end) ? next + 1 : end;
+            lineNumber++;
+
+            while (line < lineEnd && IsSpace(*line))
+                line++;
+            while (lineEnd > line && IsSpace(lineEnd[-1]))
+                lineEnd--;
+
+            if (line == lineEnd || *line == ';' || *line == '#' || (lineEnd - line >= 2 && line[0] == '/' && line[1] == '/'))
+            {
+                line = next;
+                continue;
+            }
+
+            if (*line == '[')
+            {
+                const char* close = line + 1;
+                while (close < lineEnd && *close != ']')
+                    close++;
+                if (close == lineEnd)
+                {
+                    Report(report, lineNumber, "malformed section header");
+                    skipSection = true;
+                }
+                else
+                {
+                    section = line + 1;
+                    sectionLength = close - section;
+                    skipSection = IsForeignSection(section, sectionLength);
+                    if (!skipSection && !IsKnownSection(keys, section, sectionLength))
+                    {
+                        Report(report, lineNumber, "unknown section");
+                        skipSection = true;
+                    }
+                }
+                line = next;
+                continue;
+            }
+
+            if (skipSection)
+            {
+                line = next;
+                continue;
+            }
+
+            const char* equals = line;
+            while (equals < lineEnd && *equals != '=')
+                equals++;
+            if (equals == lineEnd)
+            {
+                Report(report, lineNumber, "expected 'key = value'");
+                line = next;
+                continue;
+            }
+
+            const char* nameEnd = equals;
+            while (nameEnd > line && IsSpace(nameEnd[-1]))
+                nameEnd--;
+
+            int index = FindKey(keys, section, sectionLength, line, nameEnd - line);
+            if (index < 0)
+            {
+                Report(report, lineNumber, "unknown key");
+            }
+            else if ((seen & (1u << index)) == 0)
+            {
+                seen |= 1u << index;
+
+                const Key& key = keys[index];
+                int value = ParseInt(equals + 1, lineEnd);
+                if (key.Bool)
+                    config.*key.Bool = value != 0;
+                else if (value < key.Min || value > key.Max)
+                    Report(report, lineNumber, "value out of range, using the default");
+                else
+                    config.*key.Int = value;
+            }
+            line = next;
+        }
+    }
+
+#ifdef _WIN32
+    // Maps the file and parses it, a missing file leaves the defaults
+    static bool Load(const char* path, Config& config, ReportFn report)
+    {
+        HANDLE hFile = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+        if (hFile == INVALID_HANDLE_VALUE)
+            return false;
+
+        bool loaded = false;
+        DWORD size = GetFileSize(hFile, NULL);
+        if (size == 0)
+            loaded = true;
+        else if (size != INVALID_FILE_SIZE)
+        {
+            HANDLE hMapping = CreateFileMappingA(hFile, NULL, PAGE_READONLY, 0, 0, NULL);
+            if (hMapping)
+            {
+                const char* data = static_cast<const char*>(MapViewOfFile(hMapping, FILE_MAP_READ, 0, 0, 0));
+                if (data)
+                {
+                    Parse(data, size, config, report);
+                    UnmapViewOfFile(data);
+                    loaded = true;
+                }
+                CloseHandle(hMapping);
+            }
+        }
+        CloseHandle(hFile);
+        return loaded;
+    }
+#endif
+
+private:
+    struct Key
+    {
+        const char* Section;
+        const char* Name;
+        int Min;
+        int Max;
+        int Config::* Int;
+        bool Config::* Bool;
+    };
+
+    static const Key* Keys()
+    {
+        static const Key keys[] = {
+            { "MAIN", "ForceWindowedMode", 0, 0, nullptr, &Config::ForceWindowedMode },
+            { "MAIN", "Direct3D8DisableMaximizedWindowedModeShim", 0, 0, nullptr, &Config::Direct3D8DisableMaximizedWindowedModeShim },
+            { "MAIN", "FPSLimit", 0, 1000, &Config::FPSLimit, nullptr },
+            { "MAIN", "FPSLimitMode", 1, 3, &Config::FPSLimitMode, nullptr },
+            { "MAIN", "FPSLimitCatchUp", 0, 60, &Config::FPSLimitCatchUp, nullptr },
+            { "MAIN", "FPSLimitResyncMs", 0, 10000, &Config::FPSLimitResyncMs, nullptr },
+            { "MAIN", "FullScreenRefreshRateInHz", -1, 1000, &Config::FullScreenRefreshRateInHz, nullptr },
+            { "MAIN", "DisplayFPSCounter", 0, 2, &Config::DisplayFPSCounter, nullptr },
+            { "MAIN", "FrameStatsLog", 0, 2, &Config::FrameStatsLog, nullptr },
+            { "MAIN", "FilterRedundantStates", 0, 0, nullptr, &Config::FilterRedundantStates },
+            { "MAIN", "BufferUPDraws", 0, 0, nullptr, &Config::BufferUPDraws },
+            { "MAIN", "MergeUPDraws", 0, 0, nullptr, &Config::MergeUPDraws },
+            { "MAIN", "OptimizeLockFlags", 0, 0, nullptr, &Config::OptimizeLockFlags },
+            { "MAIN", "RenameLockedBuffers", 0, 0, nullptr, &Config::RenameLockedBuffers },
+            { "MAIN", "DeduplicateTextures", 0, 0, nullptr, &Config::DeduplicateTextures },
+            { "MAIN", "VerifyShadowState", 0, 0, nullptr, &Config::VerifyShadowState },
+            { "MAIN", "HotReload", 0, 0, nullptr, &Config::HotReload },
+            { "MAIN", "RecordTrace", 0, 0, nullptr, &Config::RecordTrace },
+            { "FORCEWINDOWED", "UsePrimaryMonitor", 0, 0, nullptr, &Config::UsePrimaryMonitor },
+            { "FORCEWINDOWED", "CenterWindow", 0, 0, nullptr, &Config::CenterWindow },
+            { "FORCEWINDOWED", "BorderlessFullscreen", 0, 0, nullptr, &Config::BorderlessFullscreen },
+            { "FORCEWINDOWED", "AlwaysOnTop", 0, 0, nullptr, &Config::AlwaysOnTop },
+            { "FORCEWINDOWED", "DoNotNotifyOnTaskSwitch", 0, 0, nullptr, &Config::DoNotNotifyOnTaskSwitch },
+            { nullptr, nullptr, 0, 0, nullptr, nullptr },
+        };
+        return keys;
+    }
+
+    static bool IsSpace(char c)
+    {
+        return c == ' ' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+    }
+
+    // Length-bounded ASCII case-insensitive compare against a terminated name
+    static bool Equals(const char* text, size_t length, const char* name)
+    {
+        for (size_t i = 0; i < length; i++, name++)
+        {
+            char a = text[i], b = *name;
+            if (a >= 'A' && a <= 'Z')
+                a |= 0x20;
+            if (b >= 'A' && b <= 'Z')
+                b |= 0x20;
+            if (a != b || b == 0)
+                return false;
+        }
+        return *name == 0;
+    }
+
+    static bool IsForeignSection(const char* section, size_t length)
+    {
+        // Read by other patches sharing d3d8.ini
+        return Equals(section, length, "fullscreenresolution") || Equals(section, length, "FOV");
+    }
+
+    static bool IsKnownSection(const Key* keys, const char* section, size_t length)
+    {
+        for (; keys->Name; keys++)
+        {
+            if (Equals(section, length, keys->Section))
+                return true;
+        }
+        return false;
+    }
+
+    static int FindKey(const Key* keys, const char* section, size_t sectionLength, const char* name, size_t nameLength)
+    {
+        for (int i = 0; keys[i].Name; i++)
+        {
+            if (Equals(name, nameLength, keys[i].Name) && Equals(section, sectionLength, keys[i].Section))
+                return i;
+        }
+        return -1;
+    }
+
+    // Leading integer of the value like GetPrivateProfileInt, 0 when there is none
+    static int ParseInt(const char* text, const char* end)
+    {
+        while (text < end && IsSpace(*text))
+            text++;
+
+        bool negative = false;
+        if (text < end && (*text == '-' || *text == '+'))
+            negative = *text++ == '-';
+
+        int64_t value = 0;
+        for (; text < end && *text >= '0' && *text <= '9'; text++)
+        {
+            if (value < INT32_MAX)
+                value = value * 10 + (*text - '0');
+        }
+        if (value > INT32_MAX)
+            value = INT32_MAX;
+        return (int)(negative ? -value : value);
+    }
+
+    static void Report(ReportFn report, int line, const char* message)
+    {
+        if (!report)
+            return;
+
+        char text[128];
+        snprintf(text, sizeof(text), "d3d8.ini(%d): %s\n", line, message);
+        report(text);
+    }
+};
+
+#ifdef _WIN32
+/*  Watches d3d8.ini for changes from a background thread.
+ *
+ *  Each time the file is written it is parsed into a new Config which is
+ *  published through an atomic pointer; the render thread picks it up with
+ *  Take() at the next frame boundary. A config that was never taken is
+ *  replaced by the newer one, so neither side ever waits on the other.
+ */
+class ConfigWatcher
+{
+private:
+    static inline char Path[MAX_PATH] = {};
+    static inline std::atomic<Config*> Pending{ nullptr };
+
+    static void Report(const char* message)
+    {
+        OutputDebugStringA(message);
+    }
+
+    static bool GetWriteTime(FILETIME& time)
+    {
+        WIN32_FILE_ATTRIBUTE_DATA data;
+        if (!GetFileAttributesExA(Path, GetFileExInfoStandard, &data))
+            return false;
+        time = data.ftLastWriteTime;
+        return true;
+    }
+
+    static DWORD WINAPI WatchThread(LPVOID module)
+    {
+        char directory[MAX_PATH];
+        strcpy_s(directory, Path);
+        *strrchr(directory, '\\') = 0;
+
+        // Editors often save through a temporary file and a rename, so watch names as well as writes
+        HANDLE hChange = FindFirstChangeNotificationA(directory, FALSE, FILE_NOTIFY_CHANGE_LAST_WRITE | FILE_NOTIFY_CHANGE_FILE_NAME);
+        if (hChange == INVALID_HANDLE_VALUE)
+            FreeLibraryAndExitThread((HMODULE)module, 0);
+
+        FILETIME last = {};
+        GetWriteTime(last);
+
+        while (WaitForSingleObject(hChange, INFINITE) == WAIT_OBJECT_0)
+        {
+            // Let the editor finish writing before the file is read
+            Sleep(100);
+            FindNextChangeNotification(hChange);
+
+            FILETIME time;
+            if (!GetWriteTime(time) || CompareFileTime(&time, &last) == 0)
+                continue;
+            last = time;
+
+            Config* config = new Config;
+            if (!ConfigParser::Load(Path, *config, Report))
+            {
+                delete config;
+                continue;
+            }
+            delete Pending.exchange(config, std::memory_order_acq_rel);
+            OutputDebugStringA("d3d8.ini: reloaded\n");
+        }
+
+        FindCloseChangeNotification(hChange);
+        FreeLibraryAndExitThread((HMODULE)module, 0);
+    }
+
+public:
+    // Safe under the loader lock; the thread holds a reference to the module so it is never unloaded beneath it
+    static bool Start(const char* path)
+    {
+        if (strcpy_s(Path, path) != 0 || !strrchr(Path, '\\'))
+            return false;
+
+        HMODULE hModule = NULL;
+        if (!GetModuleHandleExA(GET_MODULE_HANDLE_EX_FLAG_FROM_ADDRESS, (LPCSTR)&WatchThread, &hModule))
+            return false;
+
+        HANDLE hThread = CreateThread(NULL, 0, WatchThread, hModule, 0, NULL);
+        if (!hThread)
+        {
+            FreeLibrary(hModule);
+            return false;
+        }
+        CloseHandle(hThread);
+        return true;
+    }
+
+    // Render thread; returns the newest config since the last call or nullptr, the caller deletes it
+    static Config* Take()
+    {
+        if (!Pending.load(std::memory_order_relaxed))
+            return nullptr;
+        return Pending.exchange(nullptr, std::memory_order_acquire);
+    }
+};
+#endif
+
+#endif //__CONFIG_H
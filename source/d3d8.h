@@ -16,6 +16,15 @@ class m_IDirect3DVolume8;
 class m_IDirect3DVolumeTexture8;
 
 #include "AddressLookupTable.h"
+#include "WrapperPool.h"
+#include "StateCache.h"
+#include "DisplayModeCatalogue.h"
+#include "DrawHelpers.h"
+#include "TraceRecorder.h"
+#include "UserPrimitiveBuffer.h"
+#include "LockFlagOptimizer.h"
+#include "BufferRenamer.h"
+#include "TextureDeduplicator.h"
 
 typedef int(WINAPI *Direct3D8EnableMaximizedWindowedModeShimProc)(BOOL);
 typedef HRESULT(WINAPI *ValidatePixelShaderProc)(DWORD*, DWORD*, BOOL, DWORD*);
@@ -25,6 +34,14 @@ typedef IDirect3D8 *(WINAPI *Direct3DCreate8Proc)(UINT);
 
 void genericQueryInterface(REFIID riid, LPVOID *ppvObj, m_IDirect3DDevice8* m_pDevice);
 
+extern bool bFilterRedundantStates;
+extern bool bVerifyShadowState;
+extern bool bBufferUPDraws;
+extern bool bMergeUPDraws;
+extern bool bOptimizeLockFlags;
+extern bool bRenameLockedBuffers;
+extern bool bDeduplicateTextures;
+
 #include "IDirect3D8.h"
 #include "IDirect3DDevice8.h"
 #include "IDirect3DCubeTexture8.h"
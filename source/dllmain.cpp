@@ -15,10 +15,14 @@
 */
 
 #include "d3d8.h"
-#include <d3dx8.h>
 #include "iathook.h"
 #include "helpers.h"
-#pragma comment (lib, "d3dx8.lib")
+#include "perfecthash.h"
+#include "framepacer.h"
+#include "framestats.h"
+#include "overlay.h"
+#include "config.h"
+#include "WindowStateTracker.h"
 #pragma comment (lib, "legacy_stdio_definitions.lib")
 #pragma comment(lib, "winmm.lib") // needed for timeBeginPeriod()/timeEndPeriod()
 
@@ -41,179 +45,309 @@ bool bBorderlessFullscreen;
 bool bAlwaysOnTop;
 bool bDoNotNotifyOnTaskSwitch;
 bool bDisplayFPSCounter;
+bool bDisplayWrapperStats;
+bool bFilterRedundantStates;
+bool bVerifyShadowState;
+bool bBufferUPDraws;
+bool bMergeUPDraws;
+bool bOptimizeLockFlags;
+bool bRenameLockedBuffers;
+bool bDeduplicateTextures;
+bool bHotReload;
 float fFPSLimit;
+int nFPSLimitCatchUp;
+int nFPSLimitResyncMs;
+int nFrameStatsLog;
 int nFullScreenRefreshRateInHz;
 
 char WinDir[MAX_PATH + 1];
 
-// List of registered window classes and procedures
-// WORD classAtom, ULONG_PTR WndProcPtr
-std::vector<std::pair<WORD, ULONG_PTR>> WndProcList;
+// Original window procedures of the hooked window classes
+class WndProcTable
+{
+private:
+    // Atoms of registered classes are always in 0xC000-0xFFFF, so they index a flat table
+    static constexpr WORD FirstAtom = 0xC000;
+    static inline std::atomic<WNDPROC> Procs[0x10000 - FirstAtom];
+
+    // Messages come in floods for the same window, remember the last one per thread
+    struct CachedWindow
+    {
+        HWND hWnd;
+        WNDPROC Proc;
+    };
+    static inline thread_local CachedWindow Last = {};
+
+public:
+    // May run on any thread while others dispatch messages
+    static void Add(ATOM atom, WNDPROC proc)
+    {
+        if (atom >= FirstAtom)
+            Procs[atom - FirstAtom].store(proc, std::memory_order_release);
+    }
+    static WNDPROC Find(HWND hWnd)
+    {
+        if (Last.hWnd == hWnd)
+            return Last.Proc;
+
+        WORD atom = GetClassWord(hWnd, GCW_ATOM);
+        if (atom < FirstAtom)
+            return NULL;
+
+        WNDPROC proc = Procs[atom - FirstAtom].load(std::memory_order_acquire);
+        if (proc)
+            Last = { hWnd, proc };
+        return proc;
+    }
+    static void Forget(HWND hWnd)
+    {
+        if (Last.hWnd == hWnd)
+            Last = {};
+    }
+};
 
 void HookModule(HMODULE hmod);
 
+#ifndef CREATE_WAITABLE_TIMER_HIGH_RESOLUTION
+#define CREATE_WAITABLE_TIMER_HIGH_RESOLUTION 0x00000002
+#endif
+
 class FrameLimiter
 {
 private:
-    static inline double TIME_Frequency = 0.0;
-    static inline double TIME_Ticks = 0.0;
-    static inline double TIME_Frametime = 0.0;
+    // QueryPerformanceCounter clock with a waitable timer for the coarse sleep
+    struct QpcClock
+    {
+        int64_t Frequency = 0;
+        HANDLE hTimer = NULL;
+
+        int64_t Now()
+        {
+            LARGE_INTEGER counter;
+            QueryPerformanceCounter(&counter);
+            return counter.QuadPart;
+        }
+        void Sleep(int64_t ticks)
+        {
+            LARGE_INTEGER due;
+            due.QuadPart = -(ticks * 10000000 / Frequency); // relative, 100ns units
+            if (hTimer && SetWaitableTimer(hTimer, &due, 0, NULL, NULL, FALSE))
+                WaitForSingleObject(hTimer, INFINITE);
+            else
+                ::Sleep((DWORD)(ticks * 1000 / Frequency));
+        }
+        void Spin()
+        {
+            YieldProcessor();
+        }
+    };
+
+    static inline QpcClock Clock;
+    static inline HybridPacer Pacer;
+    static inline FrameSchedule Schedule;
+    static inline FrameStats Stats;
+    static inline FrameStatsLog StatsLog;
+    static inline int64_t StatsStart = 0;
+    static inline int64_t StatsLastReport = 0;
 
 public:
-    static inline ID3DXFont* pFPSFont = nullptr;
-    static inline ID3DXFont* pTimeFont = nullptr;
+    static inline Overlay Text;
 
 public:
-    enum FPSLimitMode { FPS_NONE, FPS_REALTIME, FPS_ACCURATE };
+    enum FPSLimitMode { FPS_NONE, FPS_REALTIME, FPS_ACCURATE, FPS_HYBRID };
     static void Init(FPSLimitMode mode)
     {
         LARGE_INTEGER frequency;
 
         QueryPerformanceFrequency(&frequency);
-        static constexpr auto TICKS_PER_FRAME = 1;
-        auto TICKS_PER_SECOND = (TICKS_PER_FRAME * fFPSLimit);
-        if (mode == FPS_ACCURATE)
-        {
-            TIME_Frametime = 1000.0 / (double)fFPSLimit;
-            TIME_Frequency = (double)frequency.QuadPart / 1000.0; // ticks are milliseconds
-        }
-        else // FPS_REALTIME
+        Clock.Frequency = frequency.QuadPart;
+
+        if (mode == FPS_HYBRID)
         {
-            TIME_Frequency = (double)frequency.QuadPart / (double)TICKS_PER_SECOND; // ticks are 1/n frames (n = fFPSLimit)
+            // High resolution timers exist since Windows 10 1803, older systems get a regular one
+            if (Clock.hTimer == NULL)
+                Clock.hTimer = CreateWaitableTimerExW(NULL, NULL, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS);
+            if (Clock.hTimer == NULL)
+                Clock.hTimer = CreateWaitableTimerExW(NULL, NULL, 0, TIMER_ALL_ACCESS);
+
+            Pacer.Init(frequency.QuadPart);
         }
-        Ticks();
+
+        Schedule.Init(Clock.Now(), (double)frequency.QuadPart / (double)fFPSLimit, nFPSLimitCatchUp, frequency.QuadPart * nFPSLimitResyncMs / 1000);
     }
     static DWORD Sync_RT()
     {
-        DWORD lastTicks, currentTicks;
-        LARGE_INTEGER counter;
-
-        QueryPerformanceCounter(&counter);
-        lastTicks = (DWORD)TIME_Ticks;
-        TIME_Ticks = (double)counter.QuadPart / TIME_Frequency;
-        currentTicks = (DWORD)TIME_Ticks;
+        int64_t now = Clock.Now();
+        if (now < Schedule.Deadline())
+            return 0;
 
-        return (currentTicks > lastTicks) ? currentTicks - lastTicks : 0;
+        Schedule.Advance(now);
+        return 1;
     }
     static DWORD Sync_SLP()
     {
-        LARGE_INTEGER counter;
-        QueryPerformanceCounter(&counter);
-        double millis_current = (double)counter.QuadPart / TIME_Frequency;
-        double millis_delta = millis_current - TIME_Ticks;
-        if (TIME_Frametime <= millis_delta)
+        int64_t now = Clock.Now();
+        int64_t remaining = Schedule.Deadline() - now;
+        if (remaining <= 0)
         {
-            TIME_Ticks = millis_current;
+            Schedule.Advance(now);
             return 1;
         }
-        else if (TIME_Frametime - millis_delta > 2.0) // > 2ms
+        else if (remaining > Clock.Frequency / 500) // > 2ms
             Sleep(1); // Sleep for ~1ms
         else
             Sleep(0); // yield thread's time-slice (does not actually sleep)
 
         return 0;
     }
-    static void ShowFPS(LPDIRECT3DDEVICE8 device)
+    static void Sync_HYB()
+    {
+        Schedule.Advance(Pacer.WaitUntil(Clock, Schedule.Deadline()));
+    }
+    static void InitStats(int logMode, const char* path)
     {
-        static std::list<int> m_times;
-
-        //https://github.com/microsoft/VCSamples/blob/master/VC2012Samples/Windows%208%20samples/C%2B%2B/Windows%208%20app%20samples/Direct2D%20geometry%20realization%20sample%20(Windows%208)/C%2B%2B/FPSCounter.cpp#L279
         LARGE_INTEGER frequency;
-        LARGE_INTEGER time;
         QueryPerformanceFrequency(&frequency);
-        QueryPerformanceCounter(&time);
+        Clock.Frequency = frequency.QuadPart;
+        Stats.Init(frequency.QuadPart);
+        StatsStart = StatsLastReport = Clock.Now();
 
-        if (m_times.size() == 50)
-            m_times.pop_front();
-        m_times.push_back(static_cast<int>(time.QuadPart));
+        if (logMode == 1 || logMode == 2)
+            StatsLog.Open(path, logMode == 2);
+    }
+    static void RecordFrame()
+    {
+        LARGE_INTEGER counter;
+        QueryPerformanceCounter(&counter);
+        Stats.Push(counter.QuadPart);
 
-        uint32_t fps = 0;
-        if (m_times.size() >= 2)
-            fps = static_cast<uint32_t>(0.5f + (static_cast<float>(m_times.size() - 1) * static_cast<float>(frequency.QuadPart)) / static_cast<float>(m_times.back() - m_times.front()));
+        // Once per second hand the rolling window stats to the log writer
+        if (StatsLog.IsOpen() && counter.QuadPart - StatsLastReport >= Clock.Frequency)
+        {
+            StatsLastReport = counter.QuadPart;
+            StatsLog.Post(Stats.Summarize((double)(counter.QuadPart - StatsStart) / (double)Clock.Frequency));
+        }
+    }
+    static void ShowFPS(LPDIRECT3DDEVICE8 device, const m_IDirect3DDevice8* wrapper)
+    {
+        uint32_t fps = static_cast<uint32_t>(0.5 + Stats.AverageFps(50));
 
         static int space = 0;
-        if (!pFPSFont || !pTimeFont)
+        static int line = 0;
+        if (!Text.IsReady())
         {
             D3DDEVICE_CREATION_PARAMETERS cparams;
             RECT rect;
             device->GetCreationParameters(&cparams);
             GetClientRect(cparams.hFocusWindow, &rect);
-            
-            LOGFONT fps_font = { rect.bottom / 20, 0, 0, 0, FW_BOLD, FALSE, FALSE, FALSE, DEFAULT_CHARSET, OUT_DEFAULT_PRECIS, CLIP_DEFAULT_PRECIS, ANTIALIASED_QUALITY, DEFAULT_PITCH, "Arial" };
-            LOGFONT time_font = { rect.bottom / 35, 0, 0, 0, FW_BOLD, FALSE, FALSE, FALSE, DEFAULT_CHARSET, OUT_DEFAULT_PRECIS, CLIP_DEFAULT_PRECIS, ANTIALIASED_QUALITY, DEFAULT_PITCH, "Arial" };
+
+            const int heights[Overlay::FONT_COUNT] = { rect.bottom / 20, rect.bottom / 35 };
             space = rect.bottom / 20 + 5;
-            
-            if (D3DXCreateFontIndirect(device, &fps_font, &pFPSFont) != D3D_OK)
-                return;
+            line = rect.bottom / 35 + 2;
 
-            if (D3DXCreateFontIndirect(device, &time_font, &pTimeFont) != D3D_OK)
+            if (!Text.Create(device, heights))
                 return;
         }
-        else
-        {
-            auto DrawTextOutline = [](ID3DXFont* pFont, FLOAT X, FLOAT Y, D3DXCOLOR dColor, CONST PCHAR cString, ...)
-            {
-                const D3DXCOLOR BLACK(D3DCOLOR_XRGB(0, 0, 0));
-                CHAR cBuffer[101] = "";
 
-                va_list oArgs;
-                va_start(oArgs, cString);
-                _vsnprintf((cBuffer + strlen(cBuffer)), (sizeof(cBuffer) - strlen(cBuffer)), cString, oArgs);
-                va_end(oArgs);
+        static const D3DCOLOR YELLOW = D3DCOLOR_XRGB(0xF7, 0xF7, 0);
+        Text.Print(Overlay::FONT_LARGE, 10.0f, 10.0f, YELLOW, "%02d", fps);
+        Text.Print(Overlay::FONT_SMALL, 10.0f, (float)space, YELLOW, "%.01f ms", (1.0f / fps) * 1000.0f);
+        if (bDisplayWrapperStats)
+        {
+            const m_IDirect3DDevice8::FrameCounters& counters = wrapper->GetLastFrameCounters();
+            Text.Print(Overlay::FONT_SMALL, 10.0f, (float)(space + line), YELLOW, "states %u / %u filtered", counters.StatesFiltered, counters.StatesFiltered + counters.StatesForwarded);
+            Text.Print(Overlay::FONT_SMALL, 10.0f, (float)(space + line * 2), YELLOW, "UP draws %u / %u buffered, %u calls", counters.UPDrawsBuffered, counters.UPDraws, counters.UPDrawCalls);
+            Text.Print(Overlay::FONT_SMALL, 10.0f, (float)(space + line * 3), YELLOW, "%u lock stalls avoided", counters.LockStallsAvoided);
+            const TextureDeduplicator& textures = wrapper->GetTextureDeduplicator();
+            Text.Print(Overlay::FONT_SMALL, 10.0f, (float)(space + line * 4), YELLOW, "%u textures shared, %u KB saved", textures.GetSharedTextures(), (UINT)(textures.GetBytesSaved() / 1024));
+            const WrapperPoolStatistics pools = GetWrapperPoolStatistics<m_IDirect3DCubeTexture8, m_IDirect3DIndexBuffer8, m_IDirect3DSurface8, m_IDirect3DSwapChain8,
+                m_IDirect3DTexture8, m_IDirect3DVertexBuffer8, m_IDirect3DVolume8, m_IDirect3DVolumeTexture8>();
+            Text.Print(Overlay::FONT_SMALL, 10.0f, (float)(space + line * 5), YELLOW, "%u wrappers (%u peak) in %u slabs", pools.Live, pools.Peak, pools.Slabs);
+        }
+        Text.Flush();
+    }
+};
 
-                RECT Rect[5] =
-                {
-                    { X - 1, Y, X + 500.0f, Y + 50.0f },
-                    { X, Y - 1, X + 500.0f, Y + 50.0f },
-                    { X + 1, Y, X + 500.0f, Y + 50.0f },
-                    { X, Y + 1, X + 500.0f, Y + 50.0f },
-                    { X, Y, X + 500.0f, Y + 50.0f },
-                };
+FrameLimiter::FPSLimitMode mFPSLimitMode = FrameLimiter::FPSLimitMode::FPS_NONE;
 
-                pFont->Begin();
-                if (dColor != BLACK)
-                {
-                    for (auto i = 0; i < 4; i++)
-                        pFont->DrawText(cBuffer, -1, &Rect[i], DT_NOCLIP, BLACK);
-                }
+// Settings that can change while the game runs, applied at a frame boundary
+void ApplyFrameSettings(const Config& config)
+{
+    fFPSLimit = static_cast<float>(config.FPSLimit);
+    nFPSLimitCatchUp = config.FPSLimitCatchUp;
+    nFPSLimitResyncMs = config.FPSLimitResyncMs;
+    bDisplayFPSCounter = config.DisplayFPSCounter != 0;
+    bDisplayWrapperStats = config.DisplayFPSCounter == 2;
+    bVerifyShadowState = config.VerifyShadowState;
 
-                pFont->DrawText(cBuffer, -1, &Rect[4], DT_NOCLIP, dColor);
-                pFont->End();
-            };
-            
-            static char str_format_fps[] = "%02d";
-            static char str_format_time[] = "%.01f ms";
-            static const D3DXCOLOR YELLOW(D3DCOLOR_XRGB(0xF7, 0xF7, 0));
-            DrawTextOutline(pFPSFont, 10, 10, YELLOW, str_format_fps, fps);
-            DrawTextOutline(pTimeFont, 10, space, YELLOW, str_format_time, (1.0f / fps) * 1000.0f);
+    FrameLimiter::FPSLimitMode mode = FrameLimiter::FPSLimitMode::FPS_NONE;
+    if (fFPSLimit > 0.0f)
+    {
+        switch (config.FPSLimitMode)
+        {
+        case 2:
+            mode = FrameLimiter::FPSLimitMode::FPS_ACCURATE;
+            break;
+        case 3:
+            mode = FrameLimiter::FPSLimitMode::FPS_HYBRID;
+            break;
+        default:
+            mode = FrameLimiter::FPSLimitMode::FPS_REALTIME;
+            break;
         }
+        FrameLimiter::Init(mode);
     }
 
-private:
-    static void Ticks()
-    {
-        LARGE_INTEGER counter;
-        QueryPerformanceCounter(&counter);
-        TIME_Ticks = (double)counter.QuadPart / TIME_Frequency;
-    }
-};
+    // Keep timeBeginPeriod/timeEndPeriod balanced across mode changes
+    bool hadPeriod = mFPSLimitMode == FrameLimiter::FPSLimitMode::FPS_ACCURATE || mFPSLimitMode == FrameLimiter::FPSLimitMode::FPS_HYBRID;
+    bool needsPeriod = mode == FrameLimiter::FPSLimitMode::FPS_ACCURATE || mode == FrameLimiter::FPSLimitMode::FPS_HYBRID;
+    if (needsPeriod && !hadPeriod)
+        timeBeginPeriod(1);
+    else if (hadPeriod && !needsPeriod)
+        timeEndPeriod(1);
 
-FrameLimiter::FPSLimitMode mFPSLimitMode = FrameLimiter::FPSLimitMode::FPS_NONE;
+    mFPSLimitMode = mode;
+}
 
 HRESULT m_IDirect3DDevice8::Present(CONST RECT* pSourceRect, CONST RECT* pDestRect, HWND hDestWindowOverride, CONST RGNDATA* pDirtyRegion)
 {
+    if (bHotReload)
+    {
+        if (Config* config = ConfigWatcher::Take())
+        {
+            ApplyFrameSettings(*config);
+            delete config;
+        }
+    }
+
+    Trace::Record(Trace::Call::Present, Trace::ByRef(pSourceRect), Trace::ByRef(pDestRect), Trace::Id(hDestWindowOverride), Trace::Block(pDirtyRegion, pDirtyRegion ? sizeof(RGNDATAHEADER) + pDirtyRegion->rdh.nRgnSize : 0));
+    Trace::Recorder::Flush();
+
+    FlushDraws();
+
     if (mFPSLimitMode == FrameLimiter::FPSLimitMode::FPS_REALTIME)
         while (!FrameLimiter::Sync_RT());
     else if (mFPSLimitMode == FrameLimiter::FPSLimitMode::FPS_ACCURATE)
         while (!FrameLimiter::Sync_SLP());
+    else if (mFPSLimitMode == FrameLimiter::FPSLimitMode::FPS_HYBRID)
+        FrameLimiter::Sync_HYB();
+
+    if (bDisplayFPSCounter || nFrameStatsLog)
+        FrameLimiter::RecordFrame();
+
+    EndFrame();
 
     return ProxyInterface->Present(pSourceRect, pDestRect, hDestWindowOverride, pDirtyRegion);
 }
 
 HRESULT m_IDirect3DDevice8::EndScene()
 {
+    Trace::Record(Trace::Call::EndScene);
+
+    FlushDraws();
+
     if (bDisplayFPSCounter)
-        FrameLimiter::ShowFPS(ProxyInterface);
+        FrameLimiter::ShowFPS(ProxyInterface, this);
 
     return ProxyInterface->EndScene();
 }
@@ -277,31 +411,15 @@ void ForceWindowed(D3DPRESENT_PARAMETERS* pPresentationParameters)
     }
 }
 
-void ForceFullScreenRefreshRateInHz(D3DPRESENT_PARAMETERS* pPresentationParameters)
+void ForceFullScreenRefreshRateInHz(m_IDirect3D8* pD3D, UINT Adapter, D3DPRESENT_PARAMETERS* pPresentationParameters)
 {
     if (!pPresentationParameters->Windowed)
     {
-        std::vector<int> list;
-        DISPLAY_DEVICE dd;
-        dd.cb = sizeof(DISPLAY_DEVICE);
-        DWORD deviceNum = 0;
-        while (EnumDisplayDevices(NULL, deviceNum, &dd, 0))
-        {
-            DISPLAY_DEVICE newdd = { 0 };
-            newdd.cb = sizeof(DISPLAY_DEVICE);
-            DWORD monitorNum = 0;
-            DEVMODE dm = { 0 };
-            while (EnumDisplayDevices(dd.DeviceName, monitorNum, &newdd, 0))
-            {
-                for (auto iModeNum = 0; EnumDisplaySettings(NULL, iModeNum, &dm) != 0; iModeNum++)
-                    list.emplace_back(dm.dmDisplayFrequency);
-                monitorNum++;
-            }
-            deviceNum++;
-        }
+        std::vector<UINT> list = pD3D->GetRefreshRates(Adapter, pPresentationParameters->BackBufferWidth, pPresentationParameters->BackBufferHeight);
+        if (list.empty())
+            return;
 
-        std::sort(list.begin(), list.end());
-        if (nFullScreenRefreshRateInHz > list.back() || nFullScreenRefreshRateInHz < list.front() || nFullScreenRefreshRateInHz < 0)
+        if (nFullScreenRefreshRateInHz < 0 || (UINT)nFullScreenRefreshRateInHz > list.back() || (UINT)nFullScreenRefreshRateInHz < list.front())
             pPresentationParameters->FullScreen_RefreshRateInHz = list.back();
         else
             pPresentationParameters->FullScreen_RefreshRateInHz = nFullScreenRefreshRateInHz;
@@ -317,17 +435,9 @@ HRESULT m_IDirect3D8::CreateDevice(UINT Adapter, D3DDEVTYPE DeviceType, HWND hFo
     }
 
     if (nFullScreenRefreshRateInHz)
-        ForceFullScreenRefreshRateInHz(pPresentationParameters);
+        ForceFullScreenRefreshRateInHz(this, Adapter, pPresentationParameters);
 
-    if (bDisplayFPSCounter)
-    {
-        if (FrameLimiter::pFPSFont)
-            FrameLimiter::pFPSFont->Release();
-        if (FrameLimiter::pTimeFont)
-            FrameLimiter::pTimeFont->Release();
-        FrameLimiter::pFPSFont = nullptr;
-        FrameLimiter::pTimeFont = nullptr;
-    }
+    FrameLimiter::Text.Release();
 
     HRESULT hr = ProxyInterface->CreateDevice(Adapter, DeviceType, hFocusWindow, BehaviorFlags, pPresentationParameters, ppReturnedDeviceInterface);
 
@@ -340,34 +450,44 @@ HRESULT m_IDirect3D8::CreateDevice(UINT Adapter, D3DDEVTYPE DeviceType, HWND hFo
 
 HRESULT m_IDirect3DDevice8::Reset(D3DPRESENT_PARAMETERS* pPresentationParameters)
 {
+    Trace::Record(Trace::Call::Reset, Trace::ByRef(pPresentationParameters));
+
     if (bForceWindowedMode)
         ForceWindowed(pPresentationParameters);
 
     if (nFullScreenRefreshRateInHz)
-        ForceFullScreenRefreshRateInHz(pPresentationParameters);
-    
-    if (bDisplayFPSCounter)
     {
-        if (FrameLimiter::pFPSFont)
-            FrameLimiter::pFPSFont->Release();
-        if (FrameLimiter::pTimeFont)
-            FrameLimiter::pTimeFont->Release();
-        FrameLimiter::pFPSFont = nullptr;
-        FrameLimiter::pTimeFont = nullptr;
+        D3DDEVICE_CREATION_PARAMETERS CreationParameters;
+        if (SUCCEEDED(ProxyInterface->GetCreationParameters(&CreationParameters)))
+            ForceFullScreenRefreshRateInHz(m_pD3D, CreationParameters.AdapterOrdinal, pPresentationParameters);
     }
+    
+    FrameLimiter::Text.Release();
+
+    BeforeReset();
 
     return ProxyInterface->Reset(pPresentationParameters);
 }
 
-LRESULT WINAPI CustomWndProc(HWND hWnd, UINT uMsg, WPARAM wParam, LPARAM lParam, int idx)
+LRESULT WINAPI CustomWndProc(HWND hWnd, UINT uMsg, WPARAM wParam, LPARAM lParam, WNDPROC OrigProc)
 {
-    if (hWnd == g_hFocusWindow || _fnIsTopLevelWindow(hWnd)) // skip child windows like buttons, edit boxes, etc. 
+    if (uMsg == WM_DISPLAYCHANGE)
+        DisplayModeCatalogue::Invalidate();
+
+    if (uMsg == WM_NCDESTROY)
     {
-        if (bAlwaysOnTop)
-        {
-            if ((GetWindowLong(hWnd, GWL_EXSTYLE) & WS_EX_TOPMOST) == 0)
-                SetWindowPos(hWnd, HWND_TOPMOST, 0, 0, 0, 0, SWP_NOACTIVATE | SWP_NOMOVE | SWP_NOSIZE);
-        }
+        WndProcTable::Forget(hWnd);
+        WindowStateTracker::Forget(hWnd);
+        return OrigProc(hWnd, uMsg, wParam, lParam);
+    }
+
+    WindowStateTracker::Update(hWnd, uMsg, wParam, lParam);
+    const WindowStateTracker::State state = WindowStateTracker::Get(hWnd);
+
+    if (hWnd == g_hFocusWindow || state.TopLevel) // skip child windows like buttons, edit boxes, etc. 
+    {
+        if (bAlwaysOnTop && !state.Topmost)
+            WindowStateTracker::MakeTopmost(hWnd);
         switch (uMsg)
         {
         case WM_ACTIVATE:
@@ -403,20 +523,15 @@ LRESULT WINAPI CustomWndProc(HWND hWnd, UINT uMsg, WPARAM wParam, LPARAM lParam,
             break;
         }
     }
-    WNDPROC OrigProc = WNDPROC(WndProcList[idx].second);
     return OrigProc(hWnd, uMsg, wParam, lParam);
 }
 
 LRESULT WINAPI CustomWndProcA(HWND hWnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
 {
-    WORD wClassAtom = GetClassWord(hWnd, GCW_ATOM);
-    if (wClassAtom)
+    WNDPROC OrigProc = WndProcTable::Find(hWnd);
+    if (OrigProc)
     {
-        for (unsigned int i = 0; i < WndProcList.size(); i++) {
-            if (WndProcList[i].first == wClassAtom) {
-                return CustomWndProc(hWnd, uMsg, wParam, lParam, i);
-            }
-        }
+        return CustomWndProc(hWnd, uMsg, wParam, lParam, OrigProc);
     }
     // We should never reach here, but having safeguards anyway is good
     return DefWindowProcA(hWnd, uMsg, wParam, lParam);
@@ -424,14 +539,10 @@ LRESULT WINAPI CustomWndProcA(HWND hWnd, UINT uMsg, WPARAM wParam, LPARAM lParam
 
 LRESULT WINAPI CustomWndProcW(HWND hWnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
 {
-    WORD wClassAtom = GetClassWord(hWnd, GCW_ATOM);
-    if (wClassAtom)
+    WNDPROC OrigProc = WndProcTable::Find(hWnd);
+    if (OrigProc)
     {
-        for (unsigned int i = 0; i < WndProcList.size(); i++) {
-            if (WndProcList[i].first == wClassAtom) {
-                return CustomWndProc(hWnd, uMsg, wParam, lParam, i);
-            }
-        }
+        return CustomWndProc(hWnd, uMsg, wParam, lParam, OrigProc);
     }
     // We should never reach here, but having safeguards anyway is good
     return DefWindowProcW(hWnd, uMsg, wParam, lParam);
@@ -452,12 +563,12 @@ ATOM __stdcall hk_RegisterClassA(WNDCLASSA* lpWndClass)
             return oRegisterClassA(lpWndClass);
         }
     }
-    ULONG_PTR pWndProc = ULONG_PTR(lpWndClass->lpfnWndProc);
+    WNDPROC pWndProc = lpWndClass->lpfnWndProc;
     lpWndClass->lpfnWndProc = CustomWndProcA;
     WORD wClassAtom = oRegisterClassA(lpWndClass);
     if (wClassAtom != 0)
     {
-        WndProcList.emplace_back(wClassAtom, pWndProc);
+        WndProcTable::Add(wClassAtom, pWndProc);
     }
     return wClassAtom;
 }
@@ -468,12 +579,12 @@ ATOM __stdcall hk_RegisterClassW(WNDCLASSW* lpWndClass)
             return oRegisterClassW(lpWndClass);
         }
     }
-    ULONG_PTR pWndProc = ULONG_PTR(lpWndClass->lpfnWndProc);
+    WNDPROC pWndProc = lpWndClass->lpfnWndProc;
     lpWndClass->lpfnWndProc = CustomWndProcW;
     WORD wClassAtom = oRegisterClassW(lpWndClass);
     if (wClassAtom != 0)
     {
-        WndProcList.emplace_back(wClassAtom, pWndProc);
+        WndProcTable::Add(wClassAtom, pWndProc);
     }
     return wClassAtom;
 }
@@ -484,12 +595,12 @@ ATOM __stdcall hk_RegisterClassExA(WNDCLASSEXA* lpWndClass)
             return oRegisterClassExA(lpWndClass);
         }
     }
-    ULONG_PTR pWndProc = ULONG_PTR(lpWndClass->lpfnWndProc);
+    WNDPROC pWndProc = lpWndClass->lpfnWndProc;
     lpWndClass->lpfnWndProc = CustomWndProcA;
     WORD wClassAtom = oRegisterClassExA(lpWndClass);
     if (wClassAtom != 0)
     {
-        WndProcList.emplace_back(wClassAtom, pWndProc);
+        WndProcTable::Add(wClassAtom, pWndProc);
     }
     return wClassAtom;
 }
@@ -500,12 +611,12 @@ ATOM __stdcall hk_RegisterClassExW(WNDCLASSEXW* lpWndClass)
             return oRegisterClassExW(lpWndClass);
         }
     }
-    ULONG_PTR pWndProc = ULONG_PTR(lpWndClass->lpfnWndProc);
+    WNDPROC pWndProc = lpWndClass->lpfnWndProc;
     lpWndClass->lpfnWndProc = CustomWndProcW;
     WORD wClassAtom = oRegisterClassExW(lpWndClass);
     if (wClassAtom != 0)
     {
-        WndProcList.emplace_back(wClassAtom, pWndProc);
+        WndProcTable::Add(wClassAtom, pWndProc);
     }
     return wClassAtom;
 }
@@ -611,87 +722,60 @@ BOOL __stdcall hk_FreeLibrary(HMODULE hLibModule)
     return oFreeLibrary(hLibModule);
 }
 
+FARPROC __stdcall hk_GetProcAddress(HMODULE hModule, LPCSTR lpProcName);
+
+// Functions hooked in every non-system module, ModuleHooks lists them in the same order
+constexpr const char* HookedFunctionNames[] = {
+    "RegisterClassA", "RegisterClassW", "RegisterClassExA", "RegisterClassExW",
+    "GetForegroundWindow", "GetActiveWindow", "GetFocus",
+    "LoadLibraryA", "LoadLibraryW", "LoadLibraryExA", "LoadLibraryExW", "FreeLibrary",
+    "GetProcAddress",
+};
+
+constexpr PerfectHashSet<_countof(HookedFunctionNames), 64> HookedFunctions(HookedFunctionNames, false);
+static_assert(HookedFunctions.IsValid(), "no perfect hash seed for the hooked function names");
+
+// Originals are kept from the first module importing them
+const Iat_hook::iat_patch ModuleHooks[] = {
+    { HookedFunctionNames[0], (void*)hk_RegisterClassA, (void**)&oRegisterClassA },
+    { HookedFunctionNames[1], (void*)hk_RegisterClassW, (void**)&oRegisterClassW },
+    { HookedFunctionNames[2], (void*)hk_RegisterClassExA, (void**)&oRegisterClassExA },
+    { HookedFunctionNames[3], (void*)hk_RegisterClassExW, (void**)&oRegisterClassExW },
+    { HookedFunctionNames[4], (void*)hk_GetForegroundWindow, (void**)&oGetForegroundWindow },
+    { HookedFunctionNames[5], (void*)hk_GetActiveWindow, (void**)&oGetActiveWindow },
+    { HookedFunctionNames[6], (void*)hk_GetFocus, (void**)&oGetFocus },
+    { HookedFunctionNames[7], (void*)hk_LoadLibraryA, (void**)&oLoadLibraryA },
+    { HookedFunctionNames[8], (void*)hk_LoadLibraryW, (void**)&oLoadLibraryW },
+    { HookedFunctionNames[9], (void*)hk_LoadLibraryExA, (void**)&oLoadLibraryExA },
+    { HookedFunctionNames[10], (void*)hk_LoadLibraryExW, (void**)&oLoadLibraryExW },
+    { HookedFunctionNames[11], (void*)hk_FreeLibrary, (void**)&oFreeLibrary },
+    { HookedFunctionNames[12], (void*)hk_GetProcAddress, NULL },
+};
+static_assert(_countof(ModuleHooks) == _countof(HookedFunctionNames), "ModuleHooks and HookedFunctionNames are out of sync");
+
 FARPROC __stdcall hk_GetProcAddress(HMODULE hModule, LPCSTR lpProcName)
 {
+    // Imports by ordinal never match a hooked name
+    if (IS_INTRESOURCE(lpProcName))
+        return GetProcAddress(hModule, lpProcName);
+
+    int index = -1;
     __try
     {
-        if (!lstrcmpA(lpProcName, "RegisterClassA"))
-        {
-            if (oRegisterClassA == NULL)
-                oRegisterClassA = (RegisterClassA_fn)GetProcAddress(hModule, lpProcName);
-            return (FARPROC)hk_RegisterClassA;
-        }
-        if (!lstrcmpA(lpProcName, "RegisterClassW"))
-        {
-            if (oRegisterClassW == NULL)
-                oRegisterClassW = (RegisterClassW_fn)GetProcAddress(hModule, lpProcName);
-            return (FARPROC)hk_RegisterClassW;
-        }
-        if (!lstrcmpA(lpProcName, "RegisterClassExA"))
-        {
-            if (oRegisterClassExA == NULL)
-                oRegisterClassExA = (RegisterClassExA_fn)GetProcAddress(hModule, lpProcName);
-            return (FARPROC)hk_RegisterClassExA;
-        }
-        if (!lstrcmpA(lpProcName, "RegisterClassExW"))
-        {
-            if (oRegisterClassExW == NULL)
-                oRegisterClassExW = (RegisterClassExW_fn)GetProcAddress(hModule, lpProcName);
-            return (FARPROC)hk_RegisterClassExW;
-        }
-        if (!lstrcmpA(lpProcName, "GetForegroundWindow"))
-        {
-            if (oGetForegroundWindow == NULL)
-                oGetForegroundWindow = (GetForegroundWindow_fn)GetProcAddress(hModule, lpProcName);
-            return (FARPROC)hk_GetForegroundWindow;
-        }
-        if (!lstrcmpA(lpProcName, "GetActiveWindow"))
-        {
-            if (oGetActiveWindow == NULL)
-                oGetActiveWindow = (GetActiveWindow_fn)GetProcAddress(hModule, lpProcName);
-            return (FARPROC)hk_GetActiveWindow;
-        }
-        if (!lstrcmpA(lpProcName, "GetFocus"))
-        {
-            if (oGetFocus == NULL)
-                oGetFocus = (GetFocus_fn)GetProcAddress(hModule, lpProcName);
-            return (FARPROC)hk_GetFocus;
-        }
-        if (!lstrcmpA(lpProcName, "LoadLibraryA"))
-        {
-            if (oLoadLibraryA == NULL)
-                oLoadLibraryA = (LoadLibraryA_fn)GetProcAddress(hModule, lpProcName);
-            return (FARPROC)hk_LoadLibraryA;
-        }
-        if (!lstrcmpA(lpProcName, "LoadLibraryW"))
-        {
-            if (oLoadLibraryW == NULL)
-                oLoadLibraryW = (LoadLibraryW_fn)GetProcAddress(hModule, lpProcName);
-            return (FARPROC)hk_LoadLibraryW;
-        }
-        if (!lstrcmpA(lpProcName, "LoadLibraryExA"))
-        {
-            if (oLoadLibraryExA == NULL)
-                oLoadLibraryExA = (LoadLibraryExA_fn)GetProcAddress(hModule, lpProcName);
-            return (FARPROC)hk_LoadLibraryExA;
-        }
-        if (!lstrcmpA(lpProcName, "LoadLibraryExW"))
-        {
-            if (oLoadLibraryExW == NULL)
-                oLoadLibraryExW = (LoadLibraryExW_fn)GetProcAddress(hModule, lpProcName);
-            return (FARPROC)hk_LoadLibraryExW;
-        }
-        if (!lstrcmpA(lpProcName, "FreeLibrary"))
-        {
-            if (oFreeLibrary == NULL)
-                oFreeLibrary = (FreeLibrary_fn)GetProcAddress(hModule, lpProcName);
-            return (FARPROC)hk_FreeLibrary;
-        }
+        index = HookedFunctions.Find(lpProcName);
     }
     __except ((GetExceptionCode() == EXCEPTION_ACCESS_VIOLATION) ? EXCEPTION_EXECUTE_HANDLER : EXCEPTION_CONTINUE_SEARCH)
     {
     }
 
+    // GetProcAddress itself has no original to keep and is resolved normally
+    if (index >= 0 && ModuleHooks[index].original)
+    {
+        if (*ModuleHooks[index].original == NULL)
+            *ModuleHooks[index].original = (void*)GetProcAddress(hModule, lpProcName);
+        return (FARPROC)ModuleHooks[index].newfunction;
+    }
+
     return GetProcAddress(hModule, lpProcName);
 }
 
@@ -705,67 +789,7 @@ void HookModule(HMODULE hmod)
             return;
         }
     }
-    if (oRegisterClassA == NULL)
-        oRegisterClassA = (RegisterClassA_fn)Iat_hook::detour_iat_ptr("RegisterClassA", (void*)hk_RegisterClassA, hmod);
-    else
-        Iat_hook::detour_iat_ptr("RegisterClassA", (void*)hk_RegisterClassA, hmod);
-
-    if (oRegisterClassW == NULL)
-        oRegisterClassW = (RegisterClassW_fn)Iat_hook::detour_iat_ptr("RegisterClassW", (void*)hk_RegisterClassW, hmod);
-    else
-        Iat_hook::detour_iat_ptr("RegisterClassW", (void*)hk_RegisterClassW, hmod);
-
-    if (oRegisterClassExA == NULL)
-        oRegisterClassExA = (RegisterClassExA_fn)Iat_hook::detour_iat_ptr("RegisterClassExA", (void*)hk_RegisterClassExA, hmod);
-    else
-        Iat_hook::detour_iat_ptr("RegisterClassExA", (void*)hk_RegisterClassExA, hmod);
-
-    if (oRegisterClassExW == NULL)
-        oRegisterClassExW = (RegisterClassExW_fn)Iat_hook::detour_iat_ptr("RegisterClassExW", (void*)hk_RegisterClassExW, hmod);
-    else
-        Iat_hook::detour_iat_ptr("RegisterClassExW", (void*)hk_RegisterClassExW, hmod);
-
-    if (oGetForegroundWindow == NULL)
-        oGetForegroundWindow = (GetForegroundWindow_fn)Iat_hook::detour_iat_ptr("GetForegroundWindow", (void*)hk_GetForegroundWindow, hmod);
-    else
-        Iat_hook::detour_iat_ptr("GetForegroundWindow", (void*)hk_GetForegroundWindow, hmod);
-
-    if (oGetActiveWindow == NULL)
-        oGetActiveWindow = (GetActiveWindow_fn)Iat_hook::detour_iat_ptr("GetActiveWindow", (void*)hk_GetActiveWindow, hmod);
-    else
-        Iat_hook::detour_iat_ptr("GetActiveWindow", (void*)hk_GetActiveWindow, hmod);
-
-    if (oGetFocus == NULL)
-        oGetFocus = (GetFocus_fn)Iat_hook::detour_iat_ptr("GetFocus", (void*)hk_GetFocus, hmod);
-    else
-        Iat_hook::detour_iat_ptr("GetFocus", (void*)hk_GetFocus, hmod);
-
-    if (oLoadLibraryA == NULL)
-        oLoadLibraryA = (LoadLibraryA_fn)Iat_hook::detour_iat_ptr("LoadLibraryA", (void*)hk_LoadLibraryA, hmod);
-    else
-        Iat_hook::detour_iat_ptr("LoadLibraryA", (void*)hk_LoadLibraryA, hmod);
-
-    if (oLoadLibraryW == NULL)
-        oLoadLibraryW = (LoadLibraryW_fn)Iat_hook::detour_iat_ptr("LoadLibraryW", (void*)hk_LoadLibraryW, hmod);
-    else
-        Iat_hook::detour_iat_ptr("LoadLibraryW", (void*)hk_LoadLibraryW, hmod);
-
-    if (oLoadLibraryExA == NULL)
-        oLoadLibraryExA = (LoadLibraryExA_fn)Iat_hook::detour_iat_ptr("LoadLibraryExA", (void*)hk_LoadLibraryExA, hmod);
-    else
-        Iat_hook::detour_iat_ptr("LoadLibraryExA", (void*)hk_LoadLibraryExA, hmod);
-
-    if (oLoadLibraryExW == NULL)
-        oLoadLibraryExW = (LoadLibraryExW_fn)Iat_hook::detour_iat_ptr("LoadLibraryExW", (void*)hk_LoadLibraryExW, hmod);
-    else
-        Iat_hook::detour_iat_ptr("LoadLibraryExW", (void*)hk_LoadLibraryExW, hmod);
-
-    if (oFreeLibrary == NULL)
-        oFreeLibrary = (FreeLibrary_fn)Iat_hook::detour_iat_ptr("FreeLibrary", (void*)hk_FreeLibrary, hmod);
-    else
-        Iat_hook::detour_iat_ptr("FreeLibrary", (void*)hk_FreeLibrary, hmod);
-
-    Iat_hook::detour_iat_ptr("GetProcAddress", (void*)hk_GetProcAddress, hmod);
+    Iat_hook::detour_iat_ptrs(ModuleHooks, _countof(ModuleHooks), hmod);
 }
 
 void HookImportedModules()
@@ -820,28 +844,43 @@ bool WINAPI DllMain(HMODULE hModule, DWORD dwReason, LPVOID lpReserved)
             GetModuleFileNameA(hm, path, sizeof(path));
             strcpy(strrchr(path, '\\'), "\\d3d8.ini");
 
-            bForceWindowedMode = GetPrivateProfileInt("MAIN", "ForceWindowedMode", 0, path) != 0;
-            bDirect3D8DisableMaximizedWindowedModeShim = GetPrivateProfileInt("MAIN", "Direct3D8DisableMaximizedWindowedModeShim", 0, path) != 0;
-            fFPSLimit = static_cast<float>(GetPrivateProfileInt("MAIN", "FPSLimit", 0, path));
-            nFullScreenRefreshRateInHz = GetPrivateProfileInt("MAIN", "FullScreenRefreshRateInHz", 0, path);
-            bDisplayFPSCounter = GetPrivateProfileInt("MAIN", "DisplayFPSCounter", 0, path);
-            bUsePrimaryMonitor = GetPrivateProfileInt("FORCEWINDOWED", "UsePrimaryMonitor", 0, path) != 0;
-            bCenterWindow = GetPrivateProfileInt("FORCEWINDOWED", "CenterWindow", 1, path) != 0;
-            bBorderlessFullscreen = GetPrivateProfileInt("FORCEWINDOWED", "BorderlessFullscreen", 0, path) != 0;
-            bAlwaysOnTop = GetPrivateProfileInt("FORCEWINDOWED", "AlwaysOnTop", 0, path) != 0;
-            bDoNotNotifyOnTaskSwitch = GetPrivateProfileInt("FORCEWINDOWED", "DoNotNotifyOnTaskSwitch", 0, path) != 0;
-            
-            if (fFPSLimit > 0.0f)
+            Config config;
+            ConfigParser::Load(path, config, [](const char* message) { OutputDebugStringA(message); });
+
+            bForceWindowedMode = config.ForceWindowedMode;
+            bDirect3D8DisableMaximizedWindowedModeShim = config.Direct3D8DisableMaximizedWindowedModeShim;
+            nFullScreenRefreshRateInHz = config.FullScreenRefreshRateInHz;
+            bFilterRedundantStates = config.FilterRedundantStates;
+            bBufferUPDraws = config.BufferUPDraws;
+            bMergeUPDraws = config.MergeUPDraws;
+            bOptimizeLockFlags = config.OptimizeLockFlags;
+            bRenameLockedBuffers = config.RenameLockedBuffers;
+            bDeduplicateTextures = config.DeduplicateTextures;
+            nFrameStatsLog = config.FrameStatsLog;
+            bHotReload = config.HotReload;
+            bUsePrimaryMonitor = config.UsePrimaryMonitor;
+            bCenterWindow = config.CenterWindow;
+            bBorderlessFullscreen = config.BorderlessFullscreen;
+            bAlwaysOnTop = config.AlwaysOnTop;
+            bDoNotNotifyOnTaskSwitch = config.DoNotNotifyOnTaskSwitch;
+
+            ApplyFrameSettings(config);
+
+            if (bHotReload && !ConfigWatcher::Start(path))
+                bHotReload = false;
+
+            if (bDisplayFPSCounter || nFrameStatsLog || bHotReload)
             {
-                FrameLimiter::FPSLimitMode mode = (GetPrivateProfileInt("MAIN", "FPSLimitMode", 1, path) == 2) ? FrameLimiter::FPSLimitMode::FPS_ACCURATE : FrameLimiter::FPSLimitMode::FPS_REALTIME;
-                if (mode == FrameLimiter::FPSLimitMode::FPS_ACCURATE)
-                    timeBeginPeriod(1);
+                strcpy(strrchr(path, '\\'), (nFrameStatsLog == 2) ? "\\d3d8_framestats.jsonl" : "\\d3d8_framestats.csv");
+                FrameLimiter::InitStats(nFrameStatsLog, path);
+            }
 
-                FrameLimiter::Init(mode);
-                mFPSLimitMode = mode;
+            if (config.RecordTrace)
+            {
+                strcpy(strrchr(path, '\\'), "\\d3d8_trace.bin");
+                if (!Trace::Recorder::Start(path))
+                    OutputDebugStringA("d3d8: could not start the API trace\n");
             }
-            else
-                mFPSLimitMode = FrameLimiter::FPSLimitMode::FPS_NONE;
 
             if (bDirect3D8DisableMaximizedWindowedModeShim)
             {
@@ -861,49 +900,24 @@ bool WINAPI DllMain(HMODULE hModule, DWORD dwReason, LPVOID lpReserved)
             {
                 GetSystemWindowsDirectoryA(WinDir, MAX_PATH);
 
-                oRegisterClassA = (RegisterClassA_fn)Iat_hook::detour_iat_ptr("RegisterClassA", (void*)hk_RegisterClassA);
-                oRegisterClassW = (RegisterClassW_fn)Iat_hook::detour_iat_ptr("RegisterClassW", (void*)hk_RegisterClassW);
-                oRegisterClassExA = (RegisterClassExA_fn)Iat_hook::detour_iat_ptr("RegisterClassExA", (void*)hk_RegisterClassExA);
-                oRegisterClassExW = (RegisterClassExW_fn)Iat_hook::detour_iat_ptr("RegisterClassExW", (void*)hk_RegisterClassExW);
-                oGetForegroundWindow = (GetForegroundWindow_fn)Iat_hook::detour_iat_ptr("GetForegroundWindow", (void*)hk_GetForegroundWindow);
-                oGetActiveWindow = (GetActiveWindow_fn)Iat_hook::detour_iat_ptr("GetActiveWindow", (void*)hk_GetActiveWindow);
-                oGetFocus = (GetFocus_fn)Iat_hook::detour_iat_ptr("GetFocus", (void*)hk_GetFocus);
-                oLoadLibraryA = (LoadLibraryA_fn)Iat_hook::detour_iat_ptr("LoadLibraryA", (void*)hk_LoadLibraryA);
-                oLoadLibraryW = (LoadLibraryW_fn)Iat_hook::detour_iat_ptr("LoadLibraryW", (void*)hk_LoadLibraryW);
-                oLoadLibraryExA = (LoadLibraryExA_fn)Iat_hook::detour_iat_ptr("LoadLibraryExA", (void*)hk_LoadLibraryExA);
-                oLoadLibraryExW = (LoadLibraryExW_fn)Iat_hook::detour_iat_ptr("LoadLibraryExW", (void*)hk_LoadLibraryExW);
-                oFreeLibrary = (FreeLibrary_fn)Iat_hook::detour_iat_ptr("FreeLibrary", (void*)hk_FreeLibrary);
-
-                Iat_hook::detour_iat_ptr("GetProcAddress", (void*)hk_GetProcAddress);
-                Iat_hook::detour_iat_ptr("GetProcAddress", (void*)hk_GetProcAddress, d3d8dll);
-
-                if (oGetForegroundWindow == NULL)
-                    oGetForegroundWindow = (GetForegroundWindow_fn)Iat_hook::detour_iat_ptr("GetForegroundWindow", (void*)hk_GetForegroundWindow, d3d8dll);
-                else
-                    Iat_hook::detour_iat_ptr("GetForegroundWindow", (void*)hk_GetForegroundWindow, d3d8dll);
+                Iat_hook::detour_iat_ptrs(ModuleHooks, _countof(ModuleHooks));
+
+                const Iat_hook::iat_patch d3d8Hooks[] = {
+                    { "GetProcAddress", (void*)hk_GetProcAddress, NULL },
+                    { "GetForegroundWindow", (void*)hk_GetForegroundWindow, (void**)&oGetForegroundWindow },
+                };
+                Iat_hook::detour_iat_ptrs(d3d8Hooks, _countof(d3d8Hooks), d3d8dll);
 
                 HMODULE ole32 = GetModuleHandleA("ole32.dll");
                 if (ole32) {
-                    if (oRegisterClassA == NULL)
-                        oRegisterClassA = (RegisterClassA_fn)Iat_hook::detour_iat_ptr("RegisterClassA", (void*)hk_RegisterClassA, ole32);
-                    else
-                        Iat_hook::detour_iat_ptr("RegisterClassA", (void*)hk_RegisterClassA, ole32);
-                    if (oRegisterClassW == NULL)
-                        oRegisterClassW = (RegisterClassW_fn)Iat_hook::detour_iat_ptr("RegisterClassW", (void*)hk_RegisterClassW, ole32);
-                    else
-                        Iat_hook::detour_iat_ptr("RegisterClassW", (void*)hk_RegisterClassW, ole32);
-                    if (oRegisterClassExA == NULL)
-                        oRegisterClassExA = (RegisterClassExA_fn)Iat_hook::detour_iat_ptr("RegisterClassExA", (void*)hk_RegisterClassExA, ole32);
-                    else
-                        Iat_hook::detour_iat_ptr("RegisterClassExA", (void*)hk_RegisterClassExA, ole32);
-                    if (oRegisterClassExW == NULL)
-                        oRegisterClassExW = (RegisterClassExW_fn)Iat_hook::detour_iat_ptr("RegisterClassExW", (void*)hk_RegisterClassExW, ole32);
-                    else
-                        Iat_hook::detour_iat_ptr("RegisterClassExW", (void*)hk_RegisterClassExW, ole32);
-                    if (oGetActiveWindow == NULL)
-                        oGetActiveWindow = (GetActiveWindow_fn)Iat_hook::detour_iat_ptr("GetActiveWindow", (void*)hk_GetActiveWindow, ole32);
-                    else
-                        Iat_hook::detour_iat_ptr("GetActiveWindow", (void*)hk_GetActiveWindow, ole32);
+                    const Iat_hook::iat_patch ole32Hooks[] = {
+                        { "RegisterClassA", (void*)hk_RegisterClassA, (void**)&oRegisterClassA },
+                        { "RegisterClassW", (void*)hk_RegisterClassW, (void**)&oRegisterClassW },
+                        { "RegisterClassExA", (void*)hk_RegisterClassExA, (void**)&oRegisterClassExA },
+                        { "RegisterClassExW", (void*)hk_RegisterClassExW, (void**)&oRegisterClassExW },
+                        { "GetActiveWindow", (void*)hk_GetActiveWindow, (void**)&oGetActiveWindow },
+                    };
+                    Iat_hook::detour_iat_ptrs(ole32Hooks, _countof(ole32Hooks), ole32);
                 }
 
                 HookImportedModules();
@@ -912,7 +926,7 @@ bool WINAPI DllMain(HMODULE hModule, DWORD dwReason, LPVOID lpReserved)
         break;
         case DLL_PROCESS_DETACH:
         {
-            if (mFPSLimitMode == FrameLimiter::FPSLimitMode::FPS_ACCURATE)
+            if (mFPSLimitMode == FrameLimiter::FPSLimitMode::FPS_ACCURATE || mFPSLimitMode == FrameLimiter::FPSLimitMode::FPS_HYBRID)
                 timeEndPeriod(1);
 
             FreeLibrary(d3d8dll);
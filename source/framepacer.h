@@ -0,0 +1,146 @@
+#ifndef __FRAMEPACER_H
+#define __FRAMEPACER_H
+
+#include <stdint.h>
+
+/*  Hybrid sleep-then-spin frame pacer.
+ *
+ *  The pacer sleeps on a coarse timer until a safety margin before the
+ *  deadline and spins on the clock for the remainder. The margin follows
+ *  the observed oversleep of the coarse timer: it jumps up on a late
+ *  wakeup and decays slowly while wakeups stay on time.
+ *
+ *  All values are in clock ticks. The clock is a template parameter so the
+ *  pacing math can be driven by a simulated clock, it must provide:
+ *      int64_t Now();              current tick count
+ *      void Sleep(int64_t ticks);  coarse sleep, may oversleep
+ *      void Spin();                called between polls while spinning
+ */
+class HybridPacer
+{
+private:
+    int64_t MarginMin = 0;
+    int64_t MarginMax = 0;
+    int64_t Margin = 0;
+    int64_t Oversleep = 0;  // decaying peak of the observed oversleep
+
+public:
+    void Init(int64_t frequency)
+    {
+        MarginMin = frequency / 4000;   // 0.25 ms
+        MarginMax = frequency / 250;    // 4 ms
+        Oversleep = frequency / 1000;   // start pessimistic: 1 ms
+        UpdateMargin();
+    }
+
+    int64_t GetMargin() const { return Margin; }
+
+    // Ticks to spend in the coarse sleep before spinning up to deadline.
+    int64_t SleepTicks(int64_t now, int64_t deadline) const
+    {
+        int64_t remaining = deadline - now;
+        return (remaining > Margin) ? remaining - Margin : 0;
+    }
+
+    // Feed back one coarse sleep: how long was asked and how long it took.
+    void Observe(int64_t requested, int64_t elapsed)
+    {
+        int64_t late = elapsed - requested;
+        if (late < 0)
+            late = 0;
+
+        if (late > Oversleep)
+            Oversleep = late;
+        else
+            Oversleep -= (Oversleep - late) / 16;
+
+        UpdateMargin();
+    }
+
+    // Blocks until deadline and returns the tick count at release.
+    template <typename Clock>
+    int64_t WaitUntil(Clock& clock, int64_t deadline)
+    {
+        int64_t now = clock.Now();
+        int64_t sleep = SleepTicks(now, deadline);
+        if (sleep > 0)
+        {
+            clock.Sleep(sleep);
+            int64_t woke = clock.Now();
+            Observe(sleep, woke - now);
+            now = woke;
+        }
+
+        while (now < deadline)
+        {
+            clock.Spin();
+            now = clock.Now();
+        }
+        return now;
+    }
+
+private:
+    void UpdateMargin()
+    {
+        // 25% headroom over the worst recent oversleep
+        Margin = Oversleep + Oversleep / 4;
+        if (Margin < MarginMin)
+            Margin = MarginMin;
+        if (Margin > MarginMax)
+            Margin = MarginMax;
+    }
+};
+
+/*  Absolute frame deadline schedule: deadline N = start + N * period.
+ *
+ *  Late frames do not shift later deadlines. When the game falls behind,
+ *  up to CatchUp missed deadlines are released back-to-back and the rest
+ *  are skipped (CatchUp = 0 skips them all). A frame later than Resync
+ *  ticks, e.g. after a loading screen, restarts the schedule from now.
+ */
+class FrameSchedule
+{
+private:
+    int64_t Start = 0;
+    int64_t Frame = 0;
+    double Period = 0.0;
+    int64_t CatchUp = 0;
+    int64_t Resync = 0;
+
+public:
+    void Init(int64_t now, double period, int catchUp, int64_t resync)
+    {
+        Start = now;
+        Frame = 0;
+        Period = period;
+        CatchUp = (catchUp > 0) ? catchUp : 0;
+        Resync = resync;
+    }
+
+    int64_t Deadline() const
+    {
+        return Start + (int64_t)((double)Frame * Period);
+    }
+
+    // Called when the frame of the current deadline is released at now.
+    void Advance(int64_t now)
+    {
+        if (Resync > 0 && now - Deadline() > Resync)
+        {
+            Start = now;
+            Frame = 1;
+            return;
+        }
+
+        Frame++;
+        int64_t next = Deadline();
+        if (next > now)
+            return;
+
+        int64_t missed = (int64_t)((double)(now - next) / Period) + 1;
+        if (missed > CatchUp)
+            Frame += missed - CatchUp;
+    }
+};
+
+#endif //__FRAMEPACER_H
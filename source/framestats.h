@@ -0,0 +1,222 @@
+#ifndef __FRAMESTATS_H
+#define __FRAMESTATS_H
+
+#include <windows.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <atomic>
+
+struct FrameStatsSummary
+{
+    double Seconds;     // time since the log was opened
+    uint32_t Frames;    // frame times in the rolling window
+    double AvgFps;
+    double Low1Fps;     // fps at the 99th percentile frame time
+    double Low01Fps;    // fps at the 99.9th percentile frame time
+    double P50Ms;
+    double P95Ms;
+    double P99Ms;
+    uint32_t Stutters;  // frames in the window slower than StutterFactor x average
+};
+
+/*  Rolling window of frame timestamps.
+ *
+ *  Frame times are kept in a fixed ring together with a histogram of the
+ *  window, both updated in O(1) per frame, so percentiles are read from
+ *  the histogram without sorting or allocating.
+ */
+class FrameStats
+{
+public:
+    static constexpr uint32_t Capacity = 1024;                      // power of two
+    static constexpr uint32_t BucketsPerMs = 10;                    // 0.1 ms resolution
+    static constexpr uint32_t Buckets = 100 * BucketsPerMs + 1;     // last bucket holds >= 100 ms
+    static constexpr int64_t StutterFactor = 2;
+
+private:
+    static constexpr uint32_t Mask = Capacity - 1;
+
+    int64_t Frequency = 0;
+    int64_t Times[Capacity] = {};
+    uint16_t Bucket[Capacity] = {};     // bucket of the frame time ending at this slot
+    bool Stutter[Capacity] = {};
+    uint32_t Head = 0;                  // next slot to write
+    uint32_t Count = 0;                 // timestamps in the ring
+    uint32_t Histogram[Buckets] = {};
+    uint32_t Stutters = 0;
+
+public:
+    void Init(int64_t frequency)
+    {
+        *this = FrameStats();
+        Frequency = frequency;
+    }
+
+    void Push(int64_t time)
+    {
+        if (Count == Capacity)
+        {
+            // The oldest timestamp leaves, and with it the frame time ending at the next slot
+            uint32_t next = (Head + 1) & Mask;
+            Histogram[Bucket[next]]--;
+            if (Stutter[next])
+                Stutters--;
+            Count--;
+        }
+
+        uint16_t bucket = 0;
+        bool stutter = false;
+        if (Count > 0)
+        {
+            int64_t last = Times[(Head - 1) & Mask];
+            int64_t delta = time - last;
+            int64_t index = delta * BucketsPerMs * 1000 / Frequency;
+            bucket = (uint16_t)((index < Buckets - 1) ? ((index > 0) ? index : 0) : Buckets - 1);
+            Histogram[bucket]++;
+
+            if (Count > 1)
+            {
+                int64_t span = last - Times[(Head - Count) & Mask];
+                stutter = delta * (Count - 1) > StutterFactor * span;
+                if (stutter)
+                    Stutters++;
+            }
+        }
+
+        Times[Head] = time;
+        Bucket[Head] = bucket;
+        Stutter[Head] = stutter;
+        Head = (Head + 1) & Mask;
+        Count++;
+    }
+
+    // Average fps over the last frames timestamps
+    double AverageFps(uint32_t frames) const
+    {
+        if (frames > Count)
+            frames = Count;
+        if (frames < 2)
+            return 0.0;
+
+        int64_t span = Times[(Head - 1) & Mask] - Times[(Head - frames) & Mask];
+        return (span > 0) ? (double)(frames - 1) * (double)Frequency / (double)span : 0.0;
+    }
+
+    // Frame time in ms below which the given fraction of the window lies
+    double Percentile(double fraction) const
+    {
+        if (Count < 2)
+            return 0.0;
+
+        uint32_t target = (uint32_t)(fraction * (double)(Count - 1) + 0.5);
+        if (target < 1)
+            target = 1;
+
+        uint32_t seen = 0;
+        for (uint32_t i = 0; i < Buckets; i++)
+        {
+            seen += Histogram[i];
+            if (seen >= target)
+                return ((double)i + 0.5) / (double)BucketsPerMs;
+        }
+        return (double)(Buckets - 1) / (double)BucketsPerMs;
+    }
+
+    FrameStatsSummary Summarize(double seconds) const
+    {
+        FrameStatsSummary s;
+        s.Seconds = seconds;
+        s.Frames = (Count > 0) ? Count - 1 : 0;
+        s.AvgFps = AverageFps(Count);
+        s.P50Ms = Percentile(0.50);
+        s.P95Ms = Percentile(0.95);
+        s.P99Ms = Percentile(0.99);
+        double p999 = Percentile(0.999);
+        s.Low1Fps = (s.P99Ms > 0.0) ? 1000.0 / s.P99Ms : 0.0;
+        s.Low01Fps = (p999 > 0.0) ? 1000.0 / p999 : 0.0;
+        s.Stutters = Stutters;
+        return s;
+    }
+};
+
+/*  Streams summaries to a CSV or JSON lines file from a background thread.
+ *  The render thread only copies into a single-producer ring and signals.
+ */
+class FrameStatsLog
+{
+private:
+    static constexpr uint32_t QueueSize = 64;   // power of two
+
+    FrameStatsSummary Queue[QueueSize];
+    std::atomic<uint32_t> WritePos = 0;
+    std::atomic<uint32_t> ReadPos = 0;
+    HANDLE hEvent = NULL;
+    FILE* File = nullptr;
+    bool Json = false;
+
+public:
+    bool Open(const char* path, bool json)
+    {
+        File = fopen(path, "w");
+        if (!File)
+            return false;
+
+        Json = json;
+        if (!Json)
+        {
+            fputs("seconds,frames,avg_fps,low1_fps,low01_fps,p50_ms,p95_ms,p99_ms,stutters\n", File);
+            fflush(File);
+        }
+
+        hEvent = CreateEvent(NULL, FALSE, FALSE, NULL);
+        HANDLE hThread = CreateThread(NULL, 0, Worker, this, 0, NULL);
+        if (!hEvent || !hThread)
+        {
+            fclose(File);
+            File = nullptr;
+            return false;
+        }
+        CloseHandle(hThread);
+        return true;
+    }
+
+    bool IsOpen() const { return File != nullptr; }
+
+    // Render thread; drops the summary if the writer fell behind
+    void Post(const FrameStatsSummary& summary)
+    {
+        uint32_t write = WritePos.load(std::memory_order_relaxed);
+        if (write - ReadPos.load(std::memory_order_acquire) >= QueueSize)
+            return;
+
+        Queue[write & (QueueSize - 1)] = summary;
+        WritePos.store(write + 1, std::memory_order_release);
+        SetEvent(hEvent);
+    }
+
+private:
+    static DWORD WINAPI Worker(LPVOID lpParameter)
+    {
+        FrameStatsLog* log = static_cast<FrameStatsLog*>(lpParameter);
+        while (WaitForSingleObject(log->hEvent, INFINITE) == WAIT_OBJECT_0)
+        {
+            uint32_t read = log->ReadPos.load(std::memory_order_relaxed);
+            uint32_t write = log->WritePos.load(std::memory_order_acquire);
+            for (; read != write; read++)
+            {
+                const FrameStatsSummary& s = log->Queue[read & (QueueSize - 1)];
+                if (log->Json)
+                    fprintf(log->File, "{\"seconds\":%.3f,\"frames\":%u,\"avg_fps\":%.2f,\"low1_fps\":%.2f,\"low01_fps\":%.2f,\"p50_ms\":%.2f,\"p95_ms\":%.2f,\"p99_ms\":%.2f,\"stutters\":%u}\n",
+                        s.Seconds, s.Frames, s.AvgFps, s.Low1Fps, s.Low01Fps, s.P50Ms, s.P95Ms, s.P99Ms, s.Stutters);
+                else
+                    fprintf(log->File, "%.3f,%u,%.2f,%.2f,%.2f,%.2f,%.2f,%.2f,%u\n",
+                        s.Seconds, s.Frames, s.AvgFps, s.Low1Fps, s.Low01Fps, s.P50Ms, s.P95Ms, s.P99Ms, s.Stutters);
+                log->ReadPos.store(read + 1, std::memory_order_release);
+            }
+            fflush(log->File);
+        }
+        return 0;
+    }
+};
+
+#endif //__FRAMESTATS_H
@@ -2,6 +2,7 @@
 #define __HELPERS_H
 
 #include <windows.h>
+#include "perfecthash.h"
 
 typedef BOOL(WINAPI* LPFN_ISTOPLEVELWINDOW)(HWND);
 LPFN_ISTOPLEVELWINDOW fnIsTopLevelWindow = NULL;
@@ -30,166 +31,28 @@ BOOL IsValueIntAtom(DWORD dw)
     return (HIWORD(dw) == 0 && LOWORD(dw) < 0xC000);
 }
 
+// Window classes of the system and common controls, compared without regard to ASCII case
+constexpr const char* SystemClassNames[] = {
+    "BUTTON", "COMBOBOX", "EDIT", "LISTBOX", "MDICLIENT", "RICHEDIT", "RICHEDIT_CLASS",
+    "SCROLLBAR", "STATIC", "ANIMATE_CLASS", "DATETIMEPICK_CLASS", "HOTKEY_CLASS", "LINK_CLASS",
+    "MONTHCAL_CLASS", "NATIVEFNTCTL_CLASS", "PROGRESS_CLASS", "REBARCLASSNAME", "STANDARD_CLASSES",
+    "STATUSCLASSNAME", "TOOLBARCLASSNAME", "TOOLTIPS_CLASS", "TRACKBAR_CLASS", "UPDOWN_CLASS",
+    "WC_BUTTON", "WC_COMBOBOX", "WC_COMBOBOXEX", "WC_EDIT", "WC_HEADER", "WC_LISTBOX",
+    "WC_IPADDRESS", "WC_LINK", "WC_LISTVIEW", "WC_NATIVEFONTCTL", "WC_PAGESCROLLER",
+    "WC_SCROLLBAR", "WC_STATIC", "WC_TABCONTROL", "WC_TREEVIEW",
+};
+
+constexpr PerfectHashSet<_countof(SystemClassNames), 256> SystemClasses(SystemClassNames, true);
+static_assert(SystemClasses.IsValid(), "no perfect hash seed for the system class names");
+
 BOOL IsSystemClassNameA(LPCSTR classNameA)
 {
-    if (!lstrcmpiA(classNameA, "BUTTON"))
-        return TRUE;
-    if (!lstrcmpiA(classNameA, "COMBOBOX"))
-        return TRUE;
-    if (!lstrcmpiA(classNameA, "EDIT"))
-        return TRUE;
-    if (!lstrcmpiA(classNameA, "LISTBOX"))
-        return TRUE;
-    if (!lstrcmpiA(classNameA, "MDICLIENT"))
-        return TRUE;
-    if (!lstrcmpiA(classNameA, "RICHEDIT"))
-        return TRUE;
-    if (!lstrcmpiA(classNameA, "RICHEDIT_CLASS"))
-        return TRUE;
-    if (!lstrcmpiA(classNameA, "SCROLLBAR"))
-        return TRUE;
-    if (!lstrcmpiA(classNameA, "STATIC"))
-        return TRUE;
-    if (!lstrcmpiA(classNameA, "ANIMATE_CLASS"))
-        return TRUE;
-    if (!lstrcmpiA(classNameA, "DATETIMEPICK_CLASS"))
-        return TRUE;
-    if (!lstrcmpiA(classNameA, "HOTKEY_CLASS"))
-        return TRUE;
-    if (!lstrcmpiA(classNameA, "LINK_CLASS"))
-        return TRUE;
-    if (!lstrcmpiA(classNameA, "MONTHCAL_CLASS"))
-        return TRUE;
-    if (!lstrcmpiA(classNameA, "NATIVEFNTCTL_CLASS"))
-        return TRUE;
-    if (!lstrcmpiA(classNameA, "PROGRESS_CLASS"))
-        return TRUE;
-    if (!lstrcmpiA(classNameA, "REBARCLASSNAME"))
-        return TRUE;
-    if (!lstrcmpiA(classNameA, "STANDARD_CLASSES"))
-        return TRUE;
-    if (!lstrcmpiA(classNameA, "STATUSCLASSNAME"))
-        return TRUE;
-    if (!lstrcmpiA(classNameA, "TOOLBARCLASSNAME"))
-        return TRUE;
-    if (!lstrcmpiA(classNameA, "TOOLTIPS_CLASS"))
-        return TRUE;
-    if (!lstrcmpiA(classNameA, "TRACKBAR_CLASS"))
-        return TRUE;
-    if (!lstrcmpiA(classNameA, "UPDOWN_CLASS"))
-        return TRUE;
-    if (!lstrcmpiA(classNameA, "WC_BUTTON"))
-        return TRUE;
-    if (!lstrcmpiA(classNameA, "WC_COMBOBOX"))
-        return TRUE;
-    if (!lstrcmpiA(classNameA, "WC_COMBOBOXEX"))
-        return TRUE;
-    if (!lstrcmpiA(classNameA, "WC_EDIT"))
-        return TRUE;
-    if (!lstrcmpiA(classNameA, "WC_HEADER"))
-        return TRUE;
-    if (!lstrcmpiA(classNameA, "WC_LISTBOX"))
-        return TRUE;
-    if (!lstrcmpiA(classNameA, "WC_IPADDRESS"))
-        return TRUE;
-    if (!lstrcmpiA(classNameA, "WC_LINK"))
-        return TRUE;
-    if (!lstrcmpiA(classNameA, "WC_LISTVIEW"))
-        return TRUE;
-    if (!lstrcmpiA(classNameA, "WC_NATIVEFONTCTL"))
-        return TRUE;
-    if (!lstrcmpiA(classNameA, "WC_PAGESCROLLER"))
-        return TRUE;
-    if (!lstrcmpiA(classNameA, "WC_SCROLLBAR"))
-        return TRUE;
-    if (!lstrcmpiA(classNameA, "WC_STATIC"))
-        return TRUE;
-    if (!lstrcmpiA(classNameA, "WC_TABCONTROL"))
-        return TRUE;
-    if (!lstrcmpiA(classNameA, "WC_TREEVIEW"))
-        return TRUE;
-    return FALSE;
+    return SystemClasses.Find(classNameA) >= 0;
 }
 
 BOOL IsSystemClassNameW(LPCWSTR classNameW)
 {
-    if (!lstrcmpiW(classNameW, L"BUTTON"))
-        return TRUE;
-    if (!lstrcmpiW(classNameW, L"COMBOBOX"))
-        return TRUE;
-    if (!lstrcmpiW(classNameW, L"EDIT"))
-        return TRUE;
-    if (!lstrcmpiW(classNameW, L"LISTBOX"))
-        return TRUE;
-    if (!lstrcmpiW(classNameW, L"MDICLIENT"))
-        return TRUE;
-    if (!lstrcmpiW(classNameW, L"RICHEDIT"))
-        return TRUE;
-    if (!lstrcmpiW(classNameW, L"RICHEDIT_CLASS"))
-        return TRUE;
-    if (!lstrcmpiW(classNameW, L"SCROLLBAR"))
-        return TRUE;
-    if (!lstrcmpiW(classNameW, L"STATIC"))
-        return TRUE;
-    if (!lstrcmpiW(classNameW, L"ANIMATE_CLASS"))
-        return TRUE;
-    if (!lstrcmpiW(classNameW, L"DATETIMEPICK_CLASS"))
-        return TRUE;
-    if (!lstrcmpiW(classNameW, L"HOTKEY_CLASS"))
-        return TRUE;
-    if (!lstrcmpiW(classNameW, L"LINK_CLASS"))
-        return TRUE;
-    if (!lstrcmpiW(classNameW, L"MONTHCAL_CLASS"))
-        return TRUE;
-    if (!lstrcmpiW(classNameW, L"NATIVEFNTCTL_CLASS"))
-        return TRUE;
-    if (!lstrcmpiW(classNameW, L"PROGRESS_CLASS"))
-        return TRUE;
-    if (!lstrcmpiW(classNameW, L"REBARCLASSNAME"))
-        return TRUE;
-    if (!lstrcmpiW(classNameW, L"STANDARD_CLASSES"))
-        return TRUE;
-    if (!lstrcmpiW(classNameW, L"STATUSCLASSNAME"))
-        return TRUE;
-    if (!lstrcmpiW(classNameW, L"TOOLBARCLASSNAME"))
-        return TRUE;
-    if (!lstrcmpiW(classNameW, L"TOOLTIPS_CLASS"))
-        return TRUE;
-    if (!lstrcmpiW(classNameW, L"TRACKBAR_CLASS"))
-        return TRUE;
-    if (!lstrcmpiW(classNameW, L"UPDOWN_CLASS"))
-        return TRUE;
-    if (!lstrcmpiW(classNameW, L"WC_BUTTON"))
-        return TRUE;
-    if (!lstrcmpiW(classNameW, L"WC_COMBOBOX"))
-        return TRUE;
-    if (!lstrcmpiW(classNameW, L"WC_COMBOBOXEX"))
-        return TRUE;
-    if (!lstrcmpiW(classNameW, L"WC_EDIT"))
-        return TRUE;
-    if (!lstrcmpiW(classNameW, L"WC_HEADER"))
-        return TRUE;
-    if (!lstrcmpiW(classNameW, L"WC_LISTBOX"))
-        return TRUE;
-    if (!lstrcmpiW(classNameW, L"WC_IPADDRESS"))
-        return TRUE;
-    if (!lstrcmpiW(classNameW, L"WC_LINK"))
-        return TRUE;
-    if (!lstrcmpiW(classNameW, L"WC_LISTVIEW"))
-        return TRUE;
-    if (!lstrcmpiW(classNameW, L"WC_NATIVEFONTCTL"))
-        return TRUE;
-    if (!lstrcmpiW(classNameW, L"WC_PAGESCROLLER"))
-        return TRUE;
-    if (!lstrcmpiW(classNameW, L"WC_SCROLLBAR"))
-        return TRUE;
-    if (!lstrcmpiW(classNameW, L"WC_STATIC"))
-        return TRUE;
-    if (!lstrcmpiW(classNameW, L"WC_TABCONTROL"))
-        return TRUE;
-    if (!lstrcmpiW(classNameW, L"WC_TREEVIEW"))
-        return TRUE;
-    return FALSE;
+    return SystemClasses.Find(classNameW) >= 0;
 }
 
 #endif //__HELPERS_H
\ No newline at end of file
@@ -101,6 +101,151 @@ namespace Iat_hook
         VirtualProtect(func_ptr, sizeof(uintptr_t), old_rights, &new_rights);
         return ret;
     }
+
+    struct iat_patch
+    {
+        const char* function;
+        void* newfunction;
+        void** original;    // receives the replaced pointer if it is still NULL, may be NULL
+    };
+
+    inline uint32_t iat_hash(const char* name)
+    {
+        uint32_t hash = 2166136261u; // FNV-1a
+        for (; *name; name++)
+            hash = (hash ^ (uint8_t)*name) * 16777619u;
+        return hash;
+    }
+
+    // Patches every listed function in one walk over the module's import table.
+    // Names are matched through a small hash table built per call, and the
+    // thunks are rewritten with one VirtualProtect window per IAT page.
+    // Returns the number of thunks patched.
+    size_t detour_iat_ptrs(const iat_patch* patches, size_t count, HMODULE hModule = NULL)
+    {
+        constexpr size_t table_size = 64;   // power of two, at least twice the patch count
+        constexpr size_t max_found = 128;
+        constexpr uint8_t empty = 0xFF;
+
+        if (count > table_size / 2)
+            return 0;
+
+        if (!hModule)
+            hModule = GetModuleHandle(nullptr);
+
+        uint32_t hashes[table_size / 2];
+        uint8_t table[table_size];
+        memset(table, empty, sizeof(table));
+        for (size_t i = 0; i < count; i++)
+        {
+            hashes[i] = iat_hash(patches[i].function);
+            size_t pos = hashes[i] & (table_size - 1);
+            while (table[pos] != empty)
+                pos = (pos + 1) & (table_size - 1);
+            table[pos] = (uint8_t)i;
+        }
+
+        struct { void** slot; size_t patch; } found[max_found];
+        size_t nfound = 0;
+
+        const DWORD_PTR instance = reinterpret_cast<DWORD_PTR>(hModule);
+        const PIMAGE_NT_HEADERS ntHeader = reinterpret_cast<PIMAGE_NT_HEADERS>(instance + reinterpret_cast<PIMAGE_DOS_HEADER>(instance)->e_lfanew);
+        PIMAGE_IMPORT_DESCRIPTOR pImports = reinterpret_cast<PIMAGE_IMPORT_DESCRIPTOR>(instance + ntHeader->OptionalHeader.DataDirectory[IMAGE_DIRECTORY_ENTRY_IMPORT].VirtualAddress);
+
+        __try
+        {
+            for (; pImports->Name != 0; pImports++)
+            {
+                void** pFunctions = reinterpret_cast<void**>(instance + pImports->FirstThunk);
+                if (pImports->OriginalFirstThunk != 0)
+                {
+                    const PIMAGE_THUNK_DATA pThunk = reinterpret_cast<PIMAGE_THUNK_DATA>(instance + pImports->OriginalFirstThunk);
+                    for (ptrdiff_t j = 0; pThunk[j].u1.AddressOfData != 0 && nfound < max_found; j++)
+                    {
+                        if (IMAGE_SNAP_BY_ORDINAL(pThunk[j].u1.Ordinal))
+                            continue;
+
+                        const char* name = reinterpret_cast<PIMAGE_IMPORT_BY_NAME>(instance + pThunk[j].u1.AddressOfData)->Name;
+                        const uint32_t hash = iat_hash(name);
+                        for (size_t pos = hash & (table_size - 1); table[pos] != empty; pos = (pos + 1) & (table_size - 1))
+                        {
+                            if (hashes[table[pos]] == hash && strcmp(patches[table[pos]].function, name) == 0)
+                            {
+                                found[nfound++] = { &pFunctions[j], table[pos] };
+                                break;
+                            }
+                        }
+                    }
+                }
+                else
+                {
+                    // No name table, match the bound addresses instead
+                    HMODULE hImport = GetModuleHandleA(reinterpret_cast<const char*>(instance + pImports->Name));
+                    if (!hImport)
+                        continue;
+
+                    for (size_t i = 0; i < count; i++)
+                    {
+                        void* address = (void*)GetProcAddress(hImport, patches[i].function);
+                        if (!address)
+                            continue;
+
+                        for (ptrdiff_t j = 0; pFunctions[j] != nullptr && nfound < max_found; j++)
+                        {
+                            if (pFunctions[j] == address)
+                                found[nfound++] = { &pFunctions[j], i };
+                        }
+                    }
+                }
+            }
+        }
+        __except ((GetExceptionCode() == EXCEPTION_ACCESS_VIOLATION) ? EXCEPTION_EXECUTE_HANDLER : EXCEPTION_CONTINUE_SEARCH)
+        {
+        }
+
+        // Order the thunks by address so each page is unprotected once
+        for (size_t i = 1; i < nfound; i++)
+        {
+            auto entry = found[i];
+            size_t j = i;
+            for (; j > 0 && found[j - 1].slot > entry.slot; j--)
+                found[j] = found[j - 1];
+            found[j] = entry;
+        }
+
+        SYSTEM_INFO info;
+        GetSystemInfo(&info);
+        const uintptr_t page_mask = ~(uintptr_t)(info.dwPageSize - 1);
+
+        size_t patched = 0;
+        for (size_t i = 0, end; i < nfound; i = end)
+        {
+            const uintptr_t page = (uintptr_t)found[i].slot & page_mask;
+            for (end = i + 1; end < nfound && ((uintptr_t)found[end].slot & page_mask) == page; end++);
+
+            void** first = found[i].slot;
+            const SIZE_T size = (SIZE_T)((found[end - 1].slot - first) + 1) * sizeof(void*);
+            DWORD old_rights, new_rights = PAGE_READWRITE;
+            if (!VirtualProtect(first, size, new_rights, &old_rights))
+                continue;
+
+            for (size_t k = i; k < end; k++)
+            {
+                const iat_patch& patch = patches[found[k].patch];
+                void** func_ptr = found[k].slot;
+                if (*func_ptr == patch.newfunction || *func_ptr == NULL)
+                    continue;
+
+                if (patch.original && *patch.original == NULL)
+                    *patch.original = *func_ptr;
+                *func_ptr = patch.newfunction;
+                patched++;
+            }
+
+            VirtualProtect(first, size, old_rights, &new_rights);
+        }
+        return patched;
+    }
 #ifdef __cplusplus
 };
 #endif
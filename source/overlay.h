@@ -0,0 +1,330 @@
+#ifndef __OVERLAY_H
+#define __OVERLAY_H
+
+#include <windows.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <d3d8.h>
+
+/*  Text overlay drawn from a pre-baked glyph atlas.
+ *
+ *  Printable ASCII is rendered once with GDI for every font size and the
+ *  black outline is baked into the atlas, so a colored glyph needs a single
+ *  quad. Print() only appends quads, Flush() draws everything queued with
+ *  one DrawPrimitiveUP between a capture and a restore of the touched state.
+ */
+class Overlay
+{
+public:
+    enum Font { FONT_LARGE, FONT_SMALL, FONT_COUNT };
+
+private:
+    static constexpr int FirstChar = 32;
+    static constexpr int LastChar = 126;
+    static constexpr int CharCount = LastChar - FirstChar + 1;
+    static constexpr int Pad = 2;               // outline plus a spare texel around each glyph
+    static constexpr UINT AtlasWidth = 1024;
+    static constexpr UINT MaxAtlasHeight = 2048;
+    static constexpr UINT MaxChars = 256;
+    static constexpr DWORD FVF = D3DFVF_XYZRHW | D3DFVF_DIFFUSE | D3DFVF_TEX1;
+
+    struct Vertex
+    {
+        float x, y, z, rhw;
+        D3DCOLOR color;
+        float u, v;
+    };
+
+    struct Glyph
+    {
+        int x, y, w, h;     // cell in the atlas, outline included
+        int advance;
+        float u0, v0, u1, v1;
+    };
+
+    LPDIRECT3DDEVICE8 pDevice = nullptr;
+    LPDIRECT3DTEXTURE8 pAtlas = nullptr;
+    DWORD SavedState = 0;
+    DWORD DrawState = 0;
+    Glyph Glyphs[FONT_COUNT][CharCount] = {};
+    int LineHeight[FONT_COUNT] = {};
+    Vertex Vertices[MaxChars * 6];
+    UINT VertexCount = 0;
+
+public:
+    bool IsReady() const { return pAtlas != nullptr; }
+    int GetLineHeight(Font font) const { return LineHeight[font]; }
+
+    bool Create(LPDIRECT3DDEVICE8 device, const int heights[FONT_COUNT])
+    {
+        Release();
+
+        HDC hdc = CreateCompatibleDC(NULL);
+        if (!hdc)
+            return false;
+
+        // Held like D3DX objects hold their device, released in Release()
+        pDevice = device;
+        pDevice->AddRef();
+
+        HFONT fonts[FONT_COUNT] = {};
+        HGDIOBJ hOldFont = NULL;
+        int x = 0, y = 0, rowHeight = 0;
+        for (int f = 0; f < FONT_COUNT; f++)
+        {
+            fonts[f] = CreateFontA(heights[f], 0, 0, 0, FW_BOLD, FALSE, FALSE, FALSE, DEFAULT_CHARSET, OUT_DEFAULT_PRECIS, CLIP_DEFAULT_PRECIS, ANTIALIASED_QUALITY, DEFAULT_PITCH, "Arial");
+            HGDIOBJ hPrev = SelectObject(hdc, fonts[f]);
+            if (!hOldFont)
+                hOldFont = hPrev;
+
+            TEXTMETRICA tm;
+            GetTextMetricsA(hdc, &tm);
+            LineHeight[f] = tm.tmHeight;
+
+            for (int c = 0; c < CharCount; c++)
+            {
+                char ch = (char)(FirstChar + c);
+                SIZE size;
+                GetTextExtentPoint32A(hdc, &ch, 1, &size);
+
+                Glyph& g = Glyphs[f][c];
+                g.w = size.cx + Pad * 2;
+                g.h = tm.tmHeight + Pad * 2;
+                g.advance = size.cx;
+                if (x + g.w > (int)AtlasWidth)
+                {
+                    x = 0;
+                    y += rowHeight;
+                    rowHeight = 0;
+                }
+                g.x = x;
+                g.y = y;
+                x += g.w;
+                if (g.h > rowHeight)
+                    rowHeight = g.h;
+            }
+        }
+
+        UINT height = 64;
+        while (height < (UINT)(y + rowHeight))
+            height *= 2;
+
+        bool result = false;
+        DWORD* bits = nullptr;
+        BITMAPINFO bmi = {};
+        bmi.bmiHeader.biSize = sizeof(BITMAPINFOHEADER);
+        bmi.bmiHeader.biWidth = AtlasWidth;
+        bmi.bmiHeader.biHeight = -(LONG)height; // top-down
+        bmi.bmiHeader.biPlanes = 1;
+        bmi.bmiHeader.biBitCount = 32;
+        bmi.bmiHeader.biCompression = BI_RGB;
+        HBITMAP hBitmap = (height <= MaxAtlasHeight) ? CreateDIBSection(hdc, &bmi, DIB_RGB_COLORS, (void**)&bits, NULL, 0) : NULL;
+        if (hBitmap)
+        {
+            HGDIOBJ hOldBitmap = SelectObject(hdc, hBitmap);
+            SetTextColor(hdc, RGB(255, 255, 255));
+            SetBkMode(hdc, TRANSPARENT);
+            for (int f = 0; f < FONT_COUNT; f++)
+            {
+                SelectObject(hdc, fonts[f]);
+                for (int c = 0; c < CharCount; c++)
+                {
+                    char ch = (char)(FirstChar + c);
+                    Glyph& g = Glyphs[f][c];
+                    TextOutA(hdc, g.x + Pad, g.y + Pad, &ch, 1);
+                    g.u0 = (float)g.x / (float)AtlasWidth;
+                    g.v0 = (float)g.y / (float)height;
+                    g.u1 = (float)(g.x + g.w) / (float)AtlasWidth;
+                    g.v1 = (float)(g.y + g.h) / (float)height;
+                }
+            }
+            GdiFlush();
+
+            result = CreateAtlas(device, bits, height) && CreateStateBlocks(device);
+            SelectObject(hdc, hOldBitmap);
+            DeleteObject(hBitmap);
+        }
+
+        SelectObject(hdc, hOldFont);
+        for (int f = 0; f < FONT_COUNT; f++)
+            DeleteObject(fonts[f]);
+        DeleteDC(hdc);
+
+        if (!result)
+        {
+            Release();
+            return false;
+        }
+        return true;
+    }
+
+    void Release()
+    {
+        if (pAtlas)
+            pAtlas->Release();
+        pAtlas = nullptr;
+
+        if (pDevice)
+        {
+            if (SavedState)
+                pDevice->DeleteStateBlock(SavedState);
+            if (DrawState)
+                pDevice->DeleteStateBlock(DrawState);
+            pDevice->Release();
+            pDevice = nullptr;
+        }
+        SavedState = DrawState = 0;
+        VertexCount = 0;
+    }
+
+    // Queues a line of text, x and y are the top left corner in pixels
+    void Print(Font font, float x, float y, D3DCOLOR color, const char* format, ...)
+    {
+        char buffer[128];
+        va_list args;
+        va_start(args, format);
+        _vsnprintf(buffer, sizeof(buffer) - 1, format, args);
+        va_end(args);
+        buffer[sizeof(buffer) - 1] = '\0';
+
+        // Texel centers sit on half pixels with pre-transformed vertices
+        x -= 0.5f + Pad;
+        y -= 0.5f + Pad;
+        for (const char* p = buffer; *p; p++)
+        {
+            int c = (unsigned char)*p - FirstChar;
+            if (c < 0 || c >= CharCount)
+                continue;
+
+            const Glyph& g = Glyphs[font][c];
+            if (*p != ' ' && VertexCount + 6 <= MaxChars * 6)
+            {
+                float x1 = x + (float)g.w;
+                float y1 = y + (float)g.h;
+                Vertex* v = &Vertices[VertexCount];
+                v[0] = { x,  y,  0.0f, 1.0f, color, g.u0, g.v0 };
+                v[1] = { x1, y,  0.0f, 1.0f, color, g.u1, g.v0 };
+                v[2] = { x,  y1, 0.0f, 1.0f, color, g.u0, g.v1 };
+                v[3] = { x1, y,  0.0f, 1.0f, color, g.u1, g.v0 };
+                v[4] = { x1, y1, 0.0f, 1.0f, color, g.u1, g.v1 };
+                v[5] = { x,  y1, 0.0f, 1.0f, color, g.u0, g.v1 };
+                VertexCount += 6;
+            }
+            x += (float)g.advance;
+        }
+    }
+
+    // Draws all queued text with a single call and restores the game's state
+    void Flush()
+    {
+        if (!pDevice || VertexCount == 0)
+            return;
+
+        pDevice->CaptureStateBlock(SavedState);
+        pDevice->ApplyStateBlock(DrawState);
+        pDevice->DrawPrimitiveUP(D3DPT_TRIANGLELIST, VertexCount / 3, Vertices, sizeof(Vertex));
+        pDevice->ApplyStateBlock(SavedState);
+        VertexCount = 0;
+    }
+
+private:
+    bool CreateAtlas(LPDIRECT3DDEVICE8 device, const DWORD* bits, UINT height)
+    {
+        if (FAILED(device->CreateTexture(AtlasWidth, height, 1, 0, D3DFMT_A8R8G8B8, D3DPOOL_MANAGED, &pAtlas)))
+        {
+            pAtlas = nullptr;
+            return false;
+        }
+
+        D3DLOCKED_RECT locked;
+        if (FAILED(pAtlas->LockRect(0, &locked, NULL, 0)))
+            return false;
+
+        // GDI drew white glyphs, coverage is in any color channel. The outline
+        // is the coverage grown by one texel in the four axis directions.
+        auto Coverage = [&](int x, int y) -> DWORD
+        {
+            if (x < 0 || y < 0 || x >= (int)AtlasWidth || y >= (int)height)
+                return 0;
+            return bits[y * AtlasWidth + x] & 0xFF;
+        };
+        for (int y = 0; y < (int)height; y++)
+        {
+            DWORD* row = reinterpret_cast<DWORD*>(static_cast<BYTE*>(locked.pBits) + y * locked.Pitch);
+            for (int x = 0; x < (int)AtlasWidth; x++)
+            {
+                DWORD fill = Coverage(x, y);
+                DWORD alpha = fill;
+                const DWORD edge[4] = { Coverage(x - 1, y), Coverage(x + 1, y), Coverage(x, y - 1), Coverage(x, y + 1) };
+                for (DWORD e : edge)
+                {
+                    if (e > alpha)
+                        alpha = e;
+                }
+                DWORD lum = alpha ? fill * 255 / alpha : 0;
+                row[x] = (alpha << 24) | (lum << 16) | (lum << 8) | lum;
+            }
+        }
+
+        pAtlas->UnlockRect(0);
+        return true;
+    }
+
+    void RecordState(LPDIRECT3DDEVICE8 device)
+    {
+        device->SetRenderState(D3DRS_ZENABLE, D3DZB_FALSE);
+        device->SetRenderState(D3DRS_ZWRITEENABLE, FALSE);
+        device->SetRenderState(D3DRS_FILLMODE, D3DFILL_SOLID);
+        device->SetRenderState(D3DRS_CULLMODE, D3DCULL_NONE);
+        device->SetRenderState(D3DRS_ALPHABLENDENABLE, TRUE);
+        device->SetRenderState(D3DRS_SRCBLEND, D3DBLEND_SRCALPHA);
+        device->SetRenderState(D3DRS_DESTBLEND, D3DBLEND_INVSRCALPHA);
+        device->SetRenderState(D3DRS_ALPHATESTENABLE, FALSE);
+        device->SetRenderState(D3DRS_STENCILENABLE, FALSE);
+        device->SetRenderState(D3DRS_FOGENABLE, FALSE);
+        device->SetRenderState(D3DRS_SPECULARENABLE, FALSE);
+        device->SetRenderState(D3DRS_COLORWRITEENABLE, 0x0000000F);
+        device->SetTextureStageState(0, D3DTSS_COLOROP, D3DTOP_MODULATE);
+        device->SetTextureStageState(0, D3DTSS_COLORARG1, D3DTA_TEXTURE);
+        device->SetTextureStageState(0, D3DTSS_COLORARG2, D3DTA_DIFFUSE);
+        device->SetTextureStageState(0, D3DTSS_ALPHAOP, D3DTOP_MODULATE);
+        device->SetTextureStageState(0, D3DTSS_ALPHAARG1, D3DTA_TEXTURE);
+        device->SetTextureStageState(0, D3DTSS_ALPHAARG2, D3DTA_DIFFUSE);
+        device->SetTextureStageState(0, D3DTSS_TEXCOORDINDEX, 0);
+        device->SetTextureStageState(0, D3DTSS_TEXTURETRANSFORMFLAGS, D3DTTFF_DISABLE);
+        device->SetTextureStageState(0, D3DTSS_ADDRESSU, D3DTADDRESS_CLAMP);
+        device->SetTextureStageState(0, D3DTSS_ADDRESSV, D3DTADDRESS_CLAMP);
+        device->SetTextureStageState(0, D3DTSS_MINFILTER, D3DTEXF_POINT);
+        device->SetTextureStageState(0, D3DTSS_MAGFILTER, D3DTEXF_POINT);
+        device->SetTextureStageState(0, D3DTSS_MIPFILTER, D3DTEXF_NONE);
+        device->SetTextureStageState(1, D3DTSS_COLOROP, D3DTOP_DISABLE);
+        device->SetTextureStageState(1, D3DTSS_ALPHAOP, D3DTOP_DISABLE);
+        device->SetTexture(0, pAtlas);
+        device->SetVertexShader(FVF);
+        device->SetPixelShader(0);
+        // DrawPrimitiveUP leaves stream 0 unset, the saved block puts the game's back
+        device->SetStreamSource(0, NULL, 0);
+    }
+
+    bool CreateStateBlocks(LPDIRECT3DDEVICE8 device)
+    {
+        // Both blocks record the same states, one keeps ours and one is
+        // re-captured every frame to hold the game's values
+        device->BeginStateBlock();
+        RecordState(device);
+        if (FAILED(device->EndStateBlock(&DrawState)))
+            return false;
+
+        device->BeginStateBlock();
+        RecordState(device);
+        if (FAILED(device->EndStateBlock(&SavedState)))
+        {
+            device->DeleteStateBlock(DrawState);
+            DrawState = 0;
+            return false;
+        }
+        return true;
+    }
+};
+
+#endif //__OVERLAY_H
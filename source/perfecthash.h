@@ -0,0 +1,121 @@
+#ifndef __PERFECTHASH_H
+#define __PERFECTHASH_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <type_traits>
+
+/*  Perfect hash over a fixed set of ASCII names, built at compile time.
+ *
+ *  The constructor searches for a seed under which every name lands in its
+ *  own slot, so a lookup is one hash pass over the candidate, one length
+ *  check and one compare. Both char and wchar_t candidates are accepted,
+ *  with an optional ASCII case fold for case-insensitive sets.
+ */
+template <size_t Count, size_t TableSize>
+class PerfectHashSet
+{
+    static_assert((TableSize & (TableSize - 1)) == 0, "TableSize must be a power of two");
+    static_assert(Count < TableSize && Count < 128, "too many names for the table");
+
+private:
+    const char* Names[Count] = {};
+    size_t Lengths[Count] = {};
+    int8_t Slots[TableSize] = {};
+    size_t MaxLength = 0;
+    uint32_t Seed = 0;
+    bool Fold = false;
+
+    static constexpr uint32_t FoldChar(uint32_t c, bool fold)
+    {
+        // ASCII only: no locale lookups, and bytes above 0x7F are left alone
+        return (fold && c - 'A' < 26u) ? (c | 0x20) : c;
+    }
+
+    static constexpr uint32_t Mix(uint32_t hash, uint32_t c)
+    {
+        return (hash ^ c) * 16777619u; // FNV-1a step
+    }
+
+    static constexpr size_t Slot(uint32_t hash)
+    {
+        return (hash ^ (hash >> 16)) & (TableSize - 1);
+    }
+
+    constexpr bool TrySeed(uint32_t seed)
+    {
+        for (size_t i = 0; i < TableSize; i++)
+            Slots[i] = -1;
+
+        for (size_t i = 0; i < Count; i++)
+        {
+            uint32_t hash = seed;
+            for (size_t j = 0; j < Lengths[i]; j++)
+                hash = Mix(hash, FoldChar((uint8_t)Names[i][j], Fold));
+
+            size_t slot = Slot(hash);
+            if (Slots[slot] >= 0)
+                return false;
+            Slots[slot] = (int8_t)i;
+        }
+        return true;
+    }
+
+public:
+    constexpr PerfectHashSet(const char* const (&names)[Count], bool fold) : Fold(fold)
+    {
+        for (size_t i = 0; i < Count; i++)
+        {
+            Names[i] = names[i];
+            while (names[i][Lengths[i]])
+                Lengths[i]++;
+            if (Lengths[i] > MaxLength)
+                MaxLength = Lengths[i];
+        }
+
+        for (uint32_t seed = 2166136261u; seed != 2166136261u + 0x10000; seed++)
+        {
+            if (TrySeed(seed))
+            {
+                Seed = seed;
+                break;
+            }
+        }
+    }
+
+    constexpr bool IsValid() const { return Seed != 0; }
+
+    // Index of name in the set, or -1
+    template <typename Char>
+    int Find(const Char* name) const
+    {
+        uint32_t hash = Seed;
+        size_t length = 0;
+        for (; name[length]; length++)
+        {
+            if (length == MaxLength)
+                return -1;
+            hash = Mix(hash, FoldChar((uint32_t)(typename std::make_unsigned<Char>::type)name[length], Fold));
+        }
+
+        int index = Slots[Slot(hash)];
+        if (index < 0 || Lengths[index] != length)
+            return -1;
+
+        const char* entry = Names[index];
+        if constexpr (sizeof(Char) == 1)
+        {
+            if (!Fold)
+                return (memcmp(name, entry, length) == 0) ? index : -1;
+        }
+        for (size_t i = 0; i < length; i++)
+        {
+            if (FoldChar((uint32_t)(typename std::make_unsigned<Char>::type)name[i], Fold) != FoldChar((uint8_t)entry[i], Fold))
+                return -1;
+        }
+        return index;
+    }
+};
+
+#endif //__PERFECTHASH_H
@@ -0,0 +1,302 @@
+/**
+* Copyright (C) 2020 Elisha Riedlinger
+*
+* This software is  provided 'as-is', without any express  or implied  warranty. In no event will the
+* authors be held liable for any damages arising from the use of this software.
+* Permission  is granted  to anyone  to use  this software  for  any  purpose,  including  commercial
+* applications, and to alter it and redistribute it freely, subject to the following restrictions:
+*
+*   1. The origin of this software must not be misrepresented; you must not claim that you  wrote the
+*      original  software. If you use this  software  in a product, an  acknowledgment in the product
+*      documentation would be appreciated but is not required.
+*   2. Altered source versions must  be plainly  marked as such, and  must not be  misrepresented  as
+*      being the original software.
+*   3. This notice may not be removed or altered from any source distribution.
+*/
+
+// Checks, fuzzes and times the d3d8.ini parser of config.h on any platform:
+//
+//   g++ -std=c++17 -O2 -g -fsanitize=address,undefined tools/configfuzz.cpp -o configfuzz
+//   ./configfuzz data/d3d8.ini
+//
+// A run first parses a few fixed inputs and compares the result, then parses
+// seeded random mutations of the ini and checks that every setting stays in
+// its range, then parses the unmodified ini repeatedly and prints the time
+// per parse. Each input is parsed from a buffer of exactly its size, so the
+// sanitizers catch reads past the end. With clang the same file also builds
+// as a libFuzzer target:
+//
+//   clang++ -std=c++17 -g -fsanitize=fuzzer,address,undefined -DLIBFUZZER tools/configfuzz.cpp
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <chrono>
+#include "../source/config.h"
+
+namespace
+{
+	// Used when no ini is given
+	const char Sample[] =
+		"[MAIN]\r\n"
+		"FPSLimit = 60                                   // max fps (0: unlimited/off)\r\n"
+		"FPSLimitMode = 2                               // 1: realtime  -  2: accurate  -  3: hybrid\r\n"
+		"DisplayFPSCounter = 0\r\n"
+		"FilterRedundantStates = 1\r\n"
+		"\r\n"
+		"[FORCEWINDOWED]\r\n"
+		"ForceWindowedMode = 0\r\n"
+		"CenterWindow = 1\r\n"
+		"\r\n"
+		"[fullscreenresolution]                        // read by another patch\r\n"
+		"fullscreenresolution = 2\r\n";
+
+	// Fragments the mutations insert, so they reach the parser's branches more often than random bytes would
+	const char *const Tokens[] = { "[MAIN]", "[FORCEWINDOWED]", "[FOV]", "[", "]", "=", " = ", "\n", "\r\n", "//", ";", "#", "-", "+",
+		"FPSLimit", "FPSLimitMode", "fpslimitmode", "FullScreenRefreshRateInHz", "DisplayFPSCounter", "CenterWindow",
+		"0", "1", "3", "-1", "1000", "2147483647", "99999999999999999999", "\t", " " };
+
+	int Reports = 0;
+
+	void CountReport(const char *)
+	{
+		Reports++;
+	}
+
+	// Parses from a heap buffer of exactly Size bytes
+	Config ParseExact(const char *pData, size_t Size)
+	{
+		char *pCopy = new char[Size ? Size : 1];
+		memcpy(pCopy, pData, Size);
+		Config Result;
+		ConfigParser::Parse(pCopy, Size, Result, CountReport);
+		delete[] pCopy;
+		return Result;
+	}
+
+	Config ParseText(const char *pText)
+	{
+		return ParseExact(pText, strlen(pText));
+	}
+
+	// The ranges of config.h's key table; anything else means a value got past the range check
+	bool InRange(const Config& c)
+	{
+		return c.FPSLimit >= 0 && c.FPSLimit <= 1000 &&
+			c.FPSLimitMode >= 1 && c.FPSLimitMode <= 3 &&
+			c.FPSLimitCatchUp >= 0 && c.FPSLimitCatchUp <= 60 &&
+			c.FPSLimitResyncMs >= 0 && c.FPSLimitResyncMs <= 10000 &&
+			c.FullScreenRefreshRateInHz >= -1 && c.FullScreenRefreshRateInHz <= 1000 &&
+			c.DisplayFPSCounter >= 0 && c.DisplayFPSCounter <= 2 &&
+			c.FrameStatsLog >= 0 && c.FrameStatsLog <= 2;
+	}
+
+	int Failures = 0;
+
+	void Check(bool Condition, const char *What)
+	{
+		if (!Condition)
+		{
+			fprintf(stderr, "configfuzz: FAILED %s\n", What);
+			Failures++;
+		}
+	}
+
+	void CheckKnownAnswers()
+	{
+		const Config Defaults;
+
+		Config c = ParseText("[MAIN]\nFPSLimit = 75 // comment\nfpslimitmode=3\n");
+		Check(c.FPSLimit == 75 && c.FPSLimitMode == 3, "values, trailing comments and case-insensitive keys");
+
+		c = ParseText("[main]\r\nFPSLimit = 30\r\nFPSLimit = 90\r\n");
+		Check(c.FPSLimit == 30, "first occurrence of a key wins");
+
+		c = ParseText("[MAIN]\nFPSLimit = 5000\nFPSLimitMode = 0\nFullScreenRefreshRateInHz = -1\n");
+		Check(c.FPSLimit == Defaults.FPSLimit && c.FPSLimitMode == Defaults.FPSLimitMode && c.FullScreenRefreshRateInHz == -1, "out of range values keep the default");
+
+		c = ParseText("FPSLimit = 30\n[FOV]\nFPSLimit = 40\n[MAIN]\nFPSLimit = 50");
+		Check(c.FPSLimit == 50, "keys before the first section and in foreign sections are ignored, last line needs no newline");
+
+		c = ParseText("[MAIN]\nForceWindowedMode = 1\n[FORCEWINDOWED]\nCenterWindow = 0\nForceWindowedMode = 0\n");
+		Check(c.ForceWindowedMode && !c.CenterWindow, "keys belong to their section");
+
+		c = ParseText("[MAIN]\nFPSLimit = 99999999999999999999\nFPSLimitMode = +2\n");
+		Check(c.FPSLimit == Defaults.FPSLimit && c.FPSLimitMode == 2, "overflowing values saturate and are range checked");
+
+		Reports = 0;
+		ParseText("[MAIN]\nNoSuchKey = 1\nno equals sign\n[NoSuchSection]\n[broken\n");
+		Check(Reports == 4, "unknown keys, malformed lines and unknown sections are reported");
+	}
+
+#ifndef LIBFUZZER
+	// xorshift64*, so a seed always gives the same inputs
+	struct Random
+	{
+		uint64_t State;
+
+		uint64_t Next()
+		{
+			State ^= State >> 12;
+			State ^= State << 25;
+			State ^= State >> 27;
+			return State * 0x2545F4914F6CDD1Dull;
+		}
+		size_t Below(size_t Limit)
+		{
+			return Limit ? (size_t)(Next() % Limit) : 0;
+		}
+	};
+
+	std::string Mutate(const std::string& Input, Random& Rng)
+	{
+		std::string Text = Input;
+		const int Count = 1 + (int)Rng.Below(8);
+		for (int x = 0; x < Count; x++)
+		{
+			const size_t At = Rng.Below(Text.size() + 1);
+			switch (Rng.Below(5))
+			{
+			case 0:
+				if (At < Text.size())
+				{
+					Text[At] = (char)Rng.Next();
+				}
+				break;
+			case 1:
+				Text.insert(At, Tokens[Rng.Below(sizeof(Tokens) / sizeof(Tokens[0]))]);
+				break;
+			case 2:
+				Text.erase(At, Rng.Below(16));
+				break;
+			case 3:
+				Text.resize(At);
+				break;
+			default:
+			{
+				// Repeats a piece of the input somewhere else
+				const size_t From = Rng.Below(Input.size());
+				Text.insert(At, Input, From, Rng.Below(64));
+				break;
+			}
+			}
+		}
+		return Text;
+	}
+
+	bool ReadFile(const char *Path, std::string& Text)
+	{
+		FILE *File = fopen(Path, "rb");
+		if (!File)
+		{
+			return false;
+		}
+		char Buffer[4096];
+		size_t Read;
+		while ((Read = fread(Buffer, 1, sizeof(Buffer), File)) > 0)
+		{
+			Text.append(Buffer, Read);
+		}
+		fclose(File);
+		return true;
+	}
+#endif
+}
+
+#ifdef LIBFUZZER
+extern "C" int LLVMFuzzerInitialize(int *, char ***)
+{
+	CheckKnownAnswers();
+	if (Failures)
+	{
+		abort();
+	}
+	return 0;
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *pData, size_t Size)
+{
+	const Config c = ParseExact(reinterpret_cast<const char *>(pData), Size);
+	if (!InRange(c))
+	{
+		abort();
+	}
+	return 0;
+}
+#else
+int main(int argc, char **argv)
+{
+	const char *Path = nullptr;
+	long Iterations = 200000;
+	long Parses = 100000;
+	uint64_t Seed = 1;
+	for (int x = 1; x < argc; x++)
+	{
+		const bool HasValue = x + 1 < argc;
+		if (!strcmp(argv[x], "-iterations") && HasValue)
+		{
+			Iterations = atol(argv[++x]);
+		}
+		else if (!strcmp(argv[x], "-bench") && HasValue)
+		{
+			Parses = atol(argv[++x]);
+		}
+		else if (!strcmp(argv[x], "-seed") && HasValue)
+		{
+			Seed = strtoull(argv[++x], nullptr, 10);
+		}
+		else if (!Path && argv[x][0] != '-')
+		{
+			Path = argv[x];
+		}
+		else
+		{
+			fprintf(stderr, "usage: configfuzz [-iterations N] [-bench N] [-seed S] [d3d8.ini]\n");
+			return 2;
+		}
+	}
+
+	std::string Input = Sample;
+	if (Path && !ReadFile(Path, Input.erase()))
+	{
+		fprintf(stderr, "configfuzz: cannot open %s\n", Path);
+		return 1;
+	}
+
+	CheckKnownAnswers();
+
+	Random Rng = { Seed * 0x9E3779B97F4A7C15ull + 1 };
+	for (long x = 0; x < Iterations; x++)
+	{
+		const std::string Text = Mutate(Input, Rng);
+		if (!InRange(ParseExact(Text.data(), Text.size())))
+		{
+			fprintf(stderr, "configfuzz: FAILED setting out of range after mutation %ld of seed %llu\n", x, (unsigned long long)Seed);
+			Failures++;
+			break;
+		}
+	}
+	printf("%ld mutations of %s (%zu bytes), seed %llu\n", Iterations, Path ? Path : "the built-in sample", Input.size(), (unsigned long long)Seed);
+
+	if (Parses > 0)
+	{
+		Config c;
+		const auto Start = std::chrono::steady_clock::now();
+		for (long x = 0; x < Parses; x++)
+		{
+			ConfigParser::Parse(Input.data(), Input.size(), c, nullptr);
+		}
+		const double Ns = (double)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - Start).count() / Parses;
+		printf("parse: %.0f ns, %.1f MB/s (FPSLimit = %d)\n", Ns, Input.size() / Ns * 1e9 / (1024.0 * 1024.0), c.FPSLimit);
+	}
+
+	if (Failures)
+	{
+		fprintf(stderr, "configfuzz: %d check(s) failed\n", Failures);
+		return 1;
+	}
+	printf("all checks passed\n");
+	return 0;
+}
+#endif
@@ -0,0 +1,189 @@
+/**
+* Copyright (C) 2020 Elisha Riedlinger
+*
+* This software is  provided 'as-is', without any express  or implied  warranty. In no event will the
+* authors be held liable for any damages arising from the use of this software.
+* Permission  is granted  to anyone  to use  this software  for  any  purpose,  including  commercial
+* applications, and to alter it and redistribute it freely, subject to the following restrictions:
+*
+*   1. The origin of this software must not be misrepresented; you must not claim that you  wrote the
+*      original  software. If you use this  software  in a product, an  acknowledgment in the product
+*      documentation would be appreciated but is not required.
+*   2. Altered source versions must  be plainly  marked as such, and  must not be  misrepresented  as
+*      being the original software.
+*   3. This notice may not be removed or altered from any source distribution.
+*/
+
+// Times hooking the functions HookModule hooks in a module, with one call
+// of Iat_hook::detour_iat_ptrs against one detour_iat_ptr call per function
+// as HookModule did before. Windows only, as 32-bit as the wrapper:
+//
+//   cl /O2 /EHsc tools\iathookbench.cpp      (x86 developer prompt)
+//
+// The modules are copies of system DLLs from the system directory, mapped
+// with DONT_RESOLVE_DLL_REFERENCES so that none of their code runs and their
+// import tables can be pointed anywhere. Each round alternates between two
+// sets of fake hook addresses, so every round rewrites every thunk found.
+
+#include <windows.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../source/iathook.h"
+
+namespace
+{
+	// The functions of HookedFunctionNames in dllmain.cpp
+	const char *const FunctionNames[] = {
+		"RegisterClassA", "RegisterClassW", "RegisterClassExA", "RegisterClassExW",
+		"GetForegroundWindow", "GetActiveWindow", "GetFocus",
+		"LoadLibraryA", "LoadLibraryW", "LoadLibraryExA", "LoadLibraryExW", "FreeLibrary",
+		"GetProcAddress",
+	};
+	constexpr size_t FunctionCount = _countof(FunctionNames);
+
+	const char *const DefaultModules[] = { "user32.dll", "gdi32.dll", "ole32.dll", "shell32.dll", "comdlg32.dll", "winmm.dll" };
+
+	// Stand-ins for the hooks, never called since the modules never run
+	char FakeHooks[2][FunctionCount];
+
+	struct Module
+	{
+		const char *Name;
+		char CopyPath[MAX_PATH];
+		HMODULE hModule;
+	};
+
+	bool MapCopy(Module& Mod)
+	{
+		char SystemPath[MAX_PATH], TempDir[MAX_PATH];
+		if (!GetSystemDirectoryA(SystemPath, MAX_PATH) || !GetTempPathA(MAX_PATH, TempDir))
+		{
+			return false;
+		}
+		strcat_s(SystemPath, "\\");
+		strcat_s(SystemPath, Mod.Name);
+		sprintf_s(Mod.CopyPath, "%siathookbench_%lu_%s", TempDir, GetCurrentProcessId(), Mod.Name);
+
+		if (!CopyFileA(SystemPath, Mod.CopyPath, FALSE))
+		{
+			return false;
+		}
+		Mod.hModule = LoadLibraryExA(Mod.CopyPath, nullptr, DONT_RESOLVE_DLL_REFERENCES);
+		return Mod.hModule != nullptr;
+	}
+
+	double Microseconds(const LARGE_INTEGER& Start, const LARGE_INTEGER& End, const LARGE_INTEGER& Frequency)
+	{
+		return (double)(End.QuadPart - Start.QuadPart) * 1000000.0 / (double)Frequency.QuadPart;
+	}
+}
+
+int main(int argc, char **argv)
+{
+	bool Csv = false;
+	UINT Rounds = 200;
+	Module Modules[32] = {};
+	size_t ModuleCount = 0;
+	for (int x = 1; x < argc; x++)
+	{
+		const bool HasValue = x + 1 < argc;
+		if (!strcmp(argv[x], "-csv"))
+		{
+			Csv = true;
+		}
+		else if (!strcmp(argv[x], "-rounds") && HasValue)
+		{
+			Rounds = (UINT)strtoul(argv[++x], nullptr, 10);
+		}
+		else if (argv[x][0] != '-' && ModuleCount < _countof(Modules))
+		{
+			Modules[ModuleCount++].Name = argv[x];
+		}
+		else
+		{
+			fprintf(stderr, "usage: iathookbench [-rounds N] [-csv] [module.dll ...]\n");
+			return 2;
+		}
+	}
+	if (!Rounds)
+	{
+		fprintf(stderr, "iathookbench: needs at least one round\n");
+		return 2;
+	}
+	if (!ModuleCount)
+	{
+		for (const char *Name : DefaultModules)
+		{
+			Modules[ModuleCount++].Name = Name;
+		}
+	}
+
+	Iat_hook::iat_patch Patches[2][FunctionCount];
+	for (size_t Set = 0; Set < 2; Set++)
+	{
+		for (size_t f = 0; f < FunctionCount; f++)
+		{
+			Patches[Set][f] = { FunctionNames[f], &FakeHooks[Set][f], nullptr };
+		}
+	}
+
+	LARGE_INTEGER Frequency;
+	QueryPerformanceFrequency(&Frequency);
+
+	if (Csv)
+	{
+		printf("module,thunks,batch_us,per_function_us\n");
+	}
+	else
+	{
+		printf("%u-bit build, %u rounds, %u functions\n\n", (UINT)(sizeof(void *) * 8), Rounds, (UINT)FunctionCount);
+		printf("%-16s %8s %14s %14s\n", "module", "thunks", "detour_ptrs", "detour_ptr");
+	}
+
+	int Result = 0;
+	for (size_t m = 0; m < ModuleCount; m++)
+	{
+		Module& Mod = Modules[m];
+		if (!MapCopy(Mod))
+		{
+			fprintf(stderr, "iathookbench: cannot map a copy of %s (error %lu)\n", Mod.Name, GetLastError());
+			Result = 1;
+			continue;
+		}
+
+		size_t Thunks = 0;
+		double BatchUs = 0.0, LoopUs = 0.0;
+		for (UINT Round = 0; Round < Rounds; Round++)
+		{
+			LARGE_INTEGER Start, End;
+
+			// The batch hooks with one set of addresses, the loop with the other
+			QueryPerformanceCounter(&Start);
+			Thunks = Iat_hook::detour_iat_ptrs(Patches[0], FunctionCount, Mod.hModule);
+			QueryPerformanceCounter(&End);
+			BatchUs += Microseconds(Start, End, Frequency);
+
+			QueryPerformanceCounter(&Start);
+			for (size_t f = 0; f < FunctionCount; f++)
+			{
+				Iat_hook::detour_iat_ptr(Patches[1][f].function, Patches[1][f].newfunction, Mod.hModule);
+			}
+			QueryPerformanceCounter(&End);
+			LoopUs += Microseconds(Start, End, Frequency);
+		}
+
+		if (Csv)
+		{
+			printf("%s,%zu,%.2f,%.2f\n", Mod.Name, Thunks, BatchUs / Rounds, LoopUs / Rounds);
+		}
+		else
+		{
+			printf("%-16s %8zu %11.2f us %11.2f us\n", Mod.Name, Thunks, BatchUs / Rounds, LoopUs / Rounds);
+		}
+
+		FreeLibrary(Mod.hModule);
+		DeleteFileA(Mod.CopyPath);
+	}
+	return Result;
+}
@@ -0,0 +1,312 @@
+/**
+* Copyright (C) 2020 Elisha Riedlinger
+*
+* This software is  provided 'as-is', without any express  or implied  warranty. In no event will the
+* authors be held liable for any damages arising from the use of this software.
+* Permission  is granted  to anyone  to use  this software  for  any  purpose,  including  commercial
+* applications, and to alter it and redistribute it freely, subject to the following restrictions:
+*
+*   1. The origin of this software must not be misrepresented; you must not claim that you  wrote the
+*      original  software. If you use this  software  in a product, an  acknowledgment in the product
+*      documentation would be appreciated but is not required.
+*   2. Altered source versions must  be plainly  marked as such, and  must not be  misrepresented  as
+*      being the original software.
+*   3. This notice may not be removed or altered from any source distribution.
+*/
+
+// Creates and destroys fake wrappers through AddressLookupTable and through
+// the table it replaced, an std::unordered_map whose DeleteAddress scanned
+// every entry for the wrapper being destroyed:
+//
+//   g++ -std=c++17 -O2 -m32 tools/lookuptablebench.cpp -o lookuptablebench
+//   cl /std:c++17 /O2 /EHsc tools\lookuptablebench.cpp      (x86 developer prompt)
+//
+// All wrappers are created first and then destroyed in a shuffled order, as
+// a level unload releases them. The old table is quadratic in the number of
+// wrappers, so expect it to take a while at the default 100k.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+#include <chrono>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+typedef unsigned int UINT;
+
+template <size_t N, typename... A>
+int sprintf_s(char (&Buffer)[N], const char *Format, A... Args)
+{
+	return snprintf(Buffer, N, Format, Args...);
+}
+
+inline void OutputDebugStringA(const char *Message)
+{
+	fputs(Message, stderr);
+}
+#endif
+
+class m_IDirect3D8;
+class m_IDirect3DDevice8;
+class m_IDirect3DCubeTexture8;
+class m_IDirect3DIndexBuffer8;
+class m_IDirect3DSurface8;
+class m_IDirect3DSwapChain8;
+class m_IDirect3DTexture8;
+class m_IDirect3DVertexBuffer8;
+class m_IDirect3DVolume8;
+class m_IDirect3DVolumeTexture8;
+
+#include "../source/AddressLookupTable.h"
+
+namespace
+{
+	// xorshift64*, so a seed always gives the same order
+	struct Random
+	{
+		uint64_t State;
+
+		uint64_t Next()
+		{
+			State ^= State >> 12;
+			State ^= State << 25;
+			State ^= State >> 27;
+			return State * 0x2545F4914F6CDD1Dull;
+		}
+	};
+
+	struct Result
+	{
+		double CreateNs;
+		double DestroyNs;
+	};
+
+	template <typename F>
+	double TimeNs(size_t Operations, F Run)
+	{
+		const auto Start = std::chrono::steady_clock::now();
+		Run();
+		const auto Elapsed = std::chrono::steady_clock::now() - Start;
+		return (double)std::chrono::duration_cast<std::chrono::nanoseconds>(Elapsed).count() / (double)Operations;
+	}
+
+	// AddressLookupTable before it was keyed on the proxy in DeleteAddress
+	class ScanLookupTable
+	{
+	public:
+		~ScanLookupTable()
+		{
+			ConstructorFlag = true;
+
+			for (const auto& entry : g_map)
+			{
+				entry.second->DeleteMe();
+			}
+		}
+
+		template <typename T, typename D>
+		T *FindAddress(void *Proxy, D *pDevice)
+		{
+			auto it = g_map.find(Proxy);
+			if (it != std::end(g_map))
+			{
+				return static_cast<T *>(it->second);
+			}
+			return new T(Proxy, pDevice);
+		}
+
+		void SaveAddress(AddressLookupTableObject *Wrapper, void *Proxy)
+		{
+			g_map[Proxy] = Wrapper;
+		}
+
+		void DeleteAddress(AddressLookupTableObject *Wrapper)
+		{
+			if (ConstructorFlag)
+			{
+				return;
+			}
+
+			auto it = std::find_if(g_map.begin(), g_map.end(),
+				[=](auto Map) -> bool { return Map.second == Wrapper; });
+
+			if (it != std::end(g_map))
+			{
+				g_map.erase(it);
+			}
+		}
+
+	private:
+		bool ConstructorFlag = false;
+		std::unordered_map<void *, AddressLookupTableObject *> g_map;
+	};
+
+	struct FakeDevice
+	{
+		AddressLookupTable<FakeDevice> *ProxyAddressLookupTable;
+		ScanLookupTable *ScanTable;
+	};
+
+	class ScanWrapper : public AddressLookupTableObject
+	{
+	public:
+		ScanWrapper(void *Proxy, FakeDevice *pDevice) : m_pDevice(pDevice)
+		{
+			m_pDevice->ScanTable->SaveAddress(this, Proxy);
+		}
+		~ScanWrapper()
+		{
+			m_pDevice->ScanTable->DeleteAddress(this);
+		}
+
+	private:
+		FakeDevice *m_pDevice;
+	};
+}
+
+// Stands in for a surface wrapper, constructed by FindAddress as the real one is
+class m_IDirect3DSurface8 : public AddressLookupTableObject
+{
+private:
+	void *ProxyInterface;
+	FakeDevice *m_pDevice;
+
+public:
+	m_IDirect3DSurface8(m_IDirect3DSurface8 *pSurface8, FakeDevice *pDevice) : ProxyInterface(pSurface8), m_pDevice(pDevice)
+	{
+		m_pDevice->ProxyAddressLookupTable->SaveAddress(this, ProxyInterface);
+	}
+	~m_IDirect3DSurface8()
+	{
+		m_pDevice->ProxyAddressLookupTable->DeleteAddress(this, ProxyInterface);
+	}
+};
+
+namespace
+{
+	Result RunLookupTable(const std::vector<void *>& Proxies, const std::vector<size_t>& Order)
+	{
+		FakeDevice Device = {};
+		AddressLookupTable<FakeDevice> Table(&Device);
+		Device.ProxyAddressLookupTable = &Table;
+
+		std::vector<m_IDirect3DSurface8 *> Wrappers(Proxies.size());
+		Result r;
+		r.CreateNs = TimeNs(Proxies.size(), [&]()
+		{
+			for (size_t x = 0; x < Proxies.size(); x++)
+			{
+				Wrappers[x] = Table.FindAddress<m_IDirect3DSurface8>(Proxies[x]);
+			}
+		});
+		r.DestroyNs = TimeNs(Order.size(), [&]()
+		{
+			for (size_t x : Order)
+			{
+				delete Wrappers[x];
+			}
+		});
+		return r;
+	}
+
+	Result RunScanTable(const std::vector<void *>& Proxies, const std::vector<size_t>& Order)
+	{
+		FakeDevice Device = {};
+		ScanLookupTable Table;
+		Device.ScanTable = &Table;
+
+		std::vector<ScanWrapper *> Wrappers(Proxies.size());
+		Result r;
+		r.CreateNs = TimeNs(Proxies.size(), [&]()
+		{
+			for (size_t x = 0; x < Proxies.size(); x++)
+			{
+				Wrappers[x] = Table.FindAddress<ScanWrapper>(Proxies[x], &Device);
+			}
+		});
+		r.DestroyNs = TimeNs(Order.size(), [&]()
+		{
+			for (size_t x : Order)
+			{
+				delete Wrappers[x];
+			}
+		});
+		return r;
+	}
+}
+
+int main(int argc, char **argv)
+{
+	bool Csv = false;
+	size_t Count = 100000;
+	uint64_t Seed = 1;
+	for (int x = 1; x < argc; x++)
+	{
+		const bool HasValue = x + 1 < argc;
+		if (!strcmp(argv[x], "-csv"))
+		{
+			Csv = true;
+		}
+		else if (!strcmp(argv[x], "-wrappers") && HasValue)
+		{
+			Count = strtoull(argv[++x], nullptr, 10);
+		}
+		else if (!strcmp(argv[x], "-seed") && HasValue)
+		{
+			Seed = strtoull(argv[++x], nullptr, 10);
+		}
+		else
+		{
+			fprintf(stderr, "usage: lookuptablebench [-wrappers N] [-seed S] [-csv]\n");
+			return 2;
+		}
+	}
+	if (!Count)
+	{
+		fprintf(stderr, "lookuptablebench: needs at least one wrapper\n");
+		return 2;
+	}
+
+	Random Rng = { Seed * 0x9E3779B97F4A7C15ull + Count };
+
+	// Runtime objects are a few hundred bytes each
+	std::vector<void *> Proxies(Count);
+	for (void *&Proxy : Proxies)
+	{
+		Proxy = malloc(96 + (size_t)(Rng.Next() % 416));
+	}
+	std::vector<size_t> Order(Count);
+	for (size_t x = 0; x < Count; x++)
+	{
+		Order[x] = x;
+	}
+	for (size_t x = Order.size() - 1; x > 0; x--)
+	{
+		std::swap(Order[x], Order[(size_t)(Rng.Next() % (x + 1))]);
+	}
+
+	const Result Keyed = RunLookupTable(Proxies, Order);
+	const Result Scan = RunScanTable(Proxies, Order);
+	if (Csv)
+	{
+		printf("wrappers,keyed_create_ns,keyed_destroy_ns,scan_create_ns,scan_destroy_ns\n");
+		printf("%zu,%.2f,%.2f,%.2f,%.2f\n", Count, Keyed.CreateNs, Keyed.DestroyNs, Scan.CreateNs, Scan.DestroyNs);
+	}
+	else
+	{
+		printf("%u-bit build, %zu wrappers, seed %llu\n\n", (unsigned)(sizeof(void *) * 8), Count, (unsigned long long)Seed);
+		printf("%-28s %12s %12s\n", "", "create", "destroy");
+		printf("%-28s %9.2f ns %9.2f ns\n", "AddressLookupTable", Keyed.CreateNs, Keyed.DestroyNs);
+		printf("%-28s %9.2f ns %9.2f ns\n", "unordered_map + find_if", Scan.CreateNs, Scan.DestroyNs);
+	}
+
+	for (void *Proxy : Proxies)
+	{
+		free(Proxy);
+	}
+	return 0;
+}
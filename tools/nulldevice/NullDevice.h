@@ -0,0 +1,1246 @@
+#pragma once
+
+#include <string.h>
+#include <vector>
+#include <unordered_map>
+#include <d3d8.h>
+
+// Direct3D 8 runtime that draws nothing, for replaying traces through the
+// wrapper without a GPU. Every call succeeds and does as little as it can
+// while still behaving like the runtime where the wrapper relies on it:
+//  - reference counts, with texture levels sharing their texture's count and
+//    every resource holding a reference to its device
+//  - locks return memory that stays valid until the resource goes, so the
+//    wrapper can hash and copy what the game wrote
+//  - Get* calls return what was last set, so the wrapper's shadow state can
+//    be checked against it
+// Bound resources are not referenced by the device, a resource that is
+// released while bound is unbound instead. State blocks record nothing.
+namespace Null
+{
+	class Device;
+
+	template <typename I>
+	class Unknown : public I
+	{
+	public:
+		virtual ~Unknown() { }
+
+		STDMETHOD(QueryInterface)(THIS_ REFIID riid, void** ppvObj)
+		{
+			if (!ppvObj)
+			{
+				return E_POINTER;
+			}
+			if (riid == IID_IUnknown || IsInterface(riid))
+			{
+				AddRef();
+				*ppvObj = this;
+				return S_OK;
+			}
+			*ppvObj = nullptr;
+			return E_NOINTERFACE;
+		}
+		STDMETHOD_(ULONG, AddRef)(THIS)
+		{
+			return pContainer ? pContainer->AddRef() : ++Refs;
+		}
+		STDMETHOD_(ULONG, Release)(THIS)
+		{
+			if (pContainer)
+			{
+				return pContainer->Release();
+			}
+			const ULONG ref = --Refs;
+			if (ref == 0)
+			{
+				delete this;
+			}
+			return ref;
+		}
+
+	protected:
+		explicit Unknown(IUnknown *pContainer) : pContainer(pContainer) { }
+
+		virtual bool IsInterface(REFIID riid) const = 0;
+
+		ULONG Refs = 1;
+		IUnknown *pContainer;		// levels and implicit surfaces live and die with it
+	};
+
+	template <typename I, D3DRESOURCETYPE Type>
+	class Resource : public Unknown<I>
+	{
+	public:
+		~Resource();
+
+		STDMETHOD(GetDevice)(THIS_ IDirect3DDevice8** ppDevice);
+		STDMETHOD(SetPrivateData)(THIS_ REFGUID, CONST void*, DWORD, DWORD) { return D3D_OK; }
+		STDMETHOD(GetPrivateData)(THIS_ REFGUID, void*, DWORD*) { return D3DERR_NOTFOUND; }
+		STDMETHOD(FreePrivateData)(THIS_ REFGUID) { return D3DERR_NOTFOUND; }
+		STDMETHOD_(DWORD, SetPriority)(THIS_ DWORD PriorityNew) { const DWORD Old = Priority; Priority = PriorityNew; return Old; }
+		STDMETHOD_(DWORD, GetPriority)(THIS) { return Priority; }
+		STDMETHOD_(void, PreLoad)(THIS) { }
+		STDMETHOD_(D3DRESOURCETYPE, GetType)(THIS) { return Type; }
+
+	protected:
+		Resource(Device *pDevice, IUnknown *pContainer);
+
+		Device *pDevice;
+		DWORD Priority = 0;
+	};
+
+	template <typename I, D3DRESOURCETYPE Type>
+	class BaseTexture : public Resource<I, Type>
+	{
+	public:
+		STDMETHOD_(DWORD, SetLOD)(THIS_ DWORD LODNew) { const DWORD Old = LOD; LOD = LODNew; return Old; }
+		STDMETHOD_(DWORD, GetLOD)(THIS) { return LOD; }
+		STDMETHOD_(DWORD, GetLevelCount)(THIS) { return LevelCount; }
+
+	protected:
+		BaseTexture(Device *pDevice, UINT Width, UINT Height, UINT Depth, UINT Levels) : Resource<I, Type>(pDevice, nullptr)
+		{
+			// Zero asks for the whole chain down to 1x1
+			LevelCount = 1;
+			while ((Levels == 0 || LevelCount < Levels) && (Width >> LevelCount || Height >> LevelCount || Depth >> LevelCount))
+			{
+				LevelCount++;
+			}
+		}
+
+		static UINT LevelSize(UINT Size, UINT Level) { return (Size >> Level) ? (Size >> Level) : 1; }
+
+		DWORD LOD = 0;
+		DWORD LevelCount;
+	};
+
+	inline bool IsCompressed(D3DFORMAT Format)
+	{
+		return Format == D3DFMT_DXT1 || Format == D3DFMT_DXT2 || Format == D3DFMT_DXT3 || Format == D3DFMT_DXT4 || Format == D3DFMT_DXT5;
+	}
+
+	// Bytes per pixel, or per 4x4 block of a compressed format
+	inline UINT ElementSize(D3DFORMAT Format)
+	{
+		switch ((DWORD)Format)
+		{
+		case D3DFMT_DXT1:
+			return 8;
+		case D3DFMT_DXT2:
+		case D3DFMT_DXT3:
+		case D3DFMT_DXT4:
+		case D3DFMT_DXT5:
+			return 16;
+		case D3DFMT_R8G8B8:
+			return 3;
+		case D3DFMT_R5G6B5:
+		case D3DFMT_X1R5G5B5:
+		case D3DFMT_A1R5G5B5:
+		case D3DFMT_A4R4G4B4:
+		case D3DFMT_X4R4G4B4:
+		case D3DFMT_A8R3G3B2:
+		case D3DFMT_A8P8:
+		case D3DFMT_A8L8:
+		case D3DFMT_V8U8:
+		case D3DFMT_L6V5U5:
+		case D3DFMT_D16_LOCKABLE:
+		case D3DFMT_D15S1:
+		case D3DFMT_D16:
+		case D3DFMT_UYVY:
+		case D3DFMT_YUY2:
+			return 2;
+		case D3DFMT_R3G3B2:
+		case D3DFMT_A8:
+		case D3DFMT_P8:
+		case D3DFMT_L8:
+		case D3DFMT_A4L4:
+			return 1;
+		default:
+			return 4;
+		}
+	}
+
+	// Memory of a lockable surface or volume, allocated at its first lock
+	struct Storage
+	{
+		UINT RowPitch;
+		UINT Rows;
+		UINT SlicePitch;
+		std::vector<BYTE> Memory;
+
+		Storage(D3DFORMAT Format, UINT Width, UINT Height)
+		{
+			const bool Compressed = IsCompressed(Format);
+			RowPitch = (Compressed ? (Width + 3) / 4 : Width) * ElementSize(Format);
+			Rows = Compressed ? (Height + 3) / 4 : Height;
+			SlicePitch = RowPitch * Rows;
+		}
+
+		BYTE *Lock(D3DFORMAT Format, UINT Depth, UINT Left, UINT Top, UINT Front)
+		{
+			if (Memory.empty())
+			{
+				Memory.resize((size_t)SlicePitch * Depth);
+			}
+			const bool Compressed = IsCompressed(Format);
+			return Memory.data() + (size_t)Front * SlicePitch + (size_t)(Compressed ? Top / 4 : Top) * RowPitch + (size_t)(Compressed ? Left / 4 : Left) * ElementSize(Format);
+		}
+	};
+
+	class Surface : public Resource<IDirect3DSurface8, D3DRTYPE_SURFACE>
+	{
+	public:
+		Surface(Device *pDevice, IUnknown *pContainer, const D3DSURFACE_DESC& Desc) : Resource(pDevice, pContainer), Desc(Desc), Bits(Desc.Format, Desc.Width, Desc.Height) { }
+
+		STDMETHOD(GetContainer)(THIS_ REFIID riid, void** ppContainer);
+		STDMETHOD(GetDesc)(THIS_ D3DSURFACE_DESC *pDesc)
+		{
+			if (!pDesc)
+			{
+				return D3DERR_INVALIDCALL;
+			}
+			*pDesc = Desc;
+			return D3D_OK;
+		}
+		STDMETHOD(LockRect)(THIS_ D3DLOCKED_RECT* pLockedRect, CONST RECT* pRect, DWORD)
+		{
+			if (!pLockedRect)
+			{
+				return D3DERR_INVALIDCALL;
+			}
+			pLockedRect->Pitch = (INT)Bits.RowPitch;
+			pLockedRect->pBits = Bits.Lock(Desc.Format, 1, pRect ? pRect->left : 0, pRect ? pRect->top : 0, 0);
+			return D3D_OK;
+		}
+		STDMETHOD(UnlockRect)(THIS) { return D3D_OK; }
+
+	private:
+		bool IsInterface(REFIID riid) const { return riid == IID_IDirect3DSurface8; }
+
+		D3DSURFACE_DESC Desc;
+		Storage Bits;
+	};
+
+	class Volume : public Resource<IDirect3DVolume8, D3DRTYPE_VOLUME>
+	{
+	public:
+		Volume(Device *pDevice, IUnknown *pContainer, const D3DVOLUME_DESC& Desc) : Resource(pDevice, pContainer), Desc(Desc), Bits(Desc.Format, Desc.Width, Desc.Height) { }
+
+		STDMETHOD(GetContainer)(THIS_ REFIID riid, void** ppContainer)
+		{
+			return pContainer ? pContainer->QueryInterface(riid, ppContainer) : E_NOINTERFACE;
+		}
+		STDMETHOD(GetDesc)(THIS_ D3DVOLUME_DESC *pDesc)
+		{
+			if (!pDesc)
+			{
+				return D3DERR_INVALIDCALL;
+			}
+			*pDesc = Desc;
+			return D3D_OK;
+		}
+		STDMETHOD(LockBox)(THIS_ D3DLOCKED_BOX *pLockedVolume, CONST D3DBOX* pBox, DWORD)
+		{
+			if (!pLockedVolume)
+			{
+				return D3DERR_INVALIDCALL;
+			}
+			pLockedVolume->RowPitch = (INT)Bits.RowPitch;
+			pLockedVolume->SlicePitch = (INT)Bits.SlicePitch;
+			pLockedVolume->pBits = Bits.Lock(Desc.Format, Desc.Depth, pBox ? pBox->Left : 0, pBox ? pBox->Top : 0, pBox ? pBox->Front : 0);
+			return D3D_OK;
+		}
+		STDMETHOD(UnlockBox)(THIS) { return D3D_OK; }
+
+	private:
+		bool IsInterface(REFIID riid) const { return riid == IID_IDirect3DVolume8; }
+
+		D3DVOLUME_DESC Desc;
+		Storage Bits;
+	};
+
+	class Texture : public BaseTexture<IDirect3DTexture8, D3DRTYPE_TEXTURE>
+	{
+	public:
+		Texture(Device *pDevice, UINT Width, UINT Height, UINT Levels, DWORD Usage, D3DFORMAT Format, D3DPOOL Pool) : BaseTexture(pDevice, Width, Height, 1, Levels)
+		{
+			for (UINT x = 0; x < LevelCount; x++)
+			{
+				const UINT LevelWidth = LevelSize(Width, x), LevelHeight = LevelSize(Height, x);
+				const D3DSURFACE_DESC Desc = { Format, D3DRTYPE_SURFACE, Usage, Pool, LevelWidth * LevelHeight * ElementSize(Format), D3DMULTISAMPLE_NONE, LevelWidth, LevelHeight };
+				Surfaces.push_back(new Surface(pDevice, this, Desc));
+			}
+		}
+		~Texture()
+		{
+			for (Surface *pSurface : Surfaces)
+			{
+				delete pSurface;
+			}
+		}
+
+		STDMETHOD(GetLevelDesc)(THIS_ UINT Level, D3DSURFACE_DESC *pDesc)
+		{
+			return (Level < LevelCount) ? Surfaces[Level]->GetDesc(pDesc) : D3DERR_INVALIDCALL;
+		}
+		STDMETHOD(GetSurfaceLevel)(THIS_ UINT Level, IDirect3DSurface8** ppSurfaceLevel)
+		{
+			if (Level >= LevelCount || !ppSurfaceLevel)
+			{
+				return D3DERR_INVALIDCALL;
+			}
+			AddRef();
+			*ppSurfaceLevel = Surfaces[Level];
+			return D3D_OK;
+		}
+		STDMETHOD(LockRect)(THIS_ UINT Level, D3DLOCKED_RECT* pLockedRect, CONST RECT* pRect, DWORD Flags)
+		{
+			return (Level < LevelCount) ? Surfaces[Level]->LockRect(pLockedRect, pRect, Flags) : D3DERR_INVALIDCALL;
+		}
+		STDMETHOD(UnlockRect)(THIS_ UINT Level) { return (Level < LevelCount) ? D3D_OK : D3DERR_INVALIDCALL; }
+		STDMETHOD(AddDirtyRect)(THIS_ CONST RECT*) { return D3D_OK; }
+
+	private:
+		bool IsInterface(REFIID riid) const { return riid == IID_IDirect3DTexture8 || riid == IID_IDirect3DBaseTexture8 || riid == IID_IDirect3DResource8; }
+
+		std::vector<Surface *> Surfaces;
+	};
+
+	class CubeTexture : public BaseTexture<IDirect3DCubeTexture8, D3DRTYPE_CUBETEXTURE>
+	{
+	public:
+		CubeTexture(Device *pDevice, UINT EdgeLength, UINT Levels, DWORD Usage, D3DFORMAT Format, D3DPOOL Pool) : BaseTexture(pDevice, EdgeLength, EdgeLength, 1, Levels)
+		{
+			for (UINT x = 0; x < LevelCount * 6; x++)
+			{
+				const UINT Edge = LevelSize(EdgeLength, x / 6);
+				const D3DSURFACE_DESC Desc = { Format, D3DRTYPE_SURFACE, Usage, Pool, Edge * Edge * ElementSize(Format), D3DMULTISAMPLE_NONE, Edge, Edge };
+				Surfaces.push_back(new Surface(pDevice, this, Desc));
+			}
+		}
+		~CubeTexture()
+		{
+			for (Surface *pSurface : Surfaces)
+			{
+				delete pSurface;
+			}
+		}
+
+		STDMETHOD(GetLevelDesc)(THIS_ UINT Level, D3DSURFACE_DESC *pDesc)
+		{
+			return (Level < LevelCount) ? Surfaces[Level * 6]->GetDesc(pDesc) : D3DERR_INVALIDCALL;
+		}
+		STDMETHOD(GetCubeMapSurface)(THIS_ D3DCUBEMAP_FACES FaceType, UINT Level, IDirect3DSurface8** ppCubeMapSurface)
+		{
+			if (Level >= LevelCount || (UINT)FaceType >= 6 || !ppCubeMapSurface)
+			{
+				return D3DERR_INVALIDCALL;
+			}
+			AddRef();
+			*ppCubeMapSurface = Surfaces[Level * 6 + FaceType];
+			return D3D_OK;
+		}
+		STDMETHOD(LockRect)(THIS_ D3DCUBEMAP_FACES FaceType, UINT Level, D3DLOCKED_RECT* pLockedRect, CONST RECT* pRect, DWORD Flags)
+		{
+			return (Level < LevelCount && (UINT)FaceType < 6) ? Surfaces[Level * 6 + FaceType]->LockRect(pLockedRect, pRect, Flags) : D3DERR_INVALIDCALL;
+		}
+		STDMETHOD(UnlockRect)(THIS_ D3DCUBEMAP_FACES FaceType, UINT Level) { return (Level < LevelCount && (UINT)FaceType < 6) ? D3D_OK : D3DERR_INVALIDCALL; }
+		STDMETHOD(AddDirtyRect)(THIS_ D3DCUBEMAP_FACES, CONST RECT*) { return D3D_OK; }
+
+	private:
+		bool IsInterface(REFIID riid) const { return riid == IID_IDirect3DCubeTexture8 || riid == IID_IDirect3DBaseTexture8 || riid == IID_IDirect3DResource8; }
+
+		std::vector<Surface *> Surfaces;		// Level * 6 + FaceType
+	};
+
+	class VolumeTexture : public BaseTexture<IDirect3DVolumeTexture8, D3DRTYPE_VOLUMETEXTURE>
+	{
+	public:
+		VolumeTexture(Device *pDevice, UINT Width, UINT Height, UINT Depth, UINT Levels, DWORD Usage, D3DFORMAT Format, D3DPOOL Pool) : BaseTexture(pDevice, Width, Height, Depth, Levels)
+		{
+			for (UINT x = 0; x < LevelCount; x++)
+			{
+				const UINT LevelWidth = LevelSize(Width, x), LevelHeight = LevelSize(Height, x), LevelDepth = LevelSize(Depth, x);
+				const D3DVOLUME_DESC Desc = { Format, D3DRTYPE_VOLUME, Usage, Pool, LevelWidth * LevelHeight * LevelDepth * ElementSize(Format), LevelWidth, LevelHeight, LevelDepth };
+				Volumes.push_back(new Volume(pDevice, this, Desc));
+			}
+		}
+		~VolumeTexture()
+		{
+			for (Volume *pVolume : Volumes)
+			{
+				delete pVolume;
+			}
+		}
+
+		STDMETHOD(GetLevelDesc)(THIS_ UINT Level, D3DVOLUME_DESC *pDesc)
+		{
+			return (Level < LevelCount) ? Volumes[Level]->GetDesc(pDesc) : D3DERR_INVALIDCALL;
+		}
+		STDMETHOD(GetVolumeLevel)(THIS_ UINT Level, IDirect3DVolume8** ppVolumeLevel)
+		{
+			if (Level >= LevelCount || !ppVolumeLevel)
+			{
+				return D3DERR_INVALIDCALL;
+			}
+			AddRef();
+			*ppVolumeLevel = Volumes[Level];
+			return D3D_OK;
+		}
+		STDMETHOD(LockBox)(THIS_ UINT Level, D3DLOCKED_BOX* pLockedVolume, CONST D3DBOX* pBox, DWORD Flags)
+		{
+			return (Level < LevelCount) ? Volumes[Level]->LockBox(pLockedVolume, pBox, Flags) : D3DERR_INVALIDCALL;
+		}
+		STDMETHOD(UnlockBox)(THIS_ UINT Level) { return (Level < LevelCount) ? D3D_OK : D3DERR_INVALIDCALL; }
+		STDMETHOD(AddDirtyBox)(THIS_ CONST D3DBOX*) { return D3D_OK; }
+
+	private:
+		bool IsInterface(REFIID riid) const { return riid == IID_IDirect3DVolumeTexture8 || riid == IID_IDirect3DBaseTexture8 || riid == IID_IDirect3DResource8; }
+
+		std::vector<Volume *> Volumes;
+	};
+
+	template <typename I, D3DRESOURCETYPE Type, typename Desc_t>
+	class Buffer : public Resource<I, Type>
+	{
+	public:
+		STDMETHOD(Lock)(THIS_ UINT OffsetToLock, UINT SizeToLock, BYTE** ppbData, DWORD)
+		{
+			if (!ppbData || OffsetToLock > Memory.size() || SizeToLock > Memory.size() - OffsetToLock)
+			{
+				return D3DERR_INVALIDCALL;
+			}
+			*ppbData = Memory.data() + OffsetToLock;
+			return D3D_OK;
+		}
+		STDMETHOD(Unlock)(THIS) { return D3D_OK; }
+		STDMETHOD(GetDesc)(THIS_ Desc_t *pDesc)
+		{
+			if (!pDesc)
+			{
+				return D3DERR_INVALIDCALL;
+			}
+			*pDesc = Desc;
+			return D3D_OK;
+		}
+
+	protected:
+		Buffer(Device *pDevice, const Desc_t& Desc) : Resource<I, Type>(pDevice, nullptr), Desc(Desc), Memory(Desc.Size) { }
+
+		Desc_t Desc;
+		std::vector<BYTE> Memory;
+	};
+
+	class VertexBuffer : public Buffer<IDirect3DVertexBuffer8, D3DRTYPE_VERTEXBUFFER, D3DVERTEXBUFFER_DESC>
+	{
+	public:
+		VertexBuffer(Device *pDevice, UINT Length, DWORD Usage, DWORD FVF, D3DPOOL Pool) : Buffer(pDevice, { D3DFMT_VERTEXDATA, D3DRTYPE_VERTEXBUFFER, Usage, Pool, Length, FVF }) { }
+
+	private:
+		bool IsInterface(REFIID riid) const { return riid == IID_IDirect3DVertexBuffer8 || riid == IID_IDirect3DResource8; }
+	};
+
+	class IndexBuffer : public Buffer<IDirect3DIndexBuffer8, D3DRTYPE_INDEXBUFFER, D3DINDEXBUFFER_DESC>
+	{
+	public:
+		IndexBuffer(Device *pDevice, UINT Length, DWORD Usage, D3DFORMAT Format, D3DPOOL Pool) : Buffer(pDevice, { Format, D3DRTYPE_INDEXBUFFER, Usage, Pool, Length }) { }
+
+	private:
+		bool IsInterface(REFIID riid) const { return riid == IID_IDirect3DIndexBuffer8 || riid == IID_IDirect3DResource8; }
+	};
+
+	class SwapChain : public Unknown<IDirect3DSwapChain8>
+	{
+	public:
+		SwapChain(Device *pDevice, const D3DPRESENT_PARAMETERS& Parameters);
+		~SwapChain();
+
+		STDMETHOD(Present)(THIS_ CONST RECT*, CONST RECT*, HWND, CONST RGNDATA*) { return D3D_OK; }
+		STDMETHOD(GetBackBuffer)(THIS_ UINT BackBuffer, D3DBACKBUFFER_TYPE, IDirect3DSurface8** ppBackBuffer)
+		{
+			if (BackBuffer != 0 || !ppBackBuffer)
+			{
+				return D3DERR_INVALIDCALL;
+			}
+			pBackBuffer->AddRef();
+			*ppBackBuffer = pBackBuffer;
+			return D3D_OK;
+		}
+
+	private:
+		bool IsInterface(REFIID riid) const { return riid == IID_IDirect3DSwapChain8; }
+
+		Device *pDevice;
+		Surface *pBackBuffer;
+	};
+
+	class Direct3D : public Unknown<IDirect3D8>
+	{
+	public:
+		Direct3D() : Unknown(nullptr) { }
+
+		STDMETHOD(RegisterSoftwareDevice)(THIS_ void*) { return D3D_OK; }
+		STDMETHOD_(UINT, GetAdapterCount)(THIS) { return 1; }
+		STDMETHOD(GetAdapterIdentifier)(THIS_ UINT Adapter, DWORD, D3DADAPTER_IDENTIFIER8* pIdentifier)
+		{
+			if (Adapter != 0 || !pIdentifier)
+			{
+				return D3DERR_INVALIDCALL;
+			}
+			*pIdentifier = {};
+			strcpy(pIdentifier->Driver, "null");
+			strcpy(pIdentifier->Description, "Null Direct3D 8 device");
+			return D3D_OK;
+		}
+		STDMETHOD_(UINT, GetAdapterModeCount)(THIS_ UINT Adapter) { return (Adapter == 0) ? (UINT)_countof(Modes) : 0; }
+		STDMETHOD(EnumAdapterModes)(THIS_ UINT Adapter, UINT Mode, D3DDISPLAYMODE* pMode)
+		{
+			if (Adapter != 0 || Mode >= _countof(Modes) || !pMode)
+			{
+				return D3DERR_INVALIDCALL;
+			}
+			*pMode = Modes[Mode];
+			return D3D_OK;
+		}
+		STDMETHOD(GetAdapterDisplayMode)(THIS_ UINT Adapter, D3DDISPLAYMODE* pMode) { return EnumAdapterModes(Adapter, _countof(Modes) - 1, pMode); }
+		STDMETHOD(CheckDeviceType)(THIS_ UINT, D3DDEVTYPE, D3DFORMAT, D3DFORMAT, BOOL) { return D3D_OK; }
+		STDMETHOD(CheckDeviceFormat)(THIS_ UINT, D3DDEVTYPE, D3DFORMAT, DWORD, D3DRESOURCETYPE, D3DFORMAT) { return D3D_OK; }
+		STDMETHOD(CheckDeviceMultiSampleType)(THIS_ UINT, D3DDEVTYPE, D3DFORMAT, BOOL, D3DMULTISAMPLE_TYPE) { return D3D_OK; }
+		STDMETHOD(CheckDepthStencilMatch)(THIS_ UINT, D3DDEVTYPE, D3DFORMAT, D3DFORMAT, D3DFORMAT) { return D3D_OK; }
+		STDMETHOD(GetDeviceCaps)(THIS_ UINT Adapter, D3DDEVTYPE DeviceType, D3DCAPS8* pCaps)
+		{
+			if (Adapter != 0 || !pCaps)
+			{
+				return D3DERR_INVALIDCALL;
+			}
+			*pCaps = {};
+			pCaps->DeviceType = DeviceType;
+			pCaps->Caps2 = D3DCAPS2_DYNAMICTEXTURES | D3DCAPS2_FULLSCREENGAMMA;
+			pCaps->DevCaps = D3DDEVCAPS_HWTRANSFORMANDLIGHT | D3DDEVCAPS_DRAWPRIMTLVERTEX | D3DDEVCAPS_HWRASTERIZATION;
+			pCaps->TextureCaps = D3DPTEXTURECAPS_MIPMAP | D3DPTEXTURECAPS_CUBEMAP | D3DPTEXTURECAPS_VOLUMEMAP | D3DPTEXTURECAPS_ALPHA;
+			pCaps->MaxTextureWidth = pCaps->MaxTextureHeight = 4096;
+			pCaps->MaxVolumeExtent = 512;
+			pCaps->MaxTextureBlendStages = pCaps->MaxSimultaneousTextures = 8;
+			pCaps->MaxActiveLights = 8;
+			pCaps->MaxUserClipPlanes = 6;
+			pCaps->MaxVertexBlendMatrices = 4;
+			pCaps->MaxPrimitiveCount = 0xFFFFF;
+			pCaps->MaxVertexIndex = 0xFFFFFF;
+			pCaps->MaxStreams = 16;
+			pCaps->MaxStreamStride = 255;
+			pCaps->VertexShaderVersion = D3DVS_VERSION(1, 1);
+			pCaps->MaxVertexShaderConst = 96;
+			pCaps->PixelShaderVersion = D3DPS_VERSION(1, 4);
+			pCaps->MaxPixelShaderValue = 8.0f;
+			pCaps->MaxPointSize = 64.0f;
+			return D3D_OK;
+		}
+		STDMETHOD_(HMONITOR, GetAdapterMonitor)(THIS_ UINT) { return nullptr; }
+		STDMETHOD(CreateDevice)(THIS_ UINT Adapter, D3DDEVTYPE DeviceType, HWND hFocusWindow, DWORD BehaviorFlags, D3DPRESENT_PARAMETERS* pPresentationParameters, IDirect3DDevice8** ppReturnedDeviceInterface);
+
+	private:
+		bool IsInterface(REFIID riid) const { return riid == IID_IDirect3D8; }
+
+		static constexpr D3DDISPLAYMODE Modes[] = {
+			{ 640, 480, 60, D3DFMT_X8R8G8B8 }, { 800, 600, 60, D3DFMT_X8R8G8B8 }, { 1024, 768, 60, D3DFMT_X8R8G8B8 },
+			{ 1280, 720, 60, D3DFMT_X8R8G8B8 }, { 1280, 1024, 60, D3DFMT_X8R8G8B8 }, { 1920, 1080, 60, D3DFMT_X8R8G8B8 },
+		};
+	};
+
+	class Device : public Unknown<IDirect3DDevice8>
+	{
+	public:
+		Device(Direct3D *pD3D, const D3DDEVICE_CREATION_PARAMETERS& Creation, const D3DPRESENT_PARAMETERS& Parameters) : Unknown(nullptr), pD3D(pD3D), Creation(Creation)
+		{
+			pD3D->AddRef();
+			CreateImplicitSurfaces(Parameters);
+			SetDefaultState();
+		}
+		~Device()
+		{
+			delete pBackBuffer;
+			delete pDepthStencil;
+			pD3D->Release();
+		}
+
+		// A resource is going away, nothing may point at it afterwards
+		void Forget(IUnknown *pResource)
+		{
+			for (IDirect3DBaseTexture8 *&pTexture : Textures)
+			{
+				if (pTexture == pResource)
+				{
+					pTexture = nullptr;
+				}
+			}
+			for (Stream& Source : Streams)
+			{
+				if (Source.pBuffer == pResource)
+				{
+					Source = {};
+				}
+			}
+			if (pIndices == pResource)
+			{
+				pIndices = nullptr;
+			}
+			if (pRenderTarget == pResource)
+			{
+				pRenderTarget = pBackBuffer;
+			}
+			if (pZStencil == pResource)
+			{
+				pZStencil = pDepthStencil;
+			}
+		}
+
+		STDMETHOD(TestCooperativeLevel)(THIS) { return D3D_OK; }
+		STDMETHOD_(UINT, GetAvailableTextureMem)(THIS) { return 256 << 20; }
+		STDMETHOD(ResourceManagerDiscardBytes)(THIS_ DWORD) { return D3D_OK; }
+		STDMETHOD(GetDirect3D)(THIS_ IDirect3D8** ppD3D8)
+		{
+			if (!ppD3D8)
+			{
+				return D3DERR_INVALIDCALL;
+			}
+			pD3D->AddRef();
+			*ppD3D8 = pD3D;
+			return D3D_OK;
+		}
+		STDMETHOD(GetDeviceCaps)(THIS_ D3DCAPS8* pCaps) { return pD3D->GetDeviceCaps(Creation.AdapterOrdinal, Creation.DeviceType, pCaps); }
+		STDMETHOD(GetDisplayMode)(THIS_ D3DDISPLAYMODE* pMode) { return pD3D->GetAdapterDisplayMode(Creation.AdapterOrdinal, pMode); }
+		STDMETHOD(GetCreationParameters)(THIS_ D3DDEVICE_CREATION_PARAMETERS *pParameters)
+		{
+			if (!pParameters)
+			{
+				return D3DERR_INVALIDCALL;
+			}
+			*pParameters = Creation;
+			return D3D_OK;
+		}
+		STDMETHOD(SetCursorProperties)(THIS_ UINT, UINT, IDirect3DSurface8*) { return D3D_OK; }
+		STDMETHOD_(void, SetCursorPosition)(THIS_ UINT, UINT, DWORD) { }
+		STDMETHOD_(BOOL, ShowCursor)(THIS_ BOOL bShow) { const BOOL Old = CursorShown; CursorShown = bShow; return Old; }
+		STDMETHOD(CreateAdditionalSwapChain)(THIS_ D3DPRESENT_PARAMETERS* pPresentationParameters, IDirect3DSwapChain8** pSwapChain)
+		{
+			if (!pPresentationParameters || !pSwapChain)
+			{
+				return D3DERR_INVALIDCALL;
+			}
+			*pSwapChain = new SwapChain(this, *pPresentationParameters);
+			return D3D_OK;
+		}
+		STDMETHOD(Reset)(THIS_ D3DPRESENT_PARAMETERS* pPresentationParameters)
+		{
+			if (!pPresentationParameters)
+			{
+				return D3DERR_INVALIDCALL;
+			}
+			delete pBackBuffer;
+			delete pDepthStencil;
+			CreateImplicitSurfaces(*pPresentationParameters);
+			SetDefaultState();
+			return D3D_OK;
+		}
+		STDMETHOD(Present)(THIS_ CONST RECT*, CONST RECT*, HWND, CONST RGNDATA*) { return D3D_OK; }
+		STDMETHOD(GetBackBuffer)(THIS_ UINT BackBuffer, D3DBACKBUFFER_TYPE, IDirect3DSurface8** ppBackBuffer) { return BackBuffer == 0 ? GetSurface(pBackBuffer, ppBackBuffer) : D3DERR_INVALIDCALL; }
+		STDMETHOD(GetRasterStatus)(THIS_ D3DRASTER_STATUS* pRasterStatus)
+		{
+			if (!pRasterStatus)
+			{
+				return D3DERR_INVALIDCALL;
+			}
+			*pRasterStatus = {};
+			return D3D_OK;
+		}
+		STDMETHOD_(void, SetGammaRamp)(THIS_ DWORD, CONST D3DGAMMARAMP* pRamp) { if (pRamp) GammaRamp = *pRamp; }
+		STDMETHOD_(void, GetGammaRamp)(THIS_ D3DGAMMARAMP* pRamp) { if (pRamp) *pRamp = GammaRamp; }
+		STDMETHOD(CreateTexture)(THIS_ UINT Width, UINT Height, UINT Levels, DWORD Usage, D3DFORMAT Format, D3DPOOL Pool, IDirect3DTexture8** ppTexture)
+		{
+			return Create(ppTexture, Width && Height, [&]() { return new Texture(this, Width, Height, Levels, Usage, Format, Pool); });
+		}
+		STDMETHOD(CreateVolumeTexture)(THIS_ UINT Width, UINT Height, UINT Depth, UINT Levels, DWORD Usage, D3DFORMAT Format, D3DPOOL Pool, IDirect3DVolumeTexture8** ppVolumeTexture)
+		{
+			return Create(ppVolumeTexture, Width && Height && Depth, [&]() { return new VolumeTexture(this, Width, Height, Depth, Levels, Usage, Format, Pool); });
+		}
+		STDMETHOD(CreateCubeTexture)(THIS_ UINT EdgeLength, UINT Levels, DWORD Usage, D3DFORMAT Format, D3DPOOL Pool, IDirect3DCubeTexture8** ppCubeTexture)
+		{
+			return Create(ppCubeTexture, EdgeLength != 0, [&]() { return new CubeTexture(this, EdgeLength, Levels, Usage, Format, Pool); });
+		}
+		STDMETHOD(CreateVertexBuffer)(THIS_ UINT Length, DWORD Usage, DWORD FVF, D3DPOOL Pool, IDirect3DVertexBuffer8** ppVertexBuffer)
+		{
+			return Create(ppVertexBuffer, Length != 0, [&]() { return new VertexBuffer(this, Length, Usage, FVF, Pool); });
+		}
+		STDMETHOD(CreateIndexBuffer)(THIS_ UINT Length, DWORD Usage, D3DFORMAT Format, D3DPOOL Pool, IDirect3DIndexBuffer8** ppIndexBuffer)
+		{
+			return Create(ppIndexBuffer, Length != 0, [&]() { return new IndexBuffer(this, Length, Usage, Format, Pool); });
+		}
+		STDMETHOD(CreateRenderTarget)(THIS_ UINT Width, UINT Height, D3DFORMAT Format, D3DMULTISAMPLE_TYPE MultiSample, BOOL, IDirect3DSurface8** ppSurface)
+		{
+			return CreateSurface(ppSurface, Width, Height, Format, D3DUSAGE_RENDERTARGET, D3DPOOL_DEFAULT, MultiSample);
+		}
+		STDMETHOD(CreateDepthStencilSurface)(THIS_ UINT Width, UINT Height, D3DFORMAT Format, D3DMULTISAMPLE_TYPE MultiSample, IDirect3DSurface8** ppSurface)
+		{
+			return CreateSurface(ppSurface, Width, Height, Format, D3DUSAGE_DEPTHSTENCIL, D3DPOOL_DEFAULT, MultiSample);
+		}
+		STDMETHOD(CreateImageSurface)(THIS_ UINT Width, UINT Height, D3DFORMAT Format, IDirect3DSurface8** ppSurface)
+		{
+			return CreateSurface(ppSurface, Width, Height, Format, 0, D3DPOOL_SYSTEMMEM, D3DMULTISAMPLE_NONE);
+		}
+		STDMETHOD(CopyRects)(THIS_ IDirect3DSurface8* pSourceSurface, CONST RECT*, UINT, IDirect3DSurface8* pDestinationSurface, CONST POINT*)
+		{
+			return (pSourceSurface && pDestinationSurface) ? D3D_OK : D3DERR_INVALIDCALL;
+		}
+		STDMETHOD(UpdateTexture)(THIS_ IDirect3DBaseTexture8* pSourceTexture, IDirect3DBaseTexture8* pDestinationTexture)
+		{
+			return (pSourceTexture && pDestinationTexture) ? D3D_OK : D3DERR_INVALIDCALL;
+		}
+		STDMETHOD(GetFrontBuffer)(THIS_ IDirect3DSurface8* pDestSurface) { return pDestSurface ? D3D_OK : D3DERR_INVALIDCALL; }
+		STDMETHOD(SetRenderTarget)(THIS_ IDirect3DSurface8* pNewRenderTarget, IDirect3DSurface8* pNewZStencil)
+		{
+			if (pNewRenderTarget)
+			{
+				pRenderTarget = pNewRenderTarget;
+			}
+			pZStencil = pNewZStencil;
+			return D3D_OK;
+		}
+		STDMETHOD(GetRenderTarget)(THIS_ IDirect3DSurface8** ppRenderTarget) { return GetSurface(pRenderTarget, ppRenderTarget); }
+		STDMETHOD(GetDepthStencilSurface)(THIS_ IDirect3DSurface8** ppZStencilSurface) { return pZStencil ? GetSurface(pZStencil, ppZStencilSurface) : D3DERR_NOTFOUND; }
+		STDMETHOD(BeginScene)(THIS) { return D3D_OK; }
+		STDMETHOD(EndScene)(THIS) { return D3D_OK; }
+		STDMETHOD(Clear)(THIS_ DWORD, CONST D3DRECT*, DWORD, D3DCOLOR, float, DWORD) { return D3D_OK; }
+		STDMETHOD(SetTransform)(THIS_ D3DTRANSFORMSTATETYPE State, CONST D3DMATRIX* pMatrix)
+		{
+			if ((UINT)State >= _countof(Transforms) || !pMatrix)
+			{
+				return D3DERR_INVALIDCALL;
+			}
+			Transforms[State] = *pMatrix;
+			return D3D_OK;
+		}
+		STDMETHOD(GetTransform)(THIS_ D3DTRANSFORMSTATETYPE State, D3DMATRIX* pMatrix)
+		{
+			if ((UINT)State >= _countof(Transforms) || !pMatrix)
+			{
+				return D3DERR_INVALIDCALL;
+			}
+			*pMatrix = Transforms[State];
+			return D3D_OK;
+		}
+		STDMETHOD(MultiplyTransform)(THIS_ D3DTRANSFORMSTATETYPE State, CONST D3DMATRIX* pMatrix)
+		{
+			if ((UINT)State >= _countof(Transforms) || !pMatrix)
+			{
+				return D3DERR_INVALIDCALL;
+			}
+			D3DMATRIX Product;
+			for (int r = 0; r < 4; r++)
+			{
+				for (int c = 0; c < 4; c++)
+				{
+					Product.m[r][c] = 0.0f;
+					for (int k = 0; k < 4; k++)
+					{
+						Product.m[r][c] += pMatrix->m[r][k] * Transforms[State].m[k][c];
+					}
+				}
+			}
+			Transforms[State] = Product;
+			return D3D_OK;
+		}
+		STDMETHOD(SetViewport)(THIS_ CONST D3DVIEWPORT8* pViewport) { return Set(Viewport, pViewport); }
+		STDMETHOD(GetViewport)(THIS_ D3DVIEWPORT8* pViewport) { return Get(Viewport, pViewport); }
+		STDMETHOD(SetMaterial)(THIS_ CONST D3DMATERIAL8* pMaterial) { return Set(Material, pMaterial); }
+		STDMETHOD(GetMaterial)(THIS_ D3DMATERIAL8* pMaterial) { return Get(Material, pMaterial); }
+		STDMETHOD(SetLight)(THIS_ DWORD Index, CONST D3DLIGHT8* pLight)
+		{
+			if (!pLight)
+			{
+				return D3DERR_INVALIDCALL;
+			}
+			if (Index >= Lights.size())
+			{
+				Lights.resize(Index + 1);
+			}
+			Lights[Index].Light = *pLight;
+			Lights[Index].Set = true;
+			return D3D_OK;
+		}
+		STDMETHOD(GetLight)(THIS_ DWORD Index, D3DLIGHT8* pLight)
+		{
+			if (Index >= Lights.size() || !Lights[Index].Set || !pLight)
+			{
+				return D3DERR_INVALIDCALL;
+			}
+			*pLight = Lights[Index].Light;
+			return D3D_OK;
+		}
+		STDMETHOD(LightEnable)(THIS_ DWORD Index, BOOL Enable)
+		{
+			// Enabling a light that was never set gives it the default light
+			if (Index >= Lights.size())
+			{
+				Lights.resize(Index + 1);
+			}
+			if (!Lights[Index].Set)
+			{
+				Lights[Index].Light = {};
+				Lights[Index].Light.Type = D3DLIGHT_DIRECTIONAL;
+				Lights[Index].Light.Diffuse = { 1.0f, 1.0f, 1.0f, 0.0f };
+				Lights[Index].Light.Direction = { 0.0f, 0.0f, 1.0f };
+				Lights[Index].Set = true;
+			}
+			Lights[Index].Enabled = Enable;
+			return D3D_OK;
+		}
+		STDMETHOD(GetLightEnable)(THIS_ DWORD Index, BOOL* pEnable)
+		{
+			if (Index >= Lights.size() || !Lights[Index].Set || !pEnable)
+			{
+				return D3DERR_INVALIDCALL;
+			}
+			*pEnable = Lights[Index].Enabled;
+			return D3D_OK;
+		}
+		STDMETHOD(SetClipPlane)(THIS_ DWORD Index, CONST float* pPlane)
+		{
+			if (Index >= _countof(ClipPlanes) || !pPlane)
+			{
+				return D3DERR_INVALIDCALL;
+			}
+			memcpy(ClipPlanes[Index], pPlane, sizeof(ClipPlanes[Index]));
+			return D3D_OK;
+		}
+		STDMETHOD(GetClipPlane)(THIS_ DWORD Index, float* pPlane)
+		{
+			if (Index >= _countof(ClipPlanes) || !pPlane)
+			{
+				return D3DERR_INVALIDCALL;
+			}
+			memcpy(pPlane, ClipPlanes[Index], sizeof(ClipPlanes[Index]));
+			return D3D_OK;
+		}
+		STDMETHOD(SetRenderState)(THIS_ D3DRENDERSTATETYPE State, DWORD Value)
+		{
+			if ((UINT)State >= _countof(RenderStates))
+			{
+				return D3DERR_INVALIDCALL;
+			}
+			RenderStates[State] = Value;
+			return D3D_OK;
+		}
+		STDMETHOD(GetRenderState)(THIS_ D3DRENDERSTATETYPE State, DWORD* pValue)
+		{
+			if ((UINT)State >= _countof(RenderStates) || !pValue)
+			{
+				return D3DERR_INVALIDCALL;
+			}
+			*pValue = RenderStates[State];
+			return D3D_OK;
+		}
+		STDMETHOD(BeginStateBlock)(THIS) { return D3D_OK; }
+		STDMETHOD(EndStateBlock)(THIS_ DWORD* pToken) { return NewHandle(NextStateBlock, pToken); }
+		STDMETHOD(ApplyStateBlock)(THIS_ DWORD) { return D3D_OK; }
+		STDMETHOD(CaptureStateBlock)(THIS_ DWORD) { return D3D_OK; }
+		STDMETHOD(DeleteStateBlock)(THIS_ DWORD) { return D3D_OK; }
+		STDMETHOD(CreateStateBlock)(THIS_ D3DSTATEBLOCKTYPE, DWORD* pToken) { return NewHandle(NextStateBlock, pToken); }
+		STDMETHOD(SetClipStatus)(THIS_ CONST D3DCLIPSTATUS8* pClipStatus) { return Set(ClipStatus, pClipStatus); }
+		STDMETHOD(GetClipStatus)(THIS_ D3DCLIPSTATUS8* pClipStatus) { return Get(ClipStatus, pClipStatus); }
+		STDMETHOD(GetTexture)(THIS_ DWORD Stage, IDirect3DBaseTexture8** ppTexture)
+		{
+			if (Stage >= _countof(Textures) || !ppTexture)
+			{
+				return D3DERR_INVALIDCALL;
+			}
+			*ppTexture = Textures[Stage];
+			if (*ppTexture)
+			{
+				(*ppTexture)->AddRef();
+			}
+			return D3D_OK;
+		}
+		STDMETHOD(SetTexture)(THIS_ DWORD Stage, IDirect3DBaseTexture8* pTexture)
+		{
+			if (Stage >= _countof(Textures))
+			{
+				return D3DERR_INVALIDCALL;
+			}
+			Textures[Stage] = pTexture;
+			return D3D_OK;
+		}
+		STDMETHOD(GetTextureStageState)(THIS_ DWORD Stage, D3DTEXTURESTAGESTATETYPE Type, DWORD* pValue)
+		{
+			if (Stage >= _countof(TextureStates) || (UINT)Type >= _countof(TextureStates[0]) || !pValue)
+			{
+				return D3DERR_INVALIDCALL;
+			}
+			*pValue = TextureStates[Stage][Type];
+			return D3D_OK;
+		}
+		STDMETHOD(SetTextureStageState)(THIS_ DWORD Stage, D3DTEXTURESTAGESTATETYPE Type, DWORD Value)
+		{
+			if (Stage >= _countof(TextureStates) || (UINT)Type >= _countof(TextureStates[0]))
+			{
+				return D3DERR_INVALIDCALL;
+			}
+			TextureStates[Stage][Type] = Value;
+			return D3D_OK;
+		}
+		STDMETHOD(ValidateDevice)(THIS_ DWORD* pNumPasses)
+		{
+			if (!pNumPasses)
+			{
+				return D3DERR_INVALIDCALL;
+			}
+			*pNumPasses = 1;
+			return D3D_OK;
+		}
+		STDMETHOD(GetInfo)(THIS_ DWORD, void*, DWORD) { return S_FALSE; }
+		STDMETHOD(SetPaletteEntries)(THIS_ UINT PaletteNumber, CONST PALETTEENTRY* pEntries)
+		{
+			if (!pEntries)
+			{
+				return D3DERR_INVALIDCALL;
+			}
+			if (PaletteNumber >= Palettes.size())
+			{
+				Palettes.resize(PaletteNumber + 1);
+			}
+			memcpy(Palettes[PaletteNumber].Entries, pEntries, sizeof(Palettes[PaletteNumber].Entries));
+			return D3D_OK;
+		}
+		STDMETHOD(GetPaletteEntries)(THIS_ UINT PaletteNumber, PALETTEENTRY* pEntries)
+		{
+			if (PaletteNumber >= Palettes.size() || !pEntries)
+			{
+				return D3DERR_INVALIDCALL;
+			}
+			memcpy(pEntries, Palettes[PaletteNumber].Entries, sizeof(Palettes[PaletteNumber].Entries));
+			return D3D_OK;
+		}
+		STDMETHOD(SetCurrentTexturePalette)(THIS_ UINT PaletteNumber) { CurrentPalette = PaletteNumber; return D3D_OK; }
+		STDMETHOD(GetCurrentTexturePalette)(THIS_ UINT *PaletteNumber) { return Get(CurrentPalette, PaletteNumber); }
+		STDMETHOD(DrawPrimitive)(THIS_ D3DPRIMITIVETYPE, UINT, UINT) { return D3D_OK; }
+		STDMETHOD(DrawIndexedPrimitive)(THIS_ D3DPRIMITIVETYPE, UINT, UINT, UINT, UINT) { return D3D_OK; }
+		STDMETHOD(DrawPrimitiveUP)(THIS_ D3DPRIMITIVETYPE, UINT, CONST void* pVertexStreamZeroData, UINT)
+		{
+			// Like the runtime, a UP draw leaves stream 0 and the indices unset
+			Streams[0] = {};
+			return pVertexStreamZeroData ? D3D_OK : D3DERR_INVALIDCALL;
+		}
+		STDMETHOD(DrawIndexedPrimitiveUP)(THIS_ D3DPRIMITIVETYPE, UINT, UINT, UINT, CONST void* pIndexData, D3DFORMAT, CONST void* pVertexStreamZeroData, UINT)
+		{
+			Streams[0] = {};
+			pIndices = nullptr;
+			return (pIndexData && pVertexStreamZeroData) ? D3D_OK : D3DERR_INVALIDCALL;
+		}
+		STDMETHOD(ProcessVertices)(THIS_ UINT, UINT, UINT, IDirect3DVertexBuffer8* pDestBuffer, DWORD) { return pDestBuffer ? D3D_OK : D3DERR_INVALIDCALL; }
+		STDMETHOD(CreateVertexShader)(THIS_ CONST DWORD* pDeclaration, CONST DWORD*, DWORD* pHandle, DWORD)
+		{
+			// FVF codes are passed where shader handles go, so handles stay clear of them
+			return pDeclaration ? NewHandle(NextVertexShader, pHandle) : D3DERR_INVALIDCALL;
+		}
+		STDMETHOD(SetVertexShader)(THIS_ DWORD Handle) { VertexShader = Handle; return D3D_OK; }
+		STDMETHOD(GetVertexShader)(THIS_ DWORD* pHandle) { return Get(VertexShader, pHandle); }
+		STDMETHOD(DeleteVertexShader)(THIS_ DWORD) { return D3D_OK; }
+		STDMETHOD(SetVertexShaderConstant)(THIS_ DWORD Register, CONST void* pConstantData, DWORD ConstantCount) { return SetConstants(VertexConstants, Register, pConstantData, ConstantCount); }
+		STDMETHOD(GetVertexShaderConstant)(THIS_ DWORD Register, void* pConstantData, DWORD ConstantCount) { return GetConstants(VertexConstants, Register, pConstantData, ConstantCount); }
+		STDMETHOD(GetVertexShaderDeclaration)(THIS_ DWORD, void*, DWORD* pSizeOfData) { return GetEmpty(pSizeOfData); }
+		STDMETHOD(GetVertexShaderFunction)(THIS_ DWORD, void*, DWORD* pSizeOfData) { return GetEmpty(pSizeOfData); }
+		STDMETHOD(SetStreamSource)(THIS_ UINT StreamNumber, IDirect3DVertexBuffer8* pStreamData, UINT Stride)
+		{
+			if (StreamNumber >= _countof(Streams))
+			{
+				return D3DERR_INVALIDCALL;
+			}
+			Streams[StreamNumber] = { pStreamData, Stride };
+			return D3D_OK;
+		}
+		STDMETHOD(GetStreamSource)(THIS_ UINT StreamNumber, IDirect3DVertexBuffer8** ppStreamData, UINT* pStride)
+		{
+			if (StreamNumber >= _countof(Streams) || !ppStreamData || !pStride)
+			{
+				return D3DERR_INVALIDCALL;
+			}
+			*ppStreamData = Streams[StreamNumber].pBuffer;
+			*pStride = Streams[StreamNumber].Stride;
+			if (*ppStreamData)
+			{
+				(*ppStreamData)->AddRef();
+			}
+			return D3D_OK;
+		}
+		STDMETHOD(SetIndices)(THIS_ IDirect3DIndexBuffer8* pIndexData, UINT BaseVertexIndex)
+		{
+			pIndices = pIndexData;
+			BaseVertex = BaseVertexIndex;
+			return D3D_OK;
+		}
+		STDMETHOD(GetIndices)(THIS_ IDirect3DIndexBuffer8** ppIndexData, UINT* pBaseVertexIndex)
+		{
+			if (!ppIndexData || !pBaseVertexIndex)
+			{
+				return D3DERR_INVALIDCALL;
+			}
+			*ppIndexData = pIndices;
+			*pBaseVertexIndex = BaseVertex;
+			if (*ppIndexData)
+			{
+				(*ppIndexData)->AddRef();
+			}
+			return D3D_OK;
+		}
+		STDMETHOD(CreatePixelShader)(THIS_ CONST DWORD* pFunction, DWORD* pHandle) { return pFunction ? NewHandle(NextPixelShader, pHandle) : D3DERR_INVALIDCALL; }
+		STDMETHOD(SetPixelShader)(THIS_ DWORD Handle) { PixelShader = Handle; return D3D_OK; }
+		STDMETHOD(GetPixelShader)(THIS_ DWORD* pHandle) { return Get(PixelShader, pHandle); }
+		STDMETHOD(DeletePixelShader)(THIS_ DWORD) { return D3D_OK; }
+		STDMETHOD(SetPixelShaderConstant)(THIS_ DWORD Register, CONST void* pConstantData, DWORD ConstantCount) { return SetConstants(PixelConstants, Register, pConstantData, ConstantCount); }
+		STDMETHOD(GetPixelShaderConstant)(THIS_ DWORD Register, void* pConstantData, DWORD ConstantCount) { return GetConstants(PixelConstants, Register, pConstantData, ConstantCount); }
+		STDMETHOD(GetPixelShaderFunction)(THIS_ DWORD, void*, DWORD* pSizeOfData) { return GetEmpty(pSizeOfData); }
+		STDMETHOD(DrawRectPatch)(THIS_ UINT, CONST float*, CONST D3DRECTPATCH_INFO*) { return D3D_OK; }
+		STDMETHOD(DrawTriPatch)(THIS_ UINT, CONST float*, CONST D3DTRIPATCH_INFO*) { return D3D_OK; }
+		STDMETHOD(DeletePatch)(THIS_ UINT) { return D3D_OK; }
+
+	private:
+		bool IsInterface(REFIID riid) const { return riid == IID_IDirect3DDevice8; }
+
+		template <typename I, typename F>
+		HRESULT Create(I **ppObject, bool Valid, F New)
+		{
+			if (!ppObject || !Valid)
+			{
+				return D3DERR_INVALIDCALL;
+			}
+			*ppObject = New();
+			return D3D_OK;
+		}
+
+		HRESULT CreateSurface(IDirect3DSurface8 **ppSurface, UINT Width, UINT Height, D3DFORMAT Format, DWORD Usage, D3DPOOL Pool, D3DMULTISAMPLE_TYPE MultiSample)
+		{
+			const D3DSURFACE_DESC Desc = { Format, D3DRTYPE_SURFACE, Usage, Pool, Width * Height * ElementSize(Format), MultiSample, Width, Height };
+			return Create(ppSurface, Width && Height, [&]() { return new Surface(this, nullptr, Desc); });
+		}
+
+		static HRESULT GetSurface(IDirect3DSurface8 *pSurface, IDirect3DSurface8 **ppSurface)
+		{
+			if (!ppSurface)
+			{
+				return D3DERR_INVALIDCALL;
+			}
+			pSurface->AddRef();
+			*ppSurface = pSurface;
+			return D3D_OK;
+		}
+
+		// The implicit surfaces share the device's reference count
+		void CreateImplicitSurfaces(const D3DPRESENT_PARAMETERS& Parameters)
+		{
+			Width = Parameters.BackBufferWidth ? Parameters.BackBufferWidth : 640;
+			Height = Parameters.BackBufferHeight ? Parameters.BackBufferHeight : 480;
+			const D3DFORMAT Format = (Parameters.BackBufferFormat != D3DFMT_UNKNOWN) ? Parameters.BackBufferFormat : D3DFMT_X8R8G8B8;
+			pBackBuffer = new Surface(this, this, { Format, D3DRTYPE_SURFACE, D3DUSAGE_RENDERTARGET, D3DPOOL_DEFAULT, Width * Height * ElementSize(Format), Parameters.MultiSampleType, Width, Height });
+			pDepthStencil = Parameters.EnableAutoDepthStencil ?
+				new Surface(this, this, { Parameters.AutoDepthStencilFormat, D3DRTYPE_SURFACE, D3DUSAGE_DEPTHSTENCIL, D3DPOOL_DEFAULT, Width * Height * ElementSize(Parameters.AutoDepthStencilFormat), Parameters.MultiSampleType, Width, Height }) :
+				nullptr;
+		}
+
+		void SetDefaultState()
+		{
+			memset(RenderStates, 0, sizeof(RenderStates));
+			memset(TextureStates, 0, sizeof(TextureStates));
+			for (D3DMATRIX& Matrix : Transforms)
+			{
+				Matrix = {};
+				Matrix._11 = Matrix._22 = Matrix._33 = Matrix._44 = 1.0f;
+			}
+			Viewport = { 0, 0, Width, Height, 0.0f, 1.0f };
+			Material = {};
+			Lights.clear();
+			memset(ClipPlanes, 0, sizeof(ClipPlanes));
+			ClipStatus = {};
+			memset(Textures, 0, sizeof(Textures));
+			memset(Streams, 0, sizeof(Streams));
+			pIndices = nullptr;
+			BaseVertex = 0;
+			pRenderTarget = pBackBuffer;
+			pZStencil = pDepthStencil;
+			VertexShader = 0;
+			PixelShader = 0;
+		}
+
+		template <typename T>
+		static HRESULT Set(T& State, const T *pValue)
+		{
+			if (!pValue)
+			{
+				return D3DERR_INVALIDCALL;
+			}
+			State = *pValue;
+			return D3D_OK;
+		}
+		template <typename T>
+		static HRESULT Get(const T& State, T *pValue)
+		{
+			if (!pValue)
+			{
+				return D3DERR_INVALIDCALL;
+			}
+			*pValue = State;
+			return D3D_OK;
+		}
+		static HRESULT NewHandle(DWORD& Next, DWORD *pHandle)
+		{
+			if (!pHandle)
+			{
+				return D3DERR_INVALIDCALL;
+			}
+			*pHandle = Next;
+			Next += 2;
+			return D3D_OK;
+		}
+		static HRESULT GetEmpty(DWORD *pSizeOfData)
+		{
+			if (!pSizeOfData)
+			{
+				return D3DERR_INVALIDCALL;
+			}
+			*pSizeOfData = 0;
+			return D3D_OK;
+		}
+		template <size_t N>
+		static HRESULT SetConstants(float (&Constants)[N][4], DWORD Register, CONST void *pConstantData, DWORD ConstantCount)
+		{
+			if (!pConstantData || Register > N || ConstantCount > N - Register)
+			{
+				return D3DERR_INVALIDCALL;
+			}
+			memcpy(Constants[Register], pConstantData, ConstantCount * sizeof(Constants[0]));
+			return D3D_OK;
+		}
+		template <size_t N>
+		static HRESULT GetConstants(const float (&Constants)[N][4], DWORD Register, void *pConstantData, DWORD ConstantCount)
+		{
+			if (!pConstantData || Register > N || ConstantCount > N - Register)
+			{
+				return D3DERR_INVALIDCALL;
+			}
+			memcpy(pConstantData, Constants[Register], ConstantCount * sizeof(Constants[0]));
+			return D3D_OK;
+		}
+
+		struct Stream
+		{
+			IDirect3DVertexBuffer8 *pBuffer;
+			UINT Stride;
+		};
+
+		struct LightSlot
+		{
+			D3DLIGHT8 Light;
+			bool Set;
+			BOOL Enabled;
+		};
+
+		struct Palette
+		{
+			PALETTEENTRY Entries[256];
+		};
+
+		Direct3D *pD3D;
+		D3DDEVICE_CREATION_PARAMETERS Creation;
+		UINT Width = 0;
+		UINT Height = 0;
+		Surface *pBackBuffer = nullptr;
+		Surface *pDepthStencil = nullptr;
+		IDirect3DSurface8 *pRenderTarget = nullptr;
+		IDirect3DSurface8 *pZStencil = nullptr;
+
+		DWORD RenderStates[256];
+		DWORD TextureStates[8][32];
+		D3DMATRIX Transforms[512];
+		D3DVIEWPORT8 Viewport;
+		D3DMATERIAL8 Material;
+		std::vector<LightSlot> Lights;
+		float ClipPlanes[D3DMAXUSERCLIPPLANES][4];
+		D3DCLIPSTATUS8 ClipStatus;
+		IDirect3DBaseTexture8 *Textures[8];
+		Stream Streams[16];
+		IDirect3DIndexBuffer8 *pIndices;
+		UINT BaseVertex;
+		DWORD VertexShader;
+		DWORD PixelShader;
+		float VertexConstants[96][4] = {};
+		float PixelConstants[8][4] = {};
+		std::vector<Palette> Palettes;
+		UINT CurrentPalette = 0;
+		D3DGAMMARAMP GammaRamp = {};
+		BOOL CursorShown = FALSE;
+		DWORD NextStateBlock = 1;
+		DWORD NextVertexShader = 0x10001;
+		DWORD NextPixelShader = 1;
+	};
+
+	template <typename I, D3DRESOURCETYPE Type>
+	Resource<I, Type>::Resource(Device *pDevice, IUnknown *pContainer) : Unknown<I>(pContainer), pDevice(pDevice)
+	{
+		if (!pContainer)
+		{
+			pDevice->AddRef();
+		}
+	}
+
+	template <typename I, D3DRESOURCETYPE Type>
+	Resource<I, Type>::~Resource()
+	{
+		// Levels go too, they can be render targets
+		pDevice->Forget(this);
+		if (!this->pContainer)
+		{
+			pDevice->Release();
+		}
+	}
+
+	template <typename I, D3DRESOURCETYPE Type>
+	HRESULT Resource<I, Type>::GetDevice(IDirect3DDevice8** ppDevice)
+	{
+		if (!ppDevice)
+		{
+			return D3DERR_INVALIDCALL;
+		}
+		pDevice->AddRef();
+		*ppDevice = pDevice;
+		return D3D_OK;
+	}
+
+	inline HRESULT Surface::GetContainer(REFIID riid, void** ppContainer)
+	{
+		return (pContainer ? pContainer : static_cast<IUnknown *>(pDevice))->QueryInterface(riid, ppContainer);
+	}
+
+	inline SwapChain::SwapChain(Device *pDevice, const D3DPRESENT_PARAMETERS& Parameters) : Unknown(nullptr), pDevice(pDevice)
+	{
+		const UINT Width = Parameters.BackBufferWidth ? Parameters.BackBufferWidth : 640;
+		const UINT Height = Parameters.BackBufferHeight ? Parameters.BackBufferHeight : 480;
+		const D3DFORMAT Format = (Parameters.BackBufferFormat != D3DFMT_UNKNOWN) ? Parameters.BackBufferFormat : D3DFMT_X8R8G8B8;
+		pDevice->AddRef();
+		pBackBuffer = new Surface(pDevice, this, { Format, D3DRTYPE_SURFACE, D3DUSAGE_RENDERTARGET, D3DPOOL_DEFAULT, Width * Height * ElementSize(Format), Parameters.MultiSampleType, Width, Height });
+	}
+
+	inline SwapChain::~SwapChain()
+	{
+		delete pBackBuffer;
+		pDevice->Release();
+	}
+
+	inline HRESULT Direct3D::CreateDevice(UINT Adapter, D3DDEVTYPE DeviceType, HWND hFocusWindow, DWORD BehaviorFlags, D3DPRESENT_PARAMETERS* pPresentationParameters, IDirect3DDevice8** ppReturnedDeviceInterface)
+	{
+		if (Adapter != 0 || !pPresentationParameters || !ppReturnedDeviceInterface)
+		{
+			return D3DERR_INVALIDCALL;
+		}
+		*ppReturnedDeviceInterface = new Device(this, { Adapter, DeviceType, hFocusWindow, BehaviorFlags }, *pPresentationParameters);
+		return D3D_OK;
+	}
+}
@@ -0,0 +1,2004 @@
+/**
+* Copyright (C) 2020 Elisha Riedlinger
+*
+* This software is  provided 'as-is', without any express  or implied  warranty. In no event will the
+* authors be held liable for any damages arising from the use of this software.
+* Permission  is granted  to anyone  to use  this software  for  any  purpose,  including  commercial
+* applications, and to alter it and redistribute it freely, subject to the following restrictions:
+*
+*   1. The origin of this software must not be misrepresented; you must not claim that you  wrote the
+*      original  software. If you use this  software  in a product, an  acknowledgment in the product
+*      documentation would be appreciated but is not required.
+*   2. Altered source versions must  be plainly  marked as such, and  must not be  misrepresented  as
+*      being the original software.
+*   3. This notice may not be removed or altered from any source distribution.
+*/
+
+// Replays a d3d8_trace.bin written with RecordTrace = 1 against a device that
+// draws nothing, once straight into it and once through the wrapper classes,
+// and prints what each call type costs on the CPU either way. The difference
+// is the wrapper's overhead per call, with no driver or GPU to hide it. Builds
+// with g++ on Linux from the wrapper sources, with the headers next to this
+// file standing in for the Windows ones:
+//
+//   g++ -std=c++17 -O2 -Wno-unknown-pragmas -Itools/nulldevice -Isource/dxsdk tools/nulldevice/nullreplay.cpp source/IDirect3D*.cpp source/InterfaceQuery.cpp -o nullreplay -lpthread
+//
+// The wrapper is set up as d3d8.ini would set it up, -ini reads the settings
+// from one. The parts of dllmain.cpp that deal with the window, the frame
+// limiter and the overlay are left out, as they have nothing to replay: Present,
+// EndScene and Reset do what the wrapper does around the runtime call and no
+// more. Each round replays the whole trace once each way on a new device; the
+// fastest round is reported for every call type, which leaves out most of the
+// noise of the machine.
+//
+// Calls whose objects the trace does not know are skipped and counted, mostly
+// locks of texture levels, since the calls that return existing objects only
+// record their arguments. Render targets the trace does not know are taken to
+// be the back buffer and depth stencil surface.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <map>
+#include <vector>
+#include <algorithm>
+#include <unordered_map>
+#include "../../source/d3d8.h"
+#include "../../source/config.h"
+#include "NullDevice.h"
+
+// Settings the wrapper sources read, set in main like dllmain.cpp sets them from d3d8.ini
+bool bFilterRedundantStates;
+bool bVerifyShadowState;
+bool bBufferUPDraws;
+bool bMergeUPDraws;
+bool bOptimizeLockFlags;
+bool bRenameLockedBuffers;
+bool bDeduplicateTextures;
+
+HRESULT m_IDirect3D8::CreateDevice(UINT Adapter, D3DDEVTYPE DeviceType, HWND hFocusWindow, DWORD BehaviorFlags, D3DPRESENT_PARAMETERS* pPresentationParameters, IDirect3DDevice8** ppReturnedDeviceInterface)
+{
+	HRESULT hr = ProxyInterface->CreateDevice(Adapter, DeviceType, hFocusWindow, BehaviorFlags, pPresentationParameters, ppReturnedDeviceInterface);
+
+	if (SUCCEEDED(hr) && ppReturnedDeviceInterface)
+	{
+		*ppReturnedDeviceInterface = new m_IDirect3DDevice8(*ppReturnedDeviceInterface, this);
+	}
+	return hr;
+}
+
+HRESULT m_IDirect3DDevice8::Present(CONST RECT* pSourceRect, CONST RECT* pDestRect, HWND hDestWindowOverride, CONST RGNDATA* pDirtyRegion)
+{
+	Trace::Record(Trace::Call::Present, Trace::ByRef(pSourceRect), Trace::ByRef(pDestRect), Trace::Id(hDestWindowOverride), Trace::Block(pDirtyRegion, pDirtyRegion ? sizeof(RGNDATAHEADER) + pDirtyRegion->rdh.nRgnSize : 0));
+	Trace::Recorder::Flush();
+
+	FlushDraws();
+
+	EndFrame();
+
+	return ProxyInterface->Present(pSourceRect, pDestRect, hDestWindowOverride, pDirtyRegion);
+}
+
+HRESULT m_IDirect3DDevice8::EndScene()
+{
+	Trace::Record(Trace::Call::EndScene);
+
+	FlushDraws();
+
+	return ProxyInterface->EndScene();
+}
+
+HRESULT m_IDirect3DDevice8::Reset(D3DPRESENT_PARAMETERS* pPresentationParameters)
+{
+	Trace::Record(Trace::Call::Reset, Trace::ByRef(pPresentationParameters));
+
+	BeforeReset();
+
+	return ProxyInterface->Reset(pPresentationParameters);
+}
+
+using namespace Trace;
+
+namespace
+{
+	typedef std::chrono::steady_clock Clock;
+
+	constexpr size_t CallCount = (size_t)Call::Count;
+
+	struct Record
+	{
+		uint16_t Id;
+		uint32_t Size;
+		int64_t Time;
+		const uint8_t *pPayload;
+	};
+
+	struct Blob
+	{
+		const uint8_t *pData;
+		uint32_t Size;
+	};
+
+	struct TraceFile
+	{
+		std::vector<uint8_t> Bytes;
+		std::vector<Record> Records;			// in call order across threads, blobs left out
+		std::unordered_map<uint64_t, Blob> Blobs;
+		uint64_t Frames = 0;
+	};
+
+	struct RunStats
+	{
+		uint64_t Count[CallCount] = {};
+		uint64_t Skipped[CallCount] = {};
+		double Ns[CallCount] = {};
+	};
+
+	bool ReadChunk(TraceFile& t, const uint8_t *Data, size_t Size)
+	{
+		size_t Offset = 0;
+		while (Offset < Size)
+		{
+			RecordHeader Header;
+			if (Size - Offset < sizeof(Header))
+			{
+				return false;
+			}
+			memcpy(&Header, Data + Offset, sizeof(Header));
+			Offset += sizeof(Header);
+			if (Header.Call >= CallCount || Size - Offset < Header.Size)
+			{
+				return false;
+			}
+
+			const uint8_t *pPayload = Data + Offset;
+			Offset += Header.Size;
+
+			if (Header.Call == (uint16_t)Call::Blob)
+			{
+				uint64_t Hash;
+				if (Header.Size < sizeof(Hash))
+				{
+					return false;
+				}
+				memcpy(&Hash, pPayload, sizeof(Hash));
+				t.Blobs[Hash] = { pPayload + sizeof(Hash), Header.Size - (uint32_t)sizeof(Hash) };
+				continue;
+			}
+
+			t.Records.push_back({ Header.Call, Header.Size, Header.Time, pPayload });
+			if (Header.Call == (uint16_t)Call::Present)
+			{
+				t.Frames++;
+			}
+		}
+		return true;
+	}
+
+	bool ReadTrace(const char *Path, TraceFile& t)
+	{
+		FILE *File = fopen(Path, "rb");
+		if (!File)
+		{
+			fprintf(stderr, "nullreplay: cannot open %s\n", Path);
+			return false;
+		}
+
+		// Records point into the file, so it is read whole
+		fseek(File, 0, SEEK_END);
+		const long Length = ftell(File);
+		fseek(File, 0, SEEK_SET);
+		t.Bytes.resize(Length > 0 ? (size_t)Length : 0);
+		const bool Read = fread(t.Bytes.data(), 1, t.Bytes.size(), File) == t.Bytes.size();
+		fclose(File);
+
+		FileHeader Header;
+		if (!Read || t.Bytes.size() < sizeof(Header) || (memcpy(&Header, t.Bytes.data(), sizeof(Header)), Header.Magic != FileMagic))
+		{
+			fprintf(stderr, "nullreplay: %s is not a trace\n", Path);
+			return false;
+		}
+		if (Header.Version != FileVersion)
+		{
+			fprintf(stderr, "nullreplay: %s has version %u, expected %u\n", Path, Header.Version, FileVersion);
+			return false;
+		}
+
+		size_t Offset = sizeof(Header), Chunks = 0;
+		while (t.Bytes.size() - Offset >= sizeof(ChunkHeader))
+		{
+			ChunkHeader Chunk;
+			memcpy(&Chunk, t.Bytes.data() + Offset, sizeof(Chunk));
+			Offset += sizeof(Chunk);
+			if (t.Bytes.size() - Offset < Chunk.Size || !ReadChunk(t, t.Bytes.data() + Offset, Chunk.Size))
+			{
+				// A process that did not shut down cleanly leaves a partial chunk
+				fprintf(stderr, "nullreplay: %s is truncated after %zu chunks\n", Path, Chunks);
+				break;
+			}
+			Offset += Chunk.Size;
+			Chunks++;
+		}
+
+		// Threads record into separate chunks
+		std::stable_sort(t.Records.begin(), t.Records.end(), [](const Record& a, const Record& b) { return a.Time < b.Time; });
+		return true;
+	}
+
+	// Arguments of a record, in the order they were recorded
+	class Payload
+	{
+	public:
+		explicit Payload(const Record& r) : p(r.pPayload), End(r.pPayload + r.Size) { }
+
+		template <typename T>
+		T Get()
+		{
+			T Value = {};
+			if ((size_t)(End - p) < sizeof(T))
+			{
+				Valid = false;
+				return Value;
+			}
+			memcpy(&Value, p, sizeof(T));
+			p += sizeof(T);
+			return Value;
+		}
+
+		template <typename T>
+		const T *Ref(T& Value)
+		{
+			return Get<uint8_t>() ? (Value = Get<T>(), &Value) : nullptr;
+		}
+
+		// The structure holds the window handle, so its size is that of the recording process
+		const D3DPRESENT_PARAMETERS *PresentParameters(D3DPRESENT_PARAMETERS& Value, size_t After)
+		{
+			if (!Get<uint8_t>())
+			{
+				return nullptr;
+			}
+			const size_t HandleSize = ((size_t)(End - p) == 12 * sizeof(DWORD) + sizeof(uint32_t) + After) ? sizeof(uint32_t) : sizeof(uint64_t);
+			Value = {};
+			Value.BackBufferWidth = Get<UINT>();
+			Value.BackBufferHeight = Get<UINT>();
+			Value.BackBufferFormat = Get<D3DFORMAT>();
+			Value.BackBufferCount = Get<UINT>();
+			Value.MultiSampleType = Get<D3DMULTISAMPLE_TYPE>();
+			Value.SwapEffect = Get<D3DSWAPEFFECT>();
+			HandleSize == sizeof(uint32_t) ? (void)Get<uint32_t>() : (void)Get<uint64_t>();
+			Value.Windowed = Get<BOOL>();
+			Value.EnableAutoDepthStencil = Get<BOOL>();
+			Value.AutoDepthStencilFormat = Get<D3DFORMAT>();
+			Value.Flags = Get<DWORD>();
+			Value.FullScreen_RefreshRateInHz = Get<UINT>();
+			Value.FullScreen_PresentationInterval = Get<UINT>();
+			return &Value;
+		}
+
+		bool IsValid() const { return Valid && p == End; }
+
+	private:
+		const uint8_t *p;
+		const uint8_t *End;
+		bool Valid = true;
+	};
+
+	enum class Kind
+	{
+		Texture,
+		CubeTexture,
+		VolumeTexture,
+		VertexBuffer,
+		IndexBuffer,
+		Surface,
+		SwapChain,
+	};
+
+	// Replays a trace once on a new null device, straight or through the wrapper
+	class Replayer
+	{
+	public:
+		Replayer(const TraceFile& t, bool Wrapped, double TimerNs) : t(t), TimerNs(TimerNs)
+		{
+			Null::Direct3D *pNull = new Null::Direct3D();
+			pD3D = Wrapped ? static_cast<IDirect3D8 *>(new m_IDirect3D8(pNull)) : pNull;
+
+			// The trace starts after the device was created, so its parameters are not known
+			D3DPRESENT_PARAMETERS Parameters = {};
+			Parameters.BackBufferWidth = 640;
+			Parameters.BackBufferHeight = 480;
+			Parameters.BackBufferFormat = D3DFMT_X8R8G8B8;
+			Parameters.BackBufferCount = 1;
+			Parameters.SwapEffect = D3DSWAPEFFECT_DISCARD;
+			Parameters.Windowed = TRUE;
+			Parameters.EnableAutoDepthStencil = TRUE;
+			Parameters.AutoDepthStencilFormat = D3DFMT_D24S8;
+			pD3D->CreateDevice(0, D3DDEVTYPE_HAL, nullptr, D3DCREATE_HARDWARE_VERTEXPROCESSING, &Parameters, &pDevice);
+		}
+		~Replayer()
+		{
+			for (auto& Entry : Objects)
+			{
+				Entry.second.pObject->Release();
+			}
+			pDevice->Release();
+			pD3D->Release();
+		}
+
+		void Run(RunStats& Stats)
+		{
+			for (const Record& r : t.Records)
+			{
+				Elapsed = Clock::duration::zero();
+				if (Replay(r))
+				{
+					Stats.Count[r.Id]++;
+					Stats.Ns[r.Id] += std::max(0.0, std::chrono::duration<double, std::nano>(Elapsed).count() - TimerNs);
+				}
+				else
+				{
+					Stats.Skipped[r.Id]++;
+				}
+			}
+		}
+
+	private:
+		struct Object
+		{
+			IUnknown *pObject;
+			Kind Type;
+		};
+
+		struct LockedRegion
+		{
+			BYTE *pBits;
+			size_t Size;
+		};
+
+		const TraceFile& t;
+		const double TimerNs;
+		IDirect3D8 *pD3D = nullptr;
+		IDirect3DDevice8 *pDevice = nullptr;
+		Clock::duration Elapsed;
+
+		std::unordered_map<uint64_t, Object> Objects;					// by the wrapper address in the trace
+		std::unordered_map<DWORD, DWORD> VertexShaders;					// trace handle to replay handle
+		std::unordered_map<DWORD, DWORD> PixelShaders;
+		std::unordered_map<DWORD, DWORD> StateBlocks;
+		std::map<std::pair<uint64_t, UINT>, LockedRegion> Locks;		// by object, and level and face
+		std::vector<uint8_t> Indices;
+		std::vector<uint8_t> Vertices;
+		std::vector<uint8_t> Scratch;
+
+		// Only the call itself is timed, decoding the record and looking up objects is not
+		template <typename F>
+		void Time(F Call)
+		{
+			const Clock::time_point Start = Clock::now();
+			Call();
+			Elapsed += Clock::now() - Start;
+		}
+
+		template <typename T>
+		void Add(uint64_t Id, T *pObject, Kind Type)
+		{
+			// A Destroy may have been dropped when the writer fell behind
+			auto it = Objects.find(Id);
+			if (it != Objects.end())
+			{
+				it->second.pObject->Release();
+			}
+			Objects[Id] = { pObject, Type };
+		}
+
+		// False when the object is not known, an Id of 0 is a null pointer
+		template <typename T>
+		bool Find(uint64_t Id, Kind Type, T *&pObject)
+		{
+			pObject = nullptr;
+			if (!Id)
+			{
+				return true;
+			}
+			auto it = Objects.find(Id);
+			if (it == Objects.end() || it->second.Type != Type)
+			{
+				return false;
+			}
+			pObject = static_cast<T *>(it->second.pObject);
+			return true;
+		}
+
+		bool FindTexture(uint64_t Id, IDirect3DBaseTexture8 *&pTexture)
+		{
+			IDirect3DTexture8 *pTexture2D;
+			IDirect3DCubeTexture8 *pCube;
+			IDirect3DVolumeTexture8 *pVolume;
+			if (Find(Id, Kind::Texture, pTexture2D) && pTexture2D)
+			{
+				pTexture = pTexture2D;
+			}
+			else if (Find(Id, Kind::CubeTexture, pCube) && pCube)
+			{
+				pTexture = pCube;
+			}
+			else if (Find(Id, Kind::VolumeTexture, pVolume) && pVolume)
+			{
+				pTexture = pVolume;
+			}
+			else
+			{
+				pTexture = nullptr;
+				return !Id;
+			}
+			return true;
+		}
+
+		// False when the trace lost the contents, a hash of 0 is a null pointer
+		bool FindBlob(uint64_t Hash, const void *&pData, uint32_t *pSize = nullptr)
+		{
+			pData = nullptr;
+			if (pSize)
+			{
+				*pSize = 0;
+			}
+			if (!Hash)
+			{
+				return true;
+			}
+			auto it = t.Blobs.find(Hash);
+			if (it == t.Blobs.end())
+			{
+				return false;
+			}
+			pData = it->second.pData;
+			if (pSize)
+			{
+				*pSize = it->second.Size;
+			}
+			return true;
+		}
+
+		void Release(IUnknown *pObject)
+		{
+			if (pObject)
+			{
+				pObject->Release();
+			}
+		}
+
+		static DWORD MapHandle(const std::unordered_map<DWORD, DWORD>& Handles, DWORD Handle)
+		{
+			auto it = Handles.find(Handle);
+			return (it != Handles.end()) ? it->second : Handle;
+		}
+
+		// Writes what the game wrote into the memory of a lock, when it is unlocked
+		void Fill(uint64_t Id, UINT Key, uint64_t Hash)
+		{
+			auto it = Locks.find({ Id, Key });
+			if (it == Locks.end())
+			{
+				return;
+			}
+			const void *pData;
+			uint32_t Size;
+			if (FindBlob(Hash, pData, &Size) && pData && it->second.pBits)
+			{
+				memcpy(it->second.pBits, pData, std::min((size_t)Size, it->second.Size));
+			}
+			Locks.erase(it);
+		}
+
+		void Lock(uint64_t Id, UINT Key, void *pBits, size_t Size)
+		{
+			Locks[{ Id, Key }] = { static_cast<BYTE *>(pBits), Size };
+		}
+
+		static size_t RectSize(const D3DSURFACE_DESC& Desc, const D3DLOCKED_RECT& Locked, const RECT *pRect)
+		{
+			return LockedRectSize(Desc.Format, Locked, pRect ? (UINT)(pRect->bottom - pRect->top) : Desc.Height);
+		}
+
+		static size_t BoxSize(const D3DVOLUME_DESC& Desc, const D3DLOCKED_BOX& Locked, const D3DBOX *pBox)
+		{
+			return (Locked.SlicePitch > 0) ? (size_t)Locked.SlicePitch * (pBox ? pBox->Back - pBox->Front : Desc.Depth) : 0;
+		}
+
+		// Vertices a UP draw reads, zeros when the trace lost them
+		const void *UPVertices(uint64_t Hash, UINT Offset, UINT Size)
+		{
+			const void *pData;
+			uint32_t BlobSize;
+			FindBlob(Hash, pData, &BlobSize);
+			Vertices.assign((size_t)Offset + Size, 0);
+			if (pData)
+			{
+				memcpy(Vertices.data() + Offset, pData, std::min(BlobSize, Size));
+			}
+			return Vertices.data();
+		}
+
+		bool Replay(const Record& r)
+		{
+			Payload p(r);
+			HRESULT hr = D3D_OK;
+
+			switch ((Call)r.Id)
+			{
+			case Call::TestCooperativeLevel:
+			{
+				Time([&]() { hr = pDevice->TestCooperativeLevel(); });
+				return p.IsValid();
+			}
+			case Call::GetAvailableTextureMem:
+			{
+				Time([&]() { pDevice->GetAvailableTextureMem(); });
+				return p.IsValid();
+			}
+			case Call::ResourceManagerDiscardBytes:
+			{
+				const DWORD Bytes = p.Get<DWORD>();
+				if (!p.IsValid())
+				{
+					return false;
+				}
+				Time([&]() { hr = pDevice->ResourceManagerDiscardBytes(Bytes); });
+				return true;
+			}
+			case Call::GetDirect3D:
+			{
+				IDirect3D8 *pResult = nullptr;
+				Time([&]() { hr = pDevice->GetDirect3D(&pResult); });
+				Release(pResult);
+				return p.IsValid();
+			}
+			case Call::GetDeviceCaps:
+			{
+				D3DCAPS8 Caps;
+				Time([&]() { hr = pDevice->GetDeviceCaps(&Caps); });
+				return p.IsValid();
+			}
+			case Call::GetDisplayMode:
+			{
+				D3DDISPLAYMODE Mode;
+				Time([&]() { hr = pDevice->GetDisplayMode(&Mode); });
+				return p.IsValid();
+			}
+			case Call::GetCreationParameters:
+			{
+				D3DDEVICE_CREATION_PARAMETERS Parameters;
+				Time([&]() { hr = pDevice->GetCreationParameters(&Parameters); });
+				return p.IsValid();
+			}
+			case Call::SetCursorProperties:
+			{
+				const UINT X = p.Get<UINT>(), Y = p.Get<UINT>();
+				IDirect3DSurface8 *pSurface;
+				if (!Find(p.Get<uint64_t>(), Kind::Surface, pSurface) || !pSurface || !p.IsValid())
+				{
+					return false;
+				}
+				Time([&]() { hr = pDevice->SetCursorProperties(X, Y, pSurface); });
+				return true;
+			}
+			case Call::SetCursorPosition:
+			{
+				const UINT X = p.Get<UINT>(), Y = p.Get<UINT>();
+				const DWORD Flags = p.Get<DWORD>();
+				if (!p.IsValid())
+				{
+					return false;
+				}
+				Time([&]() { pDevice->SetCursorPosition(X, Y, Flags); });
+				return true;
+			}
+			case Call::ShowCursor:
+			{
+				const BOOL Show = p.Get<BOOL>();
+				if (!p.IsValid())
+				{
+					return false;
+				}
+				Time([&]() { pDevice->ShowCursor(Show); });
+				return true;
+			}
+			case Call::CreateAdditionalSwapChain:
+			{
+				D3DPRESENT_PARAMETERS Value;
+				const D3DPRESENT_PARAMETERS *pParameters = p.PresentParameters(Value, sizeof(uint64_t));
+				const uint64_t Id = p.Get<uint64_t>();
+				if (!pParameters || !p.IsValid())
+				{
+					return false;
+				}
+				D3DPRESENT_PARAMETERS Parameters = *pParameters;
+				IDirect3DSwapChain8 *pSwapChain = nullptr;
+				Time([&]() { hr = pDevice->CreateAdditionalSwapChain(&Parameters, &pSwapChain); });
+				if (SUCCEEDED(hr))
+				{
+					Add(Id, pSwapChain, Kind::SwapChain);
+				}
+				return true;
+			}
+			case Call::Reset:
+			{
+				D3DPRESENT_PARAMETERS Value;
+				const D3DPRESENT_PARAMETERS *pParameters = p.PresentParameters(Value, 0);
+				if (!pParameters || !p.IsValid())
+				{
+					return false;
+				}
+				D3DPRESENT_PARAMETERS Parameters = *pParameters;
+				Locks.clear();
+				Time([&]() { hr = pDevice->Reset(&Parameters); });
+				return true;
+			}
+			case Call::Present:
+			{
+				RECT Source, Dest;
+				const RECT *pSource = p.Ref(Source);
+				const RECT *pDest = p.Ref(Dest);
+				p.Get<uint64_t>();
+				const void *pRegion;
+				if (!FindBlob(p.Get<uint64_t>(), pRegion) || !p.IsValid())
+				{
+					return false;
+				}
+				Time([&]() { hr = pDevice->Present(pSource, pDest, nullptr, static_cast<const RGNDATA *>(pRegion)); });
+				return true;
+			}
+			case Call::GetBackBuffer:
+			{
+				const UINT BackBuffer = p.Get<UINT>();
+				const D3DBACKBUFFER_TYPE Type = p.Get<D3DBACKBUFFER_TYPE>();
+				if (!p.IsValid())
+				{
+					return false;
+				}
+				IDirect3DSurface8 *pSurface = nullptr;
+				Time([&]() { hr = pDevice->GetBackBuffer(BackBuffer, Type, &pSurface); });
+				Release(pSurface);
+				return true;
+			}
+			case Call::GetRasterStatus:
+			{
+				D3DRASTER_STATUS Status;
+				Time([&]() { hr = pDevice->GetRasterStatus(&Status); });
+				return p.IsValid();
+			}
+			case Call::SetGammaRamp:
+			{
+				const DWORD Flags = p.Get<DWORD>();
+				D3DGAMMARAMP Value;
+				const D3DGAMMARAMP *pRamp = p.Ref(Value);
+				if (!p.IsValid())
+				{
+					return false;
+				}
+				Time([&]() { pDevice->SetGammaRamp(Flags, pRamp); });
+				return true;
+			}
+			case Call::GetGammaRamp:
+			{
+				D3DGAMMARAMP Ramp;
+				Time([&]() { pDevice->GetGammaRamp(&Ramp); });
+				return p.IsValid();
+			}
+			case Call::CreateTexture:
+			{
+				const UINT Width = p.Get<UINT>(), Height = p.Get<UINT>(), Levels = p.Get<UINT>();
+				const DWORD Usage = p.Get<DWORD>();
+				const D3DFORMAT Format = p.Get<D3DFORMAT>();
+				const D3DPOOL Pool = p.Get<D3DPOOL>();
+				const uint64_t Id = p.Get<uint64_t>();
+				if (!p.IsValid())
+				{
+					return false;
+				}
+				IDirect3DTexture8 *pTexture = nullptr;
+				Time([&]() { hr = pDevice->CreateTexture(Width, Height, Levels, Usage, Format, Pool, &pTexture); });
+				if (SUCCEEDED(hr))
+				{
+					Add(Id, pTexture, Kind::Texture);
+				}
+				return true;
+			}
+			case Call::CreateVolumeTexture:
+			{
+				const UINT Width = p.Get<UINT>(), Height = p.Get<UINT>(), Depth = p.Get<UINT>(), Levels = p.Get<UINT>();
+				const DWORD Usage = p.Get<DWORD>();
+				const D3DFORMAT Format = p.Get<D3DFORMAT>();
+				const D3DPOOL Pool = p.Get<D3DPOOL>();
+				const uint64_t Id = p.Get<uint64_t>();
+				if (!p.IsValid())
+				{
+					return false;
+				}
+				IDirect3DVolumeTexture8 *pTexture = nullptr;
+				Time([&]() { hr = pDevice->CreateVolumeTexture(Width, Height, Depth, Levels, Usage, Format, Pool, &pTexture); });
+				if (SUCCEEDED(hr))
+				{
+					Add(Id, pTexture, Kind::VolumeTexture);
+				}
+				return true;
+			}
+			case Call::CreateCubeTexture:
+			{
+				const UINT EdgeLength = p.Get<UINT>(), Levels = p.Get<UINT>();
+				const DWORD Usage = p.Get<DWORD>();
+				const D3DFORMAT Format = p.Get<D3DFORMAT>();
+				const D3DPOOL Pool = p.Get<D3DPOOL>();
+				const uint64_t Id = p.Get<uint64_t>();
+				if (!p.IsValid())
+				{
+					return false;
+				}
+				IDirect3DCubeTexture8 *pTexture = nullptr;
+				Time([&]() { hr = pDevice->CreateCubeTexture(EdgeLength, Levels, Usage, Format, Pool, &pTexture); });
+				if (SUCCEEDED(hr))
+				{
+					Add(Id, pTexture, Kind::CubeTexture);
+				}
+				return true;
+			}
+			case Call::CreateVertexBuffer:
+			{
+				const UINT Length = p.Get<UINT>();
+				const DWORD Usage = p.Get<DWORD>(), FVF = p.Get<DWORD>();
+				const D3DPOOL Pool = p.Get<D3DPOOL>();
+				const uint64_t Id = p.Get<uint64_t>();
+				if (!p.IsValid())
+				{
+					return false;
+				}
+				IDirect3DVertexBuffer8 *pBuffer = nullptr;
+				Time([&]() { hr = pDevice->CreateVertexBuffer(Length, Usage, FVF, Pool, &pBuffer); });
+				if (SUCCEEDED(hr))
+				{
+					Add(Id, pBuffer, Kind::VertexBuffer);
+				}
+				return true;
+			}
+			case Call::CreateIndexBuffer:
+			{
+				const UINT Length = p.Get<UINT>();
+				const DWORD Usage = p.Get<DWORD>();
+				const D3DFORMAT Format = p.Get<D3DFORMAT>();
+				const D3DPOOL Pool = p.Get<D3DPOOL>();
+				const uint64_t Id = p.Get<uint64_t>();
+				if (!p.IsValid())
+				{
+					return false;
+				}
+				IDirect3DIndexBuffer8 *pBuffer = nullptr;
+				Time([&]() { hr = pDevice->CreateIndexBuffer(Length, Usage, Format, Pool, &pBuffer); });
+				if (SUCCEEDED(hr))
+				{
+					Add(Id, pBuffer, Kind::IndexBuffer);
+				}
+				return true;
+			}
+			case Call::CreateRenderTarget:
+			{
+				const UINT Width = p.Get<UINT>(), Height = p.Get<UINT>();
+				const D3DFORMAT Format = p.Get<D3DFORMAT>();
+				const D3DMULTISAMPLE_TYPE MultiSample = p.Get<D3DMULTISAMPLE_TYPE>();
+				const BOOL Lockable = p.Get<BOOL>();
+				const uint64_t Id = p.Get<uint64_t>();
+				if (!p.IsValid())
+				{
+					return false;
+				}
+				IDirect3DSurface8 *pSurface = nullptr;
+				Time([&]() { hr = pDevice->CreateRenderTarget(Width, Height, Format, MultiSample, Lockable, &pSurface); });
+				if (SUCCEEDED(hr))
+				{
+					Add(Id, pSurface, Kind::Surface);
+				}
+				return true;
+			}
+			case Call::CreateDepthStencilSurface:
+			{
+				const UINT Width = p.Get<UINT>(), Height = p.Get<UINT>();
+				const D3DFORMAT Format = p.Get<D3DFORMAT>();
+				const D3DMULTISAMPLE_TYPE MultiSample = p.Get<D3DMULTISAMPLE_TYPE>();
+				const uint64_t Id = p.Get<uint64_t>();
+				if (!p.IsValid())
+				{
+					return false;
+				}
+				IDirect3DSurface8 *pSurface = nullptr;
+				Time([&]() { hr = pDevice->CreateDepthStencilSurface(Width, Height, Format, MultiSample, &pSurface); });
+				if (SUCCEEDED(hr))
+				{
+					Add(Id, pSurface, Kind::Surface);
+				}
+				return true;
+			}
+			case Call::CreateImageSurface:
+			{
+				const UINT Width = p.Get<UINT>(), Height = p.Get<UINT>();
+				const D3DFORMAT Format = p.Get<D3DFORMAT>();
+				const uint64_t Id = p.Get<uint64_t>();
+				if (!p.IsValid())
+				{
+					return false;
+				}
+				IDirect3DSurface8 *pSurface = nullptr;
+				Time([&]() { hr = pDevice->CreateImageSurface(Width, Height, Format, &pSurface); });
+				if (SUCCEEDED(hr))
+				{
+					Add(Id, pSurface, Kind::Surface);
+				}
+				return true;
+			}
+			case Call::CopyRects:
+			{
+				IDirect3DSurface8 *pSource, *pDest;
+				const void *pRects, *pPoints;
+				const bool Found = Find(p.Get<uint64_t>(), Kind::Surface, pSource) && FindBlob(p.Get<uint64_t>(), pRects);
+				const UINT Rects = p.Get<UINT>();
+				if (!Found || !Find(p.Get<uint64_t>(), Kind::Surface, pDest) || !FindBlob(p.Get<uint64_t>(), pPoints) || !pSource || !pDest || !p.IsValid())
+				{
+					return false;
+				}
+				Time([&]() { hr = pDevice->CopyRects(pSource, static_cast<const RECT *>(pRects), Rects, pDest, static_cast<const POINT *>(pPoints)); });
+				return true;
+			}
+			case Call::UpdateTexture:
+			{
+				IDirect3DBaseTexture8 *pSource, *pDest;
+				if (!FindTexture(p.Get<uint64_t>(), pSource) || !FindTexture(p.Get<uint64_t>(), pDest) || !pSource || !pDest || !p.IsValid())
+				{
+					return false;
+				}
+				Time([&]() { hr = pDevice->UpdateTexture(pSource, pDest); });
+				return true;
+			}
+			case Call::GetFrontBuffer:
+			{
+				IDirect3DSurface8 *pSurface;
+				if (!Find(p.Get<uint64_t>(), Kind::Surface, pSurface) || !pSurface || !p.IsValid())
+				{
+					return false;
+				}
+				Time([&]() { hr = pDevice->GetFrontBuffer(pSurface); });
+				return true;
+			}
+			case Call::SetRenderTarget:
+			{
+				// Surfaces the trace does not know are the back buffer and the depth stencil surface
+				const uint64_t TargetId = p.Get<uint64_t>(), DepthId = p.Get<uint64_t>();
+				if (!p.IsValid())
+				{
+					return false;
+				}
+				IDirect3DSurface8 *pTarget, *pDepth, *pImplicitTarget = nullptr, *pImplicitDepth = nullptr;
+				if (!Find(TargetId, Kind::Surface, pTarget))
+				{
+					pDevice->GetBackBuffer(0, D3DBACKBUFFER_TYPE_MONO, &pImplicitTarget);
+					pTarget = pImplicitTarget;
+				}
+				if (!Find(DepthId, Kind::Surface, pDepth))
+				{
+					pDevice->GetDepthStencilSurface(&pImplicitDepth);
+					pDepth = pImplicitDepth;
+				}
+				Time([&]() { hr = pDevice->SetRenderTarget(pTarget, pDepth); });
+				Release(pImplicitTarget);
+				Release(pImplicitDepth);
+				return true;
+			}
+			case Call::GetRenderTarget:
+			{
+				IDirect3DSurface8 *pSurface = nullptr;
+				Time([&]() { hr = pDevice->GetRenderTarget(&pSurface); });
+				Release(pSurface);
+				return p.IsValid();
+			}
+			case Call::GetDepthStencilSurface:
+			{
+				IDirect3DSurface8 *pSurface = nullptr;
+				Time([&]() { hr = pDevice->GetDepthStencilSurface(&pSurface); });
+				Release(pSurface);
+				return p.IsValid();
+			}
+			case Call::BeginScene:
+			{
+				Time([&]() { hr = pDevice->BeginScene(); });
+				return p.IsValid();
+			}
+			case Call::EndScene:
+			{
+				Time([&]() { hr = pDevice->EndScene(); });
+				return p.IsValid();
+			}
+			case Call::Clear:
+			{
+				const DWORD Count = p.Get<DWORD>();
+				const void *pRects;
+				const bool Found = FindBlob(p.Get<uint64_t>(), pRects);
+				const DWORD Flags = p.Get<DWORD>();
+				const D3DCOLOR Color = p.Get<D3DCOLOR>();
+				const float Z = p.Get<float>();
+				const DWORD Stencil = p.Get<DWORD>();
+				if (!Found || !p.IsValid())
+				{
+					return false;
+				}
+				Time([&]() { hr = pDevice->Clear(pRects ? Count : 0, static_cast<const D3DRECT *>(pRects), Flags, Color, Z, Stencil); });
+				return true;
+			}
+			case Call::SetTransform:
+			case Call::MultiplyTransform:
+			{
+				const D3DTRANSFORMSTATETYPE State = p.Get<D3DTRANSFORMSTATETYPE>();
+				D3DMATRIX Value;
+				const D3DMATRIX *pMatrix = p.Ref(Value);
+				if (!p.IsValid())
+				{
+					return false;
+				}
+				if ((Call)r.Id == Call::SetTransform)
+				{
+					Time([&]() { hr = pDevice->SetTransform(State, pMatrix); });
+				}
+				else
+				{
+					Time([&]() { hr = pDevice->MultiplyTransform(State, pMatrix); });
+				}
+				return true;
+			}
+			case Call::GetTransform:
+			{
+				const D3DTRANSFORMSTATETYPE State = p.Get<D3DTRANSFORMSTATETYPE>();
+				if (!p.IsValid())
+				{
+					return false;
+				}
+				D3DMATRIX Matrix;
+				Time([&]() { hr = pDevice->GetTransform(State, &Matrix); });
+				return true;
+			}
+			case Call::SetViewport:
+			{
+				D3DVIEWPORT8 Value;
+				const D3DVIEWPORT8 *pViewport = p.Ref(Value);
+				if (!p.IsValid())
+				{
+					return false;
+				}
+				Time([&]() { hr = pDevice->SetViewport(pViewport); });
+				return true;
+			}
+			case Call::GetViewport:
+			{
+				D3DVIEWPORT8 Viewport;
+				Time([&]() { hr = pDevice->GetViewport(&Viewport); });
+				return p.IsValid();
+			}
+			case Call::SetMaterial:
+			{
+				D3DMATERIAL8 Value;
+				const D3DMATERIAL8 *pMaterial = p.Ref(Value);
+				if (!p.IsValid())
+				{
+					return false;
+				}
+				Time([&]() { hr = pDevice->SetMaterial(pMaterial); });
+				return true;
+			}
+			case Call::GetMaterial:
+			{
+				D3DMATERIAL8 Material;
+				Time([&]() { hr = pDevice->GetMaterial(&Material); });
+				return p.IsValid();
+			}
+			case Call::SetLight:
+			{
+				const DWORD Index = p.Get<DWORD>();
+				D3DLIGHT8 Value;
+				const D3DLIGHT8 *pLight = p.Ref(Value);
+				if (!p.IsValid())
+				{
+					return false;
+				}
+				Time([&]() { hr = pDevice->SetLight(Index, pLight); });
+				return true;
+			}
+			case Call::GetLight:
+			{
+				const DWORD Index = p.Get<DWORD>();
+				if (!p.IsValid())
+				{
+					return false;
+				}
+				D3DLIGHT8 Light;
+				Time([&]() { hr = pDevice->GetLight(Index, &Light); });
+				return true;
+			}
+			case Call::LightEnable:
+			{
+				const DWORD Index = p.Get<DWORD>();
+				const BOOL Enable = p.Get<BOOL>();
+				if (!p.IsValid())
+				{
+					return false;
+				}
+				Time([&]() { hr = pDevice->LightEnable(Index, Enable); });
+				return true;
+			}
+			case Call::GetLightEnable:
+			{
+				const DWORD Index = p.Get<DWORD>();
+				if (!p.IsValid())
+				{
+					return false;
+				}
+				BOOL Enable;
+				Time([&]() { hr = pDevice->GetLightEnable(Index, &Enable); });
+				return true;
+			}
+			case Call::SetClipPlane:
+			{
+				const DWORD Index = p.Get<DWORD>();
+				StateCache::ClipPlane Value;
+				const StateCache::ClipPlane *pPlane = p.Ref(Value);
+				if (!p.IsValid())
+				{
+					return false;
+				}
+				Time([&]() { hr = pDevice->SetClipPlane(Index, pPlane ? pPlane->Plane : nullptr); });
+				return true;
+			}
+			case Call::GetClipPlane:
+			{
+				const DWORD Index = p.Get<DWORD>();
+				if (!p.IsValid())
+				{
+					return false;
+				}
+				float Plane[4];
+				Time([&]() { hr = pDevice->GetClipPlane(Index, Plane); });
+				return true;
+			}
+			case Call::SetRenderState:
+			{
+				const D3DRENDERSTATETYPE State = p.Get<D3DRENDERSTATETYPE>();
+				const DWORD Value = p.Get<DWORD>();
+				if (!p.IsValid())
+				{
+					return false;
+				}
+				Time([&]() { hr = pDevice->SetRenderState(State, Value); });
+				return true;
+			}
+			case Call::GetRenderState:
+			{
+				const D3DRENDERSTATETYPE State = p.Get<D3DRENDERSTATETYPE>();
+				if (!p.IsValid())
+				{
+					return false;
+				}
+				DWORD Value;
+				Time([&]() { hr = pDevice->GetRenderState(State, &Value); });
+				return true;
+			}
+			case Call::BeginStateBlock:
+			{
+				Time([&]() { hr = pDevice->BeginStateBlock(); });
+				return p.IsValid();
+			}
+			case Call::EndStateBlock:
+			{
+				const DWORD Token = p.Get<DWORD>();
+				if (!p.IsValid())
+				{
+					return false;
+				}
+				DWORD NewToken = 0;
+				Time([&]() { hr = pDevice->EndStateBlock(&NewToken); });
+				if (SUCCEEDED(hr))
+				{
+					StateBlocks[Token] = NewToken;
+				}
+				return true;
+			}
+			case Call::ApplyStateBlock:
+			case Call::CaptureStateBlock:
+			case Call::DeleteStateBlock:
+			{
+				const DWORD Token = p.Get<DWORD>();
+				auto it = StateBlocks.find(Token);
+				if (it == StateBlocks.end() || !p.IsValid())
+				{
+					return false;
+				}
+				const DWORD NewToken = it->second;
+				if ((Call)r.Id == Call::ApplyStateBlock)
+				{
+					Time([&]() { hr = pDevice->ApplyStateBlock(NewToken); });
+				}
+				else if ((Call)r.Id == Call::CaptureStateBlock)
+				{
+					Time([&]() { hr = pDevice->CaptureStateBlock(NewToken); });
+				}
+				else
+				{
+					Time([&]() { hr = pDevice->DeleteStateBlock(NewToken); });
+					StateBlocks.erase(it);
+				}
+				return true;
+			}
+			case Call::CreateStateBlock:
+			{
+				const D3DSTATEBLOCKTYPE Type = p.Get<D3DSTATEBLOCKTYPE>();
+				const DWORD Token = p.Get<DWORD>();
+				if (!p.IsValid())
+				{
+					return false;
+				}
+				DWORD NewToken = 0;
+				Time([&]() { hr = pDevice->CreateStateBlock(Type, &NewToken); });
+				if (SUCCEEDED(hr))
+				{
+					StateBlocks[Token] = NewToken;
+				}
+				return true;
+			}
+			case Call::SetClipStatus:
+			{
+				D3DCLIPSTATUS8 Value;
+				const D3DCLIPSTATUS8 *pStatus = p.Ref(Value);
+				if (!p.IsValid())
+				{
+					return false;
+				}
+				Time([&]() { hr = pDevice->SetClipStatus(pStatus); });
+				return true;
+			}
+			case Call::GetClipStatus:
+			{
+				D3DCLIPSTATUS8 Status;
+				Time([&]() { hr = pDevice->GetClipStatus(&Status); });
+				return p.IsValid();
+			}
+			case Call::GetTexture:
+			{
+				const DWORD Stage = p.Get<DWORD>();
+				if (!p.IsValid())
+				{
+					return false;
+				}
+				IDirect3DBaseTexture8 *pTexture = nullptr;
+				Time([&]() { hr = pDevice->GetTexture(Stage, &pTexture); });
+				Release(pTexture);
+				return true;
+			}
+			case Call::SetTexture:
+			{
+				const DWORD Stage = p.Get<DWORD>();
+				IDirect3DBaseTexture8 *pTexture;
+				if (!FindTexture(p.Get<uint64_t>(), pTexture) || !p.IsValid())
+				{
+					return false;
+				}
+				Time([&]() { hr = pDevice->SetTexture(Stage, pTexture); });
+				return true;
+			}
+			case Call::GetTextureStageState:
+			{
+				const DWORD Stage = p.Get<DWORD>();
+				const D3DTEXTURESTAGESTATETYPE Type = p.Get<D3DTEXTURESTAGESTATETYPE>();
+				if (!p.IsValid())
+				{
+					return false;
+				}
+				DWORD Value;
+				Time([&]() { hr = pDevice->GetTextureStageState(Stage, Type, &Value); });
+				return true;
+			}
+			case Call::SetTextureStageState:
+			{
+				const DWORD Stage = p.Get<DWORD>();
+				const D3DTEXTURESTAGESTATETYPE Type = p.Get<D3DTEXTURESTAGESTATETYPE>();
+				const DWORD Value = p.Get<DWORD>();
+				if (!p.IsValid())
+				{
+					return false;
+				}
+				Time([&]() { hr = pDevice->SetTextureStageState(Stage, Type, Value); });
+				return true;
+			}
+			case Call::ValidateDevice:
+			{
+				DWORD Passes;
+				Time([&]() { hr = pDevice->ValidateDevice(&Passes); });
+				return p.IsValid();
+			}
+			case Call::GetInfo:
+			{
+				const DWORD DevInfoID = p.Get<DWORD>(), Size = p.Get<DWORD>();
+				if (!p.IsValid())
+				{
+					return false;
+				}
+				Scratch.assign(Size, 0);
+				Time([&]() { hr = pDevice->GetInfo(DevInfoID, Scratch.data(), Size); });
+				return true;
+			}
+			case Call::SetPaletteEntries:
+			{
+				const UINT Palette = p.Get<UINT>();
+				const void *pEntries;
+				if (!FindBlob(p.Get<uint64_t>(), pEntries) || !p.IsValid())
+				{
+					return false;
+				}
+				Time([&]() { hr = pDevice->SetPaletteEntries(Palette, static_cast<const PALETTEENTRY *>(pEntries)); });
+				return true;
+			}
+			case Call::GetPaletteEntries:
+			{
+				const UINT Palette = p.Get<UINT>();
+				if (!p.IsValid())
+				{
+					return false;
+				}
+				PALETTEENTRY Entries[256];
+				Time([&]() { hr = pDevice->GetPaletteEntries(Palette, Entries); });
+				return true;
+			}
+			case Call::SetCurrentTexturePalette:
+			{
+				const UINT Palette = p.Get<UINT>();
+				if (!p.IsValid())
+				{
+					return false;
+				}
+				Time([&]() { hr = pDevice->SetCurrentTexturePalette(Palette); });
+				return true;
+			}
+			case Call::GetCurrentTexturePalette:
+			{
+				UINT Palette;
+				Time([&]() { hr = pDevice->GetCurrentTexturePalette(&Palette); });
+				return p.IsValid();
+			}
+			case Call::DrawPrimitive:
+			{
+				const D3DPRIMITIVETYPE Type = p.Get<D3DPRIMITIVETYPE>();
+				const UINT StartVertex = p.Get<UINT>(), Count = p.Get<UINT>();
+				if (!p.IsValid())
+				{
+					return false;
+				}
+				Time([&]() { hr = pDevice->DrawPrimitive(Type, StartVertex, Count); });
+				return true;
+			}
+			case Call::DrawIndexedPrimitive:
+			{
+				const D3DPRIMITIVETYPE Type = p.Get<D3DPRIMITIVETYPE>();
+				const UINT MinIndex = p.Get<UINT>(), NumVertices = p.Get<UINT>(), StartIndex = p.Get<UINT>(), Count = p.Get<UINT>();
+				if (!p.IsValid())
+				{
+					return false;
+				}
+				Time([&]() { hr = pDevice->DrawIndexedPrimitive(Type, MinIndex, NumVertices, StartIndex, Count); });
+				return true;
+			}
+			case Call::DrawPrimitiveUP:
+			{
+				const D3DPRIMITIVETYPE Type = p.Get<D3DPRIMITIVETYPE>();
+				const UINT Count = p.Get<UINT>();
+				const uint64_t Hash = p.Get<uint64_t>();
+				const UINT Stride = p.Get<UINT>();
+				if (!p.IsValid())
+				{
+					return false;
+				}
+				const void *pVertices = UPVertices(Hash, 0, PrimitiveVertexCount(Type, Count) * Stride);
+				Time([&]() { hr = pDevice->DrawPrimitiveUP(Type, Count, pVertices, Stride); });
+				return true;
+			}
+			case Call::DrawIndexedPrimitiveUP:
+			{
+				const D3DPRIMITIVETYPE Type = p.Get<D3DPRIMITIVETYPE>();
+				const UINT MinIndex = p.Get<UINT>(), NumVertices = p.Get<UINT>(), Count = p.Get<UINT>();
+				const uint64_t IndexHash = p.Get<uint64_t>();
+				const D3DFORMAT Format = p.Get<D3DFORMAT>();
+				const uint64_t VertexHash = p.Get<uint64_t>();
+				const UINT Stride = p.Get<UINT>();
+				if (!p.IsValid())
+				{
+					return false;
+				}
+
+				// Lost indices all point at the first vertex, the recorded vertices start there
+				const UINT IndexSize = (Format == D3DFMT_INDEX32) ? 4 : 2;
+				const UINT IndexCount = PrimitiveVertexCount(Type, Count);
+				const void *pData;
+				uint32_t Size;
+				FindBlob(IndexHash, pData, &Size);
+				Indices.resize((size_t)IndexCount * IndexSize);
+				if (pData)
+				{
+					memcpy(Indices.data(), pData, std::min((size_t)Size, Indices.size()));
+				}
+				else
+				{
+					for (UINT x = 0; x < IndexCount; x++)
+					{
+						memcpy(Indices.data() + x * IndexSize, &MinIndex, IndexSize);
+					}
+				}
+				const void *pVertices = UPVertices(VertexHash, MinIndex * Stride, NumVertices * Stride);
+				Time([&]() { hr = pDevice->DrawIndexedPrimitiveUP(Type, MinIndex, NumVertices, Count, Indices.data(), Format, pVertices, Stride); });
+				return true;
+			}
+			case Call::ProcessVertices:
+			{
+				const UINT Source = p.Get<UINT>(), Dest = p.Get<UINT>(), Count = p.Get<UINT>();
+				IDirect3DVertexBuffer8 *pBuffer;
+				const bool Found = Find(p.Get<uint64_t>(), Kind::VertexBuffer, pBuffer);
+				const DWORD Flags = p.Get<DWORD>();
+				if (!Found || !pBuffer || !p.IsValid())
+				{
+					return false;
+				}
+				Time([&]() { hr = pDevice->ProcessVertices(Source, Dest, Count, pBuffer, Flags); });
+				return true;
+			}
+			case Call::CreateVertexShader:
+			{
+				const void *pDeclaration, *pFunction;
+				const bool Found = FindBlob(p.Get<uint64_t>(), pDeclaration) && FindBlob(p.Get<uint64_t>(), pFunction);
+				const DWORD Usage = p.Get<DWORD>(), Handle = p.Get<DWORD>();
+				if (!Found || !p.IsValid())
+				{
+					return false;
+				}
+				DWORD NewHandle = 0;
+				Time([&]() { hr = pDevice->CreateVertexShader(static_cast<const DWORD *>(pDeclaration), static_cast<const DWORD *>(pFunction), &NewHandle, Usage); });
+				if (SUCCEEDED(hr))
+				{
+					VertexShaders[Handle] = NewHandle;
+				}
+				return true;
+			}
+			case Call::SetVertexShader:
+			{
+				// Handles of shaders the trace did not create are FVF codes
+				const DWORD Handle = MapHandle(VertexShaders, p.Get<DWORD>());
+				if (!p.IsValid())
+				{
+					return false;
+				}
+				Time([&]() { hr = pDevice->SetVertexShader(Handle); });
+				return true;
+			}
+			case Call::GetVertexShader:
+			{
+				DWORD Handle;
+				Time([&]() { hr = pDevice->GetVertexShader(&Handle); });
+				return p.IsValid();
+			}
+			case Call::DeleteVertexShader:
+			{
+				const DWORD Handle = p.Get<DWORD>();
+				auto it = VertexShaders.find(Handle);
+				if (it == VertexShaders.end() || !p.IsValid())
+				{
+					return false;
+				}
+				const DWORD NewHandle = it->second;
+				Time([&]() { hr = pDevice->DeleteVertexShader(NewHandle); });
+				VertexShaders.erase(it);
+				return true;
+			}
+			case Call::SetVertexShaderConstant:
+			case Call::SetPixelShaderConstant:
+			{
+				const DWORD Register = p.Get<DWORD>();
+				const void *pData;
+				const bool Found = FindBlob(p.Get<uint64_t>(), pData);
+				const DWORD Count = p.Get<DWORD>();
+				if (!Found || !pData || !p.IsValid())
+				{
+					return false;
+				}
+				if ((Call)r.Id == Call::SetVertexShaderConstant)
+				{
+					Time([&]() { hr = pDevice->SetVertexShaderConstant(Register, pData, Count); });
+				}
+				else
+				{
+					Time([&]() { hr = pDevice->SetPixelShaderConstant(Register, pData, Count); });
+				}
+				return true;
+			}
+			case Call::GetVertexShaderConstant:
+			case Call::GetPixelShaderConstant:
+			{
+				const DWORD Register = p.Get<DWORD>(), Count = p.Get<DWORD>();
+				if (!p.IsValid())
+				{
+					return false;
+				}
+				Scratch.resize((size_t)Count * 4 * sizeof(float));
+				if ((Call)r.Id == Call::GetVertexShaderConstant)
+				{
+					Time([&]() { hr = pDevice->GetVertexShaderConstant(Register, Scratch.data(), Count); });
+				}
+				else
+				{
+					Time([&]() { hr = pDevice->GetPixelShaderConstant(Register, Scratch.data(), Count); });
+				}
+				return true;
+			}
+			case Call::GetVertexShaderDeclaration:
+			case Call::GetVertexShaderFunction:
+			case Call::GetPixelShaderFunction:
+			{
+				// Asks for the size only, the game's buffer is not known
+				const DWORD Handle = p.Get<DWORD>();
+				if (!p.IsValid())
+				{
+					return false;
+				}
+				DWORD Size = 0;
+				if ((Call)r.Id == Call::GetVertexShaderDeclaration)
+				{
+					const DWORD NewHandle = MapHandle(VertexShaders, Handle);
+					Time([&]() { hr = pDevice->GetVertexShaderDeclaration(NewHandle, nullptr, &Size); });
+				}
+				else if ((Call)r.Id == Call::GetVertexShaderFunction)
+				{
+					const DWORD NewHandle = MapHandle(VertexShaders, Handle);
+					Time([&]() { hr = pDevice->GetVertexShaderFunction(NewHandle, nullptr, &Size); });
+				}
+				else
+				{
+					const DWORD NewHandle = MapHandle(PixelShaders, Handle);
+					Time([&]() { hr = pDevice->GetPixelShaderFunction(NewHandle, nullptr, &Size); });
+				}
+				return true;
+			}
+			case Call::SetStreamSource:
+			{
+				const UINT Stream = p.Get<UINT>();
+				IDirect3DVertexBuffer8 *pBuffer;
+				const bool Found = Find(p.Get<uint64_t>(), Kind::VertexBuffer, pBuffer);
+				const UINT Stride = p.Get<UINT>();
+				if (!Found || !p.IsValid())
+				{
+					return false;
+				}
+				Time([&]() { hr = pDevice->SetStreamSource(Stream, pBuffer, Stride); });
+				return true;
+			}
+			case Call::GetStreamSource:
+			{
+				const UINT Stream = p.Get<UINT>();
+				if (!p.IsValid())
+				{
+					return false;
+				}
+				IDirect3DVertexBuffer8 *pBuffer = nullptr;
+				UINT Stride;
+				Time([&]() { hr = pDevice->GetStreamSource(Stream, &pBuffer, &Stride); });
+				Release(pBuffer);
+				return true;
+			}
+			case Call::SetIndices:
+			{
+				IDirect3DIndexBuffer8 *pBuffer;
+				const bool Found = Find(p.Get<uint64_t>(), Kind::IndexBuffer, pBuffer);
+				const UINT BaseVertex = p.Get<UINT>();
+				if (!Found || !p.IsValid())
+				{
+					return false;
+				}
+				Time([&]() { hr = pDevice->SetIndices(pBuffer, BaseVertex); });
+				return true;
+			}
+			case Call::GetIndices:
+			{
+				IDirect3DIndexBuffer8 *pBuffer = nullptr;
+				UINT BaseVertex;
+				Time([&]() { hr = pDevice->GetIndices(&pBuffer, &BaseVertex); });
+				Release(pBuffer);
+				return p.IsValid();
+			}
+			case Call::CreatePixelShader:
+			{
+				const void *pFunction;
+				const bool Found = FindBlob(p.Get<uint64_t>(), pFunction);
+				const DWORD Handle = p.Get<DWORD>();
+				if (!Found || !p.IsValid())
+				{
+					return false;
+				}
+				DWORD NewHandle = 0;
+				Time([&]() { hr = pDevice->CreatePixelShader(static_cast<const DWORD *>(pFunction), &NewHandle); });
+				if (SUCCEEDED(hr))
+				{
+					PixelShaders[Handle] = NewHandle;
+				}
+				return true;
+			}
+			case Call::SetPixelShader:
+			{
+				const DWORD Handle = MapHandle(PixelShaders, p.Get<DWORD>());
+				if (!p.IsValid())
+				{
+					return false;
+				}
+				Time([&]() { hr = pDevice->SetPixelShader(Handle); });
+				return true;
+			}
+			case Call::GetPixelShader:
+			{
+				DWORD Handle;
+				Time([&]() { hr = pDevice->GetPixelShader(&Handle); });
+				return p.IsValid();
+			}
+			case Call::DeletePixelShader:
+			{
+				const DWORD Handle = p.Get<DWORD>();
+				auto it = PixelShaders.find(Handle);
+				if (it == PixelShaders.end() || !p.IsValid())
+				{
+					return false;
+				}
+				const DWORD NewHandle = it->second;
+				Time([&]() { hr = pDevice->DeletePixelShader(NewHandle); });
+				PixelShaders.erase(it);
+				return true;
+			}
+			case Call::DrawRectPatch:
+			{
+				const UINT Handle = p.Get<UINT>();
+				const void *pSegments;
+				const bool Found = FindBlob(p.Get<uint64_t>(), pSegments);
+				D3DRECTPATCH_INFO Value;
+				const D3DRECTPATCH_INFO *pInfo = p.Ref(Value);
+				if (!Found || !p.IsValid())
+				{
+					return false;
+				}
+				Time([&]() { hr = pDevice->DrawRectPatch(Handle, static_cast<const float *>(pSegments), pInfo); });
+				return true;
+			}
+			case Call::DrawTriPatch:
+			{
+				const UINT Handle = p.Get<UINT>();
+				const void *pSegments;
+				const bool Found = FindBlob(p.Get<uint64_t>(), pSegments);
+				D3DTRIPATCH_INFO Value;
+				const D3DTRIPATCH_INFO *pInfo = p.Ref(Value);
+				if (!Found || !p.IsValid())
+				{
+					return false;
+				}
+				Time([&]() { hr = pDevice->DrawTriPatch(Handle, static_cast<const float *>(pSegments), pInfo); });
+				return true;
+			}
+			case Call::DeletePatch:
+			{
+				const UINT Handle = p.Get<UINT>();
+				if (!p.IsValid())
+				{
+					return false;
+				}
+				Time([&]() { hr = pDevice->DeletePatch(Handle); });
+				return true;
+			}
+			case Call::VertexBufferLock:
+			case Call::IndexBufferLock:
+			{
+				const bool Vertex = (Call)r.Id == Call::VertexBufferLock;
+				const uint64_t Id = p.Get<uint64_t>();
+				const UINT Offset = p.Get<UINT>(), Size = p.Get<UINT>();
+				const DWORD Flags = p.Get<DWORD>();
+				IDirect3DVertexBuffer8 *pVertexBuffer = nullptr;
+				IDirect3DIndexBuffer8 *pIndexBuffer = nullptr;
+				if (!(Vertex ? Find(Id, Kind::VertexBuffer, pVertexBuffer) && pVertexBuffer : Find(Id, Kind::IndexBuffer, pIndexBuffer) && pIndexBuffer) || !p.IsValid())
+				{
+					return false;
+				}
+				BYTE *pData = nullptr;
+				UINT Length;
+				if (Vertex)
+				{
+					Time([&]() { hr = pVertexBuffer->Lock(Offset, Size, &pData, Flags); });
+					D3DVERTEXBUFFER_DESC Desc;
+					pVertexBuffer->GetDesc(&Desc);
+					Length = Desc.Size;
+				}
+				else
+				{
+					Time([&]() { hr = pIndexBuffer->Lock(Offset, Size, &pData, Flags); });
+					D3DINDEXBUFFER_DESC Desc;
+					pIndexBuffer->GetDesc(&Desc);
+					Length = Desc.Size;
+				}
+				if (SUCCEEDED(hr))
+				{
+					Lock(Id, 0, pData, Size ? Size : Length - std::min(Offset, Length));
+				}
+				return true;
+			}
+			case Call::VertexBufferUnlock:
+			case Call::IndexBufferUnlock:
+			{
+				const bool Vertex = (Call)r.Id == Call::VertexBufferUnlock;
+				const uint64_t Id = p.Get<uint64_t>(), Hash = p.Get<uint64_t>();
+				IDirect3DVertexBuffer8 *pVertexBuffer = nullptr;
+				IDirect3DIndexBuffer8 *pIndexBuffer = nullptr;
+				if (!(Vertex ? Find(Id, Kind::VertexBuffer, pVertexBuffer) && pVertexBuffer : Find(Id, Kind::IndexBuffer, pIndexBuffer) && pIndexBuffer) || !p.IsValid())
+				{
+					return false;
+				}
+				Fill(Id, 0, Hash);
+				if (Vertex)
+				{
+					Time([&]() { hr = pVertexBuffer->Unlock(); });
+				}
+				else
+				{
+					Time([&]() { hr = pIndexBuffer->Unlock(); });
+				}
+				return true;
+			}
+			case Call::TextureLockRect:
+			{
+				IDirect3DTexture8 *pTexture;
+				const uint64_t Id = p.Get<uint64_t>();
+				const UINT Level = p.Get<UINT>();
+				RECT Value;
+				const RECT *pRect = p.Ref(Value);
+				const DWORD Flags = p.Get<DWORD>();
+				if (!Find(Id, Kind::Texture, pTexture) || !pTexture || !p.IsValid())
+				{
+					return false;
+				}
+				D3DLOCKED_RECT Locked;
+				Time([&]() { hr = pTexture->LockRect(Level, &Locked, pRect, Flags); });
+				D3DSURFACE_DESC Desc;
+				if (SUCCEEDED(hr) && SUCCEEDED(pTexture->GetLevelDesc(Level, &Desc)))
+				{
+					Lock(Id, Level, Locked.pBits, RectSize(Desc, Locked, pRect));
+				}
+				return true;
+			}
+			case Call::TextureUnlockRect:
+			{
+				IDirect3DTexture8 *pTexture;
+				const uint64_t Id = p.Get<uint64_t>();
+				const UINT Level = p.Get<UINT>();
+				const uint64_t Hash = p.Get<uint64_t>();
+				if (!Find(Id, Kind::Texture, pTexture) || !pTexture || !p.IsValid())
+				{
+					return false;
+				}
+				Fill(Id, Level, Hash);
+				Time([&]() { hr = pTexture->UnlockRect(Level); });
+				return true;
+			}
+			case Call::CubeTextureLockRect:
+			{
+				IDirect3DCubeTexture8 *pTexture;
+				const uint64_t Id = p.Get<uint64_t>();
+				const D3DCUBEMAP_FACES Face = p.Get<D3DCUBEMAP_FACES>();
+				const UINT Level = p.Get<UINT>();
+				RECT Value;
+				const RECT *pRect = p.Ref(Value);
+				const DWORD Flags = p.Get<DWORD>();
+				if (!Find(Id, Kind::CubeTexture, pTexture) || !pTexture || !p.IsValid())
+				{
+					return false;
+				}
+				D3DLOCKED_RECT Locked;
+				Time([&]() { hr = pTexture->LockRect(Face, Level, &Locked, pRect, Flags); });
+				D3DSURFACE_DESC Desc;
+				if (SUCCEEDED(hr) && SUCCEEDED(pTexture->GetLevelDesc(Level, &Desc)))
+				{
+					Lock(Id, Level | Face << 16, Locked.pBits, RectSize(Desc, Locked, pRect));
+				}
+				return true;
+			}
+			case Call::CubeTextureUnlockRect:
+			{
+				IDirect3DCubeTexture8 *pTexture;
+				const uint64_t Id = p.Get<uint64_t>();
+				const D3DCUBEMAP_FACES Face = p.Get<D3DCUBEMAP_FACES>();
+				const UINT Level = p.Get<UINT>();
+				const uint64_t Hash = p.Get<uint64_t>();
+				if (!Find(Id, Kind::CubeTexture, pTexture) || !pTexture || !p.IsValid())
+				{
+					return false;
+				}
+				Fill(Id, Level | Face << 16, Hash);
+				Time([&]() { hr = pTexture->UnlockRect(Face, Level); });
+				return true;
+			}
+			case Call::SurfaceLockRect:
+			{
+				IDirect3DSurface8 *pSurface;
+				const uint64_t Id = p.Get<uint64_t>();
+				RECT Value;
+				const RECT *pRect = p.Ref(Value);
+				const DWORD Flags = p.Get<DWORD>();
+				if (!Find(Id, Kind::Surface, pSurface) || !pSurface || !p.IsValid())
+				{
+					return false;
+				}
+				D3DLOCKED_RECT Locked;
+				Time([&]() { hr = pSurface->LockRect(&Locked, pRect, Flags); });
+				D3DSURFACE_DESC Desc;
+				if (SUCCEEDED(hr) && SUCCEEDED(pSurface->GetDesc(&Desc)))
+				{
+					Lock(Id, 0, Locked.pBits, RectSize(Desc, Locked, pRect));
+				}
+				return true;
+			}
+			case Call::SurfaceUnlockRect:
+			{
+				IDirect3DSurface8 *pSurface;
+				const uint64_t Id = p.Get<uint64_t>(), Hash = p.Get<uint64_t>();
+				if (!Find(Id, Kind::Surface, pSurface) || !pSurface || !p.IsValid())
+				{
+					return false;
+				}
+				Fill(Id, 0, Hash);
+				Time([&]() { hr = pSurface->UnlockRect(); });
+				return true;
+			}
+			case Call::VolumeTextureLockBox:
+			{
+				IDirect3DVolumeTexture8 *pTexture;
+				const uint64_t Id = p.Get<uint64_t>();
+				const UINT Level = p.Get<UINT>();
+				D3DBOX Value;
+				const D3DBOX *pBox = p.Ref(Value);
+				const DWORD Flags = p.Get<DWORD>();
+				if (!Find(Id, Kind::VolumeTexture, pTexture) || !pTexture || !p.IsValid())
+				{
+					return false;
+				}
+				D3DLOCKED_BOX Locked;
+				Time([&]() { hr = pTexture->LockBox(Level, &Locked, pBox, Flags); });
+				D3DVOLUME_DESC Desc;
+				if (SUCCEEDED(hr) && SUCCEEDED(pTexture->GetLevelDesc(Level, &Desc)))
+				{
+					Lock(Id, Level, Locked.pBits, BoxSize(Desc, Locked, pBox));
+				}
+				return true;
+			}
+			case Call::VolumeTextureUnlockBox:
+			{
+				IDirect3DVolumeTexture8 *pTexture;
+				const uint64_t Id = p.Get<uint64_t>();
+				const UINT Level = p.Get<UINT>();
+				const uint64_t Hash = p.Get<uint64_t>();
+				if (!Find(Id, Kind::VolumeTexture, pTexture) || !pTexture || !p.IsValid())
+				{
+					return false;
+				}
+				Fill(Id, Level, Hash);
+				Time([&]() { hr = pTexture->UnlockBox(Level); });
+				return true;
+			}
+			case Call::VolumeLockBox:
+			case Call::VolumeUnlockBox:
+			{
+				// Volumes only come from volume textures, which the trace does not follow
+				return false;
+			}
+			case Call::Destroy:
+			{
+				// Objects the trace did not create, like texture levels, are not counted
+				auto it = Objects.find(p.Get<uint64_t>());
+				if (it == Objects.end() || !p.IsValid())
+				{
+					return false;
+				}
+				IUnknown *pObject = it->second.pObject;
+				Objects.erase(it);
+				Time([&]() { pObject->Release(); });
+				return true;
+			}
+			default:
+				return false;
+			}
+		}
+	};
+
+	// Cost of reading the clock around a call, taken off every call
+	double TimerNs()
+	{
+		double Best = 1e9;
+		for (int Round = 0; Round < 10; Round++)
+		{
+			constexpr int Reads = 100000;
+			Clock::duration Total = Clock::duration::zero();
+			for (int x = 0; x < Reads; x++)
+			{
+				const Clock::time_point Start = Clock::now();
+				Total += Clock::now() - Start;
+			}
+			Best = std::min(Best, std::chrono::duration<double, std::nano>(Total).count() / Reads);
+		}
+		return Best;
+	}
+
+	void Report(const TraceFile& t, const char *Path, UINT Rounds, const RunStats& Direct, const RunStats& Wrapped, double Timer, bool Csv)
+	{
+		const double PerFrame = t.Frames ? 1.0 / t.Frames : 0.0;
+		auto Average = [](const RunStats& Stats, size_t x) { return Stats.Count[x] ? Stats.Ns[x] / Stats.Count[x] : 0.0; };
+
+		std::vector<size_t> Order;
+		uint64_t Calls = 0, Skipped = 0;
+		double DirectNs = 0.0, WrappedNs = 0.0;
+		for (size_t x = 0; x < CallCount; x++)
+		{
+			if (Wrapped.Count[x] || Wrapped.Skipped[x])
+			{
+				Order.push_back(x);
+			}
+			Calls += Wrapped.Count[x];
+			Skipped += Wrapped.Skipped[x];
+			DirectNs += Direct.Ns[x];
+			WrappedNs += Wrapped.Ns[x];
+		}
+		std::sort(Order.begin(), Order.end(), [&](size_t a, size_t b) { return Wrapped.Ns[a] - Direct.Ns[a] > Wrapped.Ns[b] - Direct.Ns[b]; });
+
+		if (Csv)
+		{
+			printf("call,count,per_frame,direct_ns,wrapped_ns,overhead_ns,skipped\n");
+			for (size_t x : Order)
+			{
+				printf("%s,%llu,%.2f,%.1f,%.1f,%.1f,%llu\n", CallNames[x], (unsigned long long)Wrapped.Count[x], Wrapped.Count[x] * PerFrame,
+					Average(Direct, x), Average(Wrapped, x), Average(Wrapped, x) - Average(Direct, x), (unsigned long long)Wrapped.Skipped[x]);
+			}
+			return;
+		}
+
+		printf("%s: %llu calls replayed, %llu skipped, %llu frames, best of %u rounds\n", Path, (unsigned long long)Calls, (unsigned long long)Skipped, (unsigned long long)t.Frames, Rounds);
+		printf("clock read: %.1f ns, taken off every call\n", Timer);
+		if (t.Frames)
+		{
+			printf("per frame: %.1f calls, %.2f us direct, %.2f us wrapped, %.2f us overhead\n", Calls * PerFrame, DirectNs * PerFrame / 1e3, WrappedNs * PerFrame / 1e3, (WrappedNs - DirectNs) * PerFrame / 1e3);
+		}
+		printf("overhead: %.1f ns per call\n", Calls ? (WrappedNs - DirectNs) / Calls : 0.0);
+
+		printf("\n%-32s %10s %10s %10s %10s %10s %8s\n", "call", "count", "per frame", "direct ns", "wrapped ns", "overhead", "skipped");
+		for (size_t x : Order)
+		{
+			printf("%-32s %10llu %10.1f %10.1f %10.1f %10.1f %8llu\n", CallNames[x], (unsigned long long)Wrapped.Count[x], Wrapped.Count[x] * PerFrame,
+				Average(Direct, x), Average(Wrapped, x), Average(Wrapped, x) - Average(Direct, x), (unsigned long long)Wrapped.Skipped[x]);
+		}
+	}
+
+	void ReportConfig(const char *Message)
+	{
+		fputs(Message, stderr);
+	}
+
+	bool LoadConfig(const char *Path, Config& config)
+	{
+		FILE *File = fopen(Path, "rb");
+		if (!File)
+		{
+			fprintf(stderr, "nullreplay: cannot open %s\n", Path);
+			return false;
+		}
+		std::vector<char> Data;
+		char Buffer[4096];
+		size_t Read;
+		while ((Read = fread(Buffer, 1, sizeof(Buffer), File)) != 0)
+		{
+			Data.insert(Data.end(), Buffer, Buffer + Read);
+		}
+		fclose(File);
+
+		ConfigParser::Parse(Data.data(), Data.size(), config, ReportConfig);
+		return true;
+	}
+
+	// Keeps the fastest round of each call type
+	void KeepBest(RunStats& Best, const RunStats& Round, bool First)
+	{
+		for (size_t x = 0; x < CallCount; x++)
+		{
+			if (First || Round.Ns[x] < Best.Ns[x])
+			{
+				Best.Ns[x] = Round.Ns[x];
+			}
+			Best.Count[x] = Round.Count[x];
+			Best.Skipped[x] = Round.Skipped[x];
+		}
+	}
+}
+
+int main(int argc, char **argv)
+{
+	const char *Path = nullptr;
+	const char *IniPath = nullptr;
+	bool Csv = false;
+	UINT Rounds = 5;
+	for (int x = 1; x < argc; x++)
+	{
+		const bool HasValue = x + 1 < argc;
+		if (!strcmp(argv[x], "-csv"))
+		{
+			Csv = true;
+		}
+		else if (!strcmp(argv[x], "-ini") && HasValue)
+		{
+			IniPath = argv[++x];
+		}
+		else if (!strcmp(argv[x], "-rounds") && HasValue)
+		{
+			Rounds = (UINT)strtoul(argv[++x], nullptr, 10);
+		}
+		else if (!Path && argv[x][0] != '-')
+		{
+			Path = argv[x];
+		}
+		else
+		{
+			Path = nullptr;
+			break;
+		}
+	}
+	if (!Path || !Rounds)
+	{
+		fprintf(stderr, "usage: nullreplay [-ini d3d8.ini] [-rounds N] [-csv] d3d8_trace.bin\n");
+		return 2;
+	}
+
+	Config config;
+	if (IniPath && !LoadConfig(IniPath, config))
+	{
+		return 1;
+	}
+	bFilterRedundantStates = config.FilterRedundantStates;
+	bVerifyShadowState = config.VerifyShadowState;
+	bBufferUPDraws = config.BufferUPDraws;
+	bMergeUPDraws = config.MergeUPDraws;
+	bOptimizeLockFlags = config.OptimizeLockFlags;
+	bRenameLockedBuffers = config.RenameLockedBuffers;
+	bDeduplicateTextures = config.DeduplicateTextures;
+
+	static TraceFile t;
+	if (!ReadTrace(Path, t))
+	{
+		return 1;
+	}
+
+	const double Timer = TimerNs();
+
+	// Both ways take turns going first, so a change in clock speed hits them alike
+	static RunStats Direct, Wrapped;
+	for (UINT Round = 0; Round < Rounds; Round++)
+	{
+		for (int Pass = 0; Pass < 2; Pass++)
+		{
+			const bool Wrap = (Pass == 1) != (Round % 2 == 1);
+			RunStats Stats;
+			{
+				Replayer Replay(t, Wrap, Timer);
+				Replay.Run(Stats);
+			}
+			KeepBest(Wrap ? Wrapped : Direct, Stats, Round == 0);
+		}
+	}
+
+	Report(t, Path, Rounds, Direct, Wrapped, Timer, Csv);
+	return 0;
+}
@@ -0,0 +1,4 @@
+#pragma once
+
+// d3d8types.h only declares its types for desktop applications
+#define WINAPI_FAMILY_PARTITION(Partitions) 1
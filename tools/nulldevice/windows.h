@@ -0,0 +1,191 @@
+#pragma once
+
+// The part of windows.h the wrapper sources and the DirectX 8 headers use,
+// so they build with g++ on Linux for nullreplay. Integer types keep their
+// Windows sizes, since trace payloads are stored with them. The APIs the
+// trace recorder writes files with fail, a replay never records.
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+
+#define WINAPI
+#define CALLBACK
+#define CONST const
+#define FAR
+#define NEAR
+#define WINVER 0x0601
+
+typedef int BOOL;
+typedef unsigned char BYTE;
+typedef int16_t SHORT;
+typedef uint16_t WORD, USHORT;
+typedef int32_t LONG, INT32;
+typedef uint32_t DWORD, ULONG, UINT32;
+typedef int INT;
+typedef unsigned int UINT;
+typedef float FLOAT;
+typedef int64_t LONGLONG;
+typedef uint64_t ULONGLONG;
+typedef int32_t HRESULT;
+typedef char CHAR;
+typedef wchar_t WCHAR;
+typedef void VOID;
+typedef void *PVOID, *LPVOID, *HANDLE;
+typedef const void *LPCVOID;
+typedef char *LPSTR;
+typedef const char *LPCSTR;
+typedef BYTE *LPBYTE;
+typedef DWORD *LPDWORD;
+typedef uintptr_t UINT_PTR, ULONG_PTR, DWORD_PTR, WPARAM;
+typedef intptr_t INT_PTR, LONG_PTR, LPARAM, LRESULT;
+
+#define TRUE 1
+#define FALSE 0
+#define MAX_PATH 260
+
+#define DECLARE_HANDLE(name) struct name##__ { int unused; }; typedef struct name##__ *name
+DECLARE_HANDLE(HWND);
+DECLARE_HANDLE(HDC);
+DECLARE_HANDLE(HMONITOR);
+DECLARE_HANDLE(HINSTANCE);
+typedef HINSTANCE HMODULE;
+#define HMONITOR_DECLARED
+
+typedef struct tagRECT
+{
+	LONG left;
+	LONG top;
+	LONG right;
+	LONG bottom;
+} RECT, *LPRECT;
+
+typedef struct tagPOINT
+{
+	LONG x;
+	LONG y;
+} POINT, *LPPOINT;
+
+typedef struct _RGNDATAHEADER
+{
+	DWORD dwSize;
+	DWORD iType;
+	DWORD nCount;
+	DWORD nRgnSize;
+	RECT rcBound;
+} RGNDATAHEADER;
+
+typedef struct _RGNDATA
+{
+	RGNDATAHEADER rdh;
+	char Buffer[1];
+} RGNDATA, *LPRGNDATA;
+
+typedef struct tagPALETTEENTRY
+{
+	BYTE peRed;
+	BYTE peGreen;
+	BYTE peBlue;
+	BYTE peFlags;
+} PALETTEENTRY, *LPPALETTEENTRY;
+
+typedef union _LARGE_INTEGER
+{
+	struct
+	{
+		DWORD LowPart;
+		LONG HighPart;
+	};
+	LONGLONG QuadPart;
+} LARGE_INTEGER;
+
+typedef struct _GUID
+{
+	uint32_t Data1;
+	uint16_t Data2;
+	uint16_t Data3;
+	uint8_t Data4[8];
+} GUID;
+
+#define SUCCEEDED(hr) (((HRESULT)(hr)) >= 0)
+#define FAILED(hr) (((HRESULT)(hr)) < 0)
+#define MAKE_HRESULT(sev, fac, code) ((HRESULT)(((uint32_t)(sev) << 31) | ((uint32_t)(fac) << 16) | ((uint32_t)(code))))
+#define S_OK ((HRESULT)0)
+#define S_FALSE ((HRESULT)1)
+#define E_NOTIMPL ((HRESULT)0x80004001)
+#define E_NOINTERFACE ((HRESULT)0x80004002)
+#define E_POINTER ((HRESULT)0x80004003)
+#define E_FAIL ((HRESULT)0x80004005)
+#define E_OUTOFMEMORY ((HRESULT)0x8007000E)
+#define E_INVALIDARG ((HRESULT)0x80070057)
+
+#define ZeroMemory(p, n) memset((p), 0, (n))
+#define _countof(a) (sizeof(a) / sizeof((a)[0]))
+
+template <size_t N, typename... A>
+int sprintf_s(char (&Buffer)[N], const char *Format, A... Args)
+{
+	return snprintf(Buffer, N, Format, Args...);
+}
+
+inline void OutputDebugStringA(const char *Message)
+{
+	fputs(Message, stderr);
+}
+
+inline LONG InterlockedIncrement(LONG volatile *p) { return __atomic_add_fetch(p, 1, __ATOMIC_SEQ_CST); }
+inline LONG InterlockedDecrement(LONG volatile *p) { return __atomic_sub_fetch(p, 1, __ATOMIC_SEQ_CST); }
+inline LONG InterlockedExchange(LONG volatile *p, LONG v) { return __atomic_exchange_n(p, v, __ATOMIC_SEQ_CST); }
+inline LONG InterlockedCompareExchange(LONG volatile *p, LONG v, LONG c) { __atomic_compare_exchange_n(p, &c, v, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST); return c; }
+
+// Slim reader/writer locks map onto pthread ones, which cost about the same uncontended
+typedef pthread_rwlock_t SRWLOCK;
+#define SRWLOCK_INIT PTHREAD_RWLOCK_INITIALIZER
+inline void AcquireSRWLockExclusive(SRWLOCK *p) { pthread_rwlock_wrlock(p); }
+inline void ReleaseSRWLockExclusive(SRWLOCK *p) { pthread_rwlock_unlock(p); }
+inline void AcquireSRWLockShared(SRWLOCK *p) { pthread_rwlock_rdlock(p); }
+inline void ReleaseSRWLockShared(SRWLOCK *p) { pthread_rwlock_unlock(p); }
+
+inline BOOL QueryPerformanceFrequency(LARGE_INTEGER *pFrequency)
+{
+	pFrequency->QuadPart = 1000000000;
+	return TRUE;
+}
+
+inline BOOL QueryPerformanceCounter(LARGE_INTEGER *pCounter)
+{
+	timespec Now;
+	clock_gettime(CLOCK_MONOTONIC, &Now);
+	pCounter->QuadPart = (LONGLONG)Now.tv_sec * 1000000000 + Now.tv_nsec;
+	return TRUE;
+}
+
+inline DWORD GetCurrentThreadId()
+{
+	static DWORD Next = 0;
+	static thread_local DWORD Id = __atomic_add_fetch(&Next, 1, __ATOMIC_RELAXED);
+	return Id;
+}
+
+// Trace recording, never started by a replay
+typedef DWORD (WINAPI *LPTHREAD_START_ROUTINE)(LPVOID);
+#define INVALID_HANDLE_VALUE ((HANDLE)(LONG_PTR)-1)
+#define GENERIC_WRITE 0x40000000
+#define FILE_SHARE_READ 0x00000001
+#define CREATE_ALWAYS 2
+#define FILE_ATTRIBUTE_NORMAL 0x00000080
+#define GET_MODULE_HANDLE_EX_FLAG_FROM_ADDRESS 0x00000004
+
+inline HANDLE CreateFileA(LPCSTR, DWORD, DWORD, void *, DWORD, DWORD, HANDLE) { return INVALID_HANDLE_VALUE; }
+inline BOOL WriteFile(HANDLE, LPCVOID, DWORD, LPDWORD pWritten, void *) { *pWritten = 0; return FALSE; }
+inline HANDLE CreateEventA(void *, BOOL, BOOL, LPCSTR) { return nullptr; }
+inline BOOL SetEvent(HANDLE) { return FALSE; }
+inline DWORD WaitForSingleObject(HANDLE, DWORD) { return 0; }
+inline BOOL CloseHandle(HANDLE) { return TRUE; }
+inline HANDLE CreateThread(void *, size_t, LPTHREAD_START_ROUTINE, LPVOID, DWORD, LPDWORD) { return nullptr; }
+inline BOOL GetModuleHandleExA(DWORD, LPCSTR, HMODULE *phModule) { *phModule = nullptr; return FALSE; }
+inline BOOL FreeLibrary(HMODULE) { return TRUE; }
+[[noreturn]] inline void FreeLibraryAndExitThread(HMODULE, DWORD) { pthread_exit(nullptr); }
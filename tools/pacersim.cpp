@@ -0,0 +1,303 @@
+/**
+* Copyright (C) 2020 Elisha Riedlinger
+*
+* This software is  provided 'as-is', without any express  or implied  warranty. In no event will the
+* authors be held liable for any damages arising from the use of this software.
+* Permission  is granted  to anyone  to use  this software  for  any  purpose,  including  commercial
+* applications, and to alter it and redistribute it freely, subject to the following restrictions:
+*
+*   1. The origin of this software must not be misrepresented; you must not claim that you  wrote the
+*      original  software. If you use this  software  in a product, an  acknowledgment in the product
+*      documentation would be appreciated but is not required.
+*   2. Altered source versions must  be plainly  marked as such, and  must not be  misrepresented  as
+*      being the original software.
+*   3. This notice may not be removed or altered from any source distribution.
+*/
+
+// Drives the frame pacing math of framepacer.h with a simulated clock, so
+// pacing accuracy and CPU cost can be compared without Windows or a GPU:
+//
+//   g++ -std=c++17 -O2 tools/pacersim.cpp -o pacersim
+//   cl /std:c++17 /O2 /EHsc tools\pacersim.cpp
+//
+// Each run renders frames that take a random amount of game work, then waits
+// for the next deadline of a FrameSchedule either with HybridPacer
+// (FPSLimitMode = 3) or with the Sleep(1) / Sleep(0) loop of
+// FPSLimitMode = 2. The timers oversleep by a seeded pseudo random amount,
+// so the same arguments always print the same numbers. CPU is the time
+// spent polling the clock, as a share of the whole run.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include <algorithm>
+#include "../source/framepacer.h"
+
+namespace
+{
+	constexpr int64_t Frequency = 10000000;		// QueryPerformanceFrequency on current Windows
+	constexpr int64_t PollTicks = 5;			// one clock read plus a pause, 0.5 us
+
+	int64_t Us(double Value)
+	{
+		return (int64_t)(Value * Frequency / 1000000.0);
+	}
+
+	double ToUs(int64_t Ticks)
+	{
+		return (double)Ticks * 1000000.0 / Frequency;
+	}
+
+	// xorshift64*, deterministic across compilers and platforms
+	struct Random
+	{
+		uint64_t State;
+
+		uint64_t Next()
+		{
+			State ^= State >> 12;
+			State ^= State << 25;
+			State ^= State >> 27;
+			return State * 0x2545F4914F6CDD1Dull;
+		}
+		int64_t Between(int64_t Low, int64_t High)
+		{
+			return Low + (int64_t)(Next() % (uint64_t)(High - Low + 1));
+		}
+		bool Chance(uint32_t PerMille)
+		{
+			return Next() % 1000 < PerMille;
+		}
+	};
+
+	enum class Timer { HighResolution, Legacy };
+
+	// The clock interface HybridPacer::WaitUntil expects
+	struct SimClock
+	{
+		Timer Kind;
+		Random Rng;
+		int64_t Time = 0;
+		int64_t BusyTicks = 0;
+
+		int64_t Now()
+		{
+			return Time;
+		}
+		void Sleep(int64_t Ticks)
+		{
+			Time += Ticks;
+			if (Kind == Timer::Legacy)
+			{
+				// Wakes on the next 1 ms scheduler tick
+				const int64_t Tick = Us(1000);
+				Time = (Time + Tick - 1) / Tick * Tick;
+				Time += Rng.Between(0, Us(100));
+			}
+			else
+			{
+				Time += Rng.Chance(5) ? Rng.Between(Us(300), Us(1000)) : Rng.Between(Us(20), Us(150));
+			}
+		}
+		void Spin()
+		{
+			Time += PollTicks;
+			BusyTicks += PollTicks;
+		}
+	};
+
+	enum class Method { Hybrid, SleepLoop };
+
+	struct Options
+	{
+		int Frames = 3600;
+		double Fps = 60.0;
+		int CatchUp = 0;
+		int ResyncMs = 250;
+		uint64_t Seed = 1;
+		bool Stalls = false;
+	};
+
+	struct Result
+	{
+		double AchievedFps;
+		double MeanLateUs;
+		double P99LateUs;
+		double MaxLateUs;
+		double CpuShare;
+		double FinalMarginUs;
+		int Skipped;			// frames released a period or more after their deadline
+	};
+
+	// FrameLimiter::Sync_SLP, called until it releases the frame
+	int64_t SleepLoop(SimClock& Clock, const FrameSchedule& Schedule)
+	{
+		for (;;)
+		{
+			const int64_t Now = Clock.Now();
+			const int64_t Remaining = Schedule.Deadline() - Now;
+			if (Remaining <= 0)
+			{
+				return Now;
+			}
+			if (Remaining > Frequency / 500)
+			{
+				Clock.Sleep(Us(1000));
+			}
+			else
+			{
+				Clock.Spin();
+			}
+		}
+	}
+
+	Result Run(const Options& Opt, Method How, Timer Kind)
+	{
+		SimClock Clock = { Kind, { Opt.Seed * 0x9E3779B97F4A7C15ull + 1 } };
+		Random Work = { Opt.Seed * 0xD1B54A32D192ED03ull + 1 };
+
+		HybridPacer Pacer;
+		Pacer.Init(Frequency);
+		FrameSchedule Schedule;
+		const double Period = Frequency / Opt.Fps;
+		Schedule.Init(Clock.Now(), Period, Opt.CatchUp, Frequency * Opt.ResyncMs / 1000);
+
+		std::vector<int64_t> Late;
+		Late.reserve(Opt.Frames);
+		int64_t First = 0, Last = 0;
+		int Skipped = 0;
+		for (int x = 0; x < Opt.Frames; x++)
+		{
+			const int64_t Deadline = Schedule.Deadline();
+			const int64_t Release = (How == Method::Hybrid) ? Pacer.WaitUntil(Clock, Deadline) : SleepLoop(Clock, Schedule);
+			Schedule.Advance(Release);
+
+			if (Release - Deadline < (int64_t)Period)
+			{
+				Late.push_back(Release - Deadline);
+			}
+			else
+			{
+				Skipped++;
+			}
+			if (x == 0)
+			{
+				First = Release;
+			}
+			Last = Release;
+
+			// Game work up to the next Present, with a loading screen and a hitch when asked for
+			int64_t Busy = Work.Between((int64_t)(Period * 0.25), (int64_t)(Period * 0.75));
+			if (Opt.Stalls && x == Opt.Frames / 3)
+			{
+				Busy = Frequency * 2;
+			}
+			else if (Opt.Stalls && x % 500 == 250)
+			{
+				Busy = (int64_t)(Period * 2.5);
+			}
+			Clock.Time += Busy;
+		}
+
+		Result r = {};
+		std::sort(Late.begin(), Late.end());
+		if (!Late.empty())
+		{
+			double Sum = 0.0;
+			for (int64_t Value : Late)
+			{
+				Sum += (double)Value;
+			}
+			r.MeanLateUs = ToUs((int64_t)(Sum / Late.size()));
+			r.P99LateUs = ToUs(Late[Late.size() * 99 / 100]);
+			r.MaxLateUs = ToUs(Late.back());
+		}
+		r.AchievedFps = (Last > First) ? (Opt.Frames - 1) * (double)Frequency / (double)(Last - First) : 0.0;
+		r.CpuShare = Clock.Time ? (double)Clock.BusyTicks / (double)Clock.Time : 0.0;
+		r.FinalMarginUs = (How == Method::Hybrid) ? ToUs(Pacer.GetMargin()) : 0.0;
+		r.Skipped = Skipped;
+		return r;
+	}
+}
+
+int main(int argc, char **argv)
+{
+	Options Opt;
+	bool Csv = false;
+	for (int x = 1; x < argc; x++)
+	{
+		const bool HasValue = x + 1 < argc;
+		if (!strcmp(argv[x], "-csv"))
+		{
+			Csv = true;
+		}
+		else if (!strcmp(argv[x], "-stalls"))
+		{
+			Opt.Stalls = true;
+		}
+		else if (!strcmp(argv[x], "-frames") && HasValue)
+		{
+			Opt.Frames = atoi(argv[++x]);
+		}
+		else if (!strcmp(argv[x], "-fps") && HasValue)
+		{
+			Opt.Fps = atof(argv[++x]);
+		}
+		else if (!strcmp(argv[x], "-catchup") && HasValue)
+		{
+			Opt.CatchUp = atoi(argv[++x]);
+		}
+		else if (!strcmp(argv[x], "-resync") && HasValue)
+		{
+			Opt.ResyncMs = atoi(argv[++x]);
+		}
+		else if (!strcmp(argv[x], "-seed") && HasValue)
+		{
+			Opt.Seed = strtoull(argv[++x], nullptr, 10);
+		}
+		else
+		{
+			fprintf(stderr, "usage: pacersim [-frames N] [-fps F] [-catchup K] [-resync MS] [-seed S] [-stalls] [-csv]\n");
+			return 2;
+		}
+	}
+	if (Opt.Frames < 2 || Opt.Fps <= 0.0)
+	{
+		fprintf(stderr, "pacersim: needs at least two frames and a positive frame rate\n");
+		return 2;
+	}
+
+	static const struct { const char *Name; Method How; Timer Kind; } Runs[] = {
+		{ "hybrid, high resolution timer", Method::Hybrid, Timer::HighResolution },
+		{ "hybrid, 1 ms timer", Method::Hybrid, Timer::Legacy },
+		{ "sleep loop, high resolution timer", Method::SleepLoop, Timer::HighResolution },
+		{ "sleep loop, 1 ms timer", Method::SleepLoop, Timer::Legacy },
+	};
+
+	if (Csv)
+	{
+		printf("run,fps,mean_late_us,p99_late_us,max_late_us,cpu_share,margin_us,skipped\n");
+	}
+	else
+	{
+		printf("%d frames at %.3f fps, catch-up %d, resync %d ms, seed %llu%s\n\n", Opt.Frames, Opt.Fps, Opt.CatchUp, Opt.ResyncMs,
+			(unsigned long long)Opt.Seed, Opt.Stalls ? ", with stalls" : "");
+		printf("%-36s %10s %10s %10s %10s %6s %10s %8s\n", "run", "fps", "late us", "p99 us", "max us", "cpu", "margin us", "skipped");
+	}
+
+	for (const auto& Entry : Runs)
+	{
+		const Result r = Run(Opt, Entry.How, Entry.Kind);
+		if (Csv)
+		{
+			printf("%s,%.4f,%.1f,%.1f,%.1f,%.4f,%.1f,%d\n", Entry.Name, r.AchievedFps, r.MeanLateUs, r.P99LateUs, r.MaxLateUs, r.CpuShare, r.FinalMarginUs, r.Skipped);
+		}
+		else
+		{
+			printf("%-36s %10.4f %10.1f %10.1f %10.1f %5.1f%% %10.1f %8d\n", Entry.Name, r.AchievedFps, r.MeanLateUs, r.P99LateUs, r.MaxLateUs,
+				100.0 * r.CpuShare, r.FinalMarginUs, r.Skipped);
+		}
+	}
+	return 0;
+}
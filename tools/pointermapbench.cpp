@@ -0,0 +1,208 @@
+/**
+* Copyright (C) 2020 Elisha Riedlinger
+*
+* This software is  provided 'as-is', without any express  or implied  warranty. In no event will the
+* authors be held liable for any damages arising from the use of this software.
+* Permission  is granted  to anyone  to use  this software  for  any  purpose,  including  commercial
+* applications, and to alter it and redistribute it freely, subject to the following restrictions:
+*
+*   1. The origin of this software must not be misrepresented; you must not claim that you  wrote the
+*      original  software. If you use this  software  in a product, an  acknowledgment in the product
+*      documentation would be appreciated but is not required.
+*   2. Altered source versions must  be plainly  marked as such, and  must not be  misrepresented  as
+*      being the original software.
+*   3. This notice may not be removed or altered from any source distribution.
+*/
+
+// Times the PointerMap of AddressLookupTable against std::unordered_map, the
+// map it replaced, with 1k, 10k and 100k live wrappers. The wrapper DLL is a
+// 32-bit build, so measure it that way:
+//
+//   g++ -std=c++17 -O2 -m32 tools/pointermapbench.cpp -o pointermapbench
+//   cl /std:c++17 /O2 /EHsc tools\pointermapbench.cpp      (x86 developer prompt)
+//
+// Keys are heap blocks of the size of runtime objects, allocated in one go
+// and looked up in a shuffled order, so neither table gets the benefit of
+// walking memory in allocation order. "find" is a lookup of a live key, as in
+// FindAddress; "churn" erases a key and inserts it again, as a wrapper that
+// is released and created anew does.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+#include <chrono>
+#include "../source/PointerMap.h"
+
+namespace
+{
+	// xorshift64*, so a seed always gives the same order
+	struct Random
+	{
+		uint64_t State;
+
+		uint64_t Next()
+		{
+			State ^= State >> 12;
+			State ^= State << 25;
+			State ^= State >> 27;
+			return State * 0x2545F4914F6CDD1Dull;
+		}
+	};
+
+	struct Result
+	{
+		double FindNs;
+		double ChurnNs;
+	};
+
+	template <typename F>
+	double TimeNs(size_t Operations, F Run)
+	{
+		const auto Start = std::chrono::steady_clock::now();
+		Run();
+		const auto Elapsed = std::chrono::steady_clock::now() - Start;
+		return (double)std::chrono::duration_cast<std::chrono::nanoseconds>(Elapsed).count() / (double)Operations;
+	}
+
+	// Keeps the compiler from dropping lookups whose result is unused
+	volatile uintptr_t Sink;
+
+	Result RunPointerMap(const std::vector<void *>& Keys, const std::vector<void *>& Order, size_t Lookups)
+	{
+		PointerMap<void *> Map;
+		for (void *Key : Keys)
+		{
+			Map.Insert(Key, Key);
+		}
+
+		Result r;
+		r.FindNs = TimeNs(Lookups, [&]()
+		{
+			uintptr_t Sum = 0;
+			for (size_t x = 0; x < Lookups; x++)
+			{
+				Sum += (uintptr_t)*Map.Find(Order[x % Order.size()]);
+			}
+			Sink = Sum;
+		});
+		r.ChurnNs = TimeNs(Order.size(), [&]()
+		{
+			for (void *Key : Order)
+			{
+				Map.Erase(Key);
+				Map.Insert(Key, Key);
+			}
+		});
+		return r;
+	}
+
+	Result RunUnorderedMap(const std::vector<void *>& Keys, const std::vector<void *>& Order, size_t Lookups)
+	{
+		std::unordered_map<void *, void *> Map;
+		for (void *Key : Keys)
+		{
+			Map[Key] = Key;
+		}
+
+		Result r;
+		r.FindNs = TimeNs(Lookups, [&]()
+		{
+			uintptr_t Sum = 0;
+			for (size_t x = 0; x < Lookups; x++)
+			{
+				Sum += (uintptr_t)Map.find(Order[x % Order.size()])->second;
+			}
+			Sink = Sum;
+		});
+		r.ChurnNs = TimeNs(Order.size(), [&]()
+		{
+			for (void *Key : Order)
+			{
+				Map.erase(Key);
+				Map[Key] = Key;
+			}
+		});
+		return r;
+	}
+}
+
+int main(int argc, char **argv)
+{
+	bool Csv = false;
+	size_t Lookups = 20000000;
+	uint64_t Seed = 1;
+	for (int x = 1; x < argc; x++)
+	{
+		const bool HasValue = x + 1 < argc;
+		if (!strcmp(argv[x], "-csv"))
+		{
+			Csv = true;
+		}
+		else if (!strcmp(argv[x], "-lookups") && HasValue)
+		{
+			Lookups = strtoull(argv[++x], nullptr, 10);
+		}
+		else if (!strcmp(argv[x], "-seed") && HasValue)
+		{
+			Seed = strtoull(argv[++x], nullptr, 10);
+		}
+		else
+		{
+			fprintf(stderr, "usage: pointermapbench [-lookups N] [-seed S] [-csv]\n");
+			return 2;
+		}
+	}
+	if (!Lookups)
+	{
+		fprintf(stderr, "pointermapbench: needs at least one lookup\n");
+		return 2;
+	}
+
+	if (Csv)
+	{
+		printf("entries,pointermap_find_ns,unordered_map_find_ns,pointermap_churn_ns,unordered_map_churn_ns\n");
+	}
+	else
+	{
+		printf("%u-bit build, %zu lookups per size, seed %llu\n\n", (unsigned)(sizeof(void *) * 8), Lookups, (unsigned long long)Seed);
+		printf("%10s %12s %12s %12s %12s\n", "entries", "flat find", "std find", "flat churn", "std churn");
+	}
+
+	static const size_t Sizes[] = { 1000, 10000, 100000 };
+	for (size_t Count : Sizes)
+	{
+		Random Rng = { Seed * 0x9E3779B97F4A7C15ull + Count };
+
+		// Runtime objects are a few hundred bytes each
+		std::vector<void *> Keys(Count);
+		for (void *&Key : Keys)
+		{
+			Key = malloc(96 + (size_t)(Rng.Next() % 416));
+		}
+		std::vector<void *> Order = Keys;
+		for (size_t x = Order.size() - 1; x > 0; x--)
+		{
+			std::swap(Order[x], Order[(size_t)(Rng.Next() % (x + 1))]);
+		}
+
+		const Result Flat = RunPointerMap(Keys, Order, Lookups);
+		const Result Std = RunUnorderedMap(Keys, Order, Lookups);
+		if (Csv)
+		{
+			printf("%zu,%.2f,%.2f,%.2f,%.2f\n", Count, Flat.FindNs, Std.FindNs, Flat.ChurnNs, Std.ChurnNs);
+		}
+		else
+		{
+			printf("%10zu %9.2f ns %9.2f ns %9.2f ns %9.2f ns\n", Count, Flat.FindNs, Std.FindNs, Flat.ChurnNs, Std.ChurnNs);
+		}
+
+		for (void *Key : Keys)
+		{
+			free(Key);
+		}
+	}
+	return 0;
+}
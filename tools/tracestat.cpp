@@ -0,0 +1,291 @@
+/**
+* Copyright (C) 2020 Elisha Riedlinger
+*
+* This software is  provided 'as-is', without any express  or implied  warranty. In no event will the
+* authors be held liable for any damages arising from the use of this software.
+* Permission  is granted  to anyone  to use  this software  for  any  purpose,  including  commercial
+* applications, and to alter it and redistribute it freely, subject to the following restrictions:
+*
+*   1. The origin of this software must not be misrepresented; you must not claim that you  wrote the
+*      original  software. If you use this  software  in a product, an  acknowledgment in the product
+*      documentation would be appreciated but is not required.
+*   2. Altered source versions must  be plainly  marked as such, and  must not be  misrepresented  as
+*      being the original software.
+*   3. This notice may not be removed or altered from any source distribution.
+*/
+
+// Reads a d3d8_trace.bin written with RecordTrace = 1 and prints per call
+// statistics. Only the portable trace layout is used, so this builds anywhere:
+//
+//   g++ -std=c++17 -O2 tools/tracestat.cpp -o tracestat
+//   cl /std:c++17 /O2 /EHsc tools\tracestat.cpp
+//
+// The gap of a call is the time from it to the next call on the same thread.
+// That covers the wrapper, the runtime and the driver, but also whatever the
+// game did in between, so it shows where a frame's time goes around the API
+// and is not the cost of the wrapper itself; compare two traces taken with an
+// optimization on and off for that. Blobs are skipped so recording overhead
+// is left out.
+
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+#include <algorithm>
+#include "../source/TraceFormat.h"
+
+using namespace Trace;
+
+namespace
+{
+	struct CallStats
+	{
+		uint64_t Count = 0;
+		uint64_t PayloadBytes = 0;
+		uint64_t Ticks = 0;				// sum of the gaps to the next call on the thread
+		uint64_t TimedCount = 0;		// calls that had a next call
+	};
+
+	struct ThreadState
+	{
+		uint32_t Thread;
+		uint16_t LastCall;
+		int64_t LastTime;
+	};
+
+	struct TraceStats
+	{
+		int64_t Frequency = 0;
+		uint64_t Chunks = 0;
+		uint64_t Blobs = 0;
+		uint64_t BlobBytes = 0;
+		CallStats Calls[(size_t)Call::Count];
+		std::vector<int64_t> CallTimes;			// every call except blobs and destroys
+		std::vector<int64_t> PresentTimes;
+		std::vector<ThreadState> Threads;
+	};
+
+	bool IsCall(uint16_t Id)
+	{
+		return Id != (uint16_t)Call::Blob && Id != (uint16_t)Call::Destroy;
+	}
+
+	ThreadState& GetThread(TraceStats& t, uint32_t Thread)
+	{
+		for (ThreadState& State : t.Threads)
+		{
+			if (State.Thread == Thread)
+			{
+				return State;
+			}
+		}
+		t.Threads.push_back({ Thread, (uint16_t)Call::Count, 0 });
+		return t.Threads.back();
+	}
+
+	bool ReadChunk(TraceStats& t, uint32_t Thread, const uint8_t *Data, size_t Size)
+	{
+		ThreadState& State = GetThread(t, Thread);
+
+		size_t Offset = 0;
+		while (Offset < Size)
+		{
+			RecordHeader Header;
+			if (Size - Offset < sizeof(Header))
+			{
+				return false;
+			}
+			memcpy(&Header, Data + Offset, sizeof(Header));
+			Offset += sizeof(Header);
+			if (Header.Call >= (uint16_t)Call::Count || Size - Offset < Header.Size)
+			{
+				return false;
+			}
+			Offset += Header.Size;
+
+			if (Header.Call == (uint16_t)Call::Blob)
+			{
+				t.Blobs++;
+				t.BlobBytes += Header.Size - sizeof(uint64_t);
+				continue;
+			}
+
+			CallStats& Stats = t.Calls[Header.Call];
+			Stats.Count++;
+			Stats.PayloadBytes += Header.Size;
+
+			if (State.LastCall < (uint16_t)Call::Count && Header.Time >= State.LastTime)
+			{
+				t.Calls[State.LastCall].Ticks += Header.Time - State.LastTime;
+				t.Calls[State.LastCall].TimedCount++;
+			}
+			State.LastCall = Header.Call;
+			State.LastTime = Header.Time;
+
+			if (IsCall(Header.Call))
+			{
+				t.CallTimes.push_back(Header.Time);
+			}
+			if (Header.Call == (uint16_t)Call::Present)
+			{
+				t.PresentTimes.push_back(Header.Time);
+			}
+		}
+		return true;
+	}
+
+	bool ReadTrace(const char *Path, TraceStats& t)
+	{
+		FILE *File = fopen(Path, "rb");
+		if (!File)
+		{
+			fprintf(stderr, "tracestat: cannot open %s\n", Path);
+			return false;
+		}
+
+		bool Result = false;
+		FileHeader Header;
+		if (fread(&Header, sizeof(Header), 1, File) != 1 || Header.Magic != FileMagic)
+		{
+			fprintf(stderr, "tracestat: %s is not a trace\n", Path);
+		}
+		else if (Header.Version != FileVersion || Header.Frequency <= 0)
+		{
+			fprintf(stderr, "tracestat: %s has version %u, expected %u\n", Path, Header.Version, FileVersion);
+		}
+		else
+		{
+			t.Frequency = Header.Frequency;
+
+			std::vector<uint8_t> Buffer;
+			ChunkHeader Chunk;
+			Result = true;
+			while (fread(&Chunk, sizeof(Chunk), 1, File) == 1)
+			{
+				Buffer.resize(Chunk.Size);
+				if (fread(Buffer.data(), 1, Chunk.Size, File) != Chunk.Size || !ReadChunk(t, Chunk.Thread, Buffer.data(), Chunk.Size))
+				{
+					// A process that did not shut down cleanly leaves a partial chunk
+					fprintf(stderr, "tracestat: %s is truncated after %llu chunks\n", Path, (unsigned long long)t.Chunks);
+					break;
+				}
+				t.Chunks++;
+			}
+		}
+
+		fclose(File);
+		return Result;
+	}
+
+	double ToNs(const TraceStats& t, double Ticks)
+	{
+		return Ticks * 1e9 / (double)t.Frequency;
+	}
+
+	void Report(TraceStats& t, const char *Path, bool Csv)
+	{
+		// Threads record into separate chunks, so sort before splitting calls into frames
+		std::sort(t.CallTimes.begin(), t.CallTimes.end());
+		std::sort(t.PresentTimes.begin(), t.PresentTimes.end());
+
+		// A frame is the calls after one Present up to and including the next
+		const size_t Frames = t.PresentTimes.size() > 1 ? t.PresentTimes.size() - 1 : 0;
+		uint64_t FrameCalls = 0, MinCalls = UINT64_MAX, MaxCalls = 0;
+		int64_t MaxFrameTicks = 0;
+		for (size_t x = 0; x < Frames; x++)
+		{
+			auto First = std::upper_bound(t.CallTimes.begin(), t.CallTimes.end(), t.PresentTimes[x]);
+			auto Last = std::upper_bound(First, t.CallTimes.end(), t.PresentTimes[x + 1]);
+			const uint64_t Calls = (uint64_t)(Last - First);
+			FrameCalls += Calls;
+			MinCalls = std::min(MinCalls, Calls);
+			MaxCalls = std::max(MaxCalls, Calls);
+			MaxFrameTicks = std::max(MaxFrameTicks, t.PresentTimes[x + 1] - t.PresentTimes[x]);
+		}
+
+		std::vector<size_t> Order;
+		uint64_t TotalCalls = 0, TotalTicks = 0;
+		for (size_t x = 0; x < (size_t)Call::Count; x++)
+		{
+			if (t.Calls[x].Count)
+			{
+				Order.push_back(x);
+			}
+			if (IsCall((uint16_t)x))
+			{
+				TotalCalls += t.Calls[x].Count;
+			}
+			TotalTicks += t.Calls[x].Ticks;
+		}
+		std::sort(Order.begin(), Order.end(), [&t](size_t a, size_t b) { return t.Calls[a].Ticks > t.Calls[b].Ticks; });
+
+		const double PerFrame = Frames ? 1.0 / Frames : 0.0;
+
+		if (Csv)
+		{
+			printf("call,count,per_frame,payload_bytes,gap_ns,total_gap_ms,share\n");
+			for (size_t x : Order)
+			{
+				const CallStats& Stats = t.Calls[x];
+				printf("%s,%llu,%.2f,%llu,%.1f,%.3f,%.4f\n", CallNames[x], (unsigned long long)Stats.Count, Stats.Count * PerFrame,
+					(unsigned long long)Stats.PayloadBytes, Stats.TimedCount ? ToNs(t, (double)Stats.Ticks / Stats.TimedCount) : 0.0,
+					ToNs(t, (double)Stats.Ticks) / 1e6, TotalTicks ? (double)Stats.Ticks / TotalTicks : 0.0);
+			}
+			return;
+		}
+
+		const double Span = t.CallTimes.empty() ? 0.0 : ToNs(t, (double)(t.CallTimes.back() - t.CallTimes.front())) / 1e9;
+		printf("%s: %llu calls in %.2f s, %zu threads, %llu chunks\n", Path, (unsigned long long)TotalCalls, Span, t.Threads.size(), (unsigned long long)t.Chunks);
+		printf("blobs: %llu, %.2f MB\n", (unsigned long long)t.Blobs, t.BlobBytes / (1024.0 * 1024.0));
+		if (Frames)
+		{
+			const double FrameNs = ToNs(t, (double)(t.PresentTimes.back() - t.PresentTimes.front())) / Frames;
+			printf("frames: %zu, %.2f ms average, %.2f ms longest\n", Frames, FrameNs / 1e6, ToNs(t, (double)MaxFrameTicks) / 1e6);
+			printf("calls per frame: %.1f average, %llu min, %llu max\n", FrameCalls * PerFrame, (unsigned long long)MinCalls, (unsigned long long)MaxCalls);
+		}
+		else
+		{
+			printf("frames: fewer than two Present calls were recorded\n");
+		}
+
+		printf("\n%-32s %10s %10s %12s %10s %10s %6s\n", "call", "count", "per frame", "payload KB", "gap ns", "gap ms", "share");
+		for (size_t x : Order)
+		{
+			const CallStats& Stats = t.Calls[x];
+			printf("%-32s %10llu %10.1f %12.1f %10.0f %10.2f %5.1f%%\n", CallNames[x], (unsigned long long)Stats.Count, Stats.Count * PerFrame,
+				Stats.PayloadBytes / 1024.0, Stats.TimedCount ? ToNs(t, (double)Stats.Ticks / Stats.TimedCount) : 0.0,
+				ToNs(t, (double)Stats.Ticks) / 1e6, TotalTicks ? 100.0 * Stats.Ticks / TotalTicks : 0.0);
+		}
+	}
+}
+
+int main(int argc, char **argv)
+{
+	const char *Path = nullptr;
+	bool Csv = false;
+	for (int x = 1; x < argc; x++)
+	{
+		if (!strcmp(argv[x], "-csv"))
+		{
+			Csv = true;
+		}
+		else if (!Path)
+		{
+			Path = argv[x];
+		}
+	}
+
+	if (!Path)
+	{
+		fprintf(stderr, "usage: tracestat [-csv] d3d8_trace.bin\n"
+			"gap ns is the time from a call to the next one on its thread, game work included, not the wrapper overhead\n");
+		return 2;
+	}
+
+	static TraceStats t;
+	if (!ReadTrace(Path, t))
+	{
+		return 1;
+	}
+	Report(t, Path, Csv);
+	return 0;
+}
@@ -0,0 +1,176 @@
+/**
+* Copyright (C) 2020 Elisha Riedlinger
+*
+* This software is  provided 'as-is', without any express  or implied  warranty. In no event will the
+* authors be held liable for any damages arising from the use of this software.
+* Permission  is granted  to anyone  to use  this software  for  any  purpose,  including  commercial
+* applications, and to alter it and redistribute it freely, subject to the following restrictions:
+*
+*   1. The origin of this software must not be misrepresented; you must not claim that you  wrote the
+*      original  software. If you use this  software  in a product, an  acknowledgment in the product
+*      documentation would be appreciated but is not required.
+*   2. Altered source versions must  be plainly  marked as such, and  must not be  misrepresented  as
+*      being the original software.
+*   3. This notice may not be removed or altered from any source distribution.
+*/
+
+// Sends a storm of messages to a window with AlwaysOnTop set, through the
+// window state checks CustomWndProc makes before every message, and prints
+// the cost per message. Windows only, as 32-bit as the wrapper:
+//
+//   cl /std:c++17 /O2 /EHsc tools\wndprocbench.cpp user32.lib      (x86 developer prompt)
+//
+// Three windows get the same messages with SendMessage, which calls the
+// window procedure directly on the thread that owns the window:
+//   plain    DefWindowProc only, the cost of the message itself
+//   before   IsTopLevelWindow and GetWindowLong on every message, as
+//            CustomWndProc did before WindowStateTracker
+//   after    WindowStateTracker, as CustomWndProc does now
+// The activation and focus filtering CustomWndProc does afterwards is the
+// same either way and does not apply to these messages, so it is left out.
+
+#include <windows.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../source/WindowStateTracker.h"
+
+namespace
+{
+	LRESULT WINAPI PlainProc(HWND hWnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
+	{
+		return DefWindowProcA(hWnd, uMsg, wParam, lParam);
+	}
+
+	LRESULT WINAPI BeforeProc(HWND hWnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
+	{
+		if (_fnIsTopLevelWindow(hWnd))
+		{
+			if ((GetWindowLong(hWnd, GWL_EXSTYLE) & WS_EX_TOPMOST) == 0)
+				SetWindowPos(hWnd, HWND_TOPMOST, 0, 0, 0, 0, SWP_NOACTIVATE | SWP_NOMOVE | SWP_NOSIZE);
+		}
+		return DefWindowProcA(hWnd, uMsg, wParam, lParam);
+	}
+
+	LRESULT WINAPI AfterProc(HWND hWnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
+	{
+		if (uMsg == WM_NCDESTROY)
+		{
+			WindowStateTracker::Forget(hWnd);
+			return DefWindowProcA(hWnd, uMsg, wParam, lParam);
+		}
+
+		WindowStateTracker::Update(hWnd, uMsg, wParam, lParam);
+		const WindowStateTracker::State state = WindowStateTracker::Get(hWnd);
+
+		if (state.TopLevel)
+		{
+			if (!state.Topmost)
+				WindowStateTracker::MakeTopmost(hWnd);
+		}
+		return DefWindowProcA(hWnd, uMsg, wParam, lParam);
+	}
+
+	HWND CreateBenchWindow(const char *ClassName, WNDPROC Proc)
+	{
+		WNDCLASSA WndClass = {};
+		WndClass.lpfnWndProc = Proc;
+		WndClass.hInstance = GetModuleHandleA(nullptr);
+		WndClass.lpszClassName = ClassName;
+		if (!RegisterClassA(&WndClass))
+		{
+			return nullptr;
+		}
+		return CreateWindowExA(0, ClassName, ClassName, WS_OVERLAPPEDWINDOW, 0, 0, 640, 480, nullptr, nullptr, WndClass.hInstance, nullptr);
+	}
+
+	// Mouse movement and hit testing, the bulk of what a game window receives
+	double StormNs(HWND hWnd, UINT Messages, const LARGE_INTEGER& Frequency)
+	{
+		LARGE_INTEGER Start, End;
+		QueryPerformanceCounter(&Start);
+		for (UINT x = 0; x < Messages; x++)
+		{
+			const LPARAM Position = MAKELPARAM(x % 640, (x / 640) % 480);
+			SendMessageA(hWnd, (x & 1) ? WM_NCHITTEST : WM_MOUSEMOVE, 0, Position);
+		}
+		QueryPerformanceCounter(&End);
+		return (double)(End.QuadPart - Start.QuadPart) * 1000000000.0 / (double)Frequency.QuadPart / (double)Messages;
+	}
+}
+
+int main(int argc, char **argv)
+{
+	bool Csv = false;
+	UINT Messages = 1000000;
+	UINT Rounds = 5;
+	for (int x = 1; x < argc; x++)
+	{
+		const bool HasValue = x + 1 < argc;
+		if (!strcmp(argv[x], "-csv"))
+		{
+			Csv = true;
+		}
+		else if (!strcmp(argv[x], "-messages") && HasValue)
+		{
+			Messages = (UINT)strtoul(argv[++x], nullptr, 10);
+		}
+		else if (!strcmp(argv[x], "-rounds") && HasValue)
+		{
+			Rounds = (UINT)strtoul(argv[++x], nullptr, 10);
+		}
+		else
+		{
+			fprintf(stderr, "usage: wndprocbench [-messages N] [-rounds N] [-csv]\n");
+			return 2;
+		}
+	}
+	if (!Messages || !Rounds)
+	{
+		fprintf(stderr, "wndprocbench: needs at least one message and one round\n");
+		return 2;
+	}
+
+	const HWND Plain = CreateBenchWindow("wndprocbench_plain", PlainProc);
+	const HWND Before = CreateBenchWindow("wndprocbench_before", BeforeProc);
+	const HWND After = CreateBenchWindow("wndprocbench_after", AfterProc);
+	if (!Plain || !Before || !After)
+	{
+		fprintf(stderr, "wndprocbench: cannot create the windows (error %lu)\n", GetLastError());
+		return 1;
+	}
+
+	LARGE_INTEGER Frequency;
+	QueryPerformanceFrequency(&Frequency);
+
+	if (Csv)
+	{
+		printf("round,plain_ns,before_ns,after_ns\n");
+	}
+	else
+	{
+		printf("%u-bit build, %u messages per window and round\n\n", (UINT)(sizeof(void *) * 8), Messages);
+		printf("%6s %12s %12s %12s %14s %14s\n", "round", "plain", "before", "after", "before extra", "after extra");
+	}
+
+	// Interleaved, so a change in clock speed hits all three alike
+	for (UINT Round = 0; Round < Rounds; Round++)
+	{
+		const double PlainNs = StormNs(Plain, Messages, Frequency);
+		const double BeforeNs = StormNs(Before, Messages, Frequency);
+		const double AfterNs = StormNs(After, Messages, Frequency);
+		if (Csv)
+		{
+			printf("%u,%.2f,%.2f,%.2f\n", Round, PlainNs, BeforeNs, AfterNs);
+		}
+		else
+		{
+			printf("%6u %9.2f ns %9.2f ns %9.2f ns %11.2f ns %11.2f ns\n", Round, PlainNs, BeforeNs, AfterNs, BeforeNs - PlainNs, AfterNs - PlainNs);
+		}
+	}
+
+	DestroyWindow(Plain);
+	DestroyWindow(Before);
+	DestroyWindow(After);
+	return 0;
+}